@@ -29,14 +29,30 @@ public:
 	virtual bool Control(FX3Command command, uint32_t data) = 0;
 	virtual bool Control(FX3Command command, uint64_t data) = 0;
 	virtual bool SetArgument(uint16_t index, uint16_t value) = 0;
+	// The writes between BeginBatch and CommitBatch may be sent without waiting for
+	// each other, in order. CommitBatch returns once they all completed, false if one failed
+	virtual void BeginBatch() {}
+	virtual bool CommitBatch() { return true; }
 	virtual bool GetHardwareInfo(uint32_t* data) = 0;
 	virtual bool ReadDebugTrace(uint8_t* pdata, uint8_t len) = 0;
-	virtual void StartStream(ringbuffer<int16_t>& input) = 0;
+	// Size every USB transfer (input block) must be a multiple of, 0 if unknown
+	virtual uint32_t GetTransferGranularity() = 0;
+	// numofblock transfers in flight, adapted up to maxnumofblock when it is larger
+	virtual void StartStream(ringbuffer<int16_t>& input, int numofblock, int maxnumofblock = 0) = 0;
 	virtual void StopStream() = 0;
+	// Number of transfers currently in flight
+	virtual uint32_t GetTransferDepth() = 0;
+	// Number of transfers which failed since StartStream
+	virtual uint32_t GetTransferErrors() { return 0; }
+	// Scheduling of the USB thread, applied by the next StartStream
+	virtual void SetThreadConfig(const sddc_thread_config_t& config) { usb_thread_config = config; }
 	virtual bool Enumerate(unsigned char& idx, char* lbuf) = 0;
 	virtual size_t GetDeviceListLength() = 0;
 	virtual bool GetDevice(unsigned char &idx, char *name, size_t name_len, char *serial, size_t serial_len) = 0;
 	virtual vector<SDDC::DeviceItem> GetDeviceList() = 0;
+
+protected:
+	sddc_thread_config_t usb_thread_config = {};
 };
 
 extern "C" fx3class* CreateUsbHandler();
@@ -22,6 +22,7 @@
 
 
 
+#include <algorithm>
 #include <stdio.h>
 #include <string.h>
 #include <chrono>
@@ -30,6 +31,8 @@
 #include "config.h"
 #include "../Interface.h"
 #include "fft_mt_r2iq.h"
+#include "thread_config.h"
+#include "backend/backend.h"
 #include "PScope_uti.h"
 #include "pffft/pf_mixer.h"
 
@@ -54,13 +57,16 @@ void RadioHandler::OnDataPacket()
 			if (!streamRunning)
 				break;
 
+			const auto start = chrono::steady_clock::now();
 			if (fc != 0.0f)
 			{
 				std::unique_lock<std::mutex> lk(fc_mutex);
 				shift_limited_unroll_C_sse_inp_c((complexf*)buf, len_iq, stateFineTune);
 			}
+			quantizer.Convert((void*)buf, len_iq);
 
-			callbackIQ(callbackIQContext, buf, len_iq);
+			callbackIQ(callbackIQContext, buf, len_iq, iq_buffer.getReadTimestamp());
+			delivery_ns += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
 
 			iq_buffer.ReadDone();
 			count_iq_samples += len_iq;
@@ -72,10 +78,11 @@ void RadioHandler::OnDataPacket()
 			if (!streamRunning)
 				break;
 
-			callbackReal(callbackRealContext, buf, len_real);
+			const auto start = chrono::steady_clock::now();
+			callbackReal(callbackRealContext, buf, len_real, real_buffer.getReadTimestamp());
+			delivery_ns += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
 
 			real_buffer.ReadDone();
-			count_real_samples += len_real;
 		}
 	}
 }
@@ -89,19 +96,36 @@ void RadioHandler::OnDataPacket()
 RadioHandler::RadioHandler():
 	DbgPrintFX3(nullptr),
 	GetConsoleIn(nullptr),
+	stream_config(GetDefaultStreamConfig()),
 	hardware(new DummyRadio(nullptr)),
 	fc(0.0f)
 	
 {
 	TracePrintln(TAG, "");
 
-	fx3 = CreateUsbHandler();
+	fx3 = CreateFx3Backend(nullptr);
+	if (fx3 == nullptr)
+	{
+		WarnPrintln(TAG, "Invalid %s, using the USB device", SDDC_BACKEND_ENV);
+		fx3 = CreateUsbHandler();
+	}
 	stateFineTune = new shift_limited_unroll_C_sse_data_t();
 }
 
-sddc_err_t RadioHandler::Init(uint8_t dev_index)
+/**
+ * @brief Open the SDR and allocate the stream buffers
+ * 
+ * @param[in] dev_index The index of the SDR to use
+ * @param[in] config The stream geometry to use, `nullptr` to keep the current one
+ *   (see RadioHandler::SetStreamConfig)
+ * 
+ * \retval ERR_SUCCESS
+ * \retval ERR_FX3_OPEN_FAILED
+ * \retval ERR_BUFFER_SIZE_INVALID
+ */
+sddc_err_t RadioHandler::Init(uint8_t dev_index, const sddc_stream_config_t* config)
 {
-	TracePrintln(TAG, "%d", dev_index);
+	TracePrintln(TAG, "%d, %p", dev_index, config);
 
 	if(!fx3->Open(dev_index))
 	{
@@ -152,26 +176,194 @@ sddc_err_t RadioHandler::Init(uint8_t dev_index)
 		break;
 	}
 
+	// Sent at once, the setters only queue the writes
+	hardware->BeginBatch();
 	sddc_err_t ret = hardware->SetRFMode(HFMODE);
+	if(ret == ERR_SUCCESS) ret = hardware->SetADCSampleRate(DEFAULT_ADC_FREQ);
+	sddc_err_t commit = hardware->Commit();
 	if(ret != ERR_SUCCESS) return ret;
-
-	ret = hardware->SetADCSampleRate(DEFAULT_ADC_FREQ);
-	if(ret != ERR_SUCCESS) return ret;
+	if(commit != ERR_SUCCESS) return commit;
 
 	DebugPrintln(TAG, "Detected radio : %s, firmware %x", hardware->GetName(), devFirmware);
 
-	real_buffer.setBlockSize(transferSamples);
+	if (r2iqCntrl == nullptr)
+		this->r2iqCntrl = new fft_mt_r2iq();
+
+	// Now that the device is open, the geometry can be checked against the USB endpoint
+	return SetStreamConfig(config ? *config : stream_config);
+}
+
+sddc_stream_config_t RadioHandler::GetDefaultStreamConfig()
+{
+	sddc_stream_config_t config;
+	config.transfer_size = transferSize;
+	config.concurrent_transfers = concurrentTransfers;
+	config.max_concurrent_transfers = maxConcurrentTransfers;
+	config.ring_blocks = ringBlocks;
+	return config;
+}
+
+/**
+ * @brief Change the size of the USB transfers and of the ring buffers
+ * 
+ * The stream must be stopped. Before RadioHandler::Init, the geometry
+ * is only stored and gets checked against the device when it is opened.
+ * 
+ * @param[in] config New geometry. `transfer_size` must be a multiple of the
+ *   USB bulk granularity (max_packet_size * (max_burst + 1), 16384 at USB 3)
+ *   and hold at least one r2iq FFT
+ * 
+ * \retval ERR_SUCCESS
+ * \retval ERR_STREAM_RUNNING
+ * \retval ERR_BUFFER_SIZE_INVALID
+ */
+sddc_err_t RadioHandler::SetStreamConfig(const sddc_stream_config_t& config)
+{
+	TracePrintln(TAG, "%u, %u, %u", config.transfer_size, config.concurrent_transfers, config.ring_blocks);
+
+	if (streamRunning)
+		return ERR_STREAM_RUNNING;
+
+	if (config.transfer_size % sizeof(int16_t) != 0 ||
+		config.transfer_size / sizeof(int16_t) < (uint32_t)BASE_FFT_SIZE ||
+		config.transfer_size > MAX_TRANSFER_SIZE)
+	{
+		WarnPrintln(TAG, "Invalid transfer size %u", config.transfer_size);
+		return ERR_BUFFER_SIZE_INVALID;
+	}
+
+	uint32_t granularity = fx3->GetTransferGranularity();
+	if (granularity != 0 && config.transfer_size % granularity != 0)
+	{
+		WarnPrintln(TAG, "Transfer size %u is not a multiple of %u", config.transfer_size, granularity);
+		return ERR_BUFFER_SIZE_INVALID;
+	}
+
+	if (config.concurrent_transfers < 1 || config.concurrent_transfers > MAX_CONCURRENT_TRANSFERS ||
+		(config.max_concurrent_transfers != 0 &&
+		 (config.max_concurrent_transfers < config.concurrent_transfers || config.max_concurrent_transfers > MAX_CONCURRENT_TRANSFERS)) ||
+		config.ring_blocks < MIN_RING_BLOCKS || config.ring_blocks > MAX_RING_BLOCKS)
+	{
+		WarnPrintln(TAG, "Invalid transfer count %u or ring size %u", config.concurrent_transfers, config.ring_blocks);
+		return ERR_BUFFER_SIZE_INVALID;
+	}
+
+	// The USB transfers are copied into the ring, keep enough room for all of them
+	if (config.ring_blocks <= config.concurrent_transfers / 2)
+		WarnPrintln(TAG, "Ring of %u blocks is small for %u transfers in flight", config.ring_blocks, config.concurrent_transfers);
+
+	stream_config = config;
+	DebugPrintln(TAG, "Stream config: transfer size %u, %u transfers, %u ring blocks",
+		config.transfer_size, config.concurrent_transfers, config.ring_blocks);
+
+	// Not initialized yet: applied by Init
+	if (r2iqCntrl == nullptr)
+		return ERR_SUCCESS;
+
+	const int samples = stream_config.transfer_size / sizeof(int16_t);
+
+	real_buffer.setBlockCount(stream_config.ring_blocks);
+	real_buffer.setBlockSize(samples);
 
 	// May be improved : r2iq assumes that the output buffer has half
 	// the size of the input buffer (due to real to complex conversion)
-	iq_buffer.setBlockSize(transferSamples/2);
+	iq_buffer.setBlockCount(stream_config.ring_blocks);
+	iq_buffer.setBlockSize(samples / 2);
 
-	this->r2iqCntrl = new fft_mt_r2iq();
 	r2iqCntrl->Init(hardware->getGain(), &real_buffer, &iq_buffer);
 
 	return ERR_SUCCESS;
 }
 
+/**
+ * @brief Replace the USB device by another source of ADC samples
+ * 
+ * Must be called before RadioHandler::Init. By default, the backend is taken
+ * from the SDDC_BACKEND environment variable, and is the USB device when it is not set.
+ * 
+ * \code
+ *  // Stream a capture as fast as the DSP can process it
+ *  radio_handler.SetBackend("replay,file=capture.wav,speed=max");
+ *  radio_handler.Init(0);
+ * \endcode
+ * 
+ * @param[in] spec The backend and its options, see CreateFx3Backend
+ * 
+ * \retval ERR_SUCCESS
+ * \retval ERR_BACKEND_INVALID
+ */
+sddc_err_t RadioHandler::SetBackend(const char* spec)
+{
+	TracePrintln(TAG, "%s", spec);
+
+	if (r2iqCntrl != nullptr)
+		return ERR_BACKEND_INVALID;
+
+	fx3class* backend = CreateFx3Backend(spec);
+	if (backend == nullptr)
+		return ERR_BACKEND_INVALID;
+
+	delete fx3;
+	fx3 = backend;
+	fx3->SetThreadConfig(thread_config[SDDC_THREAD_USB]);
+
+	return ERR_SUCCESS;
+}
+
+/**
+ * @brief Set the scheduling of one of the driver threads
+ * 
+ * The thread gets a real time priority (SCHED_FIFO) and/or is pinned to a set of
+ * CPUs the next time the stream starts. Every thread is also named after its role
+ * ("sddc-usb", "sddc-r2iq", "sddc-delivery", "sddc-stats").
+ * 
+ * \code
+ *  // USB polling on CPU 2 at priority 80, r2iq on CPU 3 at priority 70
+ *  radio_handler.SetThreadConfig(SDDC_THREAD_USB,  { 80, 1 << 2 });
+ *  radio_handler.SetThreadConfig(SDDC_THREAD_R2IQ, { 70, 1 << 3 });
+ * \endcode
+ * 
+ * \retval ERR_SUCCESS
+ * \retval ERR_THREAD_CONFIG_INVALID
+ */
+sddc_err_t RadioHandler::SetThreadConfig(sddc_thread_role_t role, const sddc_thread_config_t& config)
+{
+	TracePrintln(TAG, "%d, %d, %llx", role, config.priority, (unsigned long long)config.cpu_mask);
+
+	if ((unsigned)role >= SDDC_THREAD_ROLE_COUNT || !sddc_thread_config_valid(config))
+		return ERR_THREAD_CONFIG_INVALID;
+
+	thread_config[role] = config;
+
+	if (role == SDDC_THREAD_USB)
+		fx3->SetThreadConfig(config);
+	else if (role == SDDC_THREAD_R2IQ && r2iqCntrl)
+		r2iqCntrl->setThreadConfig(config);
+
+	return ERR_SUCCESS;
+}
+
+/**
+ * @brief Convert the samples on the workers shared by all the devices of the process
+ * 
+ * By default each device converts its samples on its own r2iq thread. With several
+ * devices, the shared workers (one per core, see r2iq_pool) avoid having more
+ * busy threads than cores. Applied the next time the stream starts.
+ * 
+ * \retval ERR_SUCCESS
+ * \retval ERR_STREAM_RUNNING
+ */
+sddc_err_t RadioHandler::SetSharedProcessing(bool shared)
+{
+	TracePrintln(TAG, "%s", shared ? "true" : "false");
+
+	if (streamRunning)
+		return ERR_STREAM_RUNNING;
+
+	shared_processing = shared;
+	return ERR_SUCCESS;
+}
+
 RadioHandler::~RadioHandler()
 {
 	TracePrintln(TAG, "");
@@ -182,7 +374,17 @@ RadioHandler::~RadioHandler()
 	delete fx3;
 }
 
-sddc_err_t RadioHandler::AttachReal(void (*callback)(void*context, const int16_t*, uint32_t), void *context)
+/**
+ * @brief Set the function receiving the real samples
+ * 
+ * The callback gets the samples of one block and the time of the first one, in ns
+ * since the Unix epoch: the stream position converted with the ADC rate, anchored
+ * on the host clock (CLOCK_REALTIME) when the USB transfers complete.
+ * 0 means the time is unknown.
+ * 
+ * \retval ERR_SUCCESS
+ */
+sddc_err_t RadioHandler::AttachReal(void (*callback)(void*context, const int16_t*, uint32_t, int64_t), void *context)
 {
 	this->callbackReal = callback;
 	this->callbackRealContext = context;
@@ -190,7 +392,17 @@ sddc_err_t RadioHandler::AttachReal(void (*callback)(void*context, const int16_t
 	return ERR_SUCCESS;
 }
 
-sddc_err_t RadioHandler::AttachIQ(void (*callback)(void*context, const sddc_complex_t*, uint32_t), void *context)
+/**
+ * @brief Set the function receiving the IQ samples
+ * 
+ * The timestamp of a block is the time of the input signal its first sample stands
+ * for: the decimation and the group delay of the r2iq filter are accounted for
+ * (see RadioHandler::AttachReal for the time base). With a CS16 or CS8 format
+ * (see RadioHandler::SetIQFormat), the samples are integers despite the pointer type.
+ * 
+ * \retval ERR_SUCCESS
+ */
+sddc_err_t RadioHandler::AttachIQ(void (*callback)(void*context, const sddc_complex_t*, uint32_t, int64_t), void *context)
 {
 	this->callbackIQ = callback;
 	this->callbackIQContext = context;
@@ -222,6 +434,36 @@ sddc_err_t RadioHandler::SetDecimation(uint8_t decimate)
 	return ERR_SUCCESS;
 }
 
+/**
+ * @brief Set the format of the IQ samples given to the application
+ * 
+ * The r2iq output is CF32. For CS16 or CS8, every block is converted in place
+ * (see iq_quantizer) by the thread taking it, right before the callback or
+ * RadioHandler::AcquireIQ: the pointers they give then point to interleaved int16
+ * or int8 I and Q, and RadioHandler::ReadIQ copies them as such. The length of a
+ * block stays in samples. Applied right away, the stream must be stopped.
+ * 
+ * @param[in] format Output format
+ * @param[in] scale Factor applied to the float samples before rounding, 0 for the
+ *   full scale of the format (1.0 gives 32767 in CS16, 127 in CS8)
+ * @param[in] dither Add a triangular dither of +-1 LSB before rounding
+ * 
+ * \retval ERR_SUCCESS
+ * \retval ERR_STREAM_RUNNING
+ * \retval ERR_FORMAT_INVALID
+ */
+sddc_err_t RadioHandler::SetIQFormat(sddc_iq_format_t format, float scale, bool dither)
+{
+	TracePrintln(TAG, "%d, %f, %s", format, scale, dither ? "true" : "false");
+
+	if (streamRunning)
+		return ERR_STREAM_RUNNING;
+
+	if (!quantizer.Configure(format, scale, dither))
+		return ERR_FORMAT_INVALID;
+
+	return ERR_SUCCESS;
+}
 
 /**
  * @brief Start the SDR and processing functions
@@ -239,8 +481,6 @@ sddc_err_t RadioHandler::Start(bool convert_r2iq)
 	sddc_err_t ret = Stop();
 	if(ret != ERR_SUCCESS) return ret;
 
-	streamRunning = true;
-
 	// SDR starts sending frames
 	ret = hardware->StartStream();
 	if(ret != ERR_SUCCESS) return ret;
@@ -248,16 +488,38 @@ sddc_err_t RadioHandler::Start(bool convert_r2iq)
 	//iq_buffer.setBlockSize(EXT_BLOCKLEN * sizeof(float));
 
 	r2iqEnabled = convert_r2iq;
+	r2iqCntrl->setSampleRate(GetADCSampleRate());
+	r2iqCntrl->setThreadConfig(thread_config[SDDC_THREAD_R2IQ]);
+	r2iqCntrl->setSharedPool(shared_processing);
 	if(r2iqEnabled) r2iqCntrl->TurnOn();
+	else real_buffer.Start();
+
+	{
+		std::lock_guard<std::mutex> lk(pull_mutex);
+		pull_block = nullptr;
+	}
+	real_full_base = real_buffer.getFullCount();
+	iq_full_base = iq_buffer.getFullCount();
+	pull_ns_per_real = 1.0e9 / GetADCSampleRate();
+	pull_ns_per_iq = 2 * pull_ns_per_real * r2iqCntrl->getRatio();
+
+	// Only now that the rings run may the pull thread take blocks
+	streamRunning = true;
 
 	// Driver starts receiving frames
-	fx3->StartStream(real_buffer/*, QUEUE_SIZE*/);
+	fx3->StartStream(real_buffer, stream_config.concurrent_transfers, stream_config.max_concurrent_transfers);
 
-	submit_thread = std::thread([this]() {
-		this->OnDataPacket();
-	});
+	// In pull mode the application takes the blocks itself
+	if(!pull_mode)
+	{
+		submit_thread = std::thread([this]() {
+			sddc_thread_apply(SDDC_THREAD_DELIVERY, thread_config[SDDC_THREAD_DELIVERY]);
+			this->OnDataPacket();
+		});
+	}
 
 	show_stats_thread = std::thread([this](void*) {
+		sddc_thread_apply(SDDC_THREAD_STATS, thread_config[SDDC_THREAD_STATS]);
 		this->CaculateStats();
 	}, nullptr);
 
@@ -273,15 +535,28 @@ sddc_err_t RadioHandler::Stop()
 	{
 		streamRunning = false; // now waits for threads
 
-		r2iqCntrl->TurnOff();
+		// Wakes up the delivery thread, r2iq owns the buffers when it is running
+		if(r2iqEnabled) r2iqCntrl->TurnOff();
+		else real_buffer.Stop();
 
-		fx3->StopStream();
+		// Waits for a pull thread inside AcquireIQ (the stopped rings woke it up),
+		// and drops the block it holds: releasing it is a no-op from now on
+		{
+			std::lock_guard<std::mutex> lk(pull_mutex);
+			pull_block = nullptr;
+		}
 
+		// Before the USB stream goes: the stats thread reads its counters
 		show_stats_thread.join(); //first to be joined
 		DbgPrintf("show_stats_thread join2");
 
-		submit_thread.join();
-		DbgPrintf("submit_thread join1");
+		fx3->StopStream();
+
+		if(submit_thread.joinable())
+		{
+			submit_thread.join();
+			DbgPrintf("submit_thread join1");
+		}
 
 		sddc_err_t ret = hardware->StopStream(); // SDR stops sending frames
 		if(ret != ERR_SUCCESS) return ret;
@@ -289,6 +564,303 @@ sddc_err_t RadioHandler::Stop()
 	return ERR_SUCCESS;
 }
 
+/**
+ * @brief Leave the samples in the ring buffer for the application to take
+ * 
+ * In pull mode no delivery thread is started and the callbacks are not called:
+ * the application takes the blocks from its own thread, without copy, with
+ * RadioHandler::AcquireIQ and RadioHandler::ReleaseIQ (RadioHandler::AcquireReal and
+ * RadioHandler::ReleaseReal when r2iq is off), or copies any number of IQ samples
+ * with RadioHandler::ReadIQ. As with a slow callback, the samples are dropped at the
+ * USB side when the application does not keep up. Applied the next time the stream starts.
+ * 
+ * \code
+ *  radio_handler.SetPullMode(true);
+ *  radio_handler.Start(true);
+ *  while (radio_handler.AcquireIQ(&data, &length, &timestamp, 1000) == ERR_SUCCESS)
+ *  {
+ *      process(data, length);
+ *      radio_handler.ReleaseIQ();
+ *  }
+ * \endcode
+ * 
+ * \retval ERR_SUCCESS
+ * \retval ERR_STREAM_RUNNING
+ */
+sddc_err_t RadioHandler::SetPullMode(bool pull)
+{
+	TracePrintln(TAG, "%s", pull ? "true" : "false");
+
+	if (streamRunning)
+		return ERR_STREAM_RUNNING;
+
+	pull_mode = pull;
+	return ERR_SUCCESS;
+}
+
+/**
+ * @brief Take the next block of IQ samples, in pull mode
+ * 
+ * The block stays in the ring buffer until RadioHandler::ReleaseIQ, calling this
+ * function again before that gives the same block. Only one thread may take the blocks.
+ * 
+ * @param[out] data The samples
+ * @param[out] length Number of samples of the block
+ * @param[out] timestamp_ns Time of the first sample (see RadioHandler::AttachIQ), can be `nullptr`
+ * @param[in] timeout_ms Longest wait for a block
+ * 
+ * \retval ERR_SUCCESS
+ * \retval ERR_TIMEOUT
+ * \retval ERR_STREAM_STOPPED The stream is not running, or was stopped while waiting
+ * \retval ERR_NOT_COMPATIBLE Not in pull mode, or r2iq is off
+ */
+sddc_err_t RadioHandler::AcquireIQ(const sddc_complex_t** data, uint32_t* length, int64_t* timestamp_ns, uint32_t timeout_ms)
+{
+	if (!streamRunning)
+		return ERR_STREAM_STOPPED;
+	if (!pull_mode || !r2iqEnabled)
+		return ERR_NOT_COMPATIBLE;
+
+	const uint32_t len_iq = iq_buffer.getBlockSize();
+
+	std::lock_guard<std::mutex> lk(pull_mutex);
+	if (pull_block == nullptr)
+	{
+		auto buf = iq_buffer.getReadPtr(timeout_ms);
+		if (buf == nullptr)
+			return ERR_TIMEOUT;
+		if (!streamRunning)
+			return ERR_STREAM_STOPPED;
+
+		const auto start = chrono::steady_clock::now();
+		if (fc != 0.0f)
+		{
+			std::unique_lock<std::mutex> lk(fc_mutex);
+			shift_limited_unroll_C_sse_inp_c((complexf*)buf, len_iq, stateFineTune);
+		}
+		quantizer.Convert((void*)buf, len_iq);
+		delivery_ns += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+
+		pull_block = buf;
+		pull_offset = 0;
+	}
+
+	*data = (const sddc_complex_t*)pull_block;
+	*length = len_iq;
+	if (timestamp_ns)
+		*timestamp_ns = iq_buffer.getReadTimestamp();
+
+	return ERR_SUCCESS;
+}
+
+/**
+ * @brief Give back the block taken by RadioHandler::AcquireIQ
+ * 
+ * \retval ERR_SUCCESS
+ */
+sddc_err_t RadioHandler::ReleaseIQ()
+{
+	std::lock_guard<std::mutex> lk(pull_mutex);
+	if (pull_block == nullptr)
+		return ERR_SUCCESS;
+
+	pull_block = nullptr;
+	iq_buffer.ReadDone();
+	count_iq_samples += iq_buffer.getBlockSize();
+
+	return ERR_SUCCESS;
+}
+
+/**
+ * @brief Take the next block of real samples, in pull mode with r2iq off
+ * 
+ * See RadioHandler::AcquireIQ
+ * 
+ * \retval ERR_SUCCESS
+ * \retval ERR_TIMEOUT
+ * \retval ERR_STREAM_STOPPED
+ * \retval ERR_NOT_COMPATIBLE Not in pull mode, or r2iq is on
+ */
+sddc_err_t RadioHandler::AcquireReal(const int16_t** data, uint32_t* length, int64_t* timestamp_ns, uint32_t timeout_ms)
+{
+	if (!streamRunning)
+		return ERR_STREAM_STOPPED;
+	if (!pull_mode || r2iqEnabled)
+		return ERR_NOT_COMPATIBLE;
+
+	std::lock_guard<std::mutex> lk(pull_mutex);
+	if (pull_block == nullptr)
+	{
+		auto buf = real_buffer.getReadPtr(timeout_ms);
+		if (buf == nullptr)
+			return ERR_TIMEOUT;
+		if (!streamRunning)
+			return ERR_STREAM_STOPPED;
+
+		pull_block = buf;
+		pull_offset = 0;
+	}
+
+	*data = (const int16_t*)pull_block;
+	*length = real_buffer.getBlockSize();
+	if (timestamp_ns)
+		*timestamp_ns = real_buffer.getReadTimestamp();
+
+	return ERR_SUCCESS;
+}
+
+/**
+ * @brief Give back the block taken by RadioHandler::AcquireReal
+ * 
+ * \retval ERR_SUCCESS
+ */
+sddc_err_t RadioHandler::ReleaseReal()
+{
+	std::lock_guard<std::mutex> lk(pull_mutex);
+	if (pull_block == nullptr)
+		return ERR_SUCCESS;
+
+	pull_block = nullptr;
+	real_buffer.ReadDone();
+
+	return ERR_SUCCESS;
+}
+
+template<typename Acquire, typename Release>
+sddc_err_t RadioHandler::ReadSamples(uint8_t* data, size_t sample_size, uint32_t length, uint32_t* read, int64_t* timestamp_ns,
+	uint32_t timeout_ms, Acquire acquire, Release release, double ns_per_sample)
+{
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+	*read = 0;
+	if (timestamp_ns)
+		*timestamp_ns = 0;
+
+	while (*read < length)
+	{
+		auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+
+		const uint8_t* block;
+		uint32_t block_length;
+		int64_t block_timestamp;
+		sddc_err_t ret = acquire(&block, &block_length, &block_timestamp, (uint32_t)std::max<int64_t>(0, left.count()));
+		if (ret != ERR_SUCCESS)
+			return ret;
+
+		if (*read == 0 && timestamp_ns && block_timestamp != 0)
+			*timestamp_ns = block_timestamp + (int64_t)(pull_offset * ns_per_sample);
+
+		const uint32_t count = std::min(length - *read, block_length - pull_offset);
+		memcpy(data + *read * sample_size, block + pull_offset * sample_size, count * sample_size);
+		*read += count;
+		pull_offset += count;
+
+		if (pull_offset == block_length)
+			release();
+	}
+
+	return ERR_SUCCESS;
+}
+
+/**
+ * @brief Copy the next IQ samples, in pull mode
+ * 
+ * Waits until `length` samples are copied, whatever the block size: the rest of
+ * a block is kept for the next call. Not to be mixed with RadioHandler::AcquireIQ.
+ * 
+ * @param[out] data Room for `length` samples in the IQ format (see RadioHandler::SetIQFormat)
+ * @param[out] read Number of samples copied, also when an error is returned
+ * @param[out] timestamp_ns Time of `data[0]`, can be `nullptr`
+ * @param[in] timeout_ms Longest wait for the whole call
+ * 
+ * \retval ERR_SUCCESS
+ * \retval ERR_TIMEOUT Less than `length` samples arrived in time
+ * \retval ERR_STREAM_STOPPED
+ * \retval ERR_NOT_COMPATIBLE
+ */
+sddc_err_t RadioHandler::ReadIQ(void* data, uint32_t length, uint32_t* read, int64_t* timestamp_ns, uint32_t timeout_ms)
+{
+	return ReadSamples((uint8_t*)data, quantizer.SampleSize(), length, read, timestamp_ns, timeout_ms,
+		[this](const uint8_t** block, uint32_t* n, int64_t* ts, uint32_t timeout) {
+			return AcquireIQ((const sddc_complex_t**)block, n, ts, timeout);
+		},
+		[this] { return ReleaseIQ(); }, pull_ns_per_iq);
+}
+
+/**
+ * @brief Copy the next real samples, in pull mode with r2iq off
+ * 
+ * See RadioHandler::ReadIQ
+ */
+sddc_err_t RadioHandler::ReadReal(int16_t* data, uint32_t length, uint32_t* read, int64_t* timestamp_ns, uint32_t timeout_ms)
+{
+	return ReadSamples((uint8_t*)data, sizeof(int16_t), length, read, timestamp_ns, timeout_ms,
+		[this](const uint8_t** block, uint32_t* n, int64_t* ts, uint32_t timeout) {
+			return AcquireReal((const int16_t**)block, n, ts, timeout);
+		},
+		[this] { return ReleaseReal(); }, pull_ns_per_real);
+}
+
+/**
+ * @brief Number of blocks of the ring buffers read in pull mode
+ * 
+ * The blocks given by RadioHandler::AcquireIQ (RadioHandler::AcquireReal when r2iq
+ * is off) are always the same ones, in turn: a consumer can map them once and then
+ * name them by their slot, see RadioHandler::GetPullBlockIndex.
+ * Valid until the next RadioHandler::SetStreamConfig.
+ */
+uint32_t RadioHandler::GetPullBlockCount() const
+{
+	return stream_config.ring_blocks;
+}
+
+/**
+ * @brief Address of the block of slot `index`, see RadioHandler::GetPullBlockCount
+ * 
+ * @param[in] index Slot of the block
+ * @param[in] convert_r2iq The IQ ring, or the real one, as for RadioHandler::Start
+ * 
+ * @return `nullptr` when `index` is out of range
+ */
+const void* RadioHandler::GetPullBlock(uint32_t index, bool convert_r2iq)
+{
+	if (index >= GetPullBlockCount())
+		return nullptr;
+
+	return convert_r2iq ? (const void*)iq_buffer.getBlock(index) : (const void*)real_buffer.getBlock(index);
+}
+
+/**
+ * @brief Slot of the block taken by RadioHandler::AcquireIQ or RadioHandler::AcquireReal
+ * 
+ * @return -1 when no block is taken
+ */
+int RadioHandler::GetPullBlockIndex() const
+{
+	std::lock_guard<std::mutex> lk(pull_mutex);
+	if (pull_block == nullptr)
+		return -1;
+
+	return r2iqEnabled ? iq_buffer.getReadIndex() : real_buffer.getReadIndex();
+}
+
+/**
+ * @brief Number of times the ring buffer read in pull mode was found full
+ * 
+ * Every time, the producer had to wait for the application: the samples are then
+ * dropped at the USB side. Compare two values to detect an overflow.
+ * 
+ * @param[out] timestamp_ns Time of the last block written before the last overflow
+ *   (see RadioHandler::AttachIQ), can be `nullptr`
+ */
+int RadioHandler::GetPullOverflowCount(int64_t* timestamp_ns) const
+{
+	const auto& ring = r2iqEnabled ? (const ringbufferbase&)iq_buffer : (const ringbufferbase&)real_buffer;
+	if (timestamp_ns)
+		*timestamp_ns = ring.getLastFullTimestamp();
+	return ring.getFullCount();
+}
+
 sddc_err_t RadioHandler::SetRFMode(sddc_rf_mode_t mode)
 {
 	TracePrintln(TAG, "%d", mode);
@@ -299,8 +871,11 @@ sddc_err_t RadioHandler::SetRFMode(sddc_rf_mode_t mode)
 	}
 
 	DebugPrintln(TAG, "Switching to RF mode %d", mode);
+	hardware->BeginBatch();
 	sddc_err_t ret = hardware->SetRFMode(mode);
+	sddc_err_t commit = hardware->Commit();
 	if(ret != ERR_SUCCESS) return ret;
+	if(commit != ERR_SUCCESS) return commit;
 
 	if(mode == VHFMODE)
 		r2iqCntrl->setSideband(true);
@@ -575,8 +1150,10 @@ void RadioHandler::CaculateStats()
 	while (streamRunning)
 	{
 		// --- Reset all counters --- //
-		count_real_samples = 0;
 		count_iq_samples = 0;
+		const uint32_t real_writes = real_buffer.getWriteCount();
+		const uint64_t r2iq_busy = r2iqCntrl->getBusyTime();
+		const uint64_t delivery_busy = delivery_ns;
 
 		StartingTime = chrono::high_resolution_clock::now();
 
@@ -621,14 +1198,47 @@ void RadioHandler::CaculateStats()
 		EndingTime = chrono::high_resolution_clock::now();
 		chrono::duration<float,std::ratio<1,1>> timeElapsed(EndingTime-StartingTime);
 
-		real_samples_per_second = (float)count_real_samples / timeElapsed.count();
+		// Every block written in the real ring came from the device
+		real_samples_per_second = (float)((uint32_t)real_buffer.getWriteCount() - real_writes) * real_buffer.getBlockSize() / timeElapsed.count();
 		iq_samples_per_second = (float)count_iq_samples / timeElapsed.count();
+		// A block is counted whole in the window where it ends, which can take the load past 100%
+		r2iq_load = std::min((r2iqCntrl->getBusyTime() - r2iq_busy) / 1e9f / timeElapsed.count(), 1.0f);
+		delivery_load = (delivery_ns - delivery_busy) / 1e9f / timeElapsed.count();
 
-		DebugPrintln(TAG, "real=%fSps, iq=%fSps", real_samples_per_second, iq_samples_per_second);
+		transfer_depth = fx3->GetTransferDepth();
+
+		DebugPrintln(TAG, "real=%fSps, iq=%fSps, %u USB transfers in flight, r2iq %.0f%%, delivery %.0f%%",
+			real_samples_per_second, iq_samples_per_second, transfer_depth, r2iq_load * 100, delivery_load * 100);
 	}
 	return;
 }
 
+/**
+ * @brief Health of the running stream
+ * 
+ * The rates and the loads are updated every second by the statistics thread,
+ * the counters and the ring fill levels are read live. Polling it does not
+ * disturb the stream.
+ */
+sddc_stream_stats_t RadioHandler::GetStreamStats() const
+{
+	sddc_stream_stats_t stats = {};
+
+	stats.real_samples_per_second = real_samples_per_second;
+	stats.iq_samples_per_second = iq_samples_per_second;
+	stats.transfer_depth = transfer_depth;
+	stats.usb_errors = fx3->GetTransferErrors();
+	stats.real_ring_full = real_buffer.getFullCount() - real_full_base;
+	stats.iq_ring_full = iq_buffer.getFullCount() - iq_full_base;
+	stats.real_ring_fill = real_buffer.getFillCount();
+	stats.iq_ring_fill = iq_buffer.getFillCount();
+	stats.ring_blocks = stream_config.ring_blocks;
+	stats.r2iq_load = r2iq_load;
+	stats.delivery_load = delivery_load;
+
+	return stats;
+}
+
 sddc_err_t RadioHandler::SetRand(bool new_state)
 {
 	TracePrintln(TAG, "%s", new_state ? "true" : "false");
@@ -645,6 +1255,7 @@ sddc_rf_mode_t  RadioHandler::GetRFMode()                  { return hardware->Ge
 
 uint32_t	RadioHandler::GetADCSampleRate()                    { return hardware->GetADCSampleRate(); };
 sddc_err_t	RadioHandler::SetADCSampleRate(uint32_t samplefreq) { return hardware->SetADCSampleRate(samplefreq); };
+double		RadioHandler::GetIQSampleRate()                     { return GetADCSampleRate() / 2.0 / r2iqCntrl->getRatio(); };
 
 bool 		RadioHandler::GetBiasT_HF ()               { return hardware->GetBiasT_HF(); };
 sddc_err_t	RadioHandler::SetBiasT_HF (bool new_state) { return hardware->SetBiasT_HF(new_state); };
@@ -662,20 +1273,25 @@ sddc_err_t	RadioHandler::SetLED   (sddc_leds_t led, bool on) { return hardware->
 
 // --- Static functions --- //
 
-size_t RadioHandler::GetDeviceListLength()
+// `backend` selects where the devices are searched, see RadioHandler::SetBackend
+size_t RadioHandler::GetDeviceListLength(const char* backend)
 {
 	TracePrintln(TAG, "");
-	auto fx3_handler = CreateUsbHandler();
+	auto fx3_handler = CreateFx3Backend(backend);
+	if (fx3_handler == nullptr)
+		return 0;
 	size_t len = fx3_handler->GetDeviceListLength();
 	delete fx3_handler;
 
 	return len;
 }
-sddc_err_t RadioHandler::GetDevice(uint8_t dev_index, sddc_device_t *dev_pointer)
+sddc_err_t RadioHandler::GetDevice(uint8_t dev_index, sddc_device_t *dev_pointer, const char* backend)
 {
 	TracePrintln(TAG, "%d, %p", dev_index, dev_pointer);
 
-	auto fx3_handler = CreateUsbHandler();
+	auto fx3_handler = CreateFx3Backend(backend);
+	if (fx3_handler == nullptr)
+		return ERR_BACKEND_INVALID;
 	fx3_handler->GetDevice(dev_index, dev_pointer->product, 32, dev_pointer->serial_number, 32);
 
 	/* Old code, I don't know his exact role
@@ -690,11 +1306,13 @@ sddc_err_t RadioHandler::GetDevice(uint8_t dev_index, sddc_device_t *dev_pointer
 	return ERR_SUCCESS;
 }
 
-vector<SDDC::DeviceItem> RadioHandler::GetDeviceList()
+vector<SDDC::DeviceItem> RadioHandler::GetDeviceList(const char* backend)
 {
 	TracePrintln(TAG, "");
 
-	auto fx3_handler = CreateUsbHandler();
+	auto fx3_handler = CreateFx3Backend(backend);
+	if (fx3_handler == nullptr)
+		return vector<SDDC::DeviceItem>();
 	vector<SDDC::DeviceItem> dev_list = fx3_handler->GetDeviceList();
 	delete fx3_handler;
 
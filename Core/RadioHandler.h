@@ -23,6 +23,8 @@
 #define _H_RADIOHANDLER
 
 #include <array>
+#include <atomic>
+#include <mutex>
 #include <vector>
 #include <stdio.h>
 #include <stdlib.h>
@@ -34,6 +36,7 @@
 #include "radio/RadioHardware.h"
 #include "fft_mt_r2iq.h"
 #include "dsp/ringbuffer.h"
+#include "dsp/quantize.h"
 
 using namespace std;
 
@@ -54,14 +57,44 @@ class RadioHandler {
 public:
 	RadioHandler();
 	~RadioHandler();
-	sddc_err_t Init(uint8_t dev_index);
-	sddc_err_t AttachReal(void (*callback)(void* context, const int16_t*, uint32_t), void* context = nullptr);
-	sddc_err_t AttachIQ(void (*callback)(void* context, const sddc_complex_t*, uint32_t), void* context = nullptr);
+	sddc_err_t SetBackend(const char* spec);
+	sddc_err_t Init(uint8_t dev_index, const sddc_stream_config_t* config = nullptr);
+	sddc_err_t AttachReal(void (*callback)(void* context, const int16_t*, uint32_t, int64_t), void* context = nullptr);
+	sddc_err_t AttachIQ(void (*callback)(void* context, const sddc_complex_t*, uint32_t, int64_t), void* context = nullptr);
 	sddc_err_t Start(bool convert_r2iq);
 	sddc_err_t Stop();
+	bool IsStreaming() const { return streamRunning; }
+
+	// --- Pull mode --- //
+	sddc_err_t	SetPullMode(bool pull);
+	bool		GetPullMode() const { return pull_mode; }
+	sddc_err_t	AcquireIQ(const sddc_complex_t** data, uint32_t* length, int64_t* timestamp_ns, uint32_t timeout_ms);
+	sddc_err_t	ReleaseIQ();
+	sddc_err_t	AcquireReal(const int16_t** data, uint32_t* length, int64_t* timestamp_ns, uint32_t timeout_ms);
+	sddc_err_t	ReleaseReal();
+	sddc_err_t	ReadIQ(void* data, uint32_t length, uint32_t* read, int64_t* timestamp_ns, uint32_t timeout_ms);
+	sddc_err_t	ReadReal(int16_t* data, uint32_t length, uint32_t* read, int64_t* timestamp_ns, uint32_t timeout_ms);
+	uint32_t	GetPullBlockCount() const;
+	const void*	GetPullBlock(uint32_t index, bool convert_r2iq);
+	int			GetPullBlockIndex() const;
+	int			GetPullOverflowCount(int64_t* timestamp_ns = nullptr) const;
+
+	// --- Stream geometry --- //
+	sddc_err_t	SetStreamConfig(const sddc_stream_config_t& config);
+	const sddc_stream_config_t& GetStreamConfig() const { return stream_config; }
+	static sddc_stream_config_t GetDefaultStreamConfig();
+
+	// --- Threads --- //
+	sddc_err_t	SetThreadConfig(sddc_thread_role_t role, const sddc_thread_config_t& config);
+	sddc_thread_config_t GetThreadConfig(sddc_thread_role_t role) const { return thread_config[role]; }
+	sddc_err_t	SetSharedProcessing(bool shared);
+	bool		GetSharedProcessing() const { return shared_processing; }
 
 	// --- r2iq --- //
 	sddc_err_t	SetDecimation(uint8_t decimate);
+	sddc_err_t	SetIQFormat(sddc_iq_format_t format, float scale = 0, bool dither = false);
+	sddc_iq_format_t GetIQFormat() const { return quantizer.getFormat(); }
+	float		GetIQScale() const { return quantizer.getScale(); }
 
 	// ----- RF mode ----- //
 	sddc_rf_mode_t	GetBestRFMode(uint64_t freq);
@@ -71,6 +104,7 @@ public:
 	// --- ADC --- //
 	uint32_t	    GetADCSampleRate();
 	sddc_err_t	    SetADCSampleRate(uint32_t samplefreq);
+	double          GetIQSampleRate();	// after the decimation
 
 	// --- Tuner --- //
 	uint32_t        GetCenterFrequency();
@@ -105,6 +139,8 @@ public:
 
 	float getRealSamplesPerSecond() const { return real_samples_per_second; }
 	float getIQSamplesPerSecond()   const { return iq_samples_per_second; }
+	uint32_t getTransferDepth()     const { return transfer_depth; }
+	sddc_stream_stats_t GetStreamStats() const;
 
 	/// --- Hardware infos --- //
 	RadioModel getHardwareModel() { return devModel; }
@@ -122,9 +158,9 @@ public:
 	bool ReadDebugTrace(uint8_t* pdata, uint8_t len) { return fx3->ReadDebugTrace(pdata, len); }
 
 	// --- Static functions --- //
-	static size_t GetDeviceListLength();
-	static sddc_err_t GetDevice(uint8_t dev_index, sddc_device_t *dev_pointer);
-	static vector<SDDC::DeviceItem> GetDeviceList();
+	static size_t GetDeviceListLength(const char* backend = nullptr);
+	static sddc_err_t GetDevice(uint8_t dev_index, sddc_device_t *dev_pointer, const char* backend = nullptr);
+	static vector<SDDC::DeviceItem> GetDeviceList(const char* backend = nullptr);
 
 private:
 	fx3class *fx3;
@@ -132,38 +168,61 @@ private:
 	void CaculateStats();
 	void OnDataPacket();
 
-	void (*callbackReal)(void* context, const int16_t *data, uint32_t length);
+	template<typename Acquire, typename Release>
+	sddc_err_t ReadSamples(uint8_t* data, size_t sample_size, uint32_t length, uint32_t* read, int64_t* timestamp_ns,
+		uint32_t timeout_ms, Acquire acquire, Release release, double ns_per_sample);
+
+	void (*callbackReal)(void* context, const int16_t *data, uint32_t length, int64_t timestamp_ns);
 	void *callbackRealContext;
-	void (*callbackIQ)(void* context, const sddc_complex_t *data, uint32_t length);
+	void (*callbackIQ)(void* context, const sddc_complex_t *data, uint32_t length, int64_t timestamp_ns);
 	void *callbackIQContext;
 
 	void (*DbgPrintFX3)(const char* fmt, ...);
 	bool (*GetConsoleIn)(char* buf, int maxlen);
 
-	bool streamRunning = false;
+	// Set once the rings run, cleared before they stop: the pull thread may test it anytime
+	std::atomic<bool> streamRunning{false};
+
+	// pull mode: the block held by the application, see AcquireIQ. pull_mutex
+	// serializes the pull thread with Start and Stop, which may run on another one
+	bool pull_mode = false;
+	mutable std::mutex pull_mutex;
+	const void* pull_block = nullptr;	// cleared by Stop: the next release is then a no-op
+	uint32_t pull_offset = 0;		// samples of pull_block already copied by ReadIQ, pull thread only
+	double pull_ns_per_iq = 0;
+	double pull_ns_per_real = 0;
 
 	RadioModel devModel;
 	uint16_t devFirmware;
 
 	// transfer variables
+	sddc_stream_config_t stream_config;
 	ringbuffer<int16_t> real_buffer;
 	ringbuffer<sddc_complex_t> iq_buffer;
 
 	// threads
 	std::thread show_stats_thread;
 	std::thread submit_thread;
+	sddc_thread_config_t thread_config[SDDC_THREAD_ROLE_COUNT] = {};
+	bool shared_processing = false;
 
 	// --- Stats --- //
-	uint32_t count_real_samples   = 0;
 	uint32_t count_iq_samples     = 0;
 	float real_samples_per_second = 0;
 	float iq_samples_per_second   = 0;
+	uint32_t transfer_depth       = 0;
+	float r2iq_load               = 0;
+	float delivery_load           = 0;
+	std::atomic<uint64_t> delivery_ns{0};	// fine tune, conversion and callbacks, see OnDataPacket
+	int real_full_base            = 0;		// ring counters when the stream started
+	int iq_full_base              = 0;
 
 	RadioHardware* hardware;
 	std::mutex fc_mutex;
     float fc;
 	shift_limited_unroll_C_sse_data_t* stateFineTune;
-	fft_mt_r2iq* r2iqCntrl;
+	fft_mt_r2iq* r2iqCntrl = nullptr;
+	iq_quantizer quantizer;		// applied by the thread taking the IQ blocks
 	bool r2iqEnabled = false;
 };
 
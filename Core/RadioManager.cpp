@@ -0,0 +1,109 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "RadioManager.h"
+#include "config.h"
+
+#define TAG "RadioManager"
+
+RadioManager::RadioManager()
+{
+    TracePrintln(TAG, "");
+}
+
+RadioManager::~RadioManager()
+{
+    TracePrintln(TAG, "");
+
+    StopAll();
+}
+
+sddc_err_t RadioManager::Open(uint8_t dev_index, const char* backend, const sddc_stream_config_t* config)
+{
+    TracePrintln(TAG, "%d, %s", dev_index, backend ? backend : "(null)");
+
+    std::unique_ptr<RadioHandler> radio(new RadioHandler());
+
+    sddc_err_t ret;
+    if (backend != nullptr)
+    {
+        ret = radio->SetBackend(backend);
+        if (ret != ERR_SUCCESS) return ret;
+    }
+
+    ret = radio->Init(dev_index, config);
+    if (ret != ERR_SUCCESS) return ret;
+
+    ret = radio->SetSharedProcessing(true);
+    if (ret != ERR_SUCCESS) return ret;
+
+    radios.push_back(std::move(radio));
+    DebugPrintln(TAG, "%d device(s) open", (int)radios.size());
+
+    return ERR_SUCCESS;
+}
+
+sddc_err_t RadioManager::StartAll(bool convert_r2iq)
+{
+    TracePrintln(TAG, "%s", convert_r2iq ? "true" : "false");
+
+    for (auto& radio : radios)
+    {
+        sddc_err_t ret = radio->Start(convert_r2iq);
+        if (ret != ERR_SUCCESS)
+        {
+            WarnPrintln(TAG, "Failed to start a device (%d), stopping the others", ret);
+            StopAll();
+            return ret;
+        }
+    }
+
+    return ERR_SUCCESS;
+}
+
+sddc_err_t RadioManager::StopAll()
+{
+    TracePrintln(TAG, "");
+
+    sddc_err_t ret = ERR_SUCCESS;
+    for (auto& radio : radios)
+    {
+        sddc_err_t stop = radio->Stop();
+        if (stop != ERR_SUCCESS)
+            ret = stop;
+    }
+
+    return ret;
+}
+
+float RadioManager::GetRealSamplesPerSecond() const
+{
+    float total = 0;
+    for (auto& radio : radios)
+        total += radio->getRealSamplesPerSecond();
+    return total;
+}
+
+float RadioManager::GetIQSamplesPerSecond() const
+{
+    float total = 0;
+    for (auto& radio : radios)
+        total += radio->getIQSamplesPerSecond();
+    return total;
+}
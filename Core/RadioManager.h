@@ -0,0 +1,80 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "RadioHandler.h"
+
+/**
+ * @brief Several devices streaming together
+ *
+ * Every device keeps its own RadioHandler (settings, callbacks, stream), but
+ * the samples of all of them are converted on the shared r2iq workers, and the
+ * devices with the same gain share their filters and FFTW plans.
+ *
+ * \code
+ *  RadioManager manager;
+ *  for (uint8_t i = 0; i < RadioHandler::GetDeviceListLength(); i++)
+ *      manager.Open(i);
+ *  manager.Get(0)->AttachIQ(callback, context);
+ *  ...
+ *  manager.StartAll(true);
+ * \endcode
+ */
+class RadioManager
+{
+public:
+    RadioManager();
+    ~RadioManager();
+
+    /**
+     * @brief Opens a device and adds it at the end of the list
+     *
+     * @param[in] dev_index Index of the device, see RadioHandler::GetDeviceList
+     * @param[in] backend Source of the samples (see RadioHandler::SetBackend), `nullptr` for the default one
+     * @param[in] config Stream geometry, `nullptr` for the default one
+     *
+     * \retval ERR_SUCCESS
+     * \retval ERR_BACKEND_INVALID
+     * \retval ERR_FX3_OPEN_FAILED
+     * \retval ERR_BUFFER_SIZE_INVALID
+     */
+    sddc_err_t Open(uint8_t dev_index, const char* backend = nullptr, const sddc_stream_config_t* config = nullptr);
+
+    size_t Count() const { return radios.size(); }
+    RadioHandler* Get(size_t index) { return index < radios.size() ? radios[index].get() : nullptr; }
+
+    /**
+     * @brief Starts every device, stops them all if one of them fails
+     */
+    sddc_err_t StartAll(bool convert_r2iq);
+    sddc_err_t StopAll();
+
+    /**
+     * @brief Sum of the sample rates measured on the devices
+     */
+    float GetRealSamplesPerSecond() const;
+    float GetIQSamplesPerSecond() const;
+
+private:
+    std::vector<std::unique_ptr<RadioHandler>> radios;
+};
@@ -1,9 +1,12 @@
 #include <string.h>
 #include <unistd.h>
 #include <assert.h>
+#include <chrono>
 
 #include "FX3handler.h"
+#include "thread_config.h"
 #include "usb_device.h"
+#include "usb_registry.h"
 #include "ezusb.h"
 #include "firmware.h"
 
@@ -25,8 +28,12 @@ fx3handler::fx3handler()
 {
     TracePrintln(TAG, "");
 
-    usb_device_infos = nullptr;
     dev = nullptr;
+    stream = nullptr;
+    adc_rate = DEFAULT_ADC_FREQ;
+    batching = false;
+    transfer_depth = 0;
+    transfer_errors = 0;
 }
 
 fx3handler::~fx3handler()
@@ -64,21 +71,24 @@ bool fx3handler::Control(FX3Command command, uint8_t data)
 {
     TracePrintln(TAG, "%d, %d", command, data);
 
-    return usb_device_control(this->dev, command, 0, 0, (uint8_t *)&data, sizeof(data), 0) == 0;
+    return WriteUsb(command, 0, 0, (uint8_t *)&data, sizeof(data));
 }
 
 bool fx3handler::Control(FX3Command command, uint32_t data)
 {
     TracePrintln(TAG, "%d, %d", command, data);
 
-    return usb_device_control(this->dev, command, 0, 0, (uint8_t *)&data, sizeof(data), 0) == 0;
+    if (command == STARTADC)
+        adc_rate = data;
+
+    return WriteUsb(command, 0, 0, (uint8_t *)&data, sizeof(data));
 }
 
 bool fx3handler::Control(FX3Command command, uint64_t data)
 {
     TracePrintln(TAG, "%d, %ld", command, data);
 
-    return usb_device_control(this->dev, command, 0, 0, (uint8_t *)&data, sizeof(data), 0) == 0;
+    return WriteUsb(command, 0, 0, (uint8_t *)&data, sizeof(data));
 }
 
 bool fx3handler::SetArgument(uint16_t index, uint16_t value)
@@ -86,7 +96,31 @@ bool fx3handler::SetArgument(uint16_t index, uint16_t value)
     TracePrintln(TAG, "%d, %d", index, value);
 
     uint8_t data = 0;
-    return usb_device_control(this->dev, SETARGFX3, value, index, (uint8_t *)&data, sizeof(data), 0) == 0;
+    return WriteUsb(SETARGFX3, value, index, (uint8_t *)&data, sizeof(data));
+}
+
+void fx3handler::BeginBatch()
+{
+    TracePrintln(TAG, "");
+
+    batching = true;
+}
+
+bool fx3handler::CommitBatch()
+{
+    TracePrintln(TAG, "");
+
+    batching = false;
+    return usb_device_control_wait(this->dev) == 0;
+}
+
+// Synchronous, or only submitted during a batch
+bool fx3handler::WriteUsb(uint8_t command, uint16_t value, uint16_t index, uint8_t *data, size_t size)
+{
+    if (batching)
+        return usb_device_control_submit(this->dev, command, value, index, data, size) == 0;
+
+    return usb_device_control(this->dev, command, value, index, data, size, 0) == 0;
 }
 
 bool fx3handler::GetHardwareInfo(uint32_t *data)
@@ -100,27 +134,41 @@ bool fx3handler::GetHardwareInfo(uint32_t *data)
     return usb_device_control(this->dev, TESTFX3, enable_debug, 0, (uint8_t *)data, sizeof(*data), 1) == 0;
 }
 
-void fx3handler::StartStream(ringbuffer<int16_t> &samples_buf)
+uint32_t fx3handler::GetTransferGranularity()
 {
     TracePrintln(TAG, "");
 
+    return dev ? usb_device_max_transfer_size(dev) : 0;
+}
+
+void fx3handler::StartStream(ringbuffer<int16_t> &samples_buf, int numofblock, int maxnumofblock)
+{
+    TracePrintln(TAG, "%d, %d", numofblock, maxnumofblock);
+
     inputbuffer = &samples_buf;
 
-    stream = streaming_open_async(this->dev, inputbuffer->getBlockSize() * sizeof(int16_t), concurrentTransfers, PacketRead, this);
+    stream = streaming_open_async(this->dev, inputbuffer->getBlockSize() * sizeof(int16_t), numofblock, PacketRead, this);
     //samples_buf.setBlockSize(streaming_framesize(stream) / sizeof(int16_t));
 
     DebugPrintln(TAG, "Samples buffer blocksize: %d", samples_buf.getBlockSize());
 
     // Start background thread to poll the events
     run = true;
+    transfer_depth = stream ? numofblock : 0;
+    transfer_errors = 0;
     if (stream)
     {
+        streaming_set_sample_rate(stream, adc_rate);
+        if (maxnumofblock > numofblock)
+            streaming_set_depth_range(stream, std::min<uint32_t>(minConcurrentTransfers, numofblock), maxnumofblock);
         streaming_start(stream);
     }
 
+    // Sleeps in libusb until a transfer completes, StopStream interrupts it
     poll_thread = std::thread(
         [this]()
         {
+            sddc_thread_apply(SDDC_THREAD_USB, usb_thread_config);
             while (run)
             {
                 usb_device_handle_events(this->dev);
@@ -133,22 +181,51 @@ void fx3handler::StopStream()
 {
     TracePrintln(TAG, "");
 
+    auto start = std::chrono::steady_clock::now();
+
     run = false;
+    usb_device_interrupt_events(this->dev);
     poll_thread.join();
 
-    streaming_stop(stream);
-    streaming_close(stream);
+    // Cancels the transfers in flight and handles their callbacks on this thread
+    if (stream)
+    {
+        streaming_stop(stream);
+        transfer_errors = streaming_errors(stream);
+        streaming_close(stream);
+        stream = nullptr;
+    }
+    transfer_depth = 0;
+
+    DebugPrintln(TAG, "Stream stopped in %.2f ms",
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
+
+// From any thread: these never touch the stream, which StopStream closes
+uint32_t fx3handler::GetTransferDepth()
+{
+    return transfer_depth;
+}
+
+uint32_t fx3handler::GetTransferErrors()
+{
+    return transfer_errors;
 }
 
-void fx3handler::PacketRead(uint32_t data_size, uint8_t *data, void *context)
+void fx3handler::PacketRead(uint32_t data_size, uint8_t *data, int64_t timestamp_ns, void *context)
 {
-    TraceExtremePrintln(TAG, "%d, %p, %p", data_size, data, context);
+    TraceExtremePrintln(TAG, "%d, %p, %ld, %p", data_size, data, timestamp_ns, context);
     fx3handler *handler = (fx3handler *)context;
 
     auto *ptr = handler->inputbuffer->getWritePtr();
     assert(data_size == handler->inputbuffer->getBlockSize() * sizeof(int16_t));
     memcpy(ptr, data, data_size);
+    handler->inputbuffer->setWriteTimestamp(timestamp_ns);
     handler->inputbuffer->WriteDone();
+
+    // The stream outlives its callbacks, the failed transfers show at the next one
+    handler->transfer_depth.store(streaming_depth(handler->stream), std::memory_order_relaxed);
+    handler->transfer_errors.store(streaming_errors(handler->stream), std::memory_order_relaxed);
 }
 
 bool fx3handler::ReadDebugTrace(uint8_t *pdata, uint8_t len)
@@ -162,42 +239,24 @@ bool fx3handler::Enumerate(unsigned char &idx, char *lbuf)
 {
     TracePrintln(TAG, "%d, %s", idx, lbuf);
 
-    if (idx >= usb_device_count_devices()) return false;
-
-    if (usb_device_infos == nullptr) {
-        usb_device_get_device_list(&usb_device_infos);
-    }
+    auto devices = usb_registry::Get().Snapshot();
+    if (idx >= devices->size()) return false;
 
-    auto dev = &usb_device_infos[idx];
+    auto &dev = (*devices)[idx];
 
-    strcpy (lbuf, (const char*)dev->product);
+    strcpy (lbuf, dev.product.c_str());
     while (strlen(lbuf) < 18) strcat(lbuf, " ");
     strcat(lbuf, "sn:");
-    strcat(lbuf, (const char*)dev->serial_number);
+    strcat(lbuf, dev.serial_number.c_str());
 
     return true;
 }
 
-
-
-sddc_err_t fx3handler::SearchDevices()
-{
-    TracePrintln(TAG, "");
-
-    if (usb_device_infos != nullptr) {
-        usb_device_free_device_list(usb_device_infos);
-    }
-
-    usb_device_get_device_list(&usb_device_infos);
-
-    return ERR_SUCCESS;
-}
-
 size_t fx3handler::GetDeviceListLength()
 {
     TracePrintln(TAG, "");
 
-    return usb_device_count_devices();
+    return usb_registry::Get().Snapshot()->size();
 }
 
 bool fx3handler::GetDevice(
@@ -209,16 +268,13 @@ bool fx3handler::GetDevice(
 {
     TracePrintln(TAG, "%d, %p, %ld, %p, %ld", idx, name, name_len, serial, serial_len);
 
-    if (idx >= usb_device_count_devices()) return false;
+    auto devices = usb_registry::Get().Snapshot();
+    if (idx >= devices->size()) return false;
 
-    if (usb_device_infos == nullptr) {
-        SearchDevices();
-    }
-
-    auto dev = &usb_device_infos[idx];
+    auto &dev = (*devices)[idx];
 
-    strncpy(name, (const char*)dev->product, name_len);
-    strncpy(serial, (const char*)dev->serial_number, serial_len);
+    strncpy(name, dev.product.c_str(), name_len);
+    strncpy(serial, dev.serial_number.c_str(), serial_len);
 
     return true;
 }
@@ -227,22 +283,5 @@ vector<SDDC::DeviceItem> fx3handler::GetDeviceList()
 {
     TracePrintln(TAG, "");
 
-    vector<SDDC::DeviceItem> dev_list;
-
-    struct usb_device_info *usb_device_list;
-    usb_device_get_device_list(&usb_device_list);
-
-    for(uint8_t i = 0; i < usb_device_count_devices(); i++)
-    {
-        SDDC::DeviceItem dev = {
-            .index = i,
-            .product = string(usb_device_list[i].product),
-            .serial_number = string(usb_device_list[i].serial_number)
-        };
-        dev_list.push_back(dev);
-    }
-
-    usb_device_free_device_list(usb_device_list);
-
-    return dev_list;
-}
\ No newline at end of file
+    return *usb_registry::Get().Snapshot();
+}
@@ -1,6 +1,8 @@
 #ifndef FX3HANDLER_H
 #define FX3HANDLER_H
 
+#include <atomic>
+
 #include "../../config.h"
 
 #define	VENDOR_ID     (0x04B4)
@@ -24,30 +26,36 @@ public:
 	bool Control(FX3Command command, uint32_t data) override;
 	bool Control(FX3Command command, uint64_t data) override;
 	bool SetArgument(uint16_t index, uint16_t value) override;
+	void BeginBatch() override;
+	bool CommitBatch() override;
 	bool GetHardwareInfo(uint32_t* data) override;
 	bool ReadDebugTrace(uint8_t* pdata, uint8_t len) override;
-	void StartStream(ringbuffer<int16_t>& input) override;
+	uint32_t GetTransferGranularity() override;
+	void StartStream(ringbuffer<int16_t>& input, int numofblock, int maxnumofblock = 0) override;
 	void StopStream() override;
+	uint32_t GetTransferDepth() override;
+	uint32_t GetTransferErrors() override;
 	bool Enumerate(unsigned char &idx, char *lbuf) override;
 	size_t GetDeviceListLength() override;
 	bool GetDevice(unsigned char &idx, char *name, size_t name_len, char *serial, size_t serial_len) override;
 	vector<SDDC::DeviceItem> GetDeviceList() override;
 
 private:
-	bool ReadUsb(uint8_t command, uint16_t value, uint16_t index, uint8_t *data, size_t size);
 	bool WriteUsb(uint8_t command, uint16_t value, uint16_t index, uint8_t *data, size_t size);
 
 	bool Close(void);
 
-	sddc_err_t SearchDevices();
-
-	static void PacketRead(uint32_t data_size, uint8_t *data, void *context);
+	static void PacketRead(uint32_t data_size, uint8_t *data, int64_t timestamp_ns, void *context);
 
-	struct usb_device_info *usb_device_infos;
 	usb_device_t *dev;
 	streaming_t *stream;
 	ringbuffer<int16_t> *inputbuffer;
-    bool run;
+	uint32_t adc_rate;	// last rate sent with STARTADC, times the samples
+	bool batching;		// writes are submitted without waiting, see CommitBatch
+	// copied from the stream by the transfer callbacks, for the stats readers
+	std::atomic<uint32_t> transfer_depth;
+	std::atomic<uint32_t> transfer_errors;
+    std::atomic<bool> run;
     std::thread poll_thread;
 };
 
@@ -63,6 +63,8 @@ void logerror(const char *format, ...)
 
 int verbose = 1;
 
+int fx3_verify = 0;
+
 /*
  * return true if [addr,addr+len] includes external RAM
  * for Anchorchips EZ-USB or Cypress EZ-USB FX
@@ -153,7 +155,7 @@ static int ezusb_write(libusb_device_handle *device, const char *label,
 		else
 			logerror("%s ==> %d\n", label, status);
 	}
-	return (status < 0) ? -EIO : 0;
+	return (status != (signed)len) ? -EIO : 0;
 }
 
 /*
@@ -625,9 +627,28 @@ int fx3_load_ram(libusb_device_handle *device, const char *image)
 		logerror("FX3 bootloader version: 0x%02X%02X%02X%02X\n", blBuf[3], blBuf[2], blBuf[1], blBuf[0]);
 	}
 
+	// Check the image against its pre-computed checksum before writing anything
 	dCheckSum = 0;
+	while (1) {
+		dLength = *(uint32_t*)(image+offset); offset += sizeof(uint32_t);
+		if (dLength == 0)
+			break;
+		offset += sizeof(uint32_t); // address
+		dImageBuf = (uint32_t*)(image+offset); offset += sizeof(uint32_t) * dLength;
+		for (i = 0; i < dLength; i++)
+			dCheckSum += dImageBuf[i];
+	}
+	offset += sizeof(uint32_t); // program entry
+	dExpectedCheckSum = *(uint32_t*)(image + offset);
+	if (dCheckSum != dExpectedCheckSum) {
+		logerror("checksum error\n");
+		ret = -7;
+		goto exit;
+	}
+
+	offset = 4;
 	if (verbose)
-		logerror("writing image...\n");
+		logerror("writing image%s...\n", fx3_verify ? " with read back" : "");
 	while (1) {
 		dLength = *(uint32_t*)(image+offset); offset += sizeof(uint32_t);
 		dAddress = *(uint32_t*)(image+offset); offset += sizeof(uint32_t);
@@ -638,8 +659,6 @@ int fx3_load_ram(libusb_device_handle *device, const char *image)
 		// read sections
 		dImageBuf = (uint32_t*)(image+offset); offset += sizeof(uint32_t) * dLength;
 
-		for (i = 0; i < dLength; i++)
-			dCheckSum += dImageBuf[i];
 		dLength <<= 2; // convert to Byte length
 		bBuf = (unsigned char*) dImageBuf;
 
@@ -647,19 +666,18 @@ int fx3_load_ram(libusb_device_handle *device, const char *image)
 			dLen = 4096; // 4K max
 			if (dLen > dLength)
 				dLen = dLength;
+			// The control transfers are CRC protected: the read back is optional
 			if ((ezusb_write(device, "write firmware", RW_INTERNAL, dAddress, bBuf, dLen) < 0) ||
-				(ezusb_read(device, "read firmware", RW_INTERNAL, dAddress, rBuf, dLen) < 0)) {
+				(fx3_verify && ezusb_read(device, "read firmware", RW_INTERNAL, dAddress, rBuf, dLen) < 0)) {
 				logerror("R/W error\n");
 				ret = -5;
 				goto exit;
 			}
 			// Verify data: rBuf with bBuf
-			for (i = 0; i < dLen; i++) {
-				if (rBuf[i] != bBuf[i]) {
-					logerror("verify error");
-					ret = -6;
-					goto exit;
-				}
+			if (fx3_verify && memcmp(rBuf, bBuf, dLen) != 0) {
+				logerror("verify error");
+				ret = -6;
+				goto exit;
 			}
 
 			dLength -= dLen;
@@ -668,14 +686,6 @@ int fx3_load_ram(libusb_device_handle *device, const char *image)
 		}
 	}
 
-	// read pre-computed checksum data
-	dExpectedCheckSum = *(uint32_t*)(image + offset); offset += sizeof(uint32_t);
-	if (dCheckSum != dExpectedCheckSum) {
-		logerror("checksum error\n");
-		ret = -7;
-		goto exit;
-	}
-
 	// transfer execution to Program Entry
 	if (!ezusb_fx3_jump(device, dAddress)) {
 		ret = -6;
@@ -107,6 +107,9 @@ extern int ezusb_load_eeprom(libusb_device_handle *device,
 /* Verbosity level (default 1). Can be increased or decreased with options v/q  */
 extern int verbose;
 
+/* Read back and compare every chunk of an FX3 image after writing it (default 0) */
+extern int fx3_verify;
+
 #ifdef __cplusplus
 }
 #endif
@@ -34,6 +34,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <time.h>
 #include <stdatomic.h>
 
 #include "streaming.h"
@@ -46,6 +47,11 @@ typedef struct streaming streaming_t;
 
 /* internal functions */
 static void streaming_read_async_callback(struct libusb_transfer *transfer);
+static int64_t streaming_timestamp(streaming_t *this, int64_t completion_ns,
+                                   uint32_t samples);
+static void streaming_adapt_depth(streaming_t *this, int64_t completion_ns);
+static int streaming_submit(streaming_t *this, uint32_t index);
+static void streaming_transfer_done(streaming_t *this, uint32_t index);
 
 
 enum StreamingStatus {
@@ -56,23 +62,58 @@ enum StreamingStatus {
   STREAMING_STATUS_FAILED = 0xff
 };
 
+/* the user_data of a transfer: where it belongs */
+typedef struct streaming_slot {
+  streaming_t *streaming;
+  uint32_t index;             /* in the frames and transfers arrays */
+  uint8_t submitted;          /* currently in flight */
+} streaming_slot_t;
+
 typedef struct streaming {
   enum StreamingStatus status;
   int random;
   usb_device_t *usb_device;
   uint32_t sample_rate;
   uint32_t frame_size;
-  uint32_t num_frames;
+  uint32_t num_frames;        /* size of the frames and transfers arrays */
+  uint32_t min_frames;        /* bounds of the depth */
+  uint32_t max_frames;
+  uint32_t depth;             /* transfers to keep in flight */
   streaming_read_async_cb_t callback;
   void *callback_context;
-  uint8_t **frames;
+  uint8_t **frames;           /* allocated on first use past the initial depth */
   struct libusb_transfer **transfers;
+  streaming_slot_t *slots;    /* per transfer */
   atomic_int active_transfers;
+  atomic_uint errors;         /* failed transfers since streaming_start() */
+  /* depth controller, see streaming_adapt_depth() */
+  int64_t last_completion_ns;
+  int64_t max_gap_ns;
+  uint32_t adapt_count;
+  uint32_t quiet_windows;
+  /* sample timeline, see streaming_timestamp() */
+  uint64_t sample_count;
+  int64_t epoch_ns;
+  int64_t min_latency_ns;
+  uint32_t latency_count;
 } streaming_t;
 
 
 static const uint32_t DEFAULT_SAMPLE_RATE = 64000000;   /* 64Msps */
 const unsigned int BULK_XFER_TIMEOUT = 5000; // timeout (in ms) for each bulk transfer
+static const uint32_t LATENCY_WINDOW = 1024;            /* transfers between timeline corrections */
+static const uint32_t ADAPT_WINDOW = 256;               /* transfers between depth decisions */
+static const uint32_t ADAPT_SHRINK_WINDOWS = 16;        /* quiet windows before giving a transfer back */
+static const long STOP_EVENTS_TIMEOUT_US = 100000;      /* wait for the cancelled transfers */
+
+
+static void streaming_reset_timeline(streaming_t *this)
+{
+  this->sample_count = 0;
+  this->epoch_ns = 0;
+  this->min_latency_ns = INT64_MAX;
+  this->latency_count = 0;
+}
 
 
 streaming_t *streaming_open_sync(usb_device_t *usb_device)
@@ -93,11 +134,17 @@ streaming_t *streaming_open_sync(usb_device_t *usb_device)
   this->sample_rate = DEFAULT_SAMPLE_RATE;
   this->frame_size = 0;
   this->num_frames = 0;
+  this->min_frames = 0;
+  this->max_frames = 0;
+  this->depth = 0;
   this->callback = 0;
   this->callback_context = 0;
   this->frames = 0;
   this->transfers = 0;
+  this->slots = 0;
   atomic_init(&this->active_transfers, 0);
+  atomic_init(&this->errors, 0);
+  streaming_reset_timeline(this);
 
   ret_val = this;
   return ret_val;
@@ -108,6 +155,39 @@ int streaming_framesize(streaming_t *that)
   return that->frame_size;
 }
 
+
+static uint8_t *streaming_alloc_frame(usb_device_t *usb_device, uint32_t frame_size)
+{
+  #ifdef __linux__
+  return libusb_dev_mem_alloc(usb_device->dev_handle, frame_size);
+  #elif defined(__APPLE__)
+  return (uint8_t *) malloc(frame_size);
+  #endif
+}
+
+
+static void streaming_free_frame(usb_device_t *usb_device, uint8_t *frame, uint32_t frame_size)
+{
+  #ifdef __linux__
+  libusb_dev_mem_free(usb_device->dev_handle, frame, frame_size);
+  #elif defined(__APPLE__)
+  free(frame);
+  #endif
+}
+
+
+static streaming_slot_t *streaming_alloc_slots(streaming_t *this, uint32_t num_frames)
+{
+  streaming_slot_t *slots = (streaming_slot_t *) calloc(num_frames, sizeof(streaming_slot_t));
+  if (slots != 0) {
+    for (uint32_t i = 0; i < num_frames; ++i) {
+      slots[i].streaming = this;
+      slots[i].index = i;
+    }
+  }
+  return slots;
+}
+
 streaming_t *streaming_open_async(usb_device_t *usb_device, uint32_t frame_size,
                       uint32_t num_frames, streaming_read_async_cb_t callback,
                       void *callback_context)
@@ -121,8 +201,7 @@ streaming_t *streaming_open_async(usb_device_t *usb_device, uint32_t frame_size,
   }
 
   /* frame size must be a multiple of max_packet_size * (max_burst + 1) */
-  uint32_t max_xfer_size = usb_device->bulk_in_max_packet_size *
-                           (usb_device->bulk_in_max_burst + 1);
+  uint32_t max_xfer_size = usb_device_max_transfer_size(usb_device);
   if ( !max_xfer_size ) {
     fprintf(stderr, "ERROR: maximum transfer size is 0. probably not connected at USB 3 port?!\n");
     return ret_val;
@@ -137,23 +216,20 @@ streaming_t *streaming_open_async(usb_device_t *usb_device, uint32_t frame_size,
   }
 
   /* allocate frames for zerocopy USB bulk transfers */
-  uint8_t **frames = (uint8_t **) malloc(num_frames * sizeof(uint8_t *));
+  uint8_t **frames = (uint8_t **) calloc(num_frames, sizeof(uint8_t *));
+  if (frames == 0) {
+    log_error("calloc() failed", __func__, __FILE__, __LINE__);
+    return ret_val;
+  }
   for (uint32_t i = 0; i < num_frames; ++i) {
-    #ifdef __linux__
-    frames[i] = libusb_dev_mem_alloc(usb_device->dev_handle, frame_size);
-    #elif defined(__APPLE__)
-    frames[i] = (uint8_t *) malloc(frame_size);
-    #endif
+    frames[i] = streaming_alloc_frame(usb_device, frame_size);
 
     if (frames[i] == 0) {
       log_error("libusb_dev_mem_alloc() failed", __func__, __FILE__, __LINE__);
       for (uint32_t j = 0; j < i; j++) {
-        #ifdef __linux__
-        libusb_dev_mem_free(usb_device->dev_handle, frames[j], frame_size);
-        #elif defined(__APPLE__)
-        free(frames[j]);
-        #endif
+        streaming_free_frame(usb_device, frames[j], frame_size);
       }
+      free(frames);
       return ret_val;
     }
   }
@@ -166,21 +242,38 @@ streaming_t *streaming_open_async(usb_device_t *usb_device, uint32_t frame_size,
   this->sample_rate = DEFAULT_SAMPLE_RATE;
   this->frame_size = frame_size;
   this->num_frames = num_frames;
+  this->min_frames = num_frames;
+  this->max_frames = num_frames;
+  this->depth = num_frames;
   this->callback = callback;
   this->callback_context = callback_context;
   this->frames = frames;
+  this->slots = streaming_alloc_slots(this, num_frames);
 
   /* populate the required libusb_transfer fields */
-  struct libusb_transfer **transfers = (struct libusb_transfer **) malloc(num_frames * sizeof(struct libusb_transfer *));
+  struct libusb_transfer **transfers = (struct libusb_transfer **) calloc(num_frames, sizeof(struct libusb_transfer *));
+  if (this->slots == 0 || transfers == 0) {
+    log_error("calloc() failed", __func__, __FILE__, __LINE__);
+    for (uint32_t i = 0; i < num_frames; i++) {
+      streaming_free_frame(usb_device, frames[i], frame_size);
+    }
+    free(frames);
+    free(this->slots);
+    free(transfers);
+    free(this);
+    return ret_val;
+  }
   for (uint32_t i = 0; i < num_frames; ++i) {
     transfers[i] = libusb_alloc_transfer(0);	// iso_packets_per_frame ?
     libusb_fill_bulk_transfer(transfers[i], usb_device->dev_handle,
                               usb_device->bulk_in_endpoint_address,
                               frames[i], frame_size, streaming_read_async_callback,
-                              this, BULK_XFER_TIMEOUT);
+                              &this->slots[i], BULK_XFER_TIMEOUT);
   }
   this->transfers = transfers;
   atomic_init(&this->active_transfers, 0);
+  atomic_init(&this->errors, 0);
+  streaming_reset_timeline(this);
 
   ret_val = this;
   return ret_val;
@@ -191,21 +284,21 @@ void streaming_close(streaming_t *this)
 {
   if (this->transfers) {
     for (uint32_t i = 0; i < this->num_frames; ++i) {
-      libusb_free_transfer(this->transfers[i]);
+      if (this->transfers[i]) {
+        libusb_free_transfer(this->transfers[i]);
+      }
     }
     free(this->transfers);
   }
   if (this->frames != 0) {
     for (uint32_t i = 0; i < this->num_frames; ++i) {
-      #ifdef __linux__
-      libusb_dev_mem_free(this->usb_device->dev_handle, this->frames[i],
-                          this->frame_size);
-      #elif defined(__APPLE__)
-      free(this->frames[i]);
-      #endif
+      if (this->frames[i]) {
+        streaming_free_frame(this->usb_device, this->frames[i], this->frame_size);
+      }
     }
     free(this->frames);
   }
+  free(this->slots);
   free(this);
   return;
 }
@@ -219,6 +312,62 @@ int streaming_set_sample_rate(streaming_t *this, uint32_t sample_rate)
 }
 
 
+int streaming_set_depth_range(streaming_t *this, uint32_t min_frames, uint32_t max_frames)
+{
+  if (this->status != STREAMING_STATUS_READY || this->callback == 0 ||
+      min_frames == 0 || min_frames > this->depth || max_frames < this->depth) {
+    fprintf(stderr, "ERROR - streaming_set_depth_range() invalid range %u-%u for depth %u\n",
+                    min_frames, max_frames, this->depth);
+    return -1;
+  }
+
+  if (max_frames > this->num_frames) {
+    /* the frames and transfers past the current ones get allocated when the depth grows */
+    uint8_t **frames = (uint8_t **) calloc(max_frames, sizeof(uint8_t *));
+    struct libusb_transfer **transfers = (struct libusb_transfer **) calloc(max_frames, sizeof(struct libusb_transfer *));
+    streaming_slot_t *slots = streaming_alloc_slots(this, max_frames);
+    if (frames == 0 || transfers == 0 || slots == 0) {
+      log_error("calloc() failed", __func__, __FILE__, __LINE__);
+      free(frames);
+      free(transfers);
+      free(slots);
+      return -1;
+    }
+    memcpy(frames, this->frames, this->num_frames * sizeof(uint8_t *));
+    memcpy(transfers, this->transfers, this->num_frames * sizeof(struct libusb_transfer *));
+    /* nothing is in flight while ready: the transfers can move to the new slots */
+    for (uint32_t i = 0; i < this->num_frames; ++i) {
+      if (transfers[i]) {
+        transfers[i]->user_data = &slots[i];
+      }
+    }
+    free(this->frames);
+    free(this->transfers);
+    free(this->slots);
+    this->frames = frames;
+    this->transfers = transfers;
+    this->slots = slots;
+    this->num_frames = max_frames;
+  }
+
+  this->min_frames = min_frames;
+  this->max_frames = max_frames;
+  return 0;
+}
+
+
+uint32_t streaming_depth(streaming_t *this)
+{
+  return this->depth;
+}
+
+
+uint32_t streaming_errors(streaming_t *this)
+{
+  return atomic_load(&this->errors);
+}
+
+
 int streaming_set_random(streaming_t *this, int random)
 {
   this->random = random;
@@ -239,16 +388,19 @@ int streaming_start(streaming_t *this)
     return 0;
   }
 
-  /* submit all the transfers */
+  /* submit the transfers of the current depth */
   atomic_init(&this->active_transfers, 0);
-  for (uint32_t i = 0; i < this->num_frames; ++i) {
-    int ret = libusb_submit_transfer(this->transfers[i]);
-    if (ret < 0) {
-      log_usb_error(ret, __func__, __FILE__, __LINE__);
+  atomic_store(&this->errors, 0);
+  streaming_reset_timeline(this);
+  this->last_completion_ns = 0;
+  this->max_gap_ns = 0;
+  this->adapt_count = 0;
+  this->quiet_windows = 0;
+  for (uint32_t i = 0; i < this->depth; ++i) {
+    if (streaming_submit(this, i) < 0) {
       this->status = STREAMING_STATUS_FAILED;
       return -1;
     }
-    atomic_fetch_add(&this->active_transfers, 1);
   }
 
   this->status = STREAMING_STATUS_STREAMING;
@@ -269,30 +421,29 @@ int streaming_stop(streaming_t *this)
 
   this->status = STREAMING_STATUS_CANCELLED;
 
-  /* flush all the events */
-  struct timeval noblock = { 0, 0 };
-  while (this->active_transfers > 0) {
-    int ret = libusb_handle_events_timeout_completed(this->usb_device->context, &noblock, 0);
-    if (ret < 0) {
+  /* cancel the transfers in flight instead of waiting for them to fill */
+  for (uint32_t i = 0; i < this->num_frames; ++i) {
+    if (!this->slots[i].submitted) {
+      continue;
+    }
+    int ret = libusb_cancel_transfer(this->transfers[i]);
+    if (ret < 0 && ret != LIBUSB_ERROR_NOT_FOUND) {
       log_usb_error(ret, __func__, __FILE__, __LINE__);
       this->status = STREAMING_STATUS_FAILED;
     }
-    usleep(100);
   }
 
-  /* cancel all the active transfers */
-  for (uint32_t i = 0; i < this->num_frames; ++i) {
-    int ret = libusb_cancel_transfer(this->transfers[i]);
-    if (ret < 0) {
-      if (ret == LIBUSB_ERROR_NOT_FOUND)  {
-        continue;
-      }
+  /* their callbacks run from the event handling: sleep in it until the
+   * last one, the caller must not be handling the events anymore */
+  struct timeval timeout = { 0, STOP_EVENTS_TIMEOUT_US };
+  while (atomic_load(&this->active_transfers) > 0) {
+    int ret = libusb_handle_events_timeout_completed(this->usb_device->context, &timeout, 0);
+    if (ret < 0 && ret != LIBUSB_ERROR_INTERRUPTED) {
       log_usb_error(ret, __func__, __FILE__, __LINE__);
       this->status = STREAMING_STATUS_FAILED;
     }
   }
 
-  
   return 0;
 }
 
@@ -351,12 +502,19 @@ int streaming_read_sync(streaming_t *this, uint8_t *data, int length, int *trans
 /* internal functions */
 static void LIBUSB_CALL streaming_read_async_callback(struct libusb_transfer *transfer)
 {
-  streaming_t *this = (streaming_t *) transfer->user_data;
+  streaming_slot_t *slot = (streaming_slot_t *) transfer->user_data;
+  streaming_t *this = slot->streaming;
   int ret;
   switch (transfer->status) {
     case LIBUSB_TRANSFER_COMPLETED:
       /* success!!! */
       if (this->status == STREAMING_STATUS_STREAMING) {
+        /* take the time first, before anything else delays us */
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        int64_t timestamp = streaming_timestamp(this,
+                              (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec,
+                              transfer->actual_length / 2);
         /* remove ADC randomization */
         if (this->random) {
           uint16_t *samples = (uint16_t *) transfer->buffer;
@@ -368,17 +526,29 @@ static void LIBUSB_CALL streaming_read_async_callback(struct libusb_transfer *tr
           }
         }
         this->callback(transfer->actual_length, transfer->buffer,
-                       this->callback_context);
+                       timestamp, this->callback_context);
+
+        streaming_adapt_depth(this, (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec);
+        if (atomic_load(&this->active_transfers) > (int)this->depth) {
+          /* the depth went down: give this transfer back */
+          streaming_transfer_done(this, slot->index);
+          return;
+        }
+
         ret = libusb_submit_transfer(transfer);
         if (ret == 0) {
           return;
         }
         log_usb_error(ret, __func__, __FILE__, __LINE__);
+        atomic_fetch_add(&this->errors, 1);
+        break;
       }
-      break;
+      /* completed while stopping: not a failure, just not resubmitted */
+      streaming_transfer_done(this, slot->index);
+      return;
     case LIBUSB_TRANSFER_CANCELLED:
       /* librtlsdr does also ignore LIBUSB_TRANSFER_CANCELLED */
-      atomic_fetch_sub(&this->active_transfers, 1);
+      streaming_transfer_done(this, slot->index);
       return;
     case LIBUSB_TRANSFER_ERROR:
     case LIBUSB_TRANSFER_TIMED_OUT:
@@ -386,15 +556,19 @@ static void LIBUSB_CALL streaming_read_async_callback(struct libusb_transfer *tr
     case LIBUSB_TRANSFER_NO_DEVICE:
     case LIBUSB_TRANSFER_OVERFLOW:
       log_usb_error(transfer->status, __func__, __FILE__, __LINE__);
+      atomic_fetch_add(&this->errors, 1);
       break;
   }
 
   this->status = STREAMING_STATUS_FAILED;
-  atomic_fetch_sub(&this->active_transfers, 1);
+  streaming_transfer_done(this, slot->index);
 
   /* cancel all the active transfers */
   for (uint32_t i = 0; i < this->num_frames; ++i) {
-    int ret = libusb_cancel_transfer(transfer);
+    if (!this->slots[i].submitted) {
+      continue;
+    }
+    int ret = libusb_cancel_transfer(this->transfers[i]);
     if (ret < 0) {
       if (ret == LIBUSB_ERROR_NOT_FOUND) {
         continue;
@@ -403,4 +577,145 @@ static void LIBUSB_CALL streaming_read_async_callback(struct libusb_transfer *tr
     }
   }
   return;
-}
\ No newline at end of file
+}
+
+
+/* Returns the time of the first sample of a transfer of 'samples' samples
+ * that completed at 'completion_ns'.
+ *
+ * The completion time itself is a poor timestamp: it is late by the USB and
+ * scheduling delays, which vary from one transfer to the next. The time of a
+ * sample is instead derived from its position in the stream and the ADC
+ * rate, so it is exact relative to the other samples. That timeline is
+ * anchored on the host clock: the smallest delay seen over a window of
+ * transfers is the best estimate of how far the timeline is from the host
+ * clock (initial error and drift of the ADC clock), and it gets folded back
+ * into the epoch once per window.
+ */
+static int64_t streaming_timestamp(streaming_t *this, int64_t completion_ns,
+                                   uint32_t samples)
+{
+  const double ns_per_sample = 1.0e9 / this->sample_rate;
+  const int64_t duration_ns = (int64_t)(samples * ns_per_sample);
+
+  if (this->epoch_ns == 0) {
+    /* the first sample of the first transfer was taken one transfer ago */
+    this->epoch_ns = completion_ns - duration_ns;
+  }
+
+  int64_t timestamp = this->epoch_ns + (int64_t)(this->sample_count * ns_per_sample);
+  this->sample_count += samples;
+
+  int64_t latency = completion_ns - (timestamp + duration_ns);
+  if (latency < this->min_latency_ns) {
+    this->min_latency_ns = latency;
+  }
+  if (++this->latency_count == LATENCY_WINDOW) {
+    this->epoch_ns += this->min_latency_ns;
+    this->min_latency_ns = INT64_MAX;
+    this->latency_count = 0;
+  }
+
+  return timestamp;
+}
+
+
+/* Allocates transfer 'index' on first use and submits it */
+static int streaming_submit(streaming_t *this, uint32_t index)
+{
+  if (this->frames[index] == 0) {
+    this->frames[index] = streaming_alloc_frame(this->usb_device, this->frame_size);
+    if (this->frames[index] == 0) {
+      log_error("libusb_dev_mem_alloc() failed", __func__, __FILE__, __LINE__);
+      return -1;
+    }
+  }
+  if (this->transfers[index] == 0) {
+    this->transfers[index] = libusb_alloc_transfer(0);
+    libusb_fill_bulk_transfer(this->transfers[index], this->usb_device->dev_handle,
+                              this->usb_device->bulk_in_endpoint_address,
+                              this->frames[index], this->frame_size,
+                              streaming_read_async_callback, &this->slots[index], BULK_XFER_TIMEOUT);
+  }
+
+  int ret = libusb_submit_transfer(this->transfers[index]);
+  if (ret < 0) {
+    log_usb_error(ret, __func__, __FILE__, __LINE__);
+    return -1;
+  }
+  this->slots[index].submitted = 1;
+  atomic_fetch_add(&this->active_transfers, 1);
+  return 0;
+}
+
+
+/* Accounts for a transfer that is no longer in flight */
+static void streaming_transfer_done(streaming_t *this, uint32_t index)
+{
+  this->slots[index].submitted = 0;
+  atomic_fetch_sub(&this->active_transfers, 1);
+}
+
+
+/* Adjusts the number of transfers in flight to the completion jitter.
+ *
+ * The transfers in flight are what covers the time the host does not
+ * service the controller: 'depth' transfers last depth * frame duration.
+ * Over each window, the longest interval between two completions tells
+ * how much of that margin was needed. When it used more than half of it,
+ * the depth doubles (up to max_frames) right away; when it used less than
+ * an eighth for ADAPT_SHRINK_WINDOWS windows in a row, one transfer is
+ * given back (down to min_frames). Growing is fast and shrinking slow, so
+ * a noisy host settles on a safe depth instead of oscillating.
+ */
+static void streaming_adapt_depth(streaming_t *this, int64_t completion_ns)
+{
+  if (this->min_frames == this->max_frames) {
+    return;
+  }
+
+  if (this->last_completion_ns != 0) {
+    int64_t gap = completion_ns - this->last_completion_ns;
+    if (gap > this->max_gap_ns) {
+      this->max_gap_ns = gap;
+    }
+  }
+  this->last_completion_ns = completion_ns;
+
+  if (++this->adapt_count < ADAPT_WINDOW) {
+    return;
+  }
+
+  const int64_t frame_ns = (int64_t)(this->frame_size / 2 * 1.0e9 / this->sample_rate);
+  const int64_t margin_ns = this->depth * frame_ns;
+
+  if (this->max_gap_ns * 2 > margin_ns && this->depth < this->max_frames) {
+    uint32_t depth = this->depth * 2;
+    if (depth > this->max_frames) {
+      depth = this->max_frames;
+    }
+    for (uint32_t i = 0; i < this->num_frames && (uint32_t)atomic_load(&this->active_transfers) < depth; ++i) {
+      if (!this->slots[i].submitted && streaming_submit(this, i) < 0) {
+        /* out of pinned memory: stay where we are */
+        depth = atomic_load(&this->active_transfers);
+        if (depth < this->depth) {
+          depth = this->depth;
+        }
+        this->max_frames = depth;
+        break;
+      }
+    }
+    this->depth = depth;
+    this->quiet_windows = 0;
+  } else if (this->max_gap_ns * 8 < margin_ns && this->depth > this->min_frames) {
+    if (++this->quiet_windows >= ADAPT_SHRINK_WINDOWS) {
+      this->depth--;
+      this->quiet_windows = 0;
+    }
+  } else {
+    this->quiet_windows = 0;
+  }
+
+  this->max_gap_ns = 0;
+  this->adapt_count = 0;
+}
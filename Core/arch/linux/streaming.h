@@ -31,8 +31,10 @@ extern "C" {
 
 typedef struct streaming streaming_t;
 
+/* timestamp_ns is the host time (CLOCK_REALTIME, in ns) of the first sample
+   of the transfer, see streaming_read_async_callback() */
 typedef void (*streaming_read_async_cb_t)(uint32_t data_size, uint8_t *data,
-		                                      void *context);
+                                          int64_t timestamp_ns, void *context);
 
 streaming_t *streaming_open_sync(usb_device_t *usb_device);
 
@@ -45,6 +47,18 @@ void streaming_close(streaming_t *that);
 
 int streaming_set_sample_rate(streaming_t *that, uint32_t sample_rate);
 
+/* lets the number of transfers in flight follow the completion jitter,
+   between min_frames and max_frames (the num_frames given to
+   streaming_open_async() is the starting point) - call before streaming_start() */
+int streaming_set_depth_range(streaming_t *that, uint32_t min_frames,
+                              uint32_t max_frames);
+
+/* number of transfers currently kept in flight */
+uint32_t streaming_depth(streaming_t *that);
+
+/* number of transfers which failed since streaming_start() */
+uint32_t streaming_errors(streaming_t *that);
+
 int streaming_set_random(streaming_t *that, int random);
 
 int streaming_start(streaming_t *that);
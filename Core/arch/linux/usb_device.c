@@ -43,6 +43,24 @@
 
 typedef struct usb_device usb_device_t;
 
+#if LIBUSB_API_VERSION >= 0x01000105
+static const long EVENTS_TIMEOUT_US = 1000000;   /* idle wakeups, the interrupt ends the wait */
+#else
+static const long EVENTS_TIMEOUT_US = 10000;     /* no libusb_interrupt_event_handler() */
+#endif
+
+/* tv_usec must stay below a second, libusb refuses the timeval otherwise */
+static struct timeval events_timeout(void)
+{
+  struct timeval timeout = { EVENTS_TIMEOUT_US / 1000000, EVENTS_TIMEOUT_US % 1000000 };
+  return timeout;
+}
+
+static const int FIRMWARE_POLL_MS = 10;       /* re-enumeration after the firmware upload */
+static const int FIRMWARE_TIMEOUT_MS = 5000;
+#define FIRMWARE_VERIFY_ENV "SDDC_FIRMWARE_VERIFY"
+#define MAX_PORT_PATH 8     /* bus, then up to 7 hub ports */
+
 /* internal functions */
 static libusb_device_handle *find_usb_device(int index, libusb_context *ctx,
                              libusb_device **device, int *needs_firmware);
@@ -54,6 +72,11 @@ static int transfer_image(const uint8_t *image,
 static int list_endpoints(struct libusb_endpoint_descriptor endpoints[],
                           struct libusb_ss_endpoint_companion_descriptor ss_endpoints[],
                           libusb_device *device);
+static void LIBUSB_CALL control_write_callback(struct libusb_transfer *transfer);
+static libusb_device *match_usb_device(libusb_device **list, ssize_t nusbdevices,
+                                       int index, int *needs_firmware);
+static int port_path(libusb_device *device, uint8_t *path, int size);
+static int wait_for_firmware(const uint8_t *path, int path_len, libusb_context *ctx);
 
 
 struct usb_device_id {
@@ -159,7 +182,7 @@ int usb_device_get_device_list(struct usb_device_info **usb_device_infos)
           log_usb_error(ret, __func__, __FILE__, __LINE__);
           goto FAIL3;
         }
-        device_infos[count].manufacturer = (unsigned char *) realloc(device_infos[count].manufacturer, ret);
+        device_infos[count].manufacturer = (unsigned char *) realloc(device_infos[count].manufacturer, ret + 1);
       }
 
       device_infos[count].product = (unsigned char *) malloc(MAX_STRING_BYTES);
@@ -171,7 +194,7 @@ int usb_device_get_device_list(struct usb_device_info **usb_device_infos)
           log_usb_error(ret, __func__, __FILE__, __LINE__);
           goto FAIL3;
         }
-        device_infos[count].product = (unsigned char *) realloc(device_infos[count].product, ret);
+        device_infos[count].product = (unsigned char *) realloc(device_infos[count].product, ret + 1);
       }
 
       device_infos[count].serial_number = (unsigned char *) malloc(MAX_STRING_BYTES);
@@ -183,7 +206,7 @@ int usb_device_get_device_list(struct usb_device_info **usb_device_infos)
           log_usb_error(ret, __func__, __FILE__, __LINE__);
           goto FAIL3;
         }
-        device_infos[count].serial_number = (unsigned char *) realloc(device_infos[count].serial_number, ret);
+        device_infos[count].serial_number = (unsigned char *) realloc(device_infos[count].serial_number, ret + 1);
       }
       ret = 0;
 FAIL3:
@@ -253,6 +276,14 @@ usb_device_t *usb_device_open(int index, const char* image,
   }
 
   if (needs_firmware) {
+    /* the firmware re-enumerates at the same port, maybe as another index */
+    uint8_t path[MAX_PORT_PATH];
+    int path_len = port_path(device, path, MAX_PORT_PATH);
+    if (path_len < 0) {
+      log_error("port_path() failed", __func__, __FILE__, __LINE__);
+      goto FAIL2;
+    }
+
     ret = load_image(dev_handle, image, size);
     if (ret != 0) {
       log_error("load_image() failed", __func__, __FILE__, __LINE__);
@@ -262,8 +293,11 @@ usb_device_t *usb_device_open(int index, const char* image,
     /* rescan USB to get a new device handle */
     libusb_close(dev_handle);
 
-    /* wait unitl firmware is ready */
-    usleep(500 * 1000L);
+    /* wait until the firmware has re-enumerated */
+    index = wait_for_firmware(path, path_len, ctx);
+    if (index < 0) {
+      goto FAIL1;
+    }
 
     needs_firmware = 0;
     dev_handle = find_usb_device(index, ctx, &device, &needs_firmware);
@@ -315,6 +349,8 @@ usb_device_t *usb_device_open(int index, const char* image,
   this->dev_handle = dev_handle;
   this->context = ctx;
   this->completed = 0;
+  atomic_init(&this->control_pending, 0);
+  atomic_init(&this->control_failed, 0);
   this->nendpoints = nendpoints;
   memset(this->endpoints, 0, sizeof(this->endpoints));
   for (int i = 0; i < nendpoints; ++i) {
@@ -346,9 +382,27 @@ void usb_device_close(usb_device_t *this)
 }
 
 
+/* Sleeps until there are USB events to handle and handles them.
+ * usb_device_interrupt_events() makes it return right away; with a libusb
+ * too old to interrupt the wait, the timeout bounds how late that is */
 int usb_device_handle_events(usb_device_t *this)
 {
-  return libusb_handle_events_completed(this->context, &this->completed);
+  struct timeval timeout = events_timeout();
+  int ret = libusb_handle_events_timeout_completed(this->context, &timeout, &this->completed);
+  return ret == LIBUSB_ERROR_INTERRUPTED ? 0 : ret;
+}
+
+void usb_device_interrupt_events(usb_device_t *this)
+{
+#if LIBUSB_API_VERSION >= 0x01000105
+  libusb_interrupt_event_handler(this->context);
+#endif
+}
+
+/* bulk transfers must be a multiple of this size (0 if not connected at a USB 3 port) */
+uint32_t usb_device_max_transfer_size(usb_device_t *this)
+{
+  return this->bulk_in_max_packet_size * (this->bulk_in_max_burst + 1);
 }
 
 int usb_device_control(usb_device_t *this, uint8_t request, uint16_t value,
@@ -384,23 +438,74 @@ int usb_device_control(usb_device_t *this, uint8_t request, uint16_t value,
   return 0;
 }
 
+/* Queues a control write without waiting for it: the writes submitted back
+ * to back go out in order without a round trip each. The buffer is copied */
+int usb_device_control_submit(usb_device_t *this, uint8_t request, uint16_t value,
+                              uint16_t index, const uint8_t *data, uint16_t length)
+{
+  const uint8_t bmWriteRequestType = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE;
+  const unsigned int timeout = 5000;        // timeout (in ms) for each command
 
+  struct libusb_transfer *transfer = libusb_alloc_transfer(0);
+  uint8_t *buffer = (uint8_t *) malloc(LIBUSB_CONTROL_SETUP_SIZE + length);
+  if (transfer == 0 || buffer == 0) {
+    log_error("out of memory", __func__, __FILE__, __LINE__);
+    libusb_free_transfer(transfer);
+    free(buffer);
+    return -1;
+  }
 
-/* internal functions */
-static libusb_device_handle *find_usb_device(int index, libusb_context *ctx,
-                             libusb_device **device, int *needs_firmware)
+  libusb_fill_control_setup(buffer, bmWriteRequestType, request, value, index, length);
+  memcpy(buffer + LIBUSB_CONTROL_SETUP_SIZE, data, length);
+  libusb_fill_control_transfer(transfer, this->dev_handle, buffer,
+                               control_write_callback, this, timeout);
+  transfer->flags = LIBUSB_TRANSFER_FREE_BUFFER | LIBUSB_TRANSFER_FREE_TRANSFER;
+
+  atomic_fetch_add(&this->control_pending, 1);
+  int ret = libusb_submit_transfer(transfer);
+  if (ret < 0) {
+    log_usb_error(ret, __func__, __FILE__, __LINE__);
+    atomic_fetch_sub(&this->control_pending, 1);
+    libusb_free_transfer(transfer);
+    return -1;
+  }
+  return 0;
+}
+
+/* Waits for the writes of usb_device_control_submit(). Their completion is
+ * handled here, or by the streaming thread when it is running */
+int usb_device_control_wait(usb_device_t *this)
 {
-  libusb_device_handle *ret_val = 0;
+  struct timeval timeout = events_timeout();
+  while (atomic_load(&this->control_pending) > 0) {
+    int ret = libusb_handle_events_timeout_completed(this->context, &timeout, 0);
+    if (ret < 0 && ret != LIBUSB_ERROR_INTERRUPTED) {
+      log_usb_error(ret, __func__, __FILE__, __LINE__);
+      return -1;
+    }
+  }
 
-  *device = 0;
-  *needs_firmware = 0;
+  return atomic_exchange(&this->control_failed, 0) == 0 ? 0 : -1;
+}
 
-  libusb_device **list = 0;
-  ssize_t nusbdevices = libusb_get_device_list(ctx, &list);
-  if (nusbdevices < 0) {
-    log_usb_error(nusbdevices, __func__, __FILE__, __LINE__);
-    goto FAIL0;
+
+
+/* internal functions */
+static void LIBUSB_CALL control_write_callback(struct libusb_transfer *transfer)
+{
+  usb_device_t *this = (usb_device_t *) transfer->user_data;
+  if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+    log_usb_error(transfer->status, __func__, __FILE__, __LINE__);
+    atomic_fetch_add(&this->control_failed, 1);
   }
+  atomic_fetch_sub(&this->control_pending, 1);
+}
+
+/* The index-th of the devices in 'list' we know, in boot loader mode or not */
+static libusb_device *match_usb_device(libusb_device **list, ssize_t nusbdevices,
+                                       int index, int *needs_firmware)
+{
+  libusb_device *ret_val = 0;
 
   int count = 0;
   for (ssize_t j = 0; j < nusbdevices; ++j) {
@@ -411,7 +516,7 @@ static libusb_device_handle *find_usb_device(int index, libusb_context *ctx,
       if (desc.idVendor == usb_device_ids[i].vid &&
           desc.idProduct == usb_device_ids[i].pid) {
         if (count == index) {
-          *device = dev;
+          ret_val = dev;
           *needs_firmware = usb_device_ids[i].needs_firmware;
         }
         count++;
@@ -419,6 +524,73 @@ static libusb_device_handle *find_usb_device(int index, libusb_context *ctx,
     }
   }
 
+  return ret_val;
+}
+
+/* Bus number then port numbers of a device, its length (-1 on error) */
+static int port_path(libusb_device *device, uint8_t *path, int size)
+{
+  path[0] = libusb_get_bus_number(device);
+  int ports = libusb_get_port_numbers(device, path + 1, size - 1);
+  return ports < 0 ? -1 : ports + 1;
+}
+
+/* Polls the bus until the device at 'path' shows up with its firmware
+ * running, rather than sleeping for the slowest re-enumeration.
+ * The index of a device may change meanwhile (another radio takes it
+ * once the boot loader left the bus), its port does not.
+ * Returns the index of the device, -1 on timeout */
+static int wait_for_firmware(const uint8_t *path, int path_len, libusb_context *ctx)
+{
+  for (int elapsed = 0; elapsed < FIRMWARE_TIMEOUT_MS; elapsed += FIRMWARE_POLL_MS) {
+    usleep(FIRMWARE_POLL_MS * 1000L);
+
+    libusb_device **list = 0;
+    ssize_t nusbdevices = libusb_get_device_list(ctx, &list);
+    if (nusbdevices < 0) {
+      log_usb_error(nusbdevices, __func__, __FILE__, __LINE__);
+      return -1;
+    }
+
+    int found = -1;
+    for (int index = 0; found < 0; index++) {
+      int needs_firmware = 1;
+      libusb_device *device = match_usb_device(list, nusbdevices, index, &needs_firmware);
+      if (device == 0)
+        break;
+
+      uint8_t device_path[MAX_PORT_PATH];
+      if (port_path(device, device_path, MAX_PORT_PATH) == path_len &&
+          memcmp(device_path, path, path_len) == 0 && !needs_firmware)
+        found = index;
+    }
+    libusb_free_device_list(list, 1);
+
+    if (found >= 0) {
+      return found;
+    }
+  }
+
+  log_error("device is still in boot loader mode", __func__, __FILE__, __LINE__);
+  return -1;
+}
+
+static libusb_device_handle *find_usb_device(int index, libusb_context *ctx,
+                             libusb_device **device, int *needs_firmware)
+{
+  libusb_device_handle *ret_val = 0;
+
+  *device = 0;
+  *needs_firmware = 0;
+
+  libusb_device **list = 0;
+  ssize_t nusbdevices = libusb_get_device_list(ctx, &list);
+  if (nusbdevices < 0) {
+    log_usb_error(nusbdevices, __func__, __FILE__, __LINE__);
+    goto FAIL0;
+  }
+
+  *device = match_usb_device(list, nusbdevices, index, needs_firmware);
   if (*device == 0) {
     fprintf(stderr, "ERROR - usb_device@%d not found\n", index);
     goto FAIL1;
@@ -471,6 +643,11 @@ int load_image(libusb_device_handle *dev_handle, const char *image, uint32_t ima
   const int stage = 0;
   verbose = 1;
 
+  /* the image checksum is checked before the upload, reading every chunk
+   * back only doubles the cold start time: on request */
+  const char *verify = getenv(FIRMWARE_VERIFY_ENV);
+  fx3_verify = verify != 0 && strcmp(verify, "1") == 0;
+
   ret_val = fx3_load_ram(dev_handle, image);
   return ret_val;
 }
@@ -48,11 +48,20 @@ usb_device_t *usb_device_open(int index, const char* image,
 
 int usb_device_handle_events(usb_device_t *t);
 
+void usb_device_interrupt_events(usb_device_t *t);
+
+uint32_t usb_device_max_transfer_size(usb_device_t *t);
+
 void usb_device_close(usb_device_t *t);
 
 int usb_device_control(usb_device_t *t, uint8_t request, uint16_t value,
                        uint16_t index, uint8_t *data, uint16_t length, int read);
 
+int usb_device_control_submit(usb_device_t *t, uint8_t request, uint16_t value,
+                              uint16_t index, const uint8_t *data, uint16_t length);
+
+int usb_device_control_wait(usb_device_t *t);
+
 #ifdef __cplusplus
 }
 #endif
@@ -23,6 +23,8 @@
 #ifndef __USB_DEVICE_INTERNALS_H
 #define __USB_DEVICE_INTERNALS_H
 
+#include <stdatomic.h>
+
 #include "usb_device.h"
 
 
@@ -35,6 +37,8 @@ typedef struct usb_device {
   libusb_device_handle *dev_handle;
   libusb_context *context;
   int completed;
+  atomic_int control_pending;   /* asynchronous control writes in flight */
+  atomic_int control_failed;
   int nendpoints;
 #define MAX_ENDPOINTS (16)
   struct libusb_endpoint_descriptor endpoints[MAX_ENDPOINTS];
@@ -0,0 +1,156 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "usb_registry.h"
+#include "usb_device.h"
+#include "FX3handler.h"
+#include "../../config.h"
+
+#define TAG "USBRegistry"
+
+using namespace std::chrono;
+
+// Rescan period when libusb can't report the changes
+static const milliseconds RESCAN_INTERVAL(1000);
+// A device that just arrived may not be readable yet (udev rules, re-enumeration)
+static const long HOTPLUG_RETRY_US = 100000;
+static const int HOTPLUG_RETRIES = 20;
+
+static bool scan_usb_devices(vector<SDDC::DeviceItem>& devices)
+{
+    struct usb_device_info *infos = nullptr;
+    int count = usb_device_get_device_list(&infos);
+    if (count < 0)
+        return false;
+
+    for (int i = 0; i < count; i++)
+    {
+        SDDC::DeviceItem dev = {
+            .index = (uint8_t)i,
+            .product = string(infos[i].product),
+            .serial_number = string(infos[i].serial_number)
+        };
+        devices.push_back(dev);
+    }
+    usb_device_free_device_list(infos);
+
+    return true;
+}
+
+DeviceRegistry& usb_registry::Get()
+{
+    static usb_registry instance;
+    return *instance.registry;
+}
+
+usb_registry::usb_registry():
+    context(nullptr),
+    hotplug(0),
+    run(false),
+    changed(false)
+{
+    TracePrintln(TAG, "");
+
+    if (libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG))
+    {
+        int ret = libusb_init(&context);
+        if (ret == LIBUSB_SUCCESS)
+        {
+            ret = libusb_hotplug_register_callback(context,
+                (libusb_hotplug_event)(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+                LIBUSB_HOTPLUG_NO_FLAGS, VENDOR_ID, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+                HotplugCallback, this, &hotplug);
+            if (ret != LIBUSB_SUCCESS)
+            {
+                libusb_exit(context);
+                context = nullptr;
+            }
+        }
+        else
+        {
+            context = nullptr;
+        }
+
+        if (context == nullptr)
+            WarnPrintln(TAG, "Hotplug events unavailable (%s), rescanning every %d ms",
+                libusb_error_name(ret), (int)RESCAN_INTERVAL.count());
+    }
+
+    registry.reset(new DeviceRegistry(scan_usb_devices, context ? milliseconds(0) : RESCAN_INTERVAL));
+
+    if (context)
+    {
+        run = true;
+        event_thread = std::thread([this]() { Run(); });
+    }
+}
+
+usb_registry::~usb_registry()
+{
+    TracePrintln(TAG, "");
+
+    if (context)
+    {
+        run = false;
+        // Both wake up the event thread
+        libusb_hotplug_deregister_callback(context, hotplug);
+#if LIBUSB_API_VERSION >= 0x01000105
+        libusb_interrupt_event_handler(context);
+#endif
+        event_thread.join();
+        libusb_exit(context);
+    }
+}
+
+// Runs in the event handler: the scan itself opens the devices, which can't be done here
+int LIBUSB_CALL usb_registry::HotplugCallback(libusb_context *ctx, libusb_device *device,
+                                              libusb_hotplug_event event, void *user_data)
+{
+    usb_registry *self = (usb_registry *)user_data;
+
+    DebugPrintln(TAG, "Device %s", event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED ? "arrived" : "left");
+    self->registry->Invalidate();
+    self->changed = true;
+
+    return 0;   // stay registered
+}
+
+void usb_registry::Run()
+{
+    int retries = 0;
+
+    while (run)
+    {
+        struct timeval timeout = { 1, 0 };
+        if (retries > 0)
+            timeout = { 0, HOTPLUG_RETRY_US };
+
+        libusb_handle_events_timeout_completed(context, &timeout, nullptr);
+
+        // A re-enumeration comes as several events, handled by one scan
+        if (changed.exchange(false))
+            retries = HOTPLUG_RETRIES;
+
+        if (retries > 0 && run)
+        {
+            // Past the last retry, the next Snapshot() scans on demand
+            retries = registry->Refresh() ? 0 : retries - 1;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <libusb.h>
+
+#include "../../device_registry.h"
+
+/**
+ * @brief Process wide list of the USB devices handled by the driver
+ *
+ * Scanned once, then rescanned by a background thread when libusb reports
+ * that a device arrived or left. Without hotplug support, the list is
+ * rescanned when it gets older than a second.
+ */
+class usb_registry
+{
+public:
+    static DeviceRegistry& Get();
+
+private:
+    usb_registry();
+    ~usb_registry();
+
+    static int LIBUSB_CALL HotplugCallback(libusb_context *ctx, libusb_device *device,
+                                           libusb_hotplug_event event, void *user_data);
+    void Run();
+
+    std::unique_ptr<DeviceRegistry> registry;
+    libusb_context *context;
+    libusb_hotplug_callback_handle hotplug;
+    std::atomic<bool> run;
+    std::atomic<bool> changed;    // set by the callback, the scan happens out of the event handler
+    std::thread event_thread;
+};
@@ -8,8 +8,12 @@
 // modified 2017 11 30 ik1xpv@gmail.com, http://www.steila.com/blog
 // 
 #include <windows.h>
+#include <chrono>
+#include <limits.h>
+#include <vector>
 #include "../../config.h"
 #include "FX3handler.h"
+#include "../../thread_config.h"
 #include "./CyAPI/CyAPI.h"
 #include "./CyAPI/cyioctl.h"
 #include "firmware.h"
@@ -26,6 +30,8 @@ fx3class* CreateUsbHandler()
 fx3handler::fx3handler():
 	fx3dev (nullptr),
 	Fx3IsOn (false),
+	numofblock (0),
+	adc_rate (DEFAULT_ADC_FREQ),
 	devidx (0)
 {
 
@@ -98,11 +104,7 @@ bool  fx3handler::Open() {
 		return r;      // init failed
 	}
 
-	long pktSize = EndPt->MaxPktSize;
-	EndPt->SetXferSize(transferSize);
-	long ppx = transferSize / pktSize;
-	DbgPrintf("buffer transferSize = %d. packet size = %ld. packets per transfer = %ld\n"
-		, transferSize, pktSize, ppx);
+	DbgPrintf("packet size = %ld\n", (long)EndPt->MaxPktSize);
 
 	uint8_t data[4];
 	GetHardwareInfo((uint32_t*)&data);
@@ -140,6 +142,9 @@ bool fx3handler::Control(FX3Command command, UINT8 data) { // firmware control B
 bool fx3handler::Control(FX3Command command, UINT32 data) { // firmware control BBRF
 	long lgt = 4;
 
+	if (command == STARTADC)
+		adc_rate = data;
+
 	fx3dev->ControlEndPt->ReqCode = command;
 	fx3dev->ControlEndPt->Value = (USHORT)0;
 	fx3dev->ControlEndPt->Index = (USHORT)0;
@@ -329,19 +334,18 @@ void fx3handler::CleanupDataXfer(void** context)
 	delete (readContext);
 }
 
-#define USB_READ_CONCURRENT 4
-
 void fx3handler::AdcSamplesProcess()
 {
 	DbgPrintf("AdcSamplesProc thread runs\n");
 	int buf_idx;            // queue index
 	int read_idx;
-	void*		contexts[USB_READ_CONCURRENT];
+	const int depth = numofblock;	// overlapped reads in flight
+	std::vector<void*> contexts(depth, nullptr);
 
-	memset(contexts, 0, sizeof(contexts));
+	const long transferSize = inputbuffer->getBlockSize() * sizeof(int16_t);
 
 	// Queue-up the first batch of transfer requests
-	for (int n = 0; n < USB_READ_CONCURRENT; n++) {
+	for (int n = 0; n < depth; n++) {
 		auto ptr = inputbuffer->peekWritePtr(n);
 		if (!BeginDataXfer((uint8_t*)ptr, transferSize, &contexts[n])) {
 			DbgPrintf("Xfer request rejected.\n");
@@ -352,26 +356,51 @@ void fx3handler::AdcSamplesProcess()
 	read_idx = 0;	// context cycle index
 	buf_idx = 0;	// buffer cycle index
 
+	// Sample timeline: the time of a block comes from its position in the stream,
+	// anchored on the host clock with the smallest completion delay of each window
+	// (same scheme as streaming_timestamp() in the libusb backend)
+	const double ns_per_sample = 1.0e9 / adc_rate;
+	const int64_t block_ns = (int64_t)(inputbuffer->getBlockSize() * ns_per_sample);
+	uint64_t sample_count = 0;
+	int64_t epoch_ns = 0;
+	int64_t min_latency_ns = LLONG_MAX;
+	int latency_count = 0;
+
 	// The infinite xfer loop.
 	while (run) {
 		if (!FinishDataXfer(&contexts[read_idx])) {
 			break;
 		}
 
+		int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+		if (epoch_ns == 0)
+			epoch_ns = now_ns - block_ns;
+		int64_t timestamp = epoch_ns + (int64_t)(sample_count * ns_per_sample);
+		sample_count += inputbuffer->getBlockSize();
+		if (now_ns - (timestamp + block_ns) < min_latency_ns)
+			min_latency_ns = now_ns - (timestamp + block_ns);
+		if (++latency_count == 1024) {
+			epoch_ns += min_latency_ns;
+			min_latency_ns = LLONG_MAX;
+			latency_count = 0;
+		}
+
+		inputbuffer->setWriteTimestamp(timestamp);
 		inputbuffer->WriteDone();
 
 		// Re-submit this queue element to keep the queue full
-		auto ptr = inputbuffer->peekWritePtr(USB_READ_CONCURRENT - 1);
+		auto ptr = inputbuffer->peekWritePtr(depth - 1);
 		if (!BeginDataXfer((uint8_t*)ptr, transferSize, &contexts[read_idx])) { // BeginDataXfer failed
 			DbgPrintf("Xfer request rejected.\n");
 			break;
 		}
 
 		buf_idx = (buf_idx + 1) % QUEUE_SIZE;
-		read_idx = (read_idx + 1) % USB_READ_CONCURRENT;
+		read_idx = (read_idx + 1) % depth;
 	}  // End of the infinite loop
 
-	for (int n = 0; n < USB_READ_CONCURRENT; n++) {
+	for (int n = 0; n < depth; n++) {
 		CleanupDataXfer(&contexts[n]);
 	}
 
@@ -379,18 +408,42 @@ void fx3handler::AdcSamplesProcess()
 	return;  // void *
 }
 
-void fx3handler::StartStream(ringbuffer<int16_t>& input, int numofblock)
+uint32_t fx3handler::GetTransferDepth()
+{
+	return numofblock;
+}
+
+uint32_t fx3handler::GetTransferGranularity()
+{
+	return EndPt ? EndPt->MaxPktSize : 0;
+}
+
+// numofblock overlapped reads stay queued, each one into its own block of the ring.
+// The depth is fixed, maxnumofblock is ignored
+void fx3handler::StartStream(ringbuffer<int16_t>& input, int numofblock, int maxnumofblock)
 {
 	// Allocate the context and buffers
 	inputbuffer = &input;
 
-	inputbuffer->setBlockSize(transferSamples);
+	long pktSize = EndPt->MaxPktSize;
+	long transferSize = inputbuffer->getBlockSize() * sizeof(int16_t);
+	EndPt->SetXferSize(transferSize);
+	DbgPrintf("buffer transferSize = %ld. packet size = %ld. packets per transfer = %ld\n"
+		, transferSize, pktSize, transferSize / pktSize);
 
-	// create the thread
+	// create the thread, with a block left for the consumer
 	this->numofblock = numofblock;
+	if (this->numofblock > inputbuffer->getBlockCount() - 1)
+		this->numofblock = inputbuffer->getBlockCount() - 1;
+	if (this->numofblock < 1)
+		this->numofblock = 1;
+	if (this->numofblock != numofblock)
+		DbgPrintf("%d overlapped reads in flight instead of %d, for a ring of %d blocks\n",
+			this->numofblock, numofblock, inputbuffer->getBlockCount());
 	run = true;
 	adc_samples_thread = new std::thread(
 		[this]() {
+			sddc_thread_apply(SDDC_THREAD_USB, usb_thread_config);
 			this->AdcSamplesProcess();
 		}
 	);
@@ -404,6 +457,7 @@ void fx3handler::StopStream()
 
 	// force exit the thread
 	inputbuffer = nullptr;
+	numofblock = 0;
 
 	delete adc_samples_thread;
 }
@@ -42,8 +42,10 @@ public:
 	bool SetArgument(uint16_t index, uint16_t value);
 	bool GetHardwareInfo(uint32_t* data);
 	bool ReadDebugTrace(uint8_t* pdata, uint8_t len);
-	void StartStream(ringbuffer<int16_t>& input, int numofblock);
+	uint32_t GetTransferGranularity();
+	void StartStream(ringbuffer<int16_t>& input, int numofblock, int maxnumofblock = 0);
 	void StopStream();
+	uint32_t GetTransferDepth();
 	bool Enumerate(unsigned char &idx, char *lbuf);
 private:
 	bool SendI2cbytes(uint8_t i2caddr, uint8_t regaddr, uint8_t* pdata, uint8_t len);
@@ -65,6 +67,7 @@ private:
 
 	ringbuffer<int16_t> *inputbuffer;
 	int numofblock;
+	uint32_t adc_rate;	// last rate sent with STARTADC, times the samples
 	bool run;
 	UCHAR devidx;
 };
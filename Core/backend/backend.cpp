@@ -0,0 +1,108 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "backend.h"
+#include "fx3generator.h"
+#include "fx3replay.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TAG "Backend"
+
+fx3class* CreateFx3Backend(const char* spec)
+{
+    TracePrintln(TAG, "%s", spec ? spec : "(null)");
+
+    if (spec == nullptr || *spec == '\0')
+        spec = getenv(SDDC_BACKEND_ENV);
+
+    if (spec == nullptr || *spec == '\0')
+        return CreateUsbHandler();
+
+    std::string name;
+    sddc_backend_args_t args;
+    if (!sddc_parse_backend(spec, name, args))
+    {
+        WarnPrintln(TAG, "Malformed backend \"%s\"", spec);
+        return nullptr;
+    }
+
+    if (name == "usb" && args.empty())
+        return CreateUsbHandler();
+
+    if (name == "replay")
+        return fx3replay::Create(args);
+
+    if (name == "generator")
+        return fx3generator::Create(args);
+
+    WarnPrintln(TAG, "Unknown backend \"%s\"", name.c_str());
+    return nullptr;
+}
+
+bool sddc_parse_backend(const char* spec, std::string& name, sddc_backend_args_t& args)
+{
+    const char* p = spec;
+    const char* end = strchr(p, ',');
+    name.assign(p, end ? end - p : strlen(p));
+    args.clear();
+
+    if (name.empty())
+        return false;
+
+    while (end)
+    {
+        p = end + 1;
+        end = strchr(p, ',');
+        std::string option(p, end ? end - p : strlen(p));
+
+        size_t equal = option.find('=');
+        if (equal == 0 || equal == std::string::npos)
+            return false;
+
+        args[option.substr(0, equal)] = option.substr(equal + 1);
+    }
+
+    return true;
+}
+
+bool sddc_parse_model(const std::string& value, RadioModel* model)
+{
+    static const struct { const char* name; RadioModel model; } models[] = {
+        { "none",    NORADIO },
+        { "BBRF103", BBRF103 },
+        { "HF103",   HF103 },
+        { "RX888",   RX888 },
+        { "RX888r2", RX888r2 },
+        { "RX888r3", RX888r3 },
+        { "RX999",   RX999 },
+        { "RXLUCY",  RXLUCY },
+    };
+
+    for (auto& m : models)
+    {
+        if (value == m.name)
+        {
+            *model = m.model;
+            return true;
+        }
+    }
+    return false;
+}
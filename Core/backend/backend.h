@@ -0,0 +1,61 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "../FX3Class.h"
+
+// Environment variable read when no backend is given explicitly
+#define SDDC_BACKEND_ENV "SDDC_BACKEND"
+
+typedef std::map<std::string, std::string> sddc_backend_args_t;
+
+/**
+ * @brief Creates the fx3class implementation described by `spec`
+ *
+ * `spec` is a backend name followed by comma separated `key=value` options:
+ * - `usb` : the SDR plugged on the computer (default)
+ * - `replay,file=capture.wav[,speed=1][,loop=1][,model=RX888r2]` : streams a
+ *   recorded capture of raw ADC samples, see fx3replay
+ * - `generator[,tones=10e6:-20;12e6:-40][,noise=-90][,speed=1][,model=RX888r2]` :
+ *   synthesizes the ADC samples, see fx3generator
+ *
+ * @param[in] spec The backend to create, `nullptr` or empty to use the
+ *   SDDC_BACKEND environment variable (USB when it is not set)
+ *
+ * \return The new backend, `nullptr` if the name or an option is unknown
+ */
+fx3class* CreateFx3Backend(const char* spec);
+
+/**
+ * @brief Splits a backend description into its name and options
+ *
+ * \retval true The description is well formed
+ */
+bool sddc_parse_backend(const char* spec, std::string& name, sddc_backend_args_t& args);
+
+/**
+ * @brief Reads a hardware model option ("RX888r2", "HF103", "none", ...)
+ *
+ * \retval true The model is known
+ */
+bool sddc_parse_model(const std::string& value, RadioModel* model);
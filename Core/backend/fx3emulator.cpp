@@ -0,0 +1,220 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fx3emulator.h"
+#include "../thread_config.h"
+
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std::chrono;
+
+#define TAG "fx3emulator"
+
+fx3emulator::fx3emulator(const char* product):
+    adc_rate(DEFAULT_ADC_FREQ),
+    speed(1.0),
+    model(RX888r2),
+    product(product),
+    gpios(0),
+    depth(0),
+    inputbuffer(nullptr),
+    run(false)
+{
+    TracePrintln(TAG, "%s", product);
+}
+
+fx3emulator::~fx3emulator()
+{
+    TracePrintln(TAG, "");
+}
+
+bool fx3emulator::ParseCommonOption(const std::string& key, const std::string& value, bool* valid)
+{
+    if (key == "speed")
+    {
+        char* end = nullptr;
+        speed = value == "max" ? 0 : strtod(value.c_str(), &end);
+        *valid = value == "max" || (*end == '\0' && speed >= 0);
+        return true;
+    }
+    if (key == "model")
+    {
+        *valid = sddc_parse_model(value, &model);
+        return true;
+    }
+    return false;
+}
+
+bool fx3emulator::Control(FX3Command command, uint8_t data)
+{
+    TracePrintln(TAG, "%d, %d", command, data);
+    return true;
+}
+
+bool fx3emulator::Control(FX3Command command, uint32_t data)
+{
+    TracePrintln(TAG, "%d, %d", command, data);
+
+    if (command == STARTADC)
+        adc_rate = data;
+    else if (command == GPIOFX3)
+        gpios = data;
+    return true;
+}
+
+bool fx3emulator::Control(FX3Command command, uint64_t data)
+{
+    TracePrintln(TAG, "%d, %llu", command, (unsigned long long)data);
+    return true;
+}
+
+bool fx3emulator::SetArgument(uint16_t index, uint16_t value)
+{
+    TracePrintln(TAG, "%d, %d", index, value);
+    return true;
+}
+
+bool fx3emulator::GetHardwareInfo(uint32_t* data)
+{
+    TracePrintln(TAG, "%p", data);
+
+    const uint8_t info[4] = { (uint8_t)model, FIRMWARE_VER_MAJOR, FIRMWARE_VER_MINOR, 0 };
+    memcpy(data, info, sizeof(info));
+    return true;
+}
+
+bool fx3emulator::ReadDebugTrace(uint8_t* pdata, uint8_t len)
+{
+    return false;
+}
+
+uint32_t fx3emulator::GetTransferGranularity()
+{
+    return 0;
+}
+
+void fx3emulator::StartStream(ringbuffer<int16_t>& input, int numofblock, int maxnumofblock)
+{
+    TracePrintln(TAG, "%d, %d", numofblock, maxnumofblock);
+
+    inputbuffer = &input;
+    depth = numofblock;
+    Rewind();
+
+    run = true;
+    stream_thread = std::thread([this]() {
+        sddc_thread_apply(SDDC_THREAD_USB, usb_thread_config);
+        Run();
+    });
+}
+
+void fx3emulator::StopStream()
+{
+    TracePrintln(TAG, "");
+
+    run = false;
+    if (stream_thread.joinable())
+        stream_thread.join();
+}
+
+uint32_t fx3emulator::GetTransferDepth()
+{
+    return run ? depth : 0;
+}
+
+/**
+ * Fills the input ring block by block. At real time speed, a block is
+ * released when its last sample would have come out of the ADC.
+ */
+void fx3emulator::Run()
+{
+    const uint32_t block = inputbuffer->getBlockSize();
+    const double ns_per_sample = 1.0e9 / adc_rate;
+    const int64_t epoch = duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+    const auto start = steady_clock::now();
+    uint64_t count = 0;
+
+    DebugPrintln(TAG, "%s started at %u Hz, speed %g", product, adc_rate, speed);
+
+    while (run)
+    {
+        // Do not block in getWritePtr: the consumer may be gone when stopping
+        if (inputbuffer->isFull())
+        {
+            std::this_thread::sleep_for(microseconds(100));
+            continue;
+        }
+
+        int16_t* ptr = inputbuffer->getWritePtr();
+        if (Fill(ptr, block) < block)
+        {
+            DebugPrintln(TAG, "%s stream ended after %llu samples", product, (unsigned long long)count);
+            break;
+        }
+
+        if (speed > 0)
+            std::this_thread::sleep_until(start + nanoseconds((int64_t)((count + block) * ns_per_sample / speed)));
+
+        inputbuffer->setWriteTimestamp(epoch + (int64_t)(count * ns_per_sample));
+        inputbuffer->WriteDone();
+        count += block;
+    }
+}
+
+bool fx3emulator::Enumerate(unsigned char& idx, char* lbuf)
+{
+    TracePrintln(TAG, "%d", idx);
+
+    if (idx != 0)
+        return false;
+
+    snprintf(lbuf, 64, "%-18ssn:%s", product, Serial().c_str());
+    return true;
+}
+
+size_t fx3emulator::GetDeviceListLength()
+{
+    return 1;
+}
+
+bool fx3emulator::GetDevice(unsigned char &idx, char *name, size_t name_len, char *serial, size_t serial_len)
+{
+    TracePrintln(TAG, "%d, %p, %zu, %p, %zu", idx, name, name_len, serial, serial_len);
+
+    if (idx != 0)
+        return false;
+
+    strncpy(name, product, name_len);
+    strncpy(serial, Serial().c_str(), serial_len);
+    return true;
+}
+
+vector<SDDC::DeviceItem> fx3emulator::GetDeviceList()
+{
+    TracePrintln(TAG, "");
+
+    SDDC::DeviceItem dev = {
+        .index = 0,
+        .product = product,
+        .serial_number = Serial()
+    };
+    return { dev };
+}
@@ -0,0 +1,88 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "backend.h"
+
+/**
+ * @brief Base of the backends producing the ADC samples in software
+ *
+ * Accepts and ignores the control commands, except the ADC rate (STARTADC)
+ * and the GPIOs (GPIOFX3) that are kept for the sample source. A thread fills
+ * the input ring at the ADC rate times `speed` (1 is real time, 0 as fast as
+ * the pipeline consumes the samples) and timestamps the blocks with their
+ * position in the stream, from the time it started.
+ *
+ * Common options: `speed` (default 1, `max` = 0), `model` (default RX888r2)
+ */
+class fx3emulator : public fx3class
+{
+public:
+    virtual ~fx3emulator(void);
+
+    bool Control(FX3Command command, uint8_t data) override;
+    bool Control(FX3Command command, uint32_t data) override;
+    bool Control(FX3Command command, uint64_t data) override;
+    bool SetArgument(uint16_t index, uint16_t value) override;
+    bool GetHardwareInfo(uint32_t* data) override;
+    bool ReadDebugTrace(uint8_t* pdata, uint8_t len) override;
+    uint32_t GetTransferGranularity() override;
+    void StartStream(ringbuffer<int16_t>& input, int numofblock, int maxnumofblock = 0) override;
+    void StopStream() override;
+    uint32_t GetTransferDepth() override;
+    bool Enumerate(unsigned char& idx, char* lbuf) override;
+    size_t GetDeviceListLength() override;
+    bool GetDevice(unsigned char &idx, char *name, size_t name_len, char *serial, size_t serial_len) override;
+    vector<SDDC::DeviceItem> GetDeviceList() override;
+
+protected:
+    fx3emulator(const char* product);
+
+    // Reads `speed` and `model`. Returns false if `key` is not one of them
+    bool ParseCommonOption(const std::string& key, const std::string& value, bool* valid);
+
+    // Called by StartStream, before the first Fill
+    virtual void Rewind() {}
+    // Produces the next `count` samples, returning less ends the stream.
+    // Runs on the stream thread: the derived classes call StopStream in their destructor
+    virtual size_t Fill(int16_t* samples, size_t count) = 0;
+    // Serial number reported in the device list
+    virtual std::string Serial() const = 0;
+
+    bool IsRandEnabled() const { return (gpios & RANDO) != 0; }
+
+    uint32_t adc_rate;
+    double speed;
+    RadioModel model;
+
+private:
+    void Run();
+
+    const char* product;
+    std::atomic<uint32_t> gpios;
+    uint32_t depth;
+    ringbuffer<int16_t>* inputbuffer;
+    std::atomic<bool> run;
+    std::thread stream_thread;
+};
@@ -0,0 +1,261 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fx3generator.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TAG "fx3generator"
+
+// Samples generated at once. A constant trip count lets the compiler vectorize the loops
+#define GENERATOR_CHUNK 1024
+// Gaussian samples drawn from at a random offset for every chunk
+#define GENERATOR_NOISE_TABLE (1 << 16)
+
+static const float full_scale = 32767.0f;
+static const double two_pi = 6.283185307179586476925286766559;
+
+static uint32_t xorshift32(uint32_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+fx3class* fx3generator::Create(const sddc_backend_args_t& args)
+{
+    TracePrintln(TAG, "");
+
+    auto generator = new fx3generator();
+    bool valid = true;
+
+    for (auto& arg : args)
+    {
+        const std::string& key = arg.first;
+        const std::string& value = arg.second;
+        char* end = nullptr;
+
+        if (key == "tones")
+        {
+            valid = generator->ParseTones(value);
+        }
+        else if (key == "noise")
+        {
+            double level = strtod(value.c_str(), &end);
+            valid = *end == '\0' && !value.empty() && level <= 0;
+            generator->noise_rms = (float)(full_scale * pow(10.0, level / 20) / sqrt(2.0));
+        }
+        else if (key == "seed")
+        {
+            generator->seed = (uint32_t)strtoul(value.c_str(), &end, 10);
+            valid = *end == '\0' && !value.empty() && generator->seed != 0;
+        }
+        else if (!generator->ParseCommonOption(key, value, &valid))
+        {
+            valid = false;
+        }
+
+        if (!valid)
+        {
+            WarnPrintln(TAG, "Invalid option %s=%s", key.c_str(), value.c_str());
+            delete generator;
+            return nullptr;
+        }
+    }
+
+    generator->description = generator->tones.empty() ? "noise" : "";
+    for (auto& tone : generator->tones)
+    {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%s%gHz", generator->description.empty() ? "" : "+", tone.frequency);
+        generator->description += buf;
+    }
+
+    return generator;
+}
+
+fx3generator::fx3generator():
+    fx3emulator("Generator"),
+    noise_rms(0),
+    seed(1),
+    random_state(1),
+    chunk(GENERATOR_CHUNK),
+    chunk_samples(GENERATOR_CHUNK),
+    chunk_pos(GENERATOR_CHUNK)
+{
+    TracePrintln(TAG, "");
+
+    tone_t tone;
+    tone.frequency = 10e6;
+    tone.amplitude = full_scale * 0.1f;   // -20 dBFS
+    tones.push_back(tone);
+}
+
+fx3generator::~fx3generator()
+{
+    TracePrintln(TAG, "");
+
+    StopStream();
+}
+
+bool fx3generator::ParseTones(const std::string& value)
+{
+    tones.clear();
+
+    size_t pos = 0;
+    while (pos < value.size())
+    {
+        size_t next = value.find(';', pos);
+        std::string item = value.substr(pos, next == std::string::npos ? std::string::npos : next - pos);
+        pos = next == std::string::npos ? value.size() : next + 1;
+
+        char* end = nullptr;
+        tone_t tone;
+        tone.frequency = strtod(item.c_str(), &end);
+        if (end == item.c_str() || *end != ':' || tone.frequency < 0)
+            return false;
+
+        const char* level = end + 1;
+        double dbfs = strtod(level, &end);
+        if (end == level || *end != '\0')
+            return false;
+
+        tone.amplitude = (float)(full_scale * pow(10.0, dbfs / 20));
+        tones.push_back(tone);
+    }
+    return true;
+}
+
+bool fx3generator::Open(uint8_t dev_index)
+{
+    TracePrintln(TAG, "%d", dev_index);
+
+    return dev_index == 0;
+}
+
+// The tables depend on the ADC rate, which is only known when the stream starts
+void fx3generator::Rewind()
+{
+    TracePrintln(TAG, "");
+
+    for (auto& tone : tones)
+    {
+        const double w = two_pi * tone.frequency / adc_rate;
+
+        if (tone.frequency * 2 > adc_rate)
+            WarnPrintln(TAG, "%g Hz is above the Nyquist frequency, it folds back", tone.frequency);
+
+        tone.cos_table.resize(GENERATOR_CHUNK);
+        tone.sin_table.resize(GENERATOR_CHUNK);
+        for (int i = 0; i < GENERATOR_CHUNK; i++)
+        {
+            tone.cos_table[i] = (float)(tone.amplitude * cos(w * i));
+            tone.sin_table[i] = (float)(tone.amplitude * sin(w * i));
+        }
+        tone.chunk_rotation = std::polar(1.0, w * GENERATOR_CHUNK);
+        tone.phase = 1.0;
+    }
+
+    if (noise_rms > 0 && noise_table.empty())
+    {
+        // Box-Muller, the table is drawn once
+        uint32_t state = seed;
+        noise_table.resize(GENERATOR_NOISE_TABLE + GENERATOR_CHUNK);
+        for (size_t i = 0; i < noise_table.size(); i += 2)
+        {
+            double u1 = (xorshift32(state) + 1.0) / 4294967297.0;
+            double u2 = (xorshift32(state) + 1.0) / 4294967297.0;
+            double r = sqrt(-2 * log(u1));
+            noise_table[i] = (float)(noise_rms * r * cos(two_pi * u2));
+            noise_table[i + 1] = (float)(noise_rms * r * sin(two_pi * u2));
+        }
+    }
+
+    random_state = seed;
+    chunk_pos = GENERATOR_CHUNK;
+}
+
+// Produces the next GENERATOR_CHUNK samples in chunk_samples
+void fx3generator::Generate()
+{
+    float* acc = chunk.data();
+
+    if (noise_rms > 0)
+    {
+        memcpy(acc, &noise_table[xorshift32(random_state) % GENERATOR_NOISE_TABLE], GENERATOR_CHUNK * sizeof(float));
+    }
+    else
+    {
+        memset(acc, 0, GENERATOR_CHUNK * sizeof(float));
+    }
+
+    // Re(phase * amplitude * e^(i w n))
+    for (auto& tone : tones)
+    {
+        const float re = (float)tone.phase.real();
+        const float im = (float)tone.phase.imag();
+        const float* c = tone.cos_table.data();
+        const float* s = tone.sin_table.data();
+        for (int i = 0; i < GENERATOR_CHUNK; i++)
+            acc[i] += re * c[i] - im * s[i];
+
+        tone.phase *= tone.chunk_rotation;
+        tone.phase /= std::abs(tone.phase);
+    }
+
+    // Rounding with saturation, then RAND: the bits 1 to 15 are XORed with bit 0
+    const int32_t rand_mask = IsRandEnabled() ? 0xFFFE : 0;
+    int16_t* out = chunk_samples.data();
+    for (int i = 0; i < GENERATOR_CHUNK; i++)
+    {
+        float v = acc[i];
+        v = v < -32768.0f ? -32768.0f : (v > 32767.0f ? 32767.0f : v);
+        int32_t q = (int32_t)(v + (v >= 0 ? 0.5f : -0.5f));
+        q ^= -(q & 1) & rand_mask;
+        out[i] = (int16_t)q;
+    }
+
+    chunk_pos = 0;
+}
+
+size_t fx3generator::Fill(int16_t* samples, size_t count)
+{
+    size_t done = 0;
+
+    while (done < count)
+    {
+        if (chunk_pos == GENERATOR_CHUNK)
+            Generate();
+
+        size_t n = std::min<size_t>(count - done, GENERATOR_CHUNK - chunk_pos);
+        memcpy(samples + done, &chunk_samples[chunk_pos], n * sizeof(int16_t));
+        chunk_pos += n;
+        done += n;
+    }
+
+    return done;
+}
+
+std::string fx3generator::Serial() const
+{
+    return description;
+}
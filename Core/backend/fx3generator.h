@@ -0,0 +1,79 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <complex>
+#include <string>
+#include <vector>
+
+#include "fx3emulator.h"
+
+/**
+ * @brief Backend synthesizing the ADC samples: tones over a white noise floor
+ *
+ * The levels are in dBFS: a tone at 0 dBFS peaks at full scale, a noise at
+ * X dBFS has the power of a tone at X dBFS over the whole Nyquist band.
+ * The sum saturates at the int16 range like the ADC does, and is RAND encoded
+ * when the radio sets the RANDO GPIO. The tones are continuous across blocks
+ * and restart with a zero phase at every stream start.
+ *
+ * Options: `tones=freq:dBFS[;freq:dBFS...]` (Hz, default 10e6:-20),
+ * `noise=dBFS` (default none), `seed`, and the fx3emulator ones (`speed`, `model`)
+ */
+class fx3generator : public fx3emulator
+{
+public:
+    static fx3class* Create(const sddc_backend_args_t& args);
+    virtual ~fx3generator(void);
+
+    bool Open(uint8_t dev_index) override;
+
+protected:
+    void Rewind() override;
+    size_t Fill(int16_t* samples, size_t count) override;
+    std::string Serial() const override;
+
+private:
+    fx3generator();
+
+    bool ParseTones(const std::string& value);
+    void Generate();
+
+    struct tone_t {
+        double frequency;
+        float amplitude;
+        // amplitude * e^(i w n) over one chunk, and the phase at the start of the next chunk
+        std::vector<float> cos_table;
+        std::vector<float> sin_table;
+        std::complex<double> chunk_rotation;
+        std::complex<double> phase;
+    };
+
+    std::string description;
+    std::vector<tone_t> tones;
+    float noise_rms;
+    uint32_t seed;
+    uint32_t random_state;
+
+    std::vector<float> noise_table;
+    std::vector<float> chunk;
+    std::vector<int16_t> chunk_samples;
+    size_t chunk_pos;
+};
@@ -0,0 +1,390 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fx3replay.h"
+#include "../record/adc_codec.h"
+#include "../record/sigmf.h"
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+
+#define TAG "fx3replay"
+
+static uint16_t le16(const char* p)
+{
+    return (uint8_t)p[0] | (uint8_t)p[1] << 8;
+}
+
+static uint32_t le32(const char* p)
+{
+    return le16(p) | (uint32_t)le16(p + 2) << 16;
+}
+
+static uint64_t le64(const char* p)
+{
+    return le32(p) | (uint64_t)le32(p + 4) << 32;
+}
+
+// The value of `key` in a JSON text, enough for the global fields of a SigMF metadata file
+static std::string JsonValue(const std::string& json, const char* key)
+{
+    const std::string quoted = std::string("\"") + key + "\"";
+    size_t pos = json.find(quoted);
+    if (pos == std::string::npos || (pos = json.find(':', pos + quoted.size())) == std::string::npos)
+        return "";
+    pos = json.find_first_not_of(" \t\r\n", pos + 1);
+    if (pos == std::string::npos)
+        return "";
+    if (json[pos] == '"')
+    {
+        size_t end = json.find('"', pos + 1);
+        return end == std::string::npos ? "" : json.substr(pos + 1, end - pos - 1);
+    }
+    return json.substr(pos, json.find_first_of(",}] \t\r\n", pos) - pos);
+}
+
+fx3class* fx3replay::Create(const sddc_backend_args_t& args)
+{
+    TracePrintln(TAG, "");
+
+    auto replay = new fx3replay();
+    bool valid = true;
+
+    for (auto& arg : args)
+    {
+        const std::string& key = arg.first;
+        const std::string& value = arg.second;
+
+        if (key == "file")
+        {
+            replay->path = value;
+        }
+        else if (key == "loop")
+        {
+            valid = value == "0" || value == "1";
+            replay->loop = value == "1";
+        }
+        else if (!replay->ParseCommonOption(key, value, &valid))
+        {
+            valid = false;
+        }
+
+        if (!valid)
+        {
+            WarnPrintln(TAG, "Invalid option %s=%s", key.c_str(), value.c_str());
+            break;
+        }
+    }
+
+    if (valid && replay->path.empty())
+    {
+        WarnPrintln(TAG, "The file option is required");
+        valid = false;
+    }
+
+    if (!valid)
+    {
+        delete replay;
+        return nullptr;
+    }
+    return replay;
+}
+
+fx3replay::fx3replay():
+    fx3emulator("Replay"),
+    loop(true),
+    data_offset(0),
+    data_size(0),
+    position(0),
+    file_rate(0),
+    compressed(false),
+    frame_pos(0),
+    next_sample(0)
+{
+    TracePrintln(TAG, "");
+}
+
+fx3replay::~fx3replay()
+{
+    TracePrintln(TAG, "");
+
+    // Before the file goes away
+    StopStream();
+}
+
+bool fx3replay::Open(uint8_t dev_index)
+{
+    TracePrintln(TAG, "%d", dev_index);
+
+    if (dev_index != 0)
+        return false;
+
+    return OpenCapture();
+}
+
+/**
+ * Takes the sample rate from a SigMF metadata file and checks the samples are
+ * the real int16 ones of the ADC. The captures and annotations are not needed
+ * to replay the ADC stream
+ */
+bool fx3replay::ReadSigMFMeta(const std::string& meta_path)
+{
+    std::ifstream meta(meta_path);
+    if (!meta)
+    {
+        WarnPrintln(TAG, "Cannot open %s", meta_path.c_str());
+        return false;
+    }
+    std::stringstream text;
+    text << meta.rdbuf();
+
+    std::string datatype = JsonValue(text.str(), "core:datatype");
+    if (datatype != "ri16_le")
+    {
+        WarnPrintln(TAG, "%s: only ri16_le SigMF recordings (raw ADC samples) can be replayed, not '%s'",
+            meta_path.c_str(), datatype.c_str());
+        return false;
+    }
+    file_rate = (uint32_t)strtod(JsonValue(text.str(), "core:sample_rate").c_str(), nullptr);
+    return true;
+}
+
+/**
+ * Finds the samples in the file: the data chunk of a WAV file (or of an
+ * RF64/BW64 file, whose data size is in the ds64 chunk), the data file of a
+ * SigMF recording, the whole file otherwise (compressed or not)
+ */
+bool fx3replay::OpenCapture()
+{
+    TracePrintln(TAG, "");
+
+    std::string data_path = path;
+    file_rate = 0;
+
+    const bool sigmf = sigmf_writer::MetaPath(path) == path || sigmf_writer::DataPath(path) == path;
+    if (sigmf)
+    {
+        if (!ReadSigMFMeta(sigmf_writer::MetaPath(path)))
+            return false;
+        data_path = sigmf_writer::DataPath(path);
+    }
+
+    file.close();
+    file.open(data_path, std::ios::binary);
+    if (!file)
+    {
+        WarnPrintln(TAG, "Cannot open %s", data_path.c_str());
+        return false;
+    }
+
+    file.seekg(0, std::ios::end);
+    uint64_t file_size = file.tellg();
+    file.seekg(0);
+
+    data_offset = 0;
+    data_size = file_size;
+
+    uint8_t first_frame[sizeof(adc_codec::frame_header)];
+    adc_codec::frame_header frame;
+    compressed = !sigmf && file.read((char*)first_frame, sizeof(first_frame)) &&
+        adc_codec::ReadHeader(first_frame, sizeof(first_frame), &frame);
+    file.clear();
+    file.seekg(0);
+
+    char header[12];
+    if (!sigmf && !compressed && file.read(header, sizeof(header)) && memcmp(header + 8, "WAVE", 4) == 0 &&
+        (memcmp(header, "RIFF", 4) == 0 || memcmp(header, "RF64", 4) == 0 || memcmp(header, "BW64", 4) == 0))
+    {
+        bool pcm16 = false;
+        bool has_data = false;
+        uint64_t ds64_data_size = 0;
+        char chunk[16];
+
+        while (!has_data && file.read(chunk, 8))
+        {
+            uint64_t chunk_size = le32(chunk + 4);
+            uint64_t chunk_offset = file.tellg();
+
+            if (memcmp(chunk, "ds64", 4) == 0 && chunk_size >= 16 && file.read(chunk, 16))
+            {
+                ds64_data_size = le64(chunk + 8);
+            }
+            else if (memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16 && file.read(chunk, 16))
+            {
+                uint16_t format = le16(chunk);
+                pcm16 = (format == 1 || format == 0xFFFE) && le16(chunk + 2) == 1 && le16(chunk + 14) == 16;
+                file_rate = le32(chunk + 4);
+            }
+            else if (memcmp(chunk, "data", 4) == 0)
+            {
+                if (chunk_size == 0xFFFFFFFF && ds64_data_size)
+                    chunk_size = ds64_data_size;
+                data_offset = chunk_offset;
+                data_size = std::min<uint64_t>(chunk_size, file_size - chunk_offset);
+                has_data = true;
+            }
+
+            file.seekg(chunk_offset + chunk_size + (chunk_size & 1));
+        }
+
+        if (!pcm16 || !has_data)
+        {
+            WarnPrintln(TAG, "%s: only mono 16 bit PCM WAV files can be replayed", path.c_str());
+            return false;
+        }
+    }
+
+    if (!compressed)
+        data_size -= data_size % sizeof(int16_t);
+    if (data_size == 0)
+    {
+        WarnPrintln(TAG, "%s holds no samples", path.c_str());
+        return false;
+    }
+
+    Rewind();
+
+    if (compressed)
+        DebugPrintln(TAG, "Replaying %s: %llu bytes (compressed), speed %g%s", path.c_str(),
+            (unsigned long long)data_size, speed, loop ? ", looped" : "");
+    else
+        DebugPrintln(TAG, "Replaying %s: %llu samples%s, speed %g%s", path.c_str(),
+            (unsigned long long)(data_size / sizeof(int16_t)), sigmf ? " (SigMF)" : file_rate ? " (WAV)" : " (raw)",
+            speed, loop ? ", looped" : "");
+    return true;
+}
+
+bool fx3replay::Control(FX3Command command, uint32_t data)
+{
+    TracePrintln(TAG, "%d, %d", command, data);
+
+    if (command == STARTADC && file_rate != 0 && file_rate != data)
+        WarnPrintln(TAG, "%s was recorded at %u Hz and is replayed at %u Hz", path.c_str(), file_rate, data);
+
+    return fx3emulator::Control(command, data);
+}
+
+// Every stream starts from the beginning of the capture
+void fx3replay::Rewind()
+{
+    file.clear();
+    file.seekg(data_offset);
+    position = 0;
+    frame_samples.clear();
+    frame_pos = 0;
+    next_sample = 0;
+}
+
+// Reads `count` samples, going back to the start of the capture when looping
+size_t fx3replay::Fill(int16_t* samples, size_t count)
+{
+    if (compressed)
+        return FillCompressed(samples, count);
+
+    size_t done = 0;
+
+    while (done < count)
+    {
+        if (position == data_size)
+        {
+            if (!loop)
+                break;
+            Rewind();
+        }
+
+        size_t n = (size_t)std::min<uint64_t>(count - done, (data_size - position) / sizeof(int16_t));
+        if (!file.read((char*)(samples + done), n * sizeof(int16_t)))
+        {
+            WarnPrintln(TAG, "Read error in %s", path.c_str());
+            break;
+        }
+
+        position += n * sizeof(int16_t);
+        done += n;
+    }
+
+    return done;
+}
+
+// Reads and decodes the next frame of a compressed recording
+bool fx3replay::ReadFrame()
+{
+    uint8_t raw[sizeof(adc_codec::frame_header)];
+    adc_codec::frame_header header;
+
+    if (!file.read((char*)raw, sizeof(raw)) || !adc_codec::ReadHeader(raw, sizeof(raw), &header))
+    {
+        WarnPrintln(TAG, "%s: no frame at %llu", path.c_str(), (unsigned long long)position);
+        return false;
+    }
+
+    frame_data.resize(header.payload_size);
+    frame_samples.resize(header.samples);
+    if (!file.read((char*)frame_data.data(), frame_data.size()) ||
+        !adc_codec::Decode(header, frame_data.data(), frame_samples.data()))
+    {
+        WarnPrintln(TAG, "%s: damaged or partial frame at %llu", path.c_str(), (unsigned long long)position);
+        frame_samples.clear();
+        return false;
+    }
+
+    // The blocks the encoder could not take are missing, the samples go on
+    if (header.first_sample != next_sample)
+        DebugPrintln(TAG, "%llu samples missing before %llu", (unsigned long long)(header.first_sample - next_sample),
+            (unsigned long long)header.first_sample);
+    next_sample = header.first_sample + header.samples;
+
+    position += sizeof(raw) + header.payload_size;
+    frame_pos = 0;
+    return true;
+}
+
+// Decodes frame by frame, going back to the start of the recording when looping
+size_t fx3replay::FillCompressed(int16_t* samples, size_t count)
+{
+    size_t done = 0;
+
+    while (done < count)
+    {
+        if (frame_pos == frame_samples.size())
+        {
+            // A recording cut short ends at its last whole frame
+            if (position == data_size || !ReadFrame())
+            {
+                if (!loop || position == 0)
+                    break;
+                Rewind();
+            }
+            continue;
+        }
+
+        size_t n = std::min(count - done, frame_samples.size() - frame_pos);
+        memcpy(samples + done, frame_samples.data() + frame_pos, n * sizeof(int16_t));
+        frame_pos += n;
+        done += n;
+    }
+
+    return done;
+}
+
+std::string fx3replay::Serial() const
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
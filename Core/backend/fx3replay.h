@@ -0,0 +1,79 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "fx3emulator.h"
+
+/**
+ * @brief Backend streaming a recorded capture instead of the USB device
+ *
+ * The capture holds the raw int16 ADC samples, either as a mono 16 bit PCM
+ * WAV file (RF64/BW64 past 4 GiB), as a ri16_le SigMF recording (`file` names
+ * its .sigmf-meta or .sigmf-data file), as adc_codec frames (a compressed
+ * recording, decoded on the fly) or as a headerless file. It is replayed from the start every time
+ * the stream starts, at the ADC rate set by the radio times `speed`.
+ *
+ * Options: `file` (required), `loop` (default 1, 0 stops at the end of the
+ * capture), and the fx3emulator ones (`speed`, `model`)
+ */
+class fx3replay : public fx3emulator
+{
+public:
+    static fx3class* Create(const sddc_backend_args_t& args);
+    virtual ~fx3replay(void);
+
+    bool Open(uint8_t dev_index) override;
+    bool Control(FX3Command command, uint32_t data) override;
+    using fx3emulator::Control;
+
+protected:
+    void Rewind() override;
+    size_t Fill(int16_t* samples, size_t count) override;
+    std::string Serial() const override;
+
+private:
+    fx3replay();
+
+    bool OpenCapture();
+    bool ReadSigMFMeta(const std::string& meta_path);
+    bool ReadFrame();
+    size_t FillCompressed(int16_t* samples, size_t count);
+
+    // options
+    std::string path;
+    bool loop;
+
+    std::ifstream file;
+    uint64_t data_offset;   // bytes
+    uint64_t data_size;     // bytes
+    uint64_t position;      // bytes read since data_offset
+    uint32_t file_rate;     // from the WAV header or the SigMF metadata, 0 if unknown
+
+    // compressed recording
+    bool compressed;
+    std::vector<uint8_t> frame_data;
+    std::vector<int16_t> frame_samples;    // decoded frame
+    size_t frame_pos;       // next sample of frame_samples to hand over
+    uint64_t next_sample;   // first_sample the next frame should have
+};
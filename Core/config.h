@@ -124,10 +124,22 @@
 
 extern bool saveADCsamplesflag;
 
+// Default stream geometry, can be changed at runtime with RadioHandler::SetStreamConfig
 // transferSize must be a multiple of 16 (maxBurst) * 1024 (SS packet size) = 16384
 const uint32_t transferSize = 131072;
 const uint32_t transferSamples = transferSize / sizeof(int16_t);
 const uint32_t concurrentTransfers = 16;  // used to be 96, but I think it is too high
+// The number of transfers in flight adapts to the host between these bounds (see streaming.c)
+const uint32_t minConcurrentTransfers = 4;
+const uint32_t maxConcurrentTransfers = 96;
+const uint32_t ringBlocks = 64;
+
+// Bounds accepted by RadioHandler::SetStreamConfig
+const uint32_t MAX_TRANSFER_SIZE = 4 * 1024 * 1024;
+const uint32_t MAX_CONCURRENT_TRANSFERS = 256;
+const uint32_t MIN_RING_BLOCKS = 4;
+const uint32_t MAX_RING_BLOCKS = 4096;
+const uint32_t MAX_R2IQ_WORKERS = 256;		// r2iq_pool::SetWorkerCount
 
 const uint32_t DEFAULT_ADC_FREQ = 64000000;	// ADC sampling frequency
 
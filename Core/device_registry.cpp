@@ -0,0 +1,104 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "device_registry.h"
+#include "config.h"
+
+#define TAG "DeviceRegistry"
+
+using namespace std::chrono;
+
+DeviceRegistry::DeviceRegistry(Scanner scan, milliseconds max_age):
+    scan(scan),
+    max_age(max_age),
+    devices(std::make_shared<const std::vector<SDDC::DeviceItem>>()),
+    generation(1),
+    scanned_generation(0),
+    scans(0)
+{
+    TracePrintln(TAG, "%lld", (long long)max_age.count());
+}
+
+sddc_device_snapshot_t DeviceRegistry::Snapshot()
+{
+    auto up_to_date = [this]() {
+        return scanned_generation == generation &&
+            (max_age.count() == 0 || steady_clock::now() - scanned < max_age);
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (up_to_date())
+            return devices;
+    }
+
+    // Concurrent callers wait for a single scan instead of each doing their own
+    std::lock_guard<std::mutex> scan_lock(scan_mutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (up_to_date())
+            return devices;
+    }
+
+    Scan();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return devices;
+}
+
+bool DeviceRegistry::Refresh()
+{
+    TracePrintln(TAG, "");
+
+    std::lock_guard<std::mutex> scan_lock(scan_mutex);
+    return Scan();
+}
+
+// Called with scan_mutex held
+bool DeviceRegistry::Scan()
+{
+    // Read before the scan: a change reported during the scan triggers another one
+    uint64_t scan_generation = generation;
+
+    std::vector<SDDC::DeviceItem> list;
+    scans++;
+    bool ok = scan(list);
+
+    if (ok)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        devices = std::make_shared<const std::vector<SDDC::DeviceItem>>(std::move(list));
+        scanned = steady_clock::now();
+        scanned_generation = scan_generation;
+        DebugPrintln(TAG, "%d device(s)", (int)devices->size());
+    }
+    else
+    {
+        WarnPrintln(TAG, "Scan failed, keeping the previous list");
+    }
+
+    return ok;
+}
+
+void DeviceRegistry::Invalidate()
+{
+    TracePrintln(TAG, "");
+
+    generation++;
+}
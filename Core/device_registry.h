@@ -0,0 +1,93 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "types_cpp.h"
+
+typedef std::shared_ptr<const std::vector<SDDC::DeviceItem>> sddc_device_snapshot_t;
+
+/**
+ * @brief Cached list of the connected devices
+ *
+ * The bus is scanned once and the result is shared by every caller, until
+ * the owner of the registry reports a change with Invalidate() (e.g. from
+ * a hotplug event). A snapshot never changes once taken, so the length and
+ * the items of a list always come from the same scan.
+ */
+class DeviceRegistry
+{
+public:
+    /**
+     * @brief Fills the list with the devices on the bus, false if the bus can't be read
+     */
+    typedef std::function<bool(std::vector<SDDC::DeviceItem>& devices)> Scanner;
+
+    /**
+     * @param scan Called on the first query and after every change
+     * @param max_age Rescan when the snapshot is older than that, 0 to only
+     *                rescan after Invalidate() (when changes are reported)
+     */
+    DeviceRegistry(Scanner scan, std::chrono::milliseconds max_age = std::chrono::milliseconds(0));
+
+    /**
+     * @brief Current list of devices, scanned only if it is out of date
+     */
+    sddc_device_snapshot_t Snapshot();
+
+    /**
+     * @brief Scans the bus now
+     *
+     * @return false if the scan failed, the previous list is kept and the
+     *         next Snapshot() tries again
+     */
+    bool Refresh();
+
+    /**
+     * @brief Marks the list as out of date. Cheap, can be called from any thread
+     */
+    void Invalidate();
+
+    /**
+     * @brief Number of scans done so far
+     */
+    uint64_t ScanCount() const { return scans; }
+
+private:
+    bool Scan();
+
+    Scanner scan;
+    std::chrono::milliseconds max_age;
+
+    std::mutex scan_mutex;      // one scan at a time
+    std::mutex mutex;           // protects devices, scanned and scanned_generation
+    sddc_device_snapshot_t devices;
+    std::chrono::steady_clock::time_point scanned;
+
+    std::atomic<uint64_t> generation;   // bumped by Invalidate()
+    uint64_t scanned_generation;        // generation when devices was scanned
+    std::atomic<uint64_t> scans;
+};
@@ -0,0 +1,280 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "allocator.h"
+#include "../config.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+#elif defined(_WIN32)
+#include <malloc.h>
+#endif
+
+#define TAG "allocator"
+
+namespace {
+    enum alloc_kind_t {
+        ALLOC_HEAP,     // small block, aligned heap allocation
+        ALLOC_PAGES,    // anonymous mapping, regular pages
+        ALLOC_THP,      // anonymous mapping, transparent huge pages requested
+        ALLOC_HUGETLB   // anonymous mapping, explicit huge pages
+    };
+
+    struct alloc_info_t {
+        size_t length;      // length of the mapping
+        alloc_kind_t kind;
+    };
+
+    // Allocations are rare (stream setup only), a locked map is good enough
+    std::mutex registry_mutex;
+    std::map<const void*, alloc_info_t> registry;
+
+    std::atomic<int> hugepages_enabled(-1);
+
+    // Anything smaller than this comes from the heap
+    const size_t mmap_threshold = 64 * 1024;
+
+    bool use_hugepages()
+    {
+        int enabled = hugepages_enabled.load();
+        if (enabled < 0)
+        {
+            const char* env = getenv("SDDC_HUGEPAGES");
+            enabled = (env && env[0] == '0') ? 0 : 1;
+            hugepages_enabled.store(enabled);
+        }
+        return enabled != 0;
+    }
+
+    size_t round_up(size_t size, size_t granularity)
+    {
+        return (size + granularity - 1) / granularity * granularity;
+    }
+
+#if defined(__linux__)
+    int numa_node_count()
+    {
+        static int count = -1;
+        if (count < 0)
+        {
+            int n = 1;
+            while (n < 64 && access(("/sys/devices/system/node/node" + std::to_string(n)).c_str(), F_OK) == 0)
+                n++;
+            count = n;
+        }
+        return count;
+    }
+
+    bool numa_bind(void* addr, size_t length, int node, bool move)
+    {
+        if (numa_node_count() < 2 || node < 0 || node >= 64)
+            return true;
+
+        unsigned long nodemask = 1UL << node;
+        long ret = syscall(SYS_mbind, addr, length, MPOL_PREFERRED, &nodemask,
+                           sizeof(nodemask) * 8, move ? MPOL_MF_MOVE : 0);
+        if (ret != 0)
+        {
+            DebugPrintln(TAG, "mbind(node %d) failed", node);
+            return false;
+        }
+        return true;
+    }
+
+    void* map_pages(size_t size, alloc_info_t& info)
+    {
+        if (use_hugepages() && size >= SDDC_HUGEPAGE_SIZE)
+        {
+            // Explicit huge pages: only available if the administrator reserved some
+            info.length = round_up(size, SDDC_HUGEPAGE_SIZE);
+            void* ptr = mmap(nullptr, info.length, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (ptr != MAP_FAILED)
+            {
+                info.kind = ALLOC_HUGETLB;
+                return ptr;
+            }
+
+            // Transparent huge pages: the kernel only uses them on 2MB aligned ranges,
+            // so over-allocate and trim the mapping around an aligned window
+            size_t span = info.length + SDDC_HUGEPAGE_SIZE;
+            uint8_t* raw = (uint8_t*)mmap(nullptr, span, PROT_READ | PROT_WRITE,
+                                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (raw != MAP_FAILED)
+            {
+                uint8_t* aligned = (uint8_t*)round_up((uintptr_t)raw, SDDC_HUGEPAGE_SIZE);
+                if (aligned != raw)
+                    munmap(raw, aligned - raw);
+                size_t tail = (raw + span) - (aligned + info.length);
+                if (tail)
+                    munmap(aligned + info.length, tail);
+
+                info.kind = (madvise(aligned, info.length, MADV_HUGEPAGE) == 0) ? ALLOC_THP : ALLOC_PAGES;
+                return aligned;
+            }
+        }
+
+        info.length = round_up(size, (size_t)sysconf(_SC_PAGESIZE));
+        void* ptr = mmap(nullptr, info.length, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED)
+            return nullptr;
+
+        info.kind = ALLOC_PAGES;
+        return ptr;
+    }
+#endif
+}
+
+void* sddc_alloc(size_t size, int numa_node)
+{
+    TracePrintln(TAG, "%zu, %d", size, numa_node);
+
+    if (size == 0)
+        return nullptr;
+
+    alloc_info_t info;
+    void* ptr = nullptr;
+
+#if defined(__linux__)
+    if (size >= mmap_threshold)
+    {
+        ptr = map_pages(size, info);
+        if (ptr)
+        {
+            numa_bind(ptr, info.length, numa_node < 0 ? sddc_current_numa_node() : numa_node, false);
+            // First touch: fault every page in now, with the policy above in place
+            memset(ptr, 0, info.length);
+        }
+    }
+#endif
+
+    if (!ptr)
+    {
+        info.length = round_up(size, SDDC_CACHELINE_SIZE);
+        info.kind = ALLOC_HEAP;
+#if defined(_WIN32)
+        ptr = _aligned_malloc(info.length, SDDC_CACHELINE_SIZE);
+#else
+        if (posix_memalign(&ptr, SDDC_CACHELINE_SIZE, info.length) != 0)
+            ptr = nullptr;
+#endif
+        if (!ptr)
+        {
+            WarnPrintln(TAG, "Failed to allocate %zu bytes", size);
+            return nullptr;
+        }
+        memset(ptr, 0, info.length);
+    }
+
+    DebugPrintln(TAG, "Allocated %zu bytes at %p (%s)", size, ptr,
+        info.kind == ALLOC_HUGETLB ? "hugetlb" :
+        info.kind == ALLOC_THP ? "thp" :
+        info.kind == ALLOC_PAGES ? "pages" : "heap");
+
+    std::lock_guard<std::mutex> lk(registry_mutex);
+    registry[ptr] = info;
+    return ptr;
+}
+
+void sddc_free(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    alloc_info_t info;
+    {
+        std::lock_guard<std::mutex> lk(registry_mutex);
+        auto it = registry.find(ptr);
+        if (it == registry.end())
+        {
+            WarnPrintln(TAG, "sddc_free(%p): unknown block", ptr);
+            return;
+        }
+        info = it->second;
+        registry.erase(it);
+    }
+
+#if defined(__linux__)
+    if (info.kind != ALLOC_HEAP)
+    {
+        munmap(ptr, info.length);
+        return;
+    }
+#endif
+
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+bool sddc_mem_bind_current_node(void* ptr)
+{
+#if defined(__linux__)
+    size_t length;
+    {
+        std::lock_guard<std::mutex> lk(registry_mutex);
+        auto it = registry.find(ptr);
+        if (it == registry.end() || it->second.kind == ALLOC_HEAP)
+            return false;
+        length = it->second.length;
+    }
+    return numa_bind(ptr, length, sddc_current_numa_node(), true);
+#else
+    (void)ptr;
+    return false;
+#endif
+}
+
+bool sddc_mem_is_hugepage(const void* ptr)
+{
+    std::lock_guard<std::mutex> lk(registry_mutex);
+    auto it = registry.find(ptr);
+    if (it == registry.end())
+        return false;
+    return it->second.kind == ALLOC_THP || it->second.kind == ALLOC_HUGETLB;
+}
+
+void sddc_set_hugepages(bool enable)
+{
+    hugepages_enabled.store(enable ? 1 : 0);
+}
+
+int sddc_current_numa_node()
+{
+#if defined(__linux__)
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+        return (int)node;
+#endif
+    return 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+// Every block returned by sddc_alloc starts on a cache line,
+// so two ring slots never share a line between the producer and the consumer
+#define SDDC_CACHELINE_SIZE 64
+
+// Blocks at least this large are backed by huge pages when possible
+#define SDDC_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+/**
+ * @brief Allocates a sample buffer
+ *
+ * Large blocks are backed by huge pages (explicit MAP_HUGETLB pages first,
+ * transparent huge pages otherwise) and every page is touched before returning,
+ * so the streaming threads never take a page fault or a TLB miss storm.
+ *
+ * @param size Size of the block in bytes
+ * @param numa_node NUMA node to place the block on, -1 for the node of the calling thread
+ * @return Pointer aligned on SDDC_CACHELINE_SIZE, nullptr on failure
+ */
+void* sddc_alloc(size_t size, int numa_node = -1);
+
+/**
+ * @brief Releases a block returned by sddc_alloc
+ */
+void sddc_free(void* ptr);
+
+/**
+ * @brief Migrates a block to the NUMA node of the calling thread
+ *
+ * Meant to be called by the thread consuming the buffer once it is running
+ * on its final CPU. Does nothing on single node systems.
+ *
+ * \retval true The block now lives on the node of the caller
+ */
+bool sddc_mem_bind_current_node(void* ptr);
+
+/**
+ * @brief Tells if a block returned by sddc_alloc is backed by huge pages
+ */
+bool sddc_mem_is_hugepage(const void* ptr);
+
+/**
+ * @brief Enables or disables huge pages for the next allocations
+ *
+ * Huge pages are enabled by default, unless SDDC_HUGEPAGES=0 is set in the environment.
+ */
+void sddc_set_hugepages(bool enable);
+
+/**
+ * @brief NUMA node of the CPU the calling thread currently runs on (0 if unknown)
+ */
+int sddc_current_numa_node();
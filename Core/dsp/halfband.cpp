@@ -0,0 +1,74 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "halfband.h"
+#include "../fir.h"
+
+#include <string.h>
+
+namespace {
+    const int half = (halfband_decimator::taps - 1) / 2;
+}
+
+halfband_decimator::halfband_decimator()
+{
+    float kaiser[taps];
+    KaiserWindow(taps, 70.0f, 0.2f, 0.3f, kaiser);
+
+    // The even offsets are zero, give or take the rounding of sinf
+    center = kaiser[half];
+    for (int j = 0; j < (taps + 1) / 4; j++)
+        coefs[j] = kaiser[half + 2 * j + 1];
+
+    Reset();
+}
+
+void halfband_decimator::Reset()
+{
+    work.assign(2 * (taps - 1), 0.0f);
+}
+
+size_t halfband_decimator::Process(const sddc_complex_t* in, size_t count, sddc_complex_t* out)
+{
+    const size_t kept = work.size();
+    work.resize(kept + 2 * count);
+    memcpy(work.data() + kept, in, count * sizeof(sddc_complex_t));
+
+    const size_t length = work.size() / 2;
+    const size_t outputs = length >= (size_t)taps ? (length - taps) / 2 + 1 : 0;
+    const float* x = work.data();
+
+    for (size_t k = 0; k < outputs; k++)
+    {
+        const float* c = x + 2 * (2 * k + half);
+        float i = center * c[0];
+        float q = center * c[1];
+        for (int j = 0; j < (taps + 1) / 4; j++)
+        {
+            const int d = 2 * (2 * j + 1);
+            i += coefs[j] * (c[-d] + c[d]);
+            q += coefs[j] * (c[-d + 1] + c[d + 1]);
+        }
+        out[k][0] = i;
+        out[k][1] = q;
+    }
+
+    work.erase(work.begin(), work.begin() + 4 * outputs);
+    return outputs;
+}
@@ -0,0 +1,53 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+#include "../types.h"
+
+/**
+ * @brief Decimates IQ samples by 2 with a half-band low pass filter
+ *
+ * The filter is a Kaiser windowed sinc cut at a quarter of the input rate
+ * (see KaiserWindow): the band kept is +-0.4 of the output rate, what aliases
+ * onto it is 70 dB down, and every other tap is zero. The samples of the last
+ * call that the filter still needs are kept, so the blocks of a stream give
+ * the same output as one long block.
+ */
+class halfband_decimator
+{
+public:
+    halfband_decimator();
+
+    // Forgets the history, before a stream that does not follow the previous one
+    void Reset();
+
+    // `out` takes count / 2 + 1 samples. Returns the number written
+    size_t Process(const sddc_complex_t* in, size_t count, sddc_complex_t* out);
+
+    static const int taps = 43;
+
+private:
+    float center;
+    float coefs[(taps + 1) / 4];    // of the taps 1, 3, 5... away from the center
+    std::vector<float> work;        // history then input, I and Q interleaved
+};
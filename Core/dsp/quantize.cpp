@@ -0,0 +1,200 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "quantize.h"
+
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define QUANTIZE_SSE2
+#endif
+
+namespace {
+    const float uniform_scale = 1.0f / (1 << 16);   // int16 to [-0.5, 0.5)
+
+    inline uint32_t xorshift(uint32_t& x)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return x;
+    }
+
+    template<typename T> inline T Saturate(float value, float low, float high)
+    {
+        if (value < low) value = low;
+        if (value > high) value = high;
+        return (T)lrintf(value);
+    }
+
+#ifdef QUANTIZE_SSE2
+    inline __m128i xorshift(__m128i x)
+    {
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+        return x;
+    }
+
+    // Sum of two uniform values in [-0.5, 0.5): the two halves of one random word
+    inline __m128 Triangular(__m128i& state)
+    {
+        state = xorshift(state);
+        __m128i low = _mm_srai_epi32(_mm_slli_epi32(state, 16), 16);
+        __m128i high = _mm_srai_epi32(state, 16);
+        return _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(low, high)), _mm_set1_ps(uniform_scale));
+    }
+
+    // 4 samples scaled, dithered and clamped, rounded to the nearest (the default MXCSR mode, as lrintf)
+    inline __m128i Quantize(const float* input, __m128 scale, __m128 low, __m128 high, bool dither, __m128i& state)
+    {
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(input), scale);
+        if (dither)
+            v = _mm_add_ps(v, Triangular(state));
+        v = _mm_min_ps(_mm_max_ps(v, low), high);
+        return _mm_cvtps_epi32(v);
+    }
+#endif
+}
+
+iq_quantizer::iq_quantizer():
+    format(SDDC_IQ_CF32),
+    scale(1.0f),
+    dither(false),
+    seed{ 0x9E3779B9u, 0x7F4A7C15u, 0x85EBCA6Bu, 0xC2B2AE35u }
+{
+}
+
+bool iq_quantizer::Configure(sddc_iq_format_t format, float scale, bool dither)
+{
+    if (format != SDDC_IQ_CF32 && format != SDDC_IQ_CS16 && format != SDDC_IQ_CS8)
+        return false;
+    if (!(scale >= 0) || isinf(scale))
+        return false;
+
+    this->format = format;
+    this->scale = scale == 0 ? FullScale(format) : scale;
+    this->dither = dither;
+    return true;
+}
+
+size_t iq_quantizer::SampleSize(sddc_iq_format_t format)
+{
+    switch (format)
+    {
+        case SDDC_IQ_CS16: return 2 * sizeof(int16_t);
+        case SDDC_IQ_CS8:  return 2 * sizeof(int8_t);
+        default:           return sizeof(sddc_complex_t);
+    }
+}
+
+float iq_quantizer::FullScale(sddc_iq_format_t format)
+{
+    switch (format)
+    {
+        case SDDC_IQ_CS16: return 32767.0f;
+        case SDDC_IQ_CS8:  return 127.0f;
+        default:           return 1.0f;
+    }
+}
+
+float iq_quantizer::Triangular()
+{
+    uint32_t x = xorshift(seed[0]);
+    return (float)((int16_t)(x & 0xFFFF) + (int16_t)(x >> 16)) * uniform_scale;
+}
+
+void iq_quantizer::Convert(void* data, size_t count)
+{
+    // The output never overtakes the input: every position is read before it is written
+    switch (format)
+    {
+        case SDDC_IQ_CS16:
+            ConvertCS16((const float*)data, (int16_t*)data, count * 2);
+            break;
+        case SDDC_IQ_CS8:
+            ConvertCS8((const float*)data, (int8_t*)data, count * 2);
+            break;
+        default:
+            break;
+    }
+}
+
+void iq_quantizer::ConvertCS16(const float* input, int16_t* output, size_t n)
+{
+    size_t i = 0;
+
+#ifdef QUANTIZE_SSE2
+    const __m128 s = _mm_set1_ps(scale);
+    const __m128 low = _mm_set1_ps(-32768.0f);
+    const __m128 high = _mm_set1_ps(32767.0f);
+    __m128i state = _mm_loadu_si128((const __m128i*)seed);
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i a = Quantize(input + i, s, low, high, dither, state);
+        __m128i b = Quantize(input + i + 4, s, low, high, dither, state);
+        _mm_storeu_si128((__m128i*)(output + i), _mm_packs_epi32(a, b));
+    }
+
+    _mm_storeu_si128((__m128i*)seed, state);
+#endif
+
+    for (; i < n; i++)
+    {
+        float v = input[i] * scale;
+        if (dither)
+            v += Triangular();
+        output[i] = Saturate<int16_t>(v, -32768.0f, 32767.0f);
+    }
+}
+
+void iq_quantizer::ConvertCS8(const float* input, int8_t* output, size_t n)
+{
+    size_t i = 0;
+
+#ifdef QUANTIZE_SSE2
+    const __m128 s = _mm_set1_ps(scale);
+    const __m128 low = _mm_set1_ps(-128.0f);
+    const __m128 high = _mm_set1_ps(127.0f);
+    __m128i state = _mm_loadu_si128((const __m128i*)seed);
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i a = Quantize(input + i, s, low, high, dither, state);
+        __m128i b = Quantize(input + i + 4, s, low, high, dither, state);
+        __m128i c = Quantize(input + i + 8, s, low, high, dither, state);
+        __m128i d = Quantize(input + i + 12, s, low, high, dither, state);
+        __m128i ab = _mm_packs_epi32(a, b);
+        __m128i cd = _mm_packs_epi32(c, d);
+        _mm_storeu_si128((__m128i*)(output + i), _mm_packs_epi16(ab, cd));
+    }
+
+    _mm_storeu_si128((__m128i*)seed, state);
+#endif
+
+    for (; i < n; i++)
+    {
+        float v = input[i] * scale;
+        if (dither)
+            v += Triangular();
+        output[i] = Saturate<int8_t>(v, -128.0f, 127.0f);
+    }
+}
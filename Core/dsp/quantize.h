@@ -0,0 +1,69 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../types.h"
+
+/**
+ * @brief Converts the r2iq output (CF32) to integer IQ samples, in place
+ *
+ * Every sample is multiplied by the scale, optionally gets a triangular dither
+ * of +-1 LSB (decorrelates the quantization error from the signal, useful with
+ * CS8), then is rounded to the nearest integer and saturated.
+ * The converted samples start at the address of the input, which is half (CS16)
+ * or a quarter (CS8) of its size: the block is converted where it is, without
+ * another buffer.
+ */
+class iq_quantizer
+{
+public:
+    iq_quantizer();
+
+    // The scale must be > 0, 0 picks the full scale of the format (see FullScale)
+    bool Configure(sddc_iq_format_t format, float scale = 0, bool dither = false);
+
+    sddc_iq_format_t getFormat() const { return format; }
+    float getScale() const { return scale; }
+    bool getDither() const { return dither; }
+
+    // Bytes of one IQ sample
+    size_t SampleSize() const { return SampleSize(format); }
+    static size_t SampleSize(sddc_iq_format_t format);
+
+    // Scale giving the largest integer for a float sample of 1.0
+    static float FullScale(sddc_iq_format_t format);
+
+    // Converts `count` IQ samples, nothing to do for CF32
+    void Convert(void* data, size_t count);
+
+private:
+    void ConvertCS16(const float* input, int16_t* output, size_t n);
+    void ConvertCS8(const float* input, int8_t* output, size_t n);
+    float Triangular();
+
+    sddc_iq_format_t format;
+    float scale;
+    bool dither;
+
+    uint32_t seed[4];   // one xorshift generator per SIMD lane
+};
@@ -1,15 +1,19 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <vector>
+#include <stdint.h>
 
 #include "../config.h"
+#include "allocator.h"
 
 namespace {
     const int default_count = 64;
     const int spin_count = 100;
-    #define ALIGN (8)
 }
 
 
@@ -19,46 +23,88 @@ public:
         max_count(count),
         read_index(0),
         write_index(0),
+        timestamps(count, 0),
         emptyCount(0),
         fullCount(0),
         writeCount(0),
-        stopped(false)
+        lastFullTimestamp(0),
+        readers_waiting(0),
+        writers_waiting(0),
+        stopped(false),
+        write_listener(nullptr),
+        write_listener_context(nullptr)
     {
     }
 
     int getFullCount() const { return fullCount; }
 
+    // Time of the last block written before the producer last had to wait (see setWriteTimestamp)
+    int64_t getLastFullTimestamp() const { return lastFullTimestamp; }
+
     int getEmptyCount() const { return emptyCount; }
 
     int getWriteCount() const { return writeCount; }
 
+    // Slot of the block getReadPtr() gives, see ringbuffer::getBlock
+    int getReadIndex() const { return read_index; }
+
+    // Blocks written and not read yet
+    int getFillCount() const { return (write_index - read_index + max_count) % max_count; }
+
+    // True when getWritePtr() would wait for the consumer
+    bool isFull() const { return (write_index + 1) % max_count == read_index; }
+
+    // True when getReadPtr() would wait for the producer
+    bool isEmpty() const { return read_index == write_index; }
+
+    // Called by WriteDone() after every block, for a consumer that does not wait
+    // in getReadPtr() (see r2iq_pool). Set it before the producer starts
+    void setWriteListener(void (*listener)(void* context), void* context)
+    {
+        write_listener_context = context;
+        write_listener = listener;
+    }
+
+    // Time of the first sample of a block (ns, CLOCK_REALTIME based, 0 if unknown).
+    // The producer stamps the block it is filling before WriteDone(),
+    // the consumer reads the stamp of the block it got before ReadDone()
+    void setWriteTimestamp(int64_t timestamp_ns) { timestamps[write_index] = timestamp_ns; }
+    int64_t getReadTimestamp() const { return timestamps[read_index]; }
+
+    // A block finished after Stop() belongs to the stream stopped: its index is not
+    // stored back over the ones reset, where it would outlive the next Start()
+
     void ReadDone()
     {
-        std::unique_lock<std::mutex> lk(mutex);
-        if ((write_index + 1) % max_count == read_index)
+        if (stopped) return;
+
+        read_index = (read_index + 1) % max_count;
+
+        // The mutex is only taken when the producer sleeps in getWritePtr()
+        if (writers_waiting)
         {
-            read_index = (read_index + 1) % max_count;
+            { std::lock_guard<std::mutex> lk(mutex); }
             nonfullCV.notify_all();
         }
-        else
-        {
-            read_index = (read_index + 1) % max_count;
-        }
     }
 
     void WriteDone()
     {
-        std::unique_lock<std::mutex> lk(mutex);
-        if (read_index == write_index)
+        if (stopped) return;
+
+        write_index = (write_index + 1) % max_count;
+        writeCount++;
+
+        // Same for a consumer sleeping in getReadPtr()
+        if (readers_waiting)
         {
-            write_index = (write_index + 1) % max_count;
+            { std::lock_guard<std::mutex> lk(mutex); }
             nonemptyCV.notify_all();
         }
-        else
-        {
-            write_index = (write_index + 1) % max_count;
-        }
-        writeCount++;
+
+        auto listener = write_listener.load();
+        if (listener)
+            listener(write_listener_context);
     }
 
     void Start()
@@ -80,6 +126,15 @@ public:
 
 protected:
 
+    // The waits spin a little, then sleep on a condition variable.
+    // A waiter registers itself (readers_waiting / writers_waiting) under the mutex
+    // before testing the indices again; ReadDone() and WriteDone() move their index
+    // then test the counter: with both sequentially consistent, either the waiter
+    // sees the new index or the other side sees the waiter and notifies it.
+    // The notifier only passes through the mutex (the waiter is then inside wait())
+    // and notifies after releasing it, so the woken thread does not block on it again.
+    // While nobody sleeps, a block goes through without any lock or system call
+
     void WaitUntilNotEmpty()
     {
         if (stopped) return;
@@ -91,15 +146,40 @@ protected:
                 return;
         }
 
-        if (read_index == write_index)
-        {
-            std::unique_lock<std::mutex> lk(mutex);
+        std::unique_lock<std::mutex> lk(mutex);
+        if (read_index != write_index)
+            return;
+
+        emptyCount++;
+        readers_waiting++;
+        nonemptyCV.wait(lk, [this] {
+            return read_index != write_index;
+        });
+        readers_waiting--;
+    }
 
-            emptyCount++;
-            nonemptyCV.wait(lk, [this] {
-                return read_index != write_index;
-            });
+    // Same as above, false when nothing came within the timeout
+    bool WaitUntilNotEmpty(std::chrono::milliseconds timeout)
+    {
+        if (stopped) return true;
+
+        for (int i = 0; i < spin_count; i++)
+        {
+            if (read_index != write_index)
+                return true;
         }
+
+        std::unique_lock<std::mutex> lk(mutex);
+        if (read_index != write_index)
+            return true;
+
+        emptyCount++;
+        readers_waiting++;
+        bool ready = nonemptyCV.wait_for(lk, timeout, [this] {
+            return read_index != write_index;
+        });
+        readers_waiting--;
+        return ready;
     }
 
     void WaitUntilNotFull()
@@ -112,30 +192,44 @@ protected:
                 return;
         }
 
-        if ((write_index + 1) % max_count == read_index)
-        {
-            std::unique_lock<std::mutex> lk(mutex);
-            fullCount++;
-            nonfullCV.wait(lk, [this] {
-                return (write_index + 1) % max_count != read_index;
-            });
-        }
+        std::unique_lock<std::mutex> lk(mutex);
+        if ((write_index + 1) % max_count != read_index)
+            return;
+
+        lastFullTimestamp = timestamps[(write_index + max_count - 1) % max_count];
+        fullCount++;
+        writers_waiting++;
+        nonfullCV.wait(lk, [this] {
+            return (write_index + 1) % max_count != read_index;
+        });
+        writers_waiting--;
     }
 
     int max_count;
 
-    volatile int read_index;
-    volatile int write_index;
+    // Producer and consumer each own a cache line
+    alignas(SDDC_CACHELINE_SIZE) std::atomic<int> read_index;
+    alignas(SDDC_CACHELINE_SIZE) std::atomic<int> write_index;
+
+    std::vector<int64_t> timestamps;
 
 private:
     int emptyCount;
-    int fullCount;
-    int writeCount;
+    std::atomic<int> fullCount;     // read by the statistics, from other threads
+    std::atomic<int> writeCount;
+    std::atomic<int64_t> lastFullTimestamp;
+
+    // Threads sleeping in the waits, changed under the mutex
+    std::atomic<int> readers_waiting;
+    std::atomic<int> writers_waiting;
 
     std::mutex mutex;
-    bool stopped;
+    std::atomic<bool> stopped;
     std::condition_variable nonemptyCV;
     std::condition_variable nonfullCV;
+
+    std::atomic<void (*)(void*)> write_listener;
+    void* write_listener_context;
 };
 
 template<typename T> class ringbuffer : public ringbufferbase {
@@ -156,7 +250,7 @@ public:
         Stop();
 
         if (raw_buffer)
-            delete[] raw_buffer;
+            sddc_free(raw_buffer);
         // In the event of the destructor being called twice by another part of the code,
         // The raw_buffer goes back to nullptr to avoid a double free
         raw_buffer = nullptr;
@@ -164,6 +258,35 @@ public:
         delete[] buffers;
     }
 
+    // Changes the number of blocks, the content is lost.
+    // Only valid while nobody is reading or writing
+    void setBlockCount(int count)
+    {
+        TracePrintln("ringbuffer", "%d", count);
+
+        if (count == max_count)
+            return;
+
+        delete[] buffers;
+        max_count = count;
+        buffers = new TPtr[max_count];
+        timestamps.assign(max_count, 0);
+
+        int size = block_size;
+        block_size = 0;
+        if (raw_buffer)
+        {
+            sddc_free(raw_buffer);
+            raw_buffer = nullptr;
+        }
+        if (size)
+            setBlockSize(size);
+
+        Start();
+    }
+
+    int getBlockCount() const { return max_count; }
+
     void setBlockSize(int size)
     {
         TracePrintln("ringbuffer", "");
@@ -173,12 +296,14 @@ public:
             block_size = size;
 
             if (raw_buffer)
-                delete[] raw_buffer;
+                sddc_free(raw_buffer);
 
-            int aligned_block_size = (block_size + ALIGN - 1) & (~(ALIGN - 1));
+            // Every block starts on its own cache line
+            const int align = SDDC_CACHELINE_SIZE / sizeof(T);
+            int aligned_block_size = (block_size + align - 1) / align * align;
 
             DebugPrintln("ringbuffer", "New raw buffer size : %d", max_count * aligned_block_size);
-            raw_buffer = new T[max_count * aligned_block_size];
+            raw_buffer = (T*)sddc_alloc(sizeof(T) * max_count * aligned_block_size);
 
             for (int i = 0; i < max_count; ++i)
             {
@@ -211,8 +336,30 @@ public:
         return buffers[read_index];
     }
 
+    // Same as getReadPtr(), but gives up after timeout_ms: nullptr when no block came
+    const T* getReadPtr(uint32_t timeout_ms)
+    {
+        if (!WaitUntilNotEmpty(std::chrono::milliseconds(timeout_ms)))
+            return nullptr;
+
+        return buffers[read_index];
+    }
+
     int getBlockSize() const { return block_size; }
 
+    // Block of slot `index`, for the consumers which name the blocks by their slot.
+    // Valid until the next setBlockCount() or setBlockSize()
+    T* getBlock(int index) { return buffers[index]; }
+
+    // Moves the blocks next to the calling thread, see sddc_mem_bind_current_node
+    void BindToCurrentNode()
+    {
+        if (raw_buffer)
+            sddc_mem_bind_current_node(raw_buffer);
+    }
+
+    bool isHugepageBacked() const { return raw_buffer && sddc_mem_is_hugepage(raw_buffer); }
+
 private:
     int block_size;
 
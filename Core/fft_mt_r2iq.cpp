@@ -18,15 +18,129 @@ The name fft_mt_r2iq stands for Fast Fourier Transform, Multi-Threaded, Real to
 #include "RadioHandler.h"
 
 #include "fir.h"
+#include "r2iq_pool.h"
+#include "dsp/allocator.h"
+#include "thread_config.h"
 
 #include <assert.h>
+#include <map>
 #include <utility>
 
 #define TAG "fft_mt_r2iq"
 
 
-fft_mt_r2iq::fft_mt_r2iq() :
-	filterHw(nullptr)
+// The FFTW planner is not thread safe, and the devices are opened from any thread
+static std::mutex& fftw_planner_mutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+
+std::shared_ptr<const r2iqTables> r2iqTables::Acquire(float gain)
+{
+	TracePrintln(TAG, "%f", gain);
+
+	static std::mutex cache_mutex;
+	static std::map<float, std::weak_ptr<const r2iqTables>> cache;
+
+	std::lock_guard<std::mutex> cache_lock(cache_mutex);
+	auto shared = cache[gain].lock();
+	if (shared)
+	{
+		DebugPrintln(TAG, "Using the filters and plans of gain %f", gain);
+		return shared;
+	}
+
+	std::lock_guard<std::mutex> lock(fftw_planner_mutex());
+	auto tables = std::make_shared<r2iqTables>();
+	tables->gain = gain;
+
+	fftwf_import_wisdom_from_filename("wisdom");
+
+	fftwf_plan filterplan_t2f_c2c; // time to frequency fft
+
+	// filters
+	fftwf_complex *pfilterht;       // time filter ht
+	pfilterht = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex)*BASE_FFT_HALF_SIZE);
+	for (int d = 0; d < NDECIDX; d++)
+	{
+		tables->filterHw[d] = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex)*BASE_FFT_HALF_SIZE);
+	}
+
+	filterplan_t2f_c2c = fftwf_plan_dft_1d(BASE_FFT_HALF_SIZE, pfilterht, tables->filterHw[0], FFTW_FORWARD, FFTW_MEASURE);
+	float *pht = new float[BASE_FFT_HALF_SIZE / 4 + 1];
+	const float Astop = 120.0f;
+	const float relPass = 0.85f;  // 85% of Nyquist should be usable
+	const float relStop = 1.1f;   // 'some' alias back into transition band is OK
+	for (int d = 0; d < NDECIDX; d++)	// @todo when increasing NDECIDX
+	{
+		// @todo: have dynamic bandpass filter size - depending on decimation
+		//   to allow same stopband-attenuation for all decimations
+		float Bw = 64.0f / (1 << d);
+		// Bw *= 0.8f;  // easily visualize Kaiser filter's response
+		KaiserWindow(BASE_FFT_HALF_SIZE / 4 + 1, Astop, relPass * Bw / 128.0f, relStop * Bw / 128.0f, pht);
+
+		float gainadj = gain * 2048.0f / (float)FFTN_R_ADC; // reference is FFTN_R_ADC == 2048
+
+		for (int t = 0; t < BASE_FFT_HALF_SIZE; t++)
+		{
+			pfilterht[t][0] = pfilterht[t][1]= 0.0F;
+		}
+
+		for (int t = 0; t < (BASE_FFT_HALF_SIZE/4+1); t++)
+		{
+			pfilterht[BASE_FFT_HALF_SIZE-1-t][0] = gainadj * pht[t];
+		}
+
+		fftwf_execute_dft(filterplan_t2f_c2c, pfilterht, tables->filterHw[d]);
+	}
+	delete[] pht;
+	fftwf_destroy_plan(filterplan_t2f_c2c);
+	fftwf_free(pfilterht);
+
+	DebugPrintln(TAG, "Generated filters");
+
+	// Planned on buffers allocated like the ones of the threads, so that they
+	// have the same alignment when the plans are executed on them
+	float* time = (float*)sddc_alloc((transferSamples + BASE_FFT_SIZE) * sizeof(float));
+	fftwf_complex* freq = (fftwf_complex*)sddc_alloc(sizeof(fftwf_complex)*(BASE_FFT_HALF_SIZE + 1));
+	fftwf_complex* tmp = (fftwf_complex*)sddc_alloc(sizeof(fftwf_complex)*(BASE_FFT_HALF_SIZE));
+
+	tables->plan_time2freq_r2c = fftwf_plan_dft_r2c_1d(/*real_length=*/BASE_FFT_SIZE, /*in=*/time, /*out=*/freq, /*flags=*/FFTW_MEASURE);
+	DebugPrintln(TAG, "Generated FFTW real to IQ plan");
+
+	for (int d = 0; d < NDECIDX; d++)
+	{
+		// Generate inverse FFT plans for each decimation steps
+		tables->plan_freq2time[d] = fftwf_plan_dft_1d(BASE_FFT_HALF_SIZE >> d, tmp, tmp, FFTW_BACKWARD, FFTW_MEASURE);
+	}
+	DebugPrintln(TAG, "Generated %d IFFT plans", NDECIDX);
+
+	sddc_free(time);
+	sddc_free(freq);
+	sddc_free(tmp);
+
+	cache[gain] = tables;
+	return tables;
+}
+
+r2iqTables::~r2iqTables()
+{
+	TracePrintln(TAG, "%f", gain);
+
+	std::lock_guard<std::mutex> lock(fftw_planner_mutex());
+
+	fftwf_export_wisdom_to_filename("wisdom");
+
+	for (int d = 0; d < NDECIDX; d++)
+	{
+		fftwf_free(filterHw[d]);     // 4096
+		fftwf_destroy_plan(plan_freq2time[d]);
+	}
+	fftwf_destroy_plan(plan_time2freq_r2c);
+}
+
+fft_mt_r2iq::fft_mt_r2iq()
 {
 	r2iqOn = false;
 	stateADCRand = false;
@@ -75,31 +189,26 @@ fft_mt_r2iq::fft_mt_r2iq() :
 
 fft_mt_r2iq::~fft_mt_r2iq()
 {
-	if (filterHw == nullptr)
-		return;
+	// The pool would keep calling a deleted converter
+	if (pool_attached)
+		TurnOff();
 
-	fftwf_export_wisdom_to_filename("wisdom");
-
-	for (int d = 0; d < NDECIDX; d++)
-	{
-		fftwf_free(filterHw[d]);     // 4096
-	}
-	fftwf_free(filterHw);
+	Release();
+}
 
-	fftwf_destroy_plan(plan_time2freq_r2c);
-	for (int d = 0; d < NDECIDX; d++)
-	{
-		fftwf_destroy_plan(plan_freq2time_per_decimation[d]);
-	}
+void fft_mt_r2iq::Release()
+{
+	tables.reset();
 
 	for (unsigned t = 0; t < processor_count; t++) {
 		auto th = threadArgs[t];
-		fftwf_free(th->ADCinTime);
-		fftwf_free(th->ADCinFreq);
-		fftwf_free(th->inFreqTmp);
+		sddc_free(th->ADCinTime);
+		sddc_free(th->ADCinFreq);
+		sddc_free(th->inFreqTmp);
 
 		delete threadArgs[t];
 	}
+	processor_count = 0;
 }
 
 float fft_mt_r2iq::setFreqOffset(float offset)
@@ -117,12 +226,20 @@ float fft_mt_r2iq::setFreqOffset(float offset)
 
 void fft_mt_r2iq::TurnOn() {
 	this->r2iqOn = true;
-	this->bufIdx = 0;
-	this->lastThread = threadArgs[0];
 
 	inputbuffer->Start();
 	outputbuffer->Start();
 
+	for (unsigned t = 0; t < processor_count; t++)
+		r2iqStreamStart(threadArgs[t]);
+
+	if (use_pool)
+	{
+		r2iq_pool::Get().Attach(this, inputbuffer, thread_config);
+		pool_attached = true;
+		return;
+	}
+
 	for (unsigned t = 0; t < processor_count; t++) {
 		r2iq_thread[t] = std::thread(
 			[this] (void* arg)
@@ -133,13 +250,30 @@ void fft_mt_r2iq::TurnOn() {
 void fft_mt_r2iq::TurnOff(void) {
 	this->r2iqOn = false;
 
+	// Wakes up a conversion waiting for a block, before waiting for it to finish
 	inputbuffer->Stop();
 	outputbuffer->Stop();
+
+	if (pool_attached)
+	{
+		r2iq_pool::Get().Detach(this);
+		pool_attached = false;
+		return;
+	}
+
 	for (unsigned t = 0; t < processor_count; t++) {
 		r2iq_thread[t].join();
 	}
 }
 
+bool fft_mt_r2iq::ProcessPending()
+{
+	if (!r2iqOn || inputbuffer->isEmpty())
+		return false;
+
+	return r2iqProcessBlock(threadArgs[0]);
+}
+
 bool fft_mt_r2iq::IsOn(void) { return(this->r2iqOn); }
 
 void fft_mt_r2iq::Init(float gain, ringbuffer<int16_t> *input, ringbuffer<sddc_complex_t>* obuffers)
@@ -147,6 +281,12 @@ void fft_mt_r2iq::Init(float gain, ringbuffer<int16_t> *input, ringbuffer<sddc_c
 	TracePrintln(TAG, "%f, %p, %p", gain, input, obuffers);
 	DebugPrintln(TAG, "Initialization...");
 
+	// Init may be called again when the stream geometry changes.
+	// Taken first, the tables are kept if the gain did not change
+	auto shared_tables = r2iqTables::Acquire(gain);
+	Release();
+	tables = shared_tables;
+
 	DebugPrintln(TAG, "Full FFT size : %d", BASE_FFT_SIZE);
 	DebugPrintln(TAG, "FFT size without scrap : %d", BASE_FFT_SIZE - BASE_FFT_SCRAP_SIZE);
 	DebugPrintln(TAG, "FFT scrap size : %d", BASE_FFT_SCRAP_SIZE);
@@ -160,16 +300,9 @@ void fft_mt_r2iq::Init(float gain, ringbuffer<int16_t> *input, ringbuffer<sddc_c
 
 	this->GainScale = gain;
 
-	// number of ffts needed to process one full buffer block
-	// including an overlap with the previous samples (required by the overlap-save method)
-	// Historically there was a "+ 1" here, but it triggers a rather catastrophic memory leak
-	ffts_per_blocks = inputbuffer_block_size / (BASE_FFT_SIZE - BASE_FFT_SCRAP_SIZE);
-	DebugPrintln(TAG, "Number of FFTs per blocks : %d", ffts_per_blocks);
-	DebugPrintln(TAG, "Effective FFT conversion : %d", ffts_per_blocks * (BASE_FFT_SIZE - BASE_FFT_SCRAP_SIZE));
-
-
-
-	fftwf_import_wisdom_from_filename("wisdom");
+	// The blocks are cut into FFTs continuously: the samples left at the end of a block
+	// (the scrap plus less than one FFT step) are processed with the next block
+	DebugPrintln(TAG, "Number of FFTs per blocks : %.2f", (float)inputbuffer_block_size / BASE_FFT_STEP);
 
 	// Get the processor count
 	processor_count = std::thread::hardware_concurrency();
@@ -181,72 +314,21 @@ void fft_mt_r2iq::Init(float gain, ringbuffer<int16_t> *input, ringbuffer<sddc_c
 	DebugPrintln(TAG, "Usable threads: %d", processor_count);
 
 	{
-		fftwf_plan filterplan_t2f_c2c; // time to frequency fft
-
-		// filters
-		fftwf_complex *pfilterht;       // time filter ht
-		pfilterht = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex)*BASE_FFT_HALF_SIZE);
-		filterHw = (fftwf_complex**)fftwf_malloc(sizeof(fftwf_complex*)*NDECIDX);
-		for (int d = 0; d < NDECIDX; d++)
-		{
-			filterHw[d] = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex)*BASE_FFT_HALF_SIZE);
-		}
-
-		filterplan_t2f_c2c = fftwf_plan_dft_1d(BASE_FFT_HALF_SIZE, pfilterht, filterHw[0], FFTW_FORWARD, FFTW_MEASURE);
-		float *pht = new float[BASE_FFT_HALF_SIZE / 4 + 1];
-		const float Astop = 120.0f;
-		const float relPass = 0.85f;  // 85% of Nyquist should be usable
-		const float relStop = 1.1f;   // 'some' alias back into transition band is OK
-		for (int d = 0; d < NDECIDX; d++)	// @todo when increasing NDECIDX
-		{
-			// @todo: have dynamic bandpass filter size - depending on decimation
-			//   to allow same stopband-attenuation for all decimations
-			float Bw = 64.0f / decimation_ratio[d];
-			// Bw *= 0.8f;  // easily visualize Kaiser filter's response
-			KaiserWindow(BASE_FFT_HALF_SIZE / 4 + 1, Astop, relPass * Bw / 128.0f, relStop * Bw / 128.0f, pht);
-
-			float gainadj = gain * 2048.0f / (float)FFTN_R_ADC; // reference is FFTN_R_ADC == 2048
-
-			for (int t = 0; t < BASE_FFT_HALF_SIZE; t++)
-			{
-				pfilterht[t][0] = pfilterht[t][1]= 0.0F;
-			}
-		
-			for (int t = 0; t < (BASE_FFT_HALF_SIZE/4+1); t++)
-			{
-				pfilterht[BASE_FFT_HALF_SIZE-1-t][0] = gainadj * pht[t];
-			}
-
-			fftwf_execute_dft(filterplan_t2f_c2c, pfilterht, filterHw[d]);
-		}
-		delete[] pht;
-		fftwf_destroy_plan(filterplan_t2f_c2c);
-		fftwf_free(pfilterht);
-
-		DebugPrintln(TAG, "Generated filters");
-
 		for (unsigned t = 0; t < processor_count; t++) {
 			r2iqThreadArg *th = new r2iqThreadArg();
 			threadArgs[t] = th;
 
 			// Buffer containing real samples of one block converted to float
-			// plus a scrap portion from the previous block for the overlap-save
-			th->ADCinTime = (float*)fftwf_malloc((inputbuffer_block_size + BASE_FFT_SCRAP_SIZE) * sizeof(float));
-
-			th->ADCinFreq = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex)*(BASE_FFT_HALF_SIZE + 1)); // 1024+1
-			th->inFreqTmp = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex)*(BASE_FFT_HALF_SIZE));    // 1024
+			// plus what is left of the previous blocks (at most the scrap and one FFT step)
+			// The scratch buffers are cache line aligned (which also satisfies FFTW's SIMD alignment)
+			// and get moved next to the r2iq thread once it is running
+			th->ADCinTime = (float*)sddc_alloc((inputbuffer_block_size + BASE_FFT_SIZE) * sizeof(float));
+			th->history = BASE_FFT_SCRAP_SIZE;
+
+			th->ADCinFreq = (fftwf_complex*)sddc_alloc(sizeof(fftwf_complex)*(BASE_FFT_HALF_SIZE + 1)); // 1024+1
+			th->inFreqTmp = (fftwf_complex*)sddc_alloc(sizeof(fftwf_complex)*(BASE_FFT_HALF_SIZE));    // 1024
 		}
 		DebugPrintln(TAG, "Generated argument sets for the threads");
-
-		plan_time2freq_r2c = fftwf_plan_dft_r2c_1d(/*real_length=*/BASE_FFT_SIZE, /*in=*/threadArgs[0]->ADCinTime, /*out=*/threadArgs[0]->ADCinFreq, /*flags=*/FFTW_MEASURE);
-		DebugPrintln(TAG, "Generated FFTW real to IQ plan");
-
-		for (int d = 0; d < NDECIDX; d++)
-		{
-			// Generate inverse FFT plans for each decimation steps
-			plan_freq2time_per_decimation[d] = fftwf_plan_dft_1d(fft_size_per_decimation[d], threadArgs[0]->inFreqTmp, threadArgs[0]->inFreqTmp, FFTW_BACKWARD, FFTW_MEASURE);
-		}
-		DebugPrintln(TAG, "Generated %d IFFT plans", NDECIDX);
 	}
 
 	DebugPrintln(TAG, "Initialization done");
@@ -288,9 +370,18 @@ void fft_mt_r2iq::Init(float gain, ringbuffer<int16_t> *input, ringbuffer<sddc_c
 
 void * fft_mt_r2iq::r2iqThreadf(r2iqThreadArg *th)
 {
+	// First thing on the thread: settle on its CPUs, then pull the blocks it works on to its NUMA node
+	sddc_thread_apply(SDDC_THREAD_R2IQ, thread_config);
+	sddc_mem_bind_current_node(th->ADCinTime);
+	sddc_mem_bind_current_node(th->ADCinFreq);
+	sddc_mem_bind_current_node(th->inFreqTmp);
+	inputbuffer->BindToCurrentNode();
+	outputbuffer->BindToCurrentNode();
+
 #ifdef NO_SIMD_OPTIM
 	DebugPrintln(TAG, "Hardware Capability: all SIMD features (AVX, AVX2, AVX512) deactivated\n");
-	return r2iqThreadf_def(th);
+	while (r2iqProcessBlock(th)) {}
+	return 0;
 #else
 #if defined(DETECT_AVX)
 	int info[4];
@@ -314,11 +405,13 @@ void * fft_mt_r2iq::r2iqThreadf(r2iqThreadArg *th)
 
 	DebugPrintln(TAG, "Hardware Capability: AVX:%s AVX2:%s AVX512:%s\n", HW_AVX ? "yes" : "no", HW_AVX2 ? "yes" : "no", HW_AVX512F ? "yes" : "no");
 
-	return r2iqThreadf_def(th);
+	while (r2iqProcessBlock(th)) {}
+	return 0;
 #elif defined(DETECT_NEON)
 	bool NEON = detect_neon();
 	DebugPrintln(TAG, "Hardware Capability: NEON:%d\n", NEON);
-	return r2iqThreadf_def(th);
+	while (r2iqProcessBlock(th)) {}
+	return 0;
 #endif
 #endif
 }
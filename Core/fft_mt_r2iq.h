@@ -8,6 +8,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <memory>
 
 #include "dsp/ringbuffer.h"
 
@@ -20,7 +21,17 @@ static const int BASE_FFT_SCRAP_SIZE = 1024;
 static const int BASE_FFT_SIZE = FFTN_R_ADC;
 static const int BASE_FFT_HALF_SIZE = BASE_FFT_SIZE / 2;
 
+// Input samples each FFT advances by (overlap-save)
+static const int BASE_FFT_STEP = BASE_FFT_SIZE - BASE_FFT_SCRAP_SIZE;
+
+// Delay, in ADC samples from the start of an FFT input frame, of the signal the
+// first kept output sample of that frame stands for: the scrap, plus the center
+// of the lowpass filter (BASE_FFT_HALF_SIZE / 4 + 1 taps at Fs/2), which is
+// placed just before time zero, so it shifts the output ahead by half its length
+static const int BASE_FFT_OUTPUT_DELAY = BASE_FFT_SCRAP_SIZE + 2 * (BASE_FFT_HALF_SIZE / 8 + 1);
+
 struct r2iqThreadArg;
+struct r2iqTables;
 
 class fft_mt_r2iq
 {
@@ -34,6 +45,9 @@ public:
     void TurnOff(void);
     bool IsOn(void);
 
+    // Time spent converting since the converter was created (ns), without the waits for the buffers
+    uint64_t getBusyTime() const { return busy_ns; }
+
     // --- Decimation --- //
     int getRatio()
     {
@@ -55,6 +69,21 @@ public:
 
     float setFreqOffset(float offset);
 
+    // ADC rate the input timestamps are interpolated with
+    void setSampleRate(uint32_t adc_rate) { this->adc_sample_rate = adc_rate; }
+
+    // Scheduling of the worker threads, applied by the next TurnOn
+    void setThreadConfig(const sddc_thread_config_t& config) { this->thread_config = config; }
+
+    // Process the blocks on the workers shared by all the devices (see r2iq_pool)
+    // instead of a thread of this converter, applied by the next TurnOn
+    void setSharedPool(bool shared) { this->use_pool = shared; }
+    bool getSharedPool() const { return this->use_pool; }
+
+    // Processes the next input block if one is ready, without waiting for it.
+    // Called by the r2iq_pool workers, one at a time
+    bool ProcessPending();
+
 protected:
 
     template<bool rand> void convert_float(float* output, const int16_t *input, int size)
@@ -128,11 +157,11 @@ private:
     bool stateADCRand;       // randomized ADC output
     bool useSidebandLSB;
 
-    // number of ffts needed to process one block of the input buffer
-    int ffts_per_blocks = 0;
+    uint32_t adc_sample_rate = DEFAULT_ADC_FREQ;
 
-    int bufIdx;         // index to next buffer to be processed
-    r2iqThreadArg* lastThread;
+    sddc_thread_config_t thread_config = {};
+    bool use_pool = false;
+    bool pool_attached = false;
 
     float GainScale;
 
@@ -142,15 +171,16 @@ private:
 
     void *r2iqThreadf(r2iqThreadArg *th);   // thread function
 
-    void * r2iqThreadf_def(r2iqThreadArg *th);
+    void r2iqStreamStart(r2iqThreadArg *th);        // resets the state of a stream
+    bool r2iqProcessBlock(r2iqThreadArg *th);       // waits for a block and converts it, false once turned off
 
-    fftwf_complex **filterHw;       // Hw complex to each decimation ratio
+    void Release();     // frees what Init allocated
 
-	fftwf_plan  plan_time2freq_r2c;      // fftw plan buffers Freq to Time complex to complex per decimation ratio
-	fftwf_plan *plan_freq2time;          // fftw plan buffers Time to Freq real to complex per buffer
-	fftwf_plan  plan_freq2time_per_decimation[NDECIDX];
+    // Filters and FFTW plans, shared by the converters with the same gain
+    std::shared_ptr<const r2iqTables> tables;
 
-    uint32_t processor_count;
+    uint32_t processor_count = 0;
+    std::atomic<uint64_t> busy_ns{0};
     r2iqThreadArg* threadArgs[N_MAX_R2IQ_THREADS];
     std::mutex mutexR2iqControl;                   // r2iq control lock
     std::thread r2iq_thread[N_MAX_R2IQ_THREADS]; // thread pointers
@@ -169,11 +199,31 @@ struct r2iqThreadArg {
 	}
 
 	float *ADCinTime;                // point to each threads input buffers [nftt][n]
+	int history;                     // samples kept in ADCinTime from the previous blocks
 	fftwf_complex *ADCinFreq;         // buffers in frequency
 	fftwf_complex *inFreqTmp;         // tmp decimation output buffers (after tune shift)
+
+	// Stream state, kept across the blocks (see r2iqStreamStart)
+	int decimation;                  // taken when the stream starts
+	bool lsb;
+	fftwf_complex *pout;             // output block being filled, nullptr if none
+	int output_pos;
 #if PRINT_INPUT_RANGE
 	int MinMaxBlockCount;
 	int16_t MinValue;
 	int16_t MaxValue;
 #endif
 };
+
+// Filter spectrums and FFTW plans of one gain. Nothing in them depends on the device,
+// so all the converters with the same gain use one set (see r2iqTables::Acquire)
+struct r2iqTables {
+	float gain;
+	fftwf_complex *filterHw[NDECIDX];       // Hw complex to each decimation ratio
+	fftwf_plan plan_time2freq_r2c;          // time to frequency, real to complex
+	fftwf_plan plan_freq2time[NDECIDX];     // frequency to time, complex to complex per decimation ratio
+
+	// Builds the set on the first use of a gain, it is freed with its last user
+	static std::shared_ptr<const r2iqTables> Acquire(float gain);
+	~r2iqTables();
+};
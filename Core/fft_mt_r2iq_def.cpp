@@ -5,39 +5,64 @@
 
 #define TAG "fft_mt_r2iq_def"
 
-void * fft_mt_r2iq::r2iqThreadf_def(r2iqThreadArg *th)
+void fft_mt_r2iq::r2iqStreamStart(r2iqThreadArg *th)
 {
     TracePrintln(TAG, "%p", th);
     DebugPrintln(TAG, "Initialization...");
 
-    const int deci_ratio = decimation_ratio[decimation];
+    th->decimation = decimation;
+    th->lsb = this->getSideband();
+
+    const int deci_ratio = decimation_ratio[th->decimation];
 
     const int deci_fft_scrap_size = (BASE_FFT_SCRAP_SIZE / 2) / deci_ratio;
-    const int fft_output_size = this->fft_size_per_decimation[decimation];
-    const int fft_output_half_size = fft_output_size / 2;
+    const int fft_output_size = this->fft_size_per_decimation[th->decimation];
     const int fft_useful_size = fft_output_size - deci_fft_scrap_size;
 
-    DebugPrintln(TAG, "Decimation : %d (index %d)", deci_ratio, decimation);
+    DebugPrintln(TAG, "Decimation : %d (index %d)", deci_ratio, th->decimation);
     DebugPrintln(TAG, "Scrap size : %d", deci_fft_scrap_size);
     DebugPrintln(TAG, "FFT output size : %d", fft_output_size);
     DebugPrintln(TAG, "FFT useful output size : %d", fft_useful_size);
     DebugPrintln(TAG, "Initialization done");
 
-    const fftwf_complex* filter = filterHw[decimation];
-    const bool lsb = this->getSideband();
+    // The output is a continuous stream cut into blocks independently of the input blocks
+    th->pout = nullptr;
+    th->output_pos = 0;
+
+    // Nothing comes before the first block: start with silence in place of the scrap
+    memset(th->ADCinTime, 0, BASE_FFT_SCRAP_SIZE * sizeof(float));
+    th->history = BASE_FFT_SCRAP_SIZE;
+}
+
+bool fft_mt_r2iq::r2iqProcessBlock(r2iqThreadArg *th)
+{
+    const int decimation = th->decimation;
+    const int deci_ratio = decimation_ratio[decimation];
+
+    const int deci_fft_scrap_size = (BASE_FFT_SCRAP_SIZE / 2) / deci_ratio;
+    const int fft_output_size = this->fft_size_per_decimation[decimation];
+    const int fft_output_half_size = fft_output_size / 2;
+    const int fft_useful_size = fft_output_size - deci_fft_scrap_size;
+
+    const fftwf_complex* filter = tables->filterHw[decimation];
+    const bool lsb = th->lsb;
     const auto filter2 = &filter[BASE_FFT_HALF_SIZE - fft_output_half_size];
 
-    plan_freq2time = &plan_freq2time_per_decimation[decimation];
-    fftwf_complex* pout = nullptr;
-    int decimate_count = 0;
+    const fftwf_plan plan_time2freq_r2c = tables->plan_time2freq_r2c;
+    const fftwf_plan plan_freq2time = tables->plan_freq2time[decimation];
+
+    const int output_block_size = outputbuffer->getBlockSize();
+    fftwf_complex* pout = th->pout;
+    int output_pos = th->output_pos;
+
+    // Timing: an output sample spans 2 * deci_ratio input samples
+    const double ns_per_sample = 1.0e9 / adc_sample_rate;
+    const double ns_per_output = ns_per_sample * 2 * deci_ratio;
 
-    while(r2iqOn)
     {
         // Pointer to the current input block
-        const int16_t *input_current_block;  
-        // Pointer to the end of the previous input block minus halfFft
-        // (input_previous_block + inputbuffer_block_size - halfFft)
-        const int16_t *last_buffer_end;
+        const int16_t *input_current_block;
+        int64_t input_timestamp;
 
         const int _center_frequency_bin = this->center_frequency_bin;  // Update LO tune is possible during run
 
@@ -46,16 +71,19 @@ void * fft_mt_r2iq::r2iqThreadf_def(r2iqThreadArg *th)
             input_current_block = inputbuffer->getReadPtr();
 
             if (!r2iqOn)
-                return 0;
-
-            this->bufIdx = (this->bufIdx + 1) % QUEUE_SIZE;
+                return false;
 
-            const int16_t *input_last_block = inputbuffer->peekReadPtr(-1);
-            last_buffer_end = input_last_block + inputbuffer_block_size - BASE_FFT_SCRAP_SIZE;
+            input_timestamp = inputbuffer->getReadTimestamp();
         }
 
+        const auto start = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::duration waited(0);
+
+        // The current block goes right after the samples left from the previous ones
+        float* input_dest = th->ADCinTime + th->history;
+
         // @todo: move the following int16_t conversion to (32-bit) float
-        // directly inside the following loop (for "k < ffts_per_blocks")
+        // directly inside the following loop (for "k < ffts")
         //   just before the forward fft "fftwf_execute_dft_r2c" is called
         // idea: this should improve cache/memory locality
 #if PRINT_INPUT_RANGE
@@ -63,18 +91,13 @@ void * fft_mt_r2iq::r2iqThreadf_def(r2iqThreadArg *th)
 #endif
         if (!this->getRand())        // plain samples no ADC rand set
         {
-            convert_float<false>(
-                /*dest=*/th->ADCinTime,
-                /*source=*/last_buffer_end,
-                /*len=*/BASE_FFT_SCRAP_SIZE
-            );
 #if PRINT_INPUT_RANGE
             auto minmax = std::minmax_element(input_current_block, input_current_block + inputbuffer_block_size);
             blockMinMax.first = *minmax.first;
             blockMinMax.second = *minmax.second;
 #endif
             convert_float<false>(
-                /*dest=*/th->ADCinTime + BASE_FFT_SCRAP_SIZE,
+                /*dest=*/input_dest,
                 /*source=*/input_current_block,
                 /*len=*/inputbuffer_block_size
             );
@@ -82,12 +105,7 @@ void * fft_mt_r2iq::r2iqThreadf_def(r2iqThreadArg *th)
         else
         {
             convert_float<true>(
-                /*dest=*/th->ADCinTime,
-                /*source=*/last_buffer_end,
-                /*len=*/BASE_FFT_SCRAP_SIZE
-            );
-            convert_float<true>(
-                /*dest=*/th->ADCinTime + BASE_FFT_SCRAP_SIZE,
+                /*dest=*/input_dest,
                 /*source=*/input_current_block,
                 /*len=*/inputbuffer_block_size
             );
@@ -111,12 +129,12 @@ void * fft_mt_r2iq::r2iqThreadf_def(r2iqThreadArg *th)
 #endif
         input_current_block = nullptr;
         inputbuffer->ReadDone();
-        // decimate in frequency plus tuning
 
-        if (decimate_count == 0)
-            pout = (fftwf_complex*)outputbuffer->getWritePtr();
+        // Every FFT needs a full frame, the tail that does not fill one waits for the next block
+        const int available = th->history + inputbuffer_block_size;
+        const int ffts = (available - BASE_FFT_SCRAP_SIZE) / BASE_FFT_STEP;
 
-        decimate_count = (decimate_count + 1) & (deci_ratio - 1);
+        // decimate in frequency plus tuning
 
         // Calculate the parameters for the first half
         // Includes all frequencies above _center_frequency_bin
@@ -136,18 +154,18 @@ void * fft_mt_r2iq::r2iqThreadf_def(r2iqThreadArg *th)
         
         // Main processing loop based on overlap-save method
         // It also includes filtering and decimation
-        for (int k = 0; k < ffts_per_blocks; k++)
+        for (int k = 0; k < ffts; k++)
         {
             // core of fast convolution including filter and decimation
             //   main part is 'overlap-scrap' (IMHO better name for 'overlap-save'), see
             //   https://en.wikipedia.org/wiki/Overlap%E2%80%93save_method
             {
                 // FFT first stage: time to frequency, real to complex
-                // Input buffer: th->ADCinTime + k * (0.75 * BASE_FFT_SIZE)
+                // Input buffer: th->ADCinTime + k * BASE_FFT_STEP
                 // Transformation size: BASE_FFT_SIZE
                 // Output buffer: th->ADCinFreq[]
                 // Output size: BASE_FFT_HALF_SIZE + 1
-                fftwf_execute_dft_r2c(plan_time2freq_r2c, th->ADCinTime + k * (BASE_FFT_SIZE - BASE_FFT_SCRAP_SIZE), th->ADCinFreq);
+                fftwf_execute_dft_r2c(plan_time2freq_r2c, th->ADCinTime + k * BASE_FFT_STEP, th->ADCinFreq);
 
                 // circular shift (mixing in full bins) and low/bandpass filtering (complex multiplication)
                 {
@@ -182,45 +200,67 @@ void * fft_mt_r2iq::r2iqThreadf_def(r2iqThreadArg *th)
 
                 // 'shorter' inverse FFT transform (decimation) -> frequency (back) to COMPLEX time domain
                 // transform size: fft_output_size (depending on the decimation)
-                fftwf_execute_dft(*plan_freq2time, th->inFreqTmp, th->inFreqTmp);
+                fftwf_execute_dft(plan_freq2time, th->inFreqTmp, th->inFreqTmp);
                 // result now in th->inFreqTmp[]
             }
 
+            // Time of the first useful output of this FFT, relative to the first sample of the
+            // current block (the frame may start in the samples left from the previous block)
+            const int64_t frame_timestamp = input_timestamp == 0 ? 0 :
+                input_timestamp + (int64_t)((k * BASE_FFT_STEP + BASE_FFT_OUTPUT_DELAY - th->history) * ns_per_sample);
+
             // postprocessing
-            // @todo: is it possible to ..
-            //  1)
-            //    let inverse FFT produce/save it's result directly
-            //    in "this->obuffers[modx] + offset" (pout)
-            //    ( obuffers[] would need to have additional space ..;
-            //      need to move 'scrap' of 'ovelap-scrap'? )
-            //    at least FFTW would allow so,
-            //      see http://www.fftw.org/fftw3_doc/New_002darray-Execute-Functions.html
-            //    attention: multithreading!
-            //  2)
-            //    could mirroring (lower sideband) get calculated together
+            // @todo: could mirroring (lower sideband) get calculated together
             //    with fine mixer - modifying the mixer frequency? (fs - fc)/fs
             //    (this would reduce one memory pass)
-            if (lsb) // lower sideband
+            int done = 0;
+            while (done < fft_useful_size)
             {
-                // mirror just by negating the imaginary Q of complex I/Q
-                copy<true>(pout + k * fft_useful_size, &th->inFreqTmp[deci_fft_scrap_size], fft_useful_size);
-            }
-            else // upper sideband
-            {
-                copy<false>(pout + k * fft_useful_size, &th->inFreqTmp[deci_fft_scrap_size], fft_useful_size);
+                if (pout == nullptr)
+                {
+                    const auto wait_start = std::chrono::steady_clock::now();
+                    pout = (fftwf_complex*)outputbuffer->getWritePtr();
+                    waited += std::chrono::steady_clock::now() - wait_start;
+                    if (!r2iqOn)
+                        return false;
+
+                    output_pos = 0;
+                    outputbuffer->setWriteTimestamp(frame_timestamp == 0 ? 0 :
+                        frame_timestamp + (int64_t)(done * ns_per_output));
+                }
+
+                const int count = std::min(fft_useful_size - done, output_block_size - output_pos);
+                if (lsb) // lower sideband
+                {
+                    // mirror just by negating the imaginary Q of complex I/Q
+                    copy<true>(pout + output_pos, &th->inFreqTmp[deci_fft_scrap_size + done], count);
+                }
+                else // upper sideband
+                {
+                    copy<false>(pout + output_pos, &th->inFreqTmp[deci_fft_scrap_size + done], count);
+                }
+                done += count;
+                output_pos += count;
+
+                if (output_pos == output_block_size)
+                {
+                    outputbuffer->WriteDone();
+                    pout = nullptr;
+                }
             }
             // result now in this->outputbuffer[]
         }
 
-        if (decimate_count == 0) {
-            outputbuffer->WriteDone();
-            pout = nullptr;
-        }
-        else
-        {
-            pout += fft_useful_size * (ffts_per_blocks);
-        }
-    } // while(run)
-//    DbgPrintf("r2iqThreadf idx %d pthread_exit %u\n",(int)th->t, pthread_self());
-    return 0;
+        // Keep the samples the next frame starts with (the scrap and the unprocessed tail)
+        const int consumed = ffts * BASE_FFT_STEP;
+        th->history = available - consumed;
+        memmove(th->ADCinTime, th->ADCinTime + consumed, th->history * sizeof(float));
+
+        busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start - waited).count();
+    }
+
+    th->pout = pout;
+    th->output_pos = output_pos;
+    return true;
 }
\ No newline at end of file
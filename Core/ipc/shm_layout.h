@@ -0,0 +1,125 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifndef _WIN32
+#include <time.h>
+#endif
+#if defined(__linux__)
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Layout of the shared memory ring of shm_publisher, read by libsddc/sddc_shm.c.
+ * C, as both sides include it. The fields written while the ring is live are
+ * only accessed through the __atomic builtins.
+ *
+ * The object holds the header, the slot descriptors, the reader cursors, then
+ * the samples: slot_count slots of slot_size bytes, block n of the stream in
+ * slot n % slot_count. Each slot is a seqlock: the publisher zeroes its seq,
+ * writes the samples, then sets seq to n + 1 and publishes it (`published`).
+ * A reader checks seq before and after using the samples in place: if it
+ * changed, the publisher reused the slot meanwhile. The publisher never waits
+ * for the readers.
+ */
+
+#define SDDC_SHM_MAGIC 0x4d484453u  /* "SDHM" */
+#define SDDC_SHM_VERSION 1
+#define SDDC_SHM_DEFAULT_NAME "/sddc"
+
+typedef struct sddc_shm_header_t {
+    uint32_t magic;             /* set last by the publisher, once the rest is */
+    uint32_t version;
+    uint64_t size;              /* of the whole object */
+    uint32_t slot_count;
+    uint32_t slot_size;
+    uint32_t max_readers;
+    uint32_t raw;               /* int16 ADC samples, else IQ samples in iq_format */
+    uint32_t iq_format;         /* sddc_iq_format_t */
+    uint32_t sample_size;       /* bytes, both I and Q for IQ */
+    double sample_rate;
+    uint32_t adc_sample_rate;
+    uint32_t publisher_pid;
+    uint64_t slots_offset;      /* sddc_shm_slot_t[slot_count] */
+    uint64_t readers_offset;    /* sddc_shm_reader_slot_t[max_readers] */
+    uint64_t data_offset;       /* slot_count * slot_size bytes, page aligned */
+    uint8_t reserved0[48];
+
+    /* publisher, a cache line of its own */
+    uint64_t published;         /* slots published since the start */
+    uint32_t futex;             /* bumped after every slot, the readers wait on it */
+    uint32_t closed;            /* the publisher stopped: no more slots */
+    uint8_t reserved1[48];
+
+    /* readers */
+    uint32_t waiters;           /* readers waiting on futex */
+    uint8_t reserved2[60];
+} sddc_shm_header_t;
+
+typedef struct sddc_shm_slot_t {
+    uint64_t seq;               /* n + 1 for slot n of the stream, 0 while written */
+    uint64_t first_sample;      /* index of its first sample in the stream */
+    int64_t timestamp_ns;       /* of its first sample, 0 if unknown */
+    uint32_t size;              /* bytes */
+    uint32_t reserved;
+} sddc_shm_slot_t;
+
+typedef struct sddc_shm_reader_slot_t {
+    uint32_t pid;               /* 0 when free, a reader takes it with a CAS */
+    uint32_t reserved0;
+    uint64_t cursor;            /* next slot of the stream it reads */
+    uint64_t dropped;           /* slots skipped, falling a ring behind */
+    uint64_t overruns;          /* blocks overwritten while it held them */
+    uint8_t reserved1[32];
+} sddc_shm_reader_slot_t;
+
+#ifndef _WIN32
+/* Wakes the readers waiting for a slot, after `futex` was bumped */
+static inline void sddc_shm_wake(sddc_shm_header_t *header)
+{
+#if defined(__linux__)
+    if (__atomic_load_n(&header->waiters, __ATOMIC_SEQ_CST))
+        syscall(SYS_futex, &header->futex, FUTEX_WAKE, INT_MAX, 0, 0, 0);
+#else
+    (void)header;
+#endif
+}
+
+/* Waits up to timeout_ns for `futex` to move from `value`. Polls without futexes */
+static inline void sddc_shm_wait(sddc_shm_header_t *header, uint32_t value, int64_t timeout_ns)
+{
+#if defined(__linux__)
+    struct timespec ts;
+    ts.tv_sec = timeout_ns / 1000000000;
+    ts.tv_nsec = timeout_ns % 1000000000;
+    syscall(SYS_futex, &header->futex, FUTEX_WAIT, value, &ts, 0, 0);
+#else
+    struct timespec ts = { 0, timeout_ns < 1000000 ? timeout_ns : 1000000 };
+    (void)value;
+    (void)header;
+    nanosleep(&ts, 0);
+#endif
+}
+#endif
@@ -0,0 +1,291 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "shm_publisher.h"
+#include "shm_layout.h"
+
+#include "../config.h"
+
+#include <algorithm>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define TAG "shm_publisher"
+
+namespace {
+    const uint32_t default_buffer_size = 64 * 1024 * 1024;
+    const uint32_t default_slot_size = 256 * 1024;
+    const uint32_t default_max_readers = 16;
+    const size_t page_size = 4096;
+
+    static_assert(sizeof(sddc_shm_header_t) == 256, "shm_layout.h: header size");
+    static_assert(sizeof(sddc_shm_slot_t) == 32, "shm_layout.h: slot size");
+    static_assert(sizeof(sddc_shm_reader_slot_t) == 64, "shm_layout.h: reader slot size");
+
+    size_t RoundUp(size_t size, size_t unit)
+    {
+        return (size + unit - 1) / unit * unit;
+    }
+
+#ifndef _WIN32
+    bool IsAlive(uint32_t pid)
+    {
+        return pid != 0 && (kill((pid_t)pid, 0) == 0 || errno == EPERM);
+    }
+
+    // A ring of that name whose publisher still runs
+    bool IsTaken(const std::string& name)
+    {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+            return false;
+
+        bool taken = false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(sddc_shm_header_t))
+        {
+            void* p = mmap(nullptr, sizeof(sddc_shm_header_t), PROT_READ, MAP_SHARED, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                const sddc_shm_header_t* h = (const sddc_shm_header_t*)p;
+                taken = __atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) == SDDC_SHM_MAGIC &&
+                    !__atomic_load_n(&h->closed, __ATOMIC_ACQUIRE) && IsAlive(h->publisher_pid);
+                munmap(p, sizeof(sddc_shm_header_t));
+            }
+        }
+        close(fd);
+        return taken;
+    }
+#endif
+}
+
+shm_publisher::shm_publisher():
+    header(nullptr),
+    object_size(0),
+    slot_size(0),
+    slot_count(0),
+    sample_size(1),
+    ns_per_sample(0),
+    samples(0),
+    bytes(0)
+{
+}
+
+shm_publisher::~shm_publisher()
+{
+    Close();
+}
+
+sddc_shm_config_t shm_publisher::GetDefaultConfig()
+{
+    sddc_shm_config_t config;
+    config.buffer_size = default_buffer_size;
+    config.slot_size = default_slot_size;
+    config.max_readers = default_max_readers;
+    return config;
+}
+
+sddc_err_t shm_publisher::Open(const char* name, const sddc_shm_config_t* config, const shm_stream_t& stream)
+{
+#ifdef _WIN32
+    (void)name;
+    (void)config;
+    (void)stream;
+    return ERR_NOT_COMPATIBLE;
+#else
+    Close();
+
+    sddc_shm_config_t c = config ? *config : GetDefaultConfig();
+    if (c.buffer_size == 0)
+        c.buffer_size = default_buffer_size;
+    if (c.slot_size == 0)
+        c.slot_size = default_slot_size;
+    if (c.max_readers == 0)
+        c.max_readers = default_max_readers;
+    if (c.slot_size % page_size || c.buffer_size < 2 * c.slot_size)
+        return ERR_BUFFER_SIZE_INVALID;
+
+    this->name = name && *name ? name : SDDC_SHM_DEFAULT_NAME;
+    if (this->name[0] != '/')
+        this->name.insert(0, "/");
+
+    if (IsTaken(this->name))
+    {
+        WarnPrintln(TAG, "%s is taken by a running publisher", this->name.c_str());
+        return ERR_SHM_FAILED;
+    }
+    shm_unlink(this->name.c_str());
+
+    slot_count = c.buffer_size / c.slot_size;
+    slot_size = c.slot_size;
+    const size_t slots_offset = sizeof(sddc_shm_header_t);
+    const size_t readers_offset = slots_offset + slot_count * sizeof(sddc_shm_slot_t);
+    const size_t data_offset = RoundUp(readers_offset + c.max_readers * sizeof(sddc_shm_reader_slot_t), page_size);
+    object_size = data_offset + (size_t)slot_count * slot_size;
+
+    int fd = shm_open(this->name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+    {
+        WarnPrintln(TAG, "shm_open(%s) failed: %s", this->name.c_str(), strerror(errno));
+        return ERR_SHM_FAILED;
+    }
+    if (ftruncate(fd, (off_t)object_size) != 0)
+    {
+        WarnPrintln(TAG, "ftruncate(%s, %zu) failed: %s", this->name.c_str(), object_size, strerror(errno));
+        close(fd);
+        shm_unlink(this->name.c_str());
+        return ERR_SHM_FAILED;
+    }
+
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;      // no page faults in the stream thread
+#endif
+    void* p = mmap(nullptr, object_size, PROT_READ | PROT_WRITE, flags, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+        WarnPrintln(TAG, "mmap(%s, %zu) failed: %s", this->name.c_str(), object_size, strerror(errno));
+        shm_unlink(this->name.c_str());
+        return ERR_SHM_FAILED;
+    }
+
+    // ftruncate zeroed the object: the slots and the reader slots are free
+    sddc_shm_header_t* h = (sddc_shm_header_t*)p;
+    h->version = SDDC_SHM_VERSION;
+    h->size = object_size;
+    h->slot_count = slot_count;
+    h->slot_size = (uint32_t)slot_size;
+    h->max_readers = c.max_readers;
+    h->raw = stream.raw;
+    h->iq_format = stream.iq_format;
+    h->sample_size = (uint32_t)stream.sample_size;
+    h->sample_rate = stream.sample_rate;
+    h->adc_sample_rate = stream.adc_sample_rate;
+    h->publisher_pid = (uint32_t)getpid();
+    h->slots_offset = slots_offset;
+    h->readers_offset = readers_offset;
+    h->data_offset = data_offset;
+    __atomic_store_n(&h->magic, SDDC_SHM_MAGIC, __ATOMIC_RELEASE);
+
+    header = h;
+    sample_size = stream.sample_size;
+    ns_per_sample = stream.sample_rate > 0 ? 1e9 / stream.sample_rate : 0;
+    samples = 0;
+    bytes = 0;
+
+    DebugPrintln(TAG, "%s: %u slots of %zu bytes, %u readers", this->name.c_str(), slot_count, slot_size, c.max_readers);
+    return ERR_SUCCESS;
+#endif
+}
+
+void shm_publisher::Write(const void* data, size_t size, int64_t timestamp_ns)
+{
+    if (header == nullptr)
+        return;
+
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t offset = 0; offset < size; offset += slot_size)
+    {
+        const uint64_t sample = offset / sample_size;
+        WriteSlot(p + offset, std::min(slot_size, size - offset), samples + sample,
+            timestamp_ns ? timestamp_ns + (int64_t)(sample * ns_per_sample) : 0);
+    }
+    samples += size / sample_size;
+    bytes += size;
+}
+
+void shm_publisher::WriteSlot(const uint8_t* data, size_t size, uint64_t first_sample, int64_t timestamp_ns)
+{
+#ifndef _WIN32
+    const uint64_t n = header->published;   // only written here
+    sddc_shm_slot_t* slot = (sddc_shm_slot_t*)((uint8_t*)header + header->slots_offset) + n % slot_count;
+    uint8_t* dest = (uint8_t*)header + header->data_offset + (n % slot_count) * slot_size;
+
+    // A reader still on the previous use of the slot sees seq change
+    __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    memcpy(dest, data, size);
+    slot->first_sample = first_sample;
+    slot->timestamp_ns = timestamp_ns;
+    slot->size = (uint32_t)size;
+
+    __atomic_store_n(&slot->seq, n + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&header->published, n + 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&header->futex, 1, __ATOMIC_SEQ_CST);
+    sddc_shm_wake(header);
+#endif
+}
+
+void shm_publisher::Close()
+{
+#ifndef _WIN32
+    if (header == nullptr)
+        return;
+
+    TracePrintln(TAG, "%s", name.c_str());
+
+    __atomic_store_n(&header->closed, 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&header->futex, 1, __ATOMIC_SEQ_CST);
+    sddc_shm_wake(header);
+
+    munmap(header, object_size);
+    header = nullptr;
+    shm_unlink(name.c_str());
+#endif
+}
+
+sddc_shm_stats_t shm_publisher::GetStats() const
+{
+    sddc_shm_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.bytes_published = bytes;
+#ifndef _WIN32
+    if (header == nullptr)
+        return stats;
+
+    stats.slots_published = __atomic_load_n(&header->published, __ATOMIC_ACQUIRE);
+    stats.slot_count = slot_count;
+
+    const sddc_shm_reader_slot_t* readers =
+        (const sddc_shm_reader_slot_t*)((const uint8_t*)header + header->readers_offset);
+    for (uint32_t i = 0; i < header->max_readers; i++)
+    {
+        if (!IsAlive(__atomic_load_n(&readers[i].pid, __ATOMIC_ACQUIRE)))
+            continue;
+
+        stats.readers++;
+        const uint64_t cursor = __atomic_load_n(&readers[i].cursor, __ATOMIC_RELAXED);
+        if (cursor < stats.slots_published)
+            stats.max_lag = std::max(stats.max_lag, stats.slots_published - cursor);
+        stats.slots_dropped += __atomic_load_n(&readers[i].dropped, __ATOMIC_RELAXED);
+        stats.overruns += __atomic_load_n(&readers[i].overruns, __ATOMIC_RELAXED);
+    }
+#endif
+    return stats;
+}
@@ -0,0 +1,91 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+#include "../types.h"
+
+struct sddc_shm_header_t;
+
+// What the stream carries, fixed while the publisher is open
+struct shm_stream_t
+{
+    bool raw;                   // int16 ADC samples, else IQ samples in iq_format
+    sddc_iq_format_t iq_format;
+    size_t sample_size;         // bytes, both I and Q for IQ
+    double sample_rate;
+    uint32_t adc_sample_rate;
+};
+
+/**
+ * @brief Publishes the stream in a POSIX shared memory ring, for the local processes
+ *
+ * Open() creates the object (shm_open) holding a ring of fixed size slots,
+ * laid out as in shm_layout.h, and Write() copies each block of the stream
+ * into the next slots, from the stream thread: a block larger than a slot spans
+ * several, each with its own first sample index and timestamp. Any number of
+ * processes map the object with the reader of libsddc/sddc_shm.h and use the
+ * samples in place. Each reader has a cursor in the object, for the statistics;
+ * the publisher never waits for them, and a reader falling a whole ring behind
+ * skips to the newest slot. The readers wait on a futex bumped after every slot,
+ * woken only when some of them wait.
+ *
+ * Close() marks the ring closed and unlinks the object: the readers attached
+ * keep their mapping until they close it, and a new publisher of the same name
+ * is a new object, to open again.
+ */
+class shm_publisher
+{
+public:
+    shm_publisher();
+    ~shm_publisher();
+
+    static sddc_shm_config_t GetDefaultConfig();
+
+    // `name` as for shm_open, the leading '/' optional. nullptr config for the defaults.
+    // ERR_SHM_FAILED if the name is taken by a publisher still running
+    sddc_err_t Open(const char* name, const sddc_shm_config_t* config, const shm_stream_t& stream);
+
+    // From the stream thread. Copies the block once, into the ring
+    void Write(const void* data, size_t size, int64_t timestamp_ns);
+
+    void Close();
+
+    bool IsOpen() const { return header != nullptr; }
+
+    // Reads the reader cursors of the object, from any thread
+    sddc_shm_stats_t GetStats() const;
+
+private:
+    void WriteSlot(const uint8_t* data, size_t size, uint64_t first_sample, int64_t timestamp_ns);
+
+    std::string name;
+    sddc_shm_header_t* header;
+    size_t object_size;
+    size_t slot_size;
+    uint32_t slot_count;
+    size_t sample_size;
+    double ns_per_sample;
+    uint64_t samples;           // published, stream thread
+    std::atomic<uint64_t> bytes;    // published
+};
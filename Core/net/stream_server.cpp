@@ -0,0 +1,689 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "stream_server.h"
+
+#include "../config.h"
+#include "../RadioHandler.h"
+#include "../thread_config.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#define TAG "stream_server"
+
+namespace {
+    const uint32_t default_max_clients = 8;
+    const uint32_t default_buffer_ms = 500;
+    const int poll_ms = 100;        // longest a thread goes without looking at `stopping`
+    const size_t max_ring_blocks = 65536;
+
+#ifdef _WIN32
+    typedef SOCKET socket_t;
+    const int send_flags = 0;
+
+    void CloseSocket(intptr_t s) { closesocket((SOCKET)s); }
+
+    bool Readable(intptr_t s, int timeout_ms)
+    {
+        WSAPOLLFD fd = { (SOCKET)s, POLLRDNORM, 0 };
+        return WSAPoll(&fd, 1, timeout_ms) > 0;
+    }
+
+    bool TimedOut() { return WSAGetLastError() == WSAETIMEDOUT || WSAGetLastError() == WSAEWOULDBLOCK; }
+#else
+    typedef int socket_t;
+#ifdef MSG_NOSIGNAL
+    const int send_flags = MSG_NOSIGNAL;
+#else
+    const int send_flags = 0;   // SO_NOSIGPIPE instead, see ConfigureClient
+#endif
+
+    void CloseSocket(intptr_t s) { close((int)s); }
+
+    bool Readable(intptr_t s, int timeout_ms)
+    {
+        struct pollfd fd = { (int)s, POLLIN, 0 };
+        return poll(&fd, 1, timeout_ms) > 0;
+    }
+
+    bool TimedOut() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+#endif
+
+    void SetBlocking(intptr_t s, bool blocking)
+    {
+#ifdef _WIN32
+        u_long mode = blocking ? 0 : 1;
+        ioctlsocket((SOCKET)s, FIONBIO, &mode);
+#else
+        int flags = fcntl((int)s, F_GETFL, 0);
+        fcntl((int)s, F_SETFL, blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK);
+#endif
+    }
+
+    // send() gives up after timeout_ms, and a closed connection is not a SIGPIPE
+    void ConfigureClient(intptr_t s, int timeout_ms)
+    {
+        // Some systems pass the mode of the listening socket on
+        SetBlocking(s, true);
+#ifdef _WIN32
+        DWORD timeout = timeout_ms;
+#else
+        struct timeval timeout = { timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+#endif
+        setsockopt((socket_t)s, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+        int on = 1;
+        setsockopt((socket_t)s, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    }
+
+    void PutBigEndian(uint8_t* p, uint32_t v)
+    {
+        p[0] = (uint8_t)(v >> 24);
+        p[1] = (uint8_t)(v >> 16);
+        p[2] = (uint8_t)(v >> 8);
+        p[3] = (uint8_t)v;
+    }
+}
+
+stream_server::stream_server(RadioHandler& radio):
+    radio(radio),
+    config(GetDefaultConfig()),
+    server_thread_config(),
+    client_thread_config(),
+    raw(false),
+    sample_rate(0),
+    listen_socket(-1),
+    port(0),
+    stopping(false),
+    clients_connected(0),
+    clients_total(0),
+    clients_refused(0),
+    clients_dropped(0),
+    blocks_dropped(0),
+    commands(0),
+    bytes_sent(0)
+{
+    for (auto& channel : channels)
+    {
+        channel.active = false;
+        channel.pool_next = 0;
+        channel.next_seq = 0;
+        channel.clients = 0;
+    }
+}
+
+stream_server::~stream_server()
+{
+    Stop();
+}
+
+sddc_server_config_t stream_server::GetDefaultConfig()
+{
+    sddc_server_config_t config;
+    config.address = nullptr;
+    config.port = 1234;
+    config.max_clients = default_max_clients;
+    config.buffer_ms = default_buffer_ms;
+    config.drop_policy = SDDC_DROP_SKIP;
+    config.scale = 0;
+    config.read_only = false;
+    return config;
+}
+
+sddc_err_t stream_server::Start(const sddc_server_config_t* config, bool raw)
+{
+    TracePrintln(TAG, "%s", raw ? "raw" : "IQ");
+
+    if (IsRunning())
+        return ERR_SERVER_FAILED;
+    if (radio.IsStreaming())
+        return ERR_STREAM_RUNNING;
+
+    this->config = config ? *config : GetDefaultConfig();
+    if (this->config.max_clients == 0)
+        this->config.max_clients = default_max_clients;
+    if (this->config.buffer_ms == 0)
+        this->config.buffer_ms = default_buffer_ms;
+    if ((unsigned)this->config.drop_policy > SDDC_DROP_DISCONNECT)
+        return ERR_SERVER_FAILED;
+
+    // The blocks are converted from CF32 by the server
+    if (!raw && (radio.GetIQFormat() != SDDC_IQ_CF32 || !quantizer.Configure(SDDC_IQ_CS8, this->config.scale)))
+        return ERR_FORMAT_INVALID;
+
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+        return ERR_SERVER_FAILED;
+#endif
+
+    socket_t s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == (socket_t)-1)
+        return ERR_SERVER_FAILED;
+
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(this->config.port);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    if ((this->config.address && inet_pton(AF_INET, this->config.address, &address.sin_addr) != 1) ||
+        bind(s, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(s, 16) != 0)
+    {
+        WarnPrintln(TAG, "cannot listen on %s:%u", this->config.address ? this->config.address : "*",
+            (unsigned)this->config.port);
+        CloseSocket(s);
+        return ERR_SERVER_FAILED;
+    }
+
+    // accept() does not wait if the client went away since the poll
+    SetBlocking(s, false);
+
+    socklen_t length = sizeof(address);
+    getsockname(s, (struct sockaddr*)&address, &length);
+    port = ntohs(address.sin_port);
+
+    radio.SetPullMode(true);
+    this->raw = raw;
+    sample_rate = raw ? (double)radio.GetADCSampleRate() : radio.GetIQSampleRate();
+
+    listen_socket = s;
+    stopping = false;
+    clients_connected = 0;
+    clients_total = 0;
+    clients_refused = 0;
+    clients_dropped = 0;
+    blocks_dropped = 0;
+    commands = 0;
+    bytes_sent = 0;
+
+    server = std::thread(&stream_server::ServerThread, this);
+    acceptor = std::thread(&stream_server::AcceptThread, this);
+
+    DebugPrintln(TAG, "listening on port %u, %s samples", (unsigned)port, raw ? "raw ADC" : "IQ");
+    return ERR_SUCCESS;
+}
+
+void stream_server::Stop()
+{
+    if (!IsRunning())
+        return;
+
+    TracePrintln(TAG, "");
+
+    stopping = true;
+    for (auto& channel : channels)
+    {
+        std::lock_guard<std::mutex> lk(channel.mutex);
+        channel.cv.notify_all();
+    }
+
+    acceptor.join();
+    server.join();
+    Reap(true);
+
+    CloseSocket(listen_socket);
+    listen_socket = -1;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+
+    for (auto& channel : channels)
+    {
+        channel.ring.clear();
+        channel.pool.clear();
+        channel.active = false;
+    }
+
+    DebugPrintln(TAG, "%u clients, %llu bytes sent, %u blocks dropped", clients_total.load(),
+        (unsigned long long)bytes_sent.load(), blocks_dropped.load());
+}
+
+sddc_server_stats_t stream_server::GetStats() const
+{
+    sddc_server_stats_t stats;
+    stats.port = port;
+    stats.clients = clients_connected;
+    stats.clients_total = clients_total;
+    stats.clients_refused = clients_refused;
+    stats.clients_dropped = clients_dropped;
+    stats.blocks_dropped = blocks_dropped;
+    stats.commands = commands;
+    stats.bytes_sent = bytes_sent;
+    return stats;
+}
+
+// Takes the blocks out of the radio ring while the stream runs, waits for it otherwise
+void stream_server::ServerThread()
+{
+    sddc_thread_apply(SDDC_THREAD_SERVER, server_thread_config);
+
+    bool streaming = false;
+    while (!stopping)
+    {
+        const void* data;
+        uint32_t length;
+        sddc_err_t ret = raw ? radio.AcquireReal((const int16_t**)&data, &length, nullptr, poll_ms) :
+            radio.AcquireIQ((const sddc_complex_t**)&data, &length, nullptr, poll_ms);
+        if (ret == ERR_TIMEOUT)
+            continue;
+        if (ret != ERR_SUCCESS)
+        {
+            streaming = false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(poll_ms / 2));
+            continue;
+        }
+
+        if (!streaming)
+        {
+            StreamStarted(length);
+            streaming = true;
+        }
+
+        if (raw)
+        {
+            if (channels[0].clients > 0)
+                Publish(channels[0], data, length);
+            radio.ReleaseReal();
+            continue;
+        }
+
+        int top = -1;
+        for (int level = 0; level < max_levels; level++)
+        {
+            if (channels[level].clients > 0)
+                top = level;
+        }
+
+        // Each rate from the one above, only down to the lowest one with clients
+        const sddc_complex_t* iq = (const sddc_complex_t*)data;
+        size_t count = length;
+        for (int level = 0; level < max_levels; level++)
+        {
+            channel_t& channel = channels[level];
+            if (level > top)
+            {
+                channel.active = false;
+                continue;
+            }
+
+            if (level > 0)
+            {
+                if (!channel.active)
+                    channel.decimator.Reset();
+                channel.iq.resize(2 * (count / 2 + 1));
+                count = channel.decimator.Process(iq, count, (sddc_complex_t*)channel.iq.data());
+                iq = (const sddc_complex_t*)channel.iq.data();
+            }
+            channel.active = true;
+
+            if (channel.clients > 0 && count > 0)
+                Publish(channel, iq, count);
+        }
+
+        radio.ReleaseIQ();
+    }
+}
+
+// The rings hold buffer_ms of blocks, from the size of the blocks and the rate of this stream
+void stream_server::StreamStarted(uint32_t block_samples)
+{
+    sample_rate = raw ? (double)radio.GetADCSampleRate() : radio.GetIQSampleRate();
+
+    const double blocks = ceil(config.buffer_ms / 1000.0 * sample_rate / block_samples);
+    const size_t ring_blocks = (size_t)std::min(std::max(blocks, 4.0), (double)max_ring_blocks);
+
+    for (auto& channel : channels)
+    {
+        std::lock_guard<std::mutex> lk(channel.mutex);
+        channel.ring.assign(ring_blocks, nullptr);
+        channel.active = false;
+    }
+
+    DebugPrintln(TAG, "stream at %.0f samples/s, %u blocks per client", sample_rate.load(), (unsigned)ring_blocks);
+}
+
+// Converts the samples once into a block, which the clients of the channel then send
+void stream_server::Publish(channel_t& channel, const void* data, size_t count)
+{
+    // Out of the ring and sent by nobody when the pool is its only owner
+    std::shared_ptr<block_t> block;
+    for (size_t i = 0; i < channel.pool.size(); i++)
+    {
+        auto& candidate = channel.pool[(channel.pool_next + i) % channel.pool.size()];
+        if (candidate.use_count() == 1)
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            block = candidate;
+            channel.pool_next = (channel.pool_next + i + 1) % channel.pool.size();
+            break;
+        }
+    }
+    if (!block)
+    {
+        block = std::make_shared<block_t>();
+        channel.pool.push_back(block);
+    }
+
+    if (raw)
+    {
+        block->size = count * sizeof(int16_t);
+        block->data.resize(block->size);
+        memcpy(block->data.data(), data, block->size);
+    }
+    else
+    {
+        // CS8 in place, then offset to the unsigned samples of rtl_tcp
+        block->data.resize(count * sizeof(sddc_complex_t));
+        memcpy(block->data.data(), data, count * sizeof(sddc_complex_t));
+        quantizer.Convert(block->data.data(), count);
+        block->size = count * 2;
+        uint8_t* p = block->data.data();
+        for (size_t i = 0; i < block->size; i++)
+            p[i] ^= 0x80;
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(channel.mutex);
+        if (channel.ring.empty())
+            return;
+        channel.ring[channel.next_seq % channel.ring.size()] = block;
+        channel.next_seq++;
+    }
+    channel.cv.notify_all();
+}
+
+void stream_server::AcceptThread()
+{
+    while (!stopping)
+    {
+        Reap(false);
+
+        if (!Readable(listen_socket, poll_ms))
+            continue;
+
+        socket_t s = accept((socket_t)listen_socket, nullptr, nullptr);
+        if (s == (socket_t)-1)
+            continue;
+
+        std::lock_guard<std::mutex> lk(clients_mutex);
+        if (clients.size() >= config.max_clients)
+        {
+            CloseSocket(s);
+            clients_refused++;
+            continue;
+        }
+
+        client_t* client = new client_t();
+        client->socket = s;
+        client->done = false;
+        client->level = -1;
+        client->cursor = 0;
+        client->policy = config.drop_policy;
+        client->buffer_ms = config.buffer_ms;
+        client->command_size = 0;
+        clients.emplace_back(client);
+        clients_total++;
+        clients_connected++;
+        client->thread = std::thread(&stream_server::ClientThread, this, client);
+    }
+}
+
+// Joins the client threads which are done, or all of them
+void stream_server::Reap(bool all)
+{
+    std::lock_guard<std::mutex> lk(clients_mutex);
+    for (auto it = clients.begin(); it != clients.end();)
+    {
+        if (all || (*it)->done)
+        {
+            (*it)->thread.join();
+            it = clients.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void stream_server::ClientThread(client_t* client)
+{
+    sddc_thread_apply(SDDC_THREAD_CLIENT, client_thread_config);
+
+    uint8_t header[12];
+    memcpy(header, raw ? "SDA0" : "RTL0", 4);
+    PutBigEndian(header + 4, 0);    // tuner type unknown
+    PutBigEndian(header + 8, (uint32_t)radio.GetRFGainSteps().size());
+
+    ConfigureClient(client->socket, poll_ms);
+    Subscribe(client, 0);
+
+    bool open = Send(client, header, sizeof(header));
+    while (open && !stopping)
+    {
+        if (!ReadCommands(client))
+            break;
+
+        channel_t& channel = channels[client->level];
+        std::shared_ptr<block_t> block;
+        {
+            std::unique_lock<std::mutex> lk(channel.mutex);
+            if (!channel.cv.wait_for(lk, std::chrono::milliseconds(poll_ms),
+                    [&] { return client->cursor < channel.next_seq || stopping; }) || stopping)
+                continue;
+
+            if (Behind(client, channel))
+            {
+                if (client->policy == SDDC_DROP_DISCONNECT)
+                {
+                    clients_dropped++;
+                    break;
+                }
+
+                // Back to the newest block
+                blocks_dropped += (uint32_t)(channel.next_seq - 1 - client->cursor);
+                client->cursor = channel.next_seq - 1;
+            }
+
+            block = channel.ring[client->cursor % channel.ring.size()];
+            if (!block)
+            {
+                // Sent before the stream restarted, its rings emptied
+                client->cursor = channel.next_seq;
+                continue;
+            }
+            client->cursor++;
+        }
+
+        open = Send(client, block->data.data(), block->size);
+    }
+
+    channels[client->level].clients--;
+    CloseSocket(client->socket);
+    clients_connected--;
+    client->done = true;
+}
+
+// Moves the client to the channel of `level`, from its next block
+void stream_server::Subscribe(client_t* client, int level)
+{
+    if (client->level >= 0)
+        channels[client->level].clients--;
+
+    channel_t& channel = channels[level];
+    std::lock_guard<std::mutex> lk(channel.mutex);
+    channel.clients++;
+    client->level = level;
+    client->cursor = channel.next_seq;
+}
+
+// Further behind than the client's buffer: its drop policy applies. Under the channel lock
+bool stream_server::Behind(client_t* client, channel_t& channel) const
+{
+    const uint64_t allowed = std::max<uint64_t>(1, (uint64_t)channel.ring.size() * client->buffer_ms / config.buffer_ms);
+    return channel.next_seq - client->cursor > allowed;
+}
+
+// All of it, false when the connection is gone, the server stops, or the client is
+// dropped while its socket does not drain
+bool stream_server::Send(client_t* client, const uint8_t* data, size_t size)
+{
+    while (size > 0)
+    {
+        int sent = send((socket_t)client->socket, (const char*)data, (int)std::min<size_t>(size, 1 << 30), send_flags);
+        if (sent > 0)
+        {
+            data += sent;
+            size -= sent;
+            bytes_sent += sent;
+            continue;
+        }
+        if (sent < 0 && TimedOut() && !stopping)
+        {
+            if (client->policy == SDDC_DROP_DISCONNECT)
+            {
+                channel_t& channel = channels[client->level];
+                std::lock_guard<std::mutex> lk(channel.mutex);
+                if (Behind(client, channel))
+                {
+                    clients_dropped++;
+                    return false;
+                }
+            }
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+// The commands received, without waiting. False when the client closed the connection
+bool stream_server::ReadCommands(client_t* client)
+{
+    while (Readable(client->socket, 0))
+    {
+        int received = recv((socket_t)client->socket, (char*)client->command + client->command_size,
+            (int)(sizeof(client->command) - client->command_size), 0);
+        if (received <= 0)
+            return false;
+
+        client->command_size += received;
+        if (client->command_size == sizeof(client->command))
+        {
+            const uint8_t* c = client->command;
+            Command(client, c[0], (uint32_t)c[1] << 24 | (uint32_t)c[2] << 16 | (uint32_t)c[3] << 8 | c[4]);
+            client->command_size = 0;
+        }
+    }
+    return true;
+}
+
+void stream_server::Command(client_t* client, uint8_t code, uint32_t param)
+{
+    DebugPrintln(TAG, "command %02x %u", code, param);
+    commands++;
+
+    // The settings of the client
+    switch (code)
+    {
+    case CMD_SET_SAMPLE_RATE:
+        if (!raw)
+            Subscribe(client, Level(param));
+        return;
+    case CMD_SET_DROP_POLICY:
+        if (param <= SDDC_DROP_DISCONNECT)
+            client->policy = (sddc_drop_policy_t)param;
+        return;
+    case CMD_SET_BUFFER:
+        client->buffer_ms = std::max<uint32_t>(1, std::min(param, config.buffer_ms));
+        return;
+    }
+
+    // The ones of the radio
+    if (config.read_only)
+        return;
+
+    std::lock_guard<std::mutex> lk(control_mutex);
+    sddc_err_t ret = ERR_SUCCESS;
+    switch (code)
+    {
+    case CMD_SET_FREQUENCY:
+        ret = radio.SetCenterFrequency(param);
+        break;
+    case CMD_SET_GAIN:
+        ret = radio.SetRFGain((int32_t)param / 10.0f);
+        break;
+    case CMD_SET_IF_GAIN:
+        ret = radio.SetIFGain((int16_t)(param & 0xffff) / 10.0f);
+        break;
+    case CMD_SET_GAIN_BY_INDEX:
+    {
+        std::vector<float> steps = radio.GetRFGainSteps();
+        ret = param < steps.size() ? radio.SetRFGain(steps[param]) : ERR_NOT_COMPATIBLE;
+        break;
+    }
+    case CMD_SET_DIRECT_SAMPLING:
+        ret = radio.SetRFMode(param ? HFMODE : VHFMODE);
+        break;
+    case CMD_SET_BIAS_TEE:
+        ret = radio.GetRFMode() == HFMODE ? radio.SetBiasT_HF(param != 0) : radio.SetBiasT_VHF(param != 0);
+        break;
+    default:
+        // gain mode, AGC, frequency correction, test mode, offset tuning: nothing to do
+        break;
+    }
+
+    if (ret != ERR_SUCCESS)
+        WarnPrintln(TAG, "command %02x %u failed: %d", code, param, ret);
+}
+
+// The lowest rate at or above the one asked, the stream's divided by a power of two
+int stream_server::Level(uint32_t rate) const
+{
+    int level = 0;
+    while (level + 1 < max_levels && sample_rate / (1 << (level + 1)) >= rate * (1 - 1e-6))
+        level++;
+
+    const double served = sample_rate / (1 << level);
+    if (fabs(served - rate) > rate * 1e-6)
+        WarnPrintln(TAG, "%u samples/s asked, %.0f served", rate, served);
+    return level;
+}
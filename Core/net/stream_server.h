@@ -0,0 +1,184 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include "../types.h"
+#include "../dsp/halfband.h"
+#include "../dsp/quantize.h"
+
+class RadioHandler;
+
+/**
+ * @brief Serves the stream of a RadioHandler to TCP clients, rtl_tcp style
+ *
+ * A client connecting gets the 12 byte rtl_tcp header ("RTL0", tuner type and
+ * number of gain steps, big endian), then the samples: unsigned 8 bit I and Q
+ * centered on 128 as rtl_tcp sends them, or with raw set the little endian
+ * int16 ADC samples (the header then starts with "SDA0", which rtl_tcp clients
+ * refuse). It sends 5 byte commands (a code, then a big endian parameter):
+ * frequency, gains and direct sampling go to the radio, shared by all the clients
+ * (see sddc_server_config_t::read_only), and the sample rate picks the rate of
+ * that client only, the rate of the stream divided by a power of two.
+ *
+ * The radio is in pull mode, and the server thread takes the IQ blocks out of
+ * its ring. For every rate with clients, the block is decimated (a cascade of
+ * halfband_decimator, each rate fed by the one above) and converted once, into
+ * a block shared by all the clients of that rate: each client has its own
+ * thread and cursor, and sends from the shared blocks without copying them.
+ * The server thread never waits for a client. Each rate keeps the blocks of
+ * the last buffer_ms; a client whose cursor falls further behind than that is
+ * either moved to the newest block (the blocks in between are counted as
+ * dropped) or disconnected, as its drop policy says.
+ */
+class stream_server
+{
+public:
+    explicit stream_server(RadioHandler& radio);
+    ~stream_server();
+
+    static sddc_server_config_t GetDefaultConfig();
+
+    // Listens and starts the server thread, nullptr config for the defaults.
+    // The radio must be stopped and is put in pull mode; the samples flow once it starts
+    sddc_err_t Start(const sddc_server_config_t* config, bool raw);
+
+    // Closes every connection and stops the threads
+    void Stop();
+
+    bool IsRunning() const { return listen_socket != -1; }
+
+    // Scheduling of the server thread and of the client threads, applied by the next Start()
+    void SetThreadConfig(const sddc_thread_config_t& server, const sddc_thread_config_t& client)
+    {
+        server_thread_config = server;
+        client_thread_config = client;
+    }
+
+    sddc_server_stats_t GetStats() const;
+
+    static const int max_levels = 7;    // rates down to the stream's divided by 64
+
+    // rtl_tcp commands, and the ones of this server
+    enum command_t
+    {
+        CMD_SET_FREQUENCY = 0x01,
+        CMD_SET_SAMPLE_RATE = 0x02,
+        CMD_SET_GAIN_MODE = 0x03,
+        CMD_SET_GAIN = 0x04,            // tenths of dB
+        CMD_SET_FREQ_CORRECTION = 0x05,
+        CMD_SET_IF_GAIN = 0x06,         // stage << 16 | tenths of dB
+        CMD_SET_TEST_MODE = 0x07,
+        CMD_SET_AGC_MODE = 0x08,
+        CMD_SET_DIRECT_SAMPLING = 0x09, // HF mode when not 0, VHF mode otherwise
+        CMD_SET_OFFSET_TUNING = 0x0a,
+        CMD_SET_GAIN_BY_INDEX = 0x0d,
+        CMD_SET_BIAS_TEE = 0x0e,
+        CMD_SET_DROP_POLICY = 0x80,     // sddc_drop_policy_t of this client
+        CMD_SET_BUFFER = 0x81,          // ms this client may fall behind, up to the server's buffer_ms
+    };
+
+private:
+    struct block_t
+    {
+        std::vector<uint8_t> data;
+        size_t size;
+    };
+
+    // One rate: the stream decimated `level` times
+    struct channel_t
+    {
+        halfband_decimator decimator;       // from the rate above, server thread
+        std::vector<float> iq;              // last block at this rate, server thread
+        bool active;                        // computed for the last block, server thread
+        std::vector<std::shared_ptr<block_t>> pool;    // server thread
+        size_t pool_next;                   // where to look for a free block first
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<std::shared_ptr<block_t>> ring;    // block `seq` at seq % ring.size()
+        uint64_t next_seq;                  // of the next block published
+        std::atomic<int> clients;
+    };
+
+    // Owned by the client thread, but for `done`
+    struct client_t
+    {
+        intptr_t socket;
+        std::thread thread;
+        std::atomic<bool> done;
+
+        int level;                  // channel the client reads
+        uint64_t cursor;            // next block it sends
+        sddc_drop_policy_t policy;
+        uint32_t buffer_ms;
+        uint8_t command[5];         // received so far
+        size_t command_size;
+    };
+
+    void ServerThread();
+    void AcceptThread();
+    void ClientThread(client_t* client);
+
+    void StreamStarted(uint32_t block_samples);
+    void Publish(channel_t& channel, const void* data, size_t count);
+    void Subscribe(client_t* client, int level);
+    bool ReadCommands(client_t* client);
+    void Command(client_t* client, uint8_t code, uint32_t param);
+    bool Send(client_t* client, const uint8_t* data, size_t size);
+    bool Behind(client_t* client, channel_t& channel) const;
+    int Level(uint32_t sample_rate) const;
+    void Reap(bool all);
+
+    RadioHandler& radio;
+    sddc_server_config_t config;
+    sddc_thread_config_t server_thread_config;
+    sddc_thread_config_t client_thread_config;
+    bool raw;
+    std::atomic<double> sample_rate;    // of level 0
+    iq_quantizer quantizer;             // server thread
+
+    intptr_t listen_socket;
+    uint16_t port;
+    std::atomic<bool> stopping;
+    std::thread server;
+    std::thread acceptor;
+    channel_t channels[max_levels];
+
+    std::mutex clients_mutex;
+    std::list<std::unique_ptr<client_t>> clients;
+    std::mutex control_mutex;   // one radio command at a time
+
+    std::atomic<uint32_t> clients_connected;
+    std::atomic<uint32_t> clients_total;
+    std::atomic<uint32_t> clients_refused;
+    std::atomic<uint32_t> clients_dropped;
+    std::atomic<uint32_t> blocks_dropped;
+    std::atomic<uint32_t> commands;
+    std::atomic<uint64_t> bytes_sent;
+};
@@ -0,0 +1,198 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "r2iq_pool.h"
+#include "config.h"
+#include "fft_mt_r2iq.h"
+#include "thread_config.h"
+
+#define TAG "r2iq_pool"
+
+r2iq_pool& r2iq_pool::Get()
+{
+    static r2iq_pool pool;
+    return pool;
+}
+
+r2iq_pool::r2iq_pool():
+    worker_count(std::max(1u, std::thread::hardware_concurrency())),
+    work_seq(0),
+    running(false),
+    slots(std::make_shared<const SlotList>())
+{
+    TracePrintln(TAG, "");
+}
+
+r2iq_pool::~r2iq_pool()
+{
+    TracePrintln(TAG, "");
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    work_cv.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void r2iq_pool::SetWorkerCount(unsigned count)
+{
+    TracePrintln(TAG, "%u", count);
+
+    std::lock_guard<std::mutex> control_lock(control_mutex);
+    std::lock_guard<std::mutex> lock(mutex);
+    worker_count = count != 0 ? std::min(count, MAX_R2IQ_WORKERS) : std::max(1u, std::thread::hardware_concurrency());
+    if (running)
+        DebugPrintln(TAG, "%u workers from the next start", worker_count);
+}
+
+void r2iq_pool::Attach(fft_mt_r2iq* stream, ringbufferbase* input, const sddc_thread_config_t& config)
+{
+    TracePrintln(TAG, "%p", stream);
+
+    std::lock_guard<std::mutex> control_lock(control_mutex);
+
+    size_t count;
+    auto slot = std::make_shared<Slot>();
+    slot->stream = stream;
+    slot->input = input;
+    slot->busy = false;
+    input->setWriteListener(Notify, this);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto list = std::make_shared<SlotList>(*slots);
+        list->push_back(slot);
+        slots = list;
+        count = list->size();
+        work_seq++;
+
+        if (!running)
+        {
+            running = true;
+            for (unsigned i = 0; i < worker_count; i++)
+                workers.emplace_back(&r2iq_pool::Worker, this, i, config);
+            DebugPrintln(TAG, "Started %u workers", worker_count);
+        }
+    }
+    work_cv.notify_all();
+
+    DebugPrintln(TAG, "%d stream(s) attached", (int)count);
+}
+
+void r2iq_pool::Detach(fft_mt_r2iq* stream)
+{
+    TracePrintln(TAG, "%p", stream);
+
+    std::lock_guard<std::mutex> control_lock(control_mutex);
+
+    std::shared_ptr<Slot> slot;
+    std::vector<std::thread> stopping;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto list = std::make_shared<SlotList>();
+        for (auto& s : *slots)
+        {
+            if (s->stream == stream)
+                slot = s;
+            else
+                list->push_back(s);
+        }
+        slots = list;
+
+        if (list->empty())
+        {
+            running = false;
+            stopping.swap(workers);
+        }
+    }
+
+    if (slot)
+    {
+        // The workers still holding the previous list can't take it anymore
+        while (slot->busy.exchange(true))
+            std::this_thread::yield();
+        slot->input->setWriteListener(nullptr, nullptr);
+    }
+
+    work_cv.notify_all();
+    for (auto& worker : stopping)
+        worker.join();
+    if (!stopping.empty())
+        DebugPrintln(TAG, "Stopped the workers");
+}
+
+size_t r2iq_pool::StreamCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return slots->size();
+}
+
+void r2iq_pool::Notify(void* context)
+{
+    r2iq_pool* pool = (r2iq_pool*)context;
+
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->work_seq++;
+    }
+    pool->work_cv.notify_one();
+}
+
+void r2iq_pool::Worker(unsigned index, sddc_thread_config_t config)
+{
+    sddc_thread_apply(SDDC_THREAD_R2IQ, config);
+
+    while (true)
+    {
+        uint64_t seq;
+        std::shared_ptr<const SlotList> list;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!running)
+                return;
+            seq = work_seq;
+            list = slots;
+        }
+
+        // Own share of the streams first, then the others
+        bool worked = false;
+        const size_t count = list->size();
+        for (size_t i = 0; i < count; i++)
+        {
+            Slot& slot = *(*list)[(index + i) % count];
+            if (slot.busy.exchange(true))
+                continue;
+
+            // One block at a time, so that a stream always ready doesn't starve the others
+            if (slot.stream->ProcessPending())
+                worked = true;
+
+            slot.busy = false;
+        }
+
+        if (worked)
+            continue;
+
+        // Nothing to do: sleep until a block arrives somewhere
+        std::unique_lock<std::mutex> lock(mutex);
+        work_cv.wait(lock, [this, seq] { return !running || work_seq != seq; });
+    }
+}
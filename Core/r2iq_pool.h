@@ -0,0 +1,97 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+#include "dsp/ringbuffer.h"
+
+class fft_mt_r2iq;
+
+/**
+ * @brief Worker threads converting the blocks of all the streams of the process
+ *
+ * Instead of a thread per device, the r2iq converters attached to the pool
+ * share one worker per core. A stream is converted by one worker at a time
+ * (its blocks depend on each other), each worker starts with its own share
+ * of the streams and takes the blocks of the others when it has nothing to do.
+ */
+class r2iq_pool
+{
+public:
+    static r2iq_pool& Get();
+
+    /**
+     * @brief Starts converting the blocks of a stream
+     *
+     * The workers are started with the first stream, with the scheduling
+     * given then (see sddc_thread_apply)
+     */
+    void Attach(fft_mt_r2iq* stream, ringbufferbase* input, const sddc_thread_config_t& config);
+
+    /**
+     * @brief Stops converting the blocks of a stream
+     *
+     * Returns once no worker is using the stream anymore: the stream must be
+     * turned off and its buffers stopped first, so that a worker waiting for
+     * its output buffer wakes up
+     */
+    void Detach(fft_mt_r2iq* stream);
+
+    /**
+     * @brief Number of workers, 0 for one per core
+     *
+     * Applied the next time the workers start, with the first stream attached
+     */
+    void SetWorkerCount(unsigned count);
+    unsigned WorkerCount() const { return worker_count; }
+    size_t StreamCount();
+
+private:
+    struct Slot
+    {
+        fft_mt_r2iq* stream;
+        ringbufferbase* input;
+        std::atomic<bool> busy;     // a worker is converting this stream
+    };
+    typedef std::vector<std::shared_ptr<Slot>> SlotList;
+
+    r2iq_pool();
+    ~r2iq_pool();
+
+    static void Notify(void* context);
+    void Worker(unsigned index, sddc_thread_config_t config);
+
+    unsigned worker_count;
+
+    std::mutex control_mutex;               // one Attach() or Detach() at a time
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    uint64_t work_seq;                      // bumped by every new block
+    bool running;
+    std::shared_ptr<const SlotList> slots;  // replaced, never modified: the workers keep the list they took
+    std::vector<std::thread> workers;
+};
@@ -64,13 +64,13 @@ sddc_err_t BBRF103Radio::SetRFMode(sddc_rf_mode_t mode)
         UnsetGPIO(ATT_SEL0 | ATT_SEL1);
 
         // Initialize Tuner
-        return Fx3->Control(TUNERINIT, (uint32_t)R820T_FREQ) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+        return Control(TUNERINIT, (uint32_t)R820T_FREQ) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
     }
 
     else if (mode == HFMODE )   // (mode == HFMODE || mode == VLFMODE) no more VLFMODE
     {
         // Stop Tuner
-        Fx3->Control(TUNERSTDBY);
+        Control(TUNERSTDBY);
 
         // switch to HF Attenna
         return SetGPIO(ATT_SEL0 | ATT_SEL1) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
@@ -98,11 +98,11 @@ sddc_err_t BBRF103Radio::SetRFAttenuation_HF(int att)
         gpios &=  ~ATT_SEL0;
         break;
     }
-    return Fx3->Control(GPIOFX3, gpios) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+    return Control(GPIOFX3, gpios) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
 }
 sddc_err_t BBRF103Radio::SetRFAttenuation_VHF(uint16_t att)
 {
-    return Fx3->SetArgument(R82XX_ATTENUATOR, att) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+    return SetArgument(R82XX_ATTENUATOR, att) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
 }
 
 sddc_err_t BBRF103Radio::SetCenterFrequency_HF(uint32_t freq)
@@ -120,7 +120,7 @@ uint32_t BBRF103Radio::GetTunerFrequency_VHF()
 }
 sddc_err_t BBRF103Radio::SetCenterFrequency_VHF(uint32_t freq)
 {
-    if(!Fx3->Control(TUNERTUNE, freq))
+    if(!Control(TUNERTUNE, freq))
         return ERR_FX3_TRANSFER_FAILED;
 
     freqLO_VHF = freq;
@@ -153,5 +153,5 @@ sddc_err_t BBRF103Radio::SetIFGain_HF(int attIndex)
 
 sddc_err_t BBRF103Radio::SetIFGain_VHF(int attIndex)
 {
-    return Fx3->SetArgument(R82XX_VGA, (uint16_t)attIndex) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+    return SetArgument(R82XX_VGA, (uint16_t)attIndex) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
 }
\ No newline at end of file
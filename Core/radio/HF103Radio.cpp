@@ -79,7 +79,7 @@ sddc_err_t HF103Radio::SetRFAttenuation_HF(int att)
 
     DbgPrintf("UpdateattRF %f \n", this->rf_steps_hf[att]);
 
-    return Fx3->SetArgument(DAT31_ATT, d) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+    return SetArgument(DAT31_ATT, d) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
 }
 sddc_err_t HF103Radio::SetRFAttenuation_VHF(uint16_t)
 {
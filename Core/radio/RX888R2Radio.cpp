@@ -91,18 +91,18 @@ sddc_err_t RX888R2Radio::SetRFMode(sddc_rf_mode_t mode)
 
         // high gain, 0db
         uint8_t gain = 0x80 | 3;
-        if(!Fx3->SetArgument(AD8340_VGA, gain))
+        if(!SetArgument(AD8340_VGA, gain))
             return ERR_FX3_TRANSFER_FAILED;
 
         // Enable Tuner reference clock
         uint32_t ref = R828D_FREQ;
-        return Fx3->Control(TUNERINIT, ref) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED; // Initialize Tuner
+        return Control(TUNERINIT, ref) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED; // Initialize Tuner
     }
     else if(mode == HFMODE)
     {
         currentRFMode = mode;
 
-        if(!Fx3->Control(TUNERSTDBY))
+        if(!Control(TUNERSTDBY))
             return ERR_FX3_TRANSFER_FAILED;
 
         return UnsetGPIO(VHF_EN);                // switch to HF Attenna
@@ -122,13 +122,13 @@ sddc_err_t RX888R2Radio::SetRFAttenuation_HF(int att)
 
     attenuationHFStep = att;
 
-    return Fx3->SetArgument(DAT31_ATT, d) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+    return SetArgument(DAT31_ATT, d) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
 }
 
 sddc_err_t RX888R2Radio::SetRFAttenuation_VHF(uint16_t att)
 {
     attenuationVHFStep = att;
-    return Fx3->SetArgument(R82XX_ATTENUATOR, att) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+    return SetArgument(R82XX_ATTENUATOR, att) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
 }
 
 uint32_t RX888R2Radio::GetTunerFrequency_HF()
@@ -148,7 +148,7 @@ uint32_t RX888R2Radio::GetTunerFrequency_VHF()
 }
 sddc_err_t RX888R2Radio::SetCenterFrequency_VHF(uint32_t freq)
 {
-    if(!Fx3->Control(TUNERTUNE, freq))
+    if(!Control(TUNERTUNE, freq))
         return ERR_FX3_TRANSFER_FAILED;
 
     freqLO_VHF = freq;
@@ -186,11 +186,11 @@ sddc_err_t RX888R2Radio::SetIFGain_HF(int gain_index)
 
     gainHFStep = gain_index;
 
-    return Fx3->SetArgument(AD8340_VGA, gain) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+    return SetArgument(AD8340_VGA, gain) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
 }
 
 sddc_err_t RX888R2Radio::SetIFGain_VHF(int gain_index)
 {
     gainVHFStep = gain_index;
-    return Fx3->SetArgument(R82XX_VGA, (uint16_t)gain_index) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+    return SetArgument(R82XX_VGA, (uint16_t)gain_index) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
 }
\ No newline at end of file
@@ -94,16 +94,16 @@ sddc_err_t RX888R3Radio::SetRFMode(sddc_rf_mode_t mode)
 
         // high gain, 0db
         uint8_t gain = 0x80 | 3;
-        if(!Fx3->SetArgument(AD8340_VGA, gain))
+        if(!SetArgument(AD8340_VGA, gain))
             return ERR_FX3_TRANSFER_FAILED;
 
         // Enable Tuner reference clock
         uint32_t ref = REFCLK_FREQ;
-        return Fx3->Control(TUNERINIT, ref) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED; // Initialize Tuner
+        return Control(TUNERINIT, ref) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED; // Initialize Tuner
     }
     else if (mode == HFMODE)
     {
-        if(!Fx3->Control(TUNERSTDBY))
+        if(!Control(TUNERSTDBY))
             return ERR_FX3_TRANSFER_FAILED;
 
         return UnsetGPIO(VHF_EN); // switch to HF Attenna
@@ -122,13 +122,13 @@ sddc_err_t RX888R3Radio::SetRFAttenuation_HF(int att)
 
     DebugPrintln(TAG, "UpdateattRF %f", this->rf_steps_hf[att]);
 
-    return Fx3->SetArgument(DAT31_ATT, d) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+    return SetArgument(DAT31_ATT, d) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
 }
 sddc_err_t RX888R3Radio::SetRFAttenuation_VHF(uint16_t att)
 {
     // uint16_t index = att;
     // this is in VHF mode
-    // return Fx3->SetArgument(R82XX_ATTENUATOR, index);
+    // return SetArgument(R82XX_ATTENUATOR, index);
     return ERR_SUCCESS;
 }
 
@@ -159,7 +159,7 @@ sddc_err_t RX888R3Radio::SetCenterFrequency_HF(uint32_t freq)
     else
         sel = 0b011;
 
-    if(!Fx3->SetArgument(PRESELECTOR, sel))
+    if(!SetArgument(PRESELECTOR, sel))
         return ERR_FX3_TRANSFER_FAILED;
 
     freqLO_HF = freq;
@@ -180,7 +180,7 @@ sddc_err_t RX888R3Radio::SetCenterFrequency_VHF(uint32_t freq)
 
     DebugPrintln(TAG, "Target VCO = %uHZ, hardware VCO= %dMHX, Actual IF = %dHZ", freq + IF_FREQ, hardwareVCO, IF_FREQ - offset);
 
-    if(!Fx3->Control(TUNERTUNE, hardwareVCO))
+    if(!Control(TUNERTUNE, hardwareVCO))
         return ERR_FX3_TRANSFER_FAILED;
 
     freqLO_VHF = freq;
@@ -219,12 +219,12 @@ sddc_err_t RX888R3Radio::SetIFGain_HF(int gain_index)
 
     DebugPrintln(TAG, "SetIFGain_HF %d", gain);
 
-    return Fx3->SetArgument(AD8340_VGA, gain) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+    return SetArgument(AD8340_VGA, gain) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
     
 }
 sddc_err_t RX888R3Radio::SetIFGain_VHF(int gain_index)
 {
     // this is in VHF mode
-    // return Fx3->SetArgument(R82XX_VGA, (uint16_t)gain_index);
+    // return SetArgument(R82XX_VGA, (uint16_t)gain_index);
     return ERR_SUCCESS;
 }
\ No newline at end of file
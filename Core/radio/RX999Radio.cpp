@@ -68,11 +68,11 @@ sddc_err_t RX999Radio::SetRFMode(sddc_rf_mode_t mode)
         // Initialize VCO
 
         // Initialize Mixer
-        return Fx3->Control(TUNERINIT, (uint32_t)0) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+        return Control(TUNERINIT, (uint32_t)0) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
     }
     else if (mode == HFMODE)
     {
-        if(!Fx3->Control(TUNERSTDBY))
+        if(!Control(TUNERSTDBY))
             return ERR_FX3_TRANSFER_FAILED;
 
         return UnsetGPIO(VHF_EN);                // switch to HF Attenna
@@ -116,10 +116,10 @@ sddc_err_t RX999Radio::SetCenterFrequency_VHF(uint32_t freq)
     else if (freq <= 2000ll*1000*1000) sel = 0b001;
     else sel = 0b011;
 
-    if(!Fx3->Control(TUNERTUNE, freq + IF_FREQ))
+    if(!Control(TUNERTUNE, freq + IF_FREQ))
         return ERR_FX3_TRANSFER_FAILED;
 
-    if(!Fx3->SetArgument(PRESELECTOR, sel))
+    if(!SetArgument(PRESELECTOR, sel))
         return ERR_FX3_TRANSFER_FAILED;
 
     freqLO_VHF = freq;
@@ -150,7 +150,7 @@ sddc_err_t RX999Radio::SetIFGain_HF(int gain_index)
 
     DbgPrintf("UpdateGainIF %d \n", gain);
 
-    return Fx3->SetArgument(AD8340_VGA, gain) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+    return SetArgument(AD8340_VGA, gain) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
 }
 
 sddc_err_t RX999Radio::SetIFGain_VHF(int gain_index)
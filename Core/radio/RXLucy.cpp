@@ -73,7 +73,7 @@ sddc_err_t RXLucyRadio::SetRFAttenuation_HF(int att)
     uint8_t d = rf_steps_hf.size() - att - 1;
 
     DbgPrintf("UpdateattRF %f \n", this->rf_steps_hf[att]);
-    return Fx3->SetArgument(VHF_ATTENUATOR, d) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+    return SetArgument(VHF_ATTENUATOR, d) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
 }
 sddc_err_t RXLucyRadio::SetRFAttenuation_VHF(uint16_t)
 {
@@ -88,7 +88,7 @@ sddc_err_t RXLucyRadio::SetIFGain_HF(int att)  //HF103 now
 
     DbgPrintf("UpdateattRF %f \n", this->if_steps_hf[att]);
 
-    return Fx3->SetArgument(DAT31_ATT, d) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+    return SetArgument(DAT31_ATT, d) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
 }
 sddc_err_t RXLucyRadio::SetIFGain_VHF(int att)
 {
@@ -109,7 +109,7 @@ uint32_t RXLucyRadio::GetTunerFrequency_VHF()
 }
 sddc_err_t RXLucyRadio::SetCenterFrequency_VHF(uint32_t freq)
 {
-    if(!Fx3->Control(TUNERTUNE, freq + IF_FREQ))
+    if(!Control(TUNERTUNE, freq + IF_FREQ))
         return ERR_FX3_TRANSFER_FAILED;
 
     freqLO_VHF = freq;
@@ -128,11 +128,11 @@ sddc_err_t RXLucyRadio::SetRFMode(sddc_rf_mode_t mode)
         // Initialize VCO
 
         // Initialize Mixer
-        return Fx3->Control(TUNERINIT, (uint32_t)0) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+        return Control(TUNERINIT, (uint32_t)0) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
     }
     else if (mode == HFMODE)
     {
-        if(!Fx3->Control(TUNERSTDBY))
+        if(!Control(TUNERSTDBY))
             return ERR_FX3_TRANSFER_FAILED;
 
         return UnsetGPIO(VHF_EN);                // switch to HF Attenna
@@ -35,7 +35,7 @@ uint32_t RadioHardware::GetADCSampleRate()
 sddc_err_t RadioHardware::SetADCSampleRate(uint32_t adc_rate)
 {
     sampleRate = adc_rate;
-    return Fx3->Control(STARTADC, adc_rate) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+    return Control(STARTADC, adc_rate) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
 }
 
 // --- Gain --- //
@@ -140,14 +140,14 @@ sddc_err_t RadioHardware::SetGPIO(uint32_t mask)
 {
     gpios |= mask;
 
-    return Fx3->Control(GPIOFX3, gpios) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+    return Control(GPIOFX3, gpios) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
 }
 
 sddc_err_t RadioHardware::UnsetGPIO(uint32_t mask)
 {
     gpios &= ~mask;
 
-    return Fx3->Control(GPIOFX3, gpios) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+    return Control(GPIOFX3, gpios) ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
 }
 
 /**
@@ -181,9 +181,91 @@ sddc_err_t RadioHardware::SetLED(sddc_leds_t led, bool on)
 }
 // ----- //
 
+// ----- Batching ----- //
+#define GPIO_REGISTER 0x10000   // past the argument indexes
+
+/**
+ * @brief Starts queuing the device writes instead of sending them
+ *
+ * The setters called until Commit() return success and only update the
+ * state. Batches nest: the outermost Commit() sends the writes.
+ */
+void RadioHardware::BeginBatch()
+{
+    batchDepth++;
+}
+
+/**
+ * @brief Sends the writes queued since BeginBatch(), in order
+ *
+ * A GPIO word or an argument written several times is only sent with its
+ * last value. The writes are pipelined when the device supports it.
+ *
+ * \retval ERR_FX3_TRANSFER_FAILED One of the writes failed
+ */
+sddc_err_t RadioHardware::Commit()
+{
+    if (batchDepth == 0 || --batchDepth > 0)
+        return ERR_SUCCESS;
+
+    vector<pending_write_t> writes;
+    writes.swap(pendingWrites);
+    DebugPrintln(TAG, "Committing %d writes", (int)writes.size());
+
+    bool ok = true;
+    Fx3->BeginBatch();
+    for (auto& pending : writes)
+        ok = pending.write() && ok;
+    ok = Fx3->CommitBatch() && ok;
+
+    return ok ? ERR_SUCCESS : ERR_FX3_TRANSFER_FAILED;
+}
+
+bool RadioHardware::Queue(int reg, function<bool()> write)
+{
+    if (batchDepth == 0)
+        return write();
+
+    // The last value of a register replaces the queued one, as long as no
+    // command (tuner, ADC) was queued in between, which may depend on it
+    for (auto it = pendingWrites.rbegin(); reg >= 0 && it != pendingWrites.rend() && it->reg >= 0; ++it)
+    {
+        if (it->reg == reg)
+        {
+            it->write = write;
+            return true;
+        }
+    }
+
+    pendingWrites.push_back({ reg, write });
+    return true;
+}
+
+bool RadioHardware::Control(FX3Command command, uint8_t data)
+{
+    return Queue(-1, [=]() { return Fx3->Control(command, data); });
+}
+
+bool RadioHardware::Control(FX3Command command, uint32_t data)
+{
+    return Queue(command == GPIOFX3 ? GPIO_REGISTER : -1, [=]() { return Fx3->Control(command, data); });
+}
+
+bool RadioHardware::SetArgument(uint16_t index, uint16_t value)
+{
+    return Queue(index, [=]() { return Fx3->SetArgument(index, value); });
+}
+// ----- //
+
 RadioHardware::~RadioHardware()
 {
     if (Fx3) {
+        // Sends what an unfinished batch queued
+        if (batchDepth > 0)
+        {
+            batchDepth = 1;
+            Commit();
+        }
         SetGPIO(SHDWN);
     }
 }
\ No newline at end of file
@@ -75,6 +75,10 @@ class RadioHardware {
         sddc_err_t SetLED   (sddc_leds_t led, bool on);
 
         bool ReadDebugTrace(uint8_t* pdata, uint8_t len) { return Fx3->ReadDebugTrace(pdata, len); }
+
+        // --- Batching --- //
+        void       BeginBatch();
+        sddc_err_t Commit();
         // ----- //
 
         // ----- Custom methods ----- //
@@ -101,6 +105,11 @@ class RadioHardware {
 
         
     protected:
+        // Device writes, queued between BeginBatch() and Commit()
+        bool Control(FX3Command command, uint8_t data = 0);
+        bool Control(FX3Command command, uint32_t data);
+        bool SetArgument(uint16_t index, uint16_t value);
+
         fx3class* Fx3;
         uint32_t gpios = 0;
 
@@ -120,6 +129,16 @@ class RadioHardware {
 
         uint32_t freqLO_HF  = 0;
         uint32_t freqLO_VHF = 0;
+
+    private:
+        bool Queue(int reg, function<bool()> write);
+
+        struct pending_write_t {
+            int reg;                    // argument index or GPIO_REGISTER, -1 for a command
+            function<bool()> write;
+        };
+        int batchDepth = 0;
+        vector<pending_write_t> pendingWrites;
 };
 
 class BBRF103Radio : public RadioHardware {
@@ -0,0 +1,351 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "adc_codec.h"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+    const size_t partition = 256;
+    const uint32_t max_frame_samples = 1 << 24;
+
+    // The bit stream of a partition: predictor (2 bits), Rice parameter (5 bits), residuals
+    const uint32_t verbatim = 3;        // predictor of a partition stored as 16 bit samples
+    const uint32_t max_rice = 17;
+    const int escape = 20;              // that many ones: the residual follows on escape_bits
+    const int escape_bits = 18;         // a zigzag residual of order 2 takes 18 bits
+
+    // RAND is its own inverse
+    inline int32_t Rand(int16_t x)
+    {
+        return (int16_t)(x ^ (-(x & 1) & 0xFFFE));
+    }
+
+    inline uint32_t Zigzag(int32_t r)
+    {
+        return ((uint32_t)r << 1) ^ (uint32_t)(r >> 31);
+    }
+
+    inline int32_t Unzigzag(uint32_t u)
+    {
+        return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+    }
+
+    inline int TrailingZeros(uint64_t v)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, v);
+        return (int)index;
+#else
+        return __builtin_ctzll(v);
+#endif
+    }
+
+    // LSB first
+    class bit_writer
+    {
+    public:
+        explicit bit_writer(uint8_t* out): start(out), out(out), acc(0), count(0) {}
+
+        // `value` below 2^n, n up to 32
+        void Put(uint32_t value, int n)
+        {
+            acc |= (uint64_t)value << count;
+            count += n;
+            if (count >= 32)
+            {
+                uint32_t word = (uint32_t)acc;
+                memcpy(out, &word, sizeof(word));
+                out += sizeof(word);
+                acc >>= 32;
+                count -= 32;
+            }
+        }
+
+        size_t Finish()
+        {
+            for (; count > 0; count -= 8, acc >>= 8)
+                *out++ = (uint8_t)acc;
+            count = 0;
+            return out - start;
+        }
+
+    private:
+        uint8_t* start;
+        uint8_t* out;
+        uint64_t acc;
+        int count;
+    };
+
+    class bit_reader
+    {
+    public:
+        bit_reader(const uint8_t* data, size_t size): data(data), size(size), pos(0), acc(0), count(0) {}
+
+        // At least 56 bits in acc, zeros past the end
+        void Refill()
+        {
+            if (size - std::min(pos, size) >= 8)
+            {
+                uint64_t word;
+                memcpy(&word, data + pos, sizeof(word));
+                acc |= word << count;
+                pos += (63 - count) >> 3;
+                count |= 56;
+            }
+            else
+            {
+                for (; count <= 56; count += 8, pos++)
+                    acc |= (uint64_t)(pos < size ? data[pos] : 0) << count;
+            }
+        }
+
+        // n up to 32, after a Refill() covering it
+        uint32_t Get(int n)
+        {
+            uint32_t value = (uint32_t)(acc & ((1ull << n) - 1));
+            Skip(n);
+            return value;
+        }
+
+        void Skip(int n)
+        {
+            acc >>= n;
+            count -= n;
+        }
+
+        uint64_t Peek() const { return acc; }
+
+        bool Overrun() const { return pos * 8 - count > size * 8; }
+
+    private:
+        const uint8_t* data;
+        size_t size;
+        size_t pos;     // next byte to load
+        uint64_t acc;
+        int count;
+    };
+
+    // RAND encoded samples look like full scale noise: their steps are much larger decoded
+    bool LooksRand(const int16_t* samples, size_t count)
+    {
+        const size_t n = std::min<size_t>(count, 4096);
+        uint64_t plain = 0;
+        uint64_t decoded = 0;
+        for (size_t i = 1; i < n; i++)
+        {
+            plain += std::abs((int32_t)samples[i] - samples[i - 1]);
+            decoded += std::abs(Rand(samples[i]) - Rand(samples[i - 1]));
+        }
+        return decoded < plain;
+    }
+
+    // Rice parameter close to the optimum for residuals of this mean
+    uint32_t RiceParameter(uint64_t sum, size_t n)
+    {
+        uint64_t mean = sum / n;
+        uint32_t k = 0;
+        while (k < max_rice && (mean >> (k + 1)) != 0)
+            k++;
+        return k;
+    }
+
+    // x[0] and x[1] are the two samples before the partition, x[2..n+1] the partition
+    void EncodePartition(const int32_t* x, size_t n, bit_writer& bits)
+    {
+        uint32_t residuals[3][partition];
+        uint64_t sums[3] = { 0, 0, 0 };
+
+        for (size_t i = 0; i < n; i++)
+            residuals[0][i] = Zigzag(x[i + 2]);
+        for (size_t i = 0; i < n; i++)
+            residuals[1][i] = Zigzag(x[i + 2] - x[i + 1]);
+        for (size_t i = 0; i < n; i++)
+            residuals[2][i] = Zigzag(x[i + 2] - 2 * x[i + 1] + x[i]);
+        for (int order = 0; order < 3; order++)
+        {
+            uint32_t sum = 0;   // below 256 * 2^18
+            for (size_t i = 0; i < n; i++)
+                sum += residuals[order][i];
+            sums[order] = sum;
+        }
+
+        const int order = (int)(std::min_element(sums, sums + 3) - sums);
+        const uint32_t* u = residuals[order];
+        const uint32_t k = RiceParameter(sums[order], n);
+
+        uint32_t cost = (uint32_t)n * (k + 1);
+        for (size_t i = 0; i < n; i++)
+        {
+            uint32_t q = u[i] >> k;
+            cost += q < (uint32_t)escape ? q : escape + escape_bits - 1 - k;
+        }
+
+        if (cost >= n * 16)
+        {
+            bits.Put(verbatim, 2);
+            bits.Put(0, 5);
+            for (size_t i = 0; i < n; i++)
+                bits.Put((uint16_t)x[i + 2], 16);
+            return;
+        }
+
+        bits.Put(order, 2);
+        bits.Put(k, 5);
+        const uint32_t low_mask = (1u << k) - 1;
+        for (size_t i = 0; i < n; i++)
+        {
+            uint32_t q = u[i] >> k;
+            if (q < (uint32_t)escape && q + 1 + k <= 32)
+            {
+                // unary quotient and remainder in one go, the usual case
+                bits.Put(((1u << q) - 1) | (u[i] & low_mask) << (q + 1), q + 1 + k);
+            }
+            else if (q < (uint32_t)escape)
+            {
+                bits.Put((1u << q) - 1, q + 1);
+                bits.Put(u[i] & low_mask, k);
+            }
+            else
+            {
+                bits.Put((1u << escape) - 1, escape);
+                bits.Put(u[i], escape_bits);
+            }
+        }
+    }
+}
+
+size_t adc_codec::MaxEncodedSize(size_t count)
+{
+    const size_t partitions = (count + partition - 1) / partition;
+    return sizeof(frame_header) + (count * 16 + partitions * 7 + 7) / 8 + sizeof(uint32_t);
+}
+
+size_t adc_codec::Encode(const int16_t* samples, size_t count, uint64_t first_sample, uint8_t* out)
+{
+    frame_header header = { frame_magic, (uint32_t)count, 0, 0, first_sample };
+    const bool rand = LooksRand(samples, count);
+    if (rand)
+        header.flags |= flag_rand;
+
+    bit_writer bits(out + sizeof(header));
+    int32_t x[partition + 2] = { 0, 0 };
+
+    for (size_t start = 0; start < count; start += partition)
+    {
+        const size_t n = std::min(partition, count - start);
+        if (rand)
+        {
+            for (size_t i = 0; i < n; i++)
+                x[i + 2] = Rand(samples[start + i]);
+        }
+        else
+        {
+            for (size_t i = 0; i < n; i++)
+                x[i + 2] = samples[start + i];
+        }
+
+        EncodePartition(x, n, bits);
+        x[0] = x[n];
+        x[1] = x[n + 1];
+    }
+
+    header.payload_size = (uint32_t)bits.Finish();
+    memcpy(out, &header, sizeof(header));
+    return sizeof(header) + header.payload_size;
+}
+
+bool adc_codec::ReadHeader(const uint8_t* data, size_t size, frame_header* header)
+{
+    if (size < sizeof(frame_header))
+        return false;
+
+    memcpy(header, data, sizeof(frame_header));
+    return header->magic == frame_magic && header->samples <= max_frame_samples &&
+        header->payload_size <= MaxEncodedSize(header->samples) - sizeof(frame_header);
+}
+
+bool adc_codec::Decode(const frame_header& header, const uint8_t* payload, int16_t* samples)
+{
+    bit_reader bits(payload, header.payload_size);
+    const uint64_t escape_mask = (1ull << escape) - 1;
+    int32_t x1 = 0, x2 = 0;
+
+    for (size_t start = 0; start < header.samples; start += partition)
+    {
+        const size_t n = std::min<size_t>(partition, header.samples - start);
+        int16_t* out = samples + start;
+
+        bits.Refill();
+        const uint32_t order = bits.Get(2);
+        const uint32_t k = bits.Get(5);
+
+        if (order == verbatim)
+        {
+            for (size_t i = 0; i < n; i++)
+            {
+                bits.Refill();
+                out[i] = (int16_t)bits.Get(16);
+            }
+            x2 = n > 1 ? out[n - 2] : x1;
+            x1 = out[n - 1];
+            continue;
+        }
+        if (k > max_rice)
+            return false;
+
+        for (size_t i = 0; i < n; i++)
+        {
+            bits.Refill();
+            uint32_t u;
+            if ((bits.Peek() & escape_mask) == escape_mask)
+            {
+                bits.Skip(escape);
+                u = bits.Get(escape_bits);
+            }
+            else
+            {
+                uint32_t q = TrailingZeros(~bits.Peek());
+                bits.Skip(q + 1);
+                u = (q << k) | bits.Get(k);
+            }
+
+            int32_t r = Unzigzag(u);
+            int32_t v = order == 0 ? r : order == 1 ? r + x1 : r + 2 * x1 - x2;
+            x2 = x1;
+            x1 = v;
+            out[i] = (int16_t)v;
+        }
+    }
+
+    if (header.flags & flag_rand)
+    {
+        for (size_t i = 0; i < header.samples; i++)
+            samples[i] = (int16_t)Rand(samples[i]);
+    }
+
+    return !bits.Overrun();
+}
@@ -0,0 +1,72 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Lossless codec of the raw int16 ADC samples
+ *
+ * A compressed capture is a sequence of independent frames, one per stream
+ * block, so that they are encoded in parallel and a damaged or missing frame
+ * only loses its own samples. A frame is a header followed by a bit stream.
+ *
+ * The samples are cut in partitions of 256. Each one is predicted with the
+ * fixed polynomial predictor of order 0, 1 or 2 whose residuals are smallest
+ * (the ADC oversamples the HF band, neighbouring samples are correlated), and
+ * the zigzag mapped residuals are Rice coded with the parameter fitting their
+ * mean. A partition the Rice code would make larger is stored verbatim. The
+ * residual and cost passes are plain loops over int32 the compiler vectorizes;
+ * only the bit output is scalar.
+ *
+ * When the samples look RAND encoded (bits 1 to 15 XORed with bit 0, see
+ * RadioHandler::SetRand), the frame is decoded from RAND first, which the
+ * flags of the header record.
+ *
+ * All the fields are little endian.
+ */
+class adc_codec
+{
+public:
+    static const uint32_t frame_magic = 0x315A4453;  // "SDZ1"
+    static const uint32_t flag_rand = 1;
+
+    struct frame_header
+    {
+        uint32_t magic;
+        uint32_t samples;
+        uint32_t payload_size;  // bytes after the header
+        uint32_t flags;
+        uint64_t first_sample;  // index in the stream: a jump is a gap in the capture
+    };
+
+    // Bytes Encode() may write for `count` samples, header included
+    static size_t MaxEncodedSize(size_t count);
+
+    // Encodes a frame into `out` (MaxEncodedSize(count) bytes), returns its size
+    static size_t Encode(const int16_t* samples, size_t count, uint64_t first_sample, uint8_t* out);
+
+    // Checks the header at `data` (`size` bytes available), false if it is not one
+    static bool ReadHeader(const uint8_t* data, size_t size, frame_header* header);
+
+    // Decodes the payload of a frame into `header.samples` samples, false if it is damaged
+    static bool Decode(const frame_header& header, const uint8_t* payload, int16_t* samples);
+};
@@ -0,0 +1,166 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "adc_encoder.h"
+#include "adc_codec.h"
+
+#include "../config.h"
+#include "../thread_config.h"
+
+#include <chrono>
+#include <string.h>
+
+#define TAG "adc_encoder"
+
+namespace {
+    const int slots_per_thread = 4;
+}
+
+adc_encoder::adc_encoder():
+    slot_count(0),
+    next_sample(0),
+    submitted(0),
+    taken(0),
+    stopping(false),
+    flushed(0),
+    bytes_in(0),
+    bytes_out(0),
+    busy_ns(0)
+{
+}
+
+adc_encoder::~adc_encoder()
+{
+    Stop();
+}
+
+void adc_encoder::Start(int threads, sink_t sink, const sddc_thread_config_t& config)
+{
+    TracePrintln(TAG, "%d", threads);
+
+    Stop();
+
+    this->sink = sink;
+    slot_count = (size_t)threads * slots_per_thread;
+    slots.reset(new slot_t[slot_count]);
+    for (size_t i = 0; i < slot_count; i++)
+        slots[i].state = SLOT_FREE;
+
+    next_sample = 0;
+    submitted = 0;
+    taken = 0;
+    stopping = false;
+    flushed = 0;
+    bytes_in = 0;
+    bytes_out = 0;
+    busy_ns = 0;
+
+    for (int i = 0; i < threads; i++)
+        workers.emplace_back(&adc_encoder::WorkerThread, this, config);
+}
+
+bool adc_encoder::Submit(const int16_t* samples, size_t count)
+{
+    slot_t& slot = slots[submitted % slot_count];
+    next_sample += count;
+
+    if (slot.state.load(std::memory_order_acquire) != SLOT_FREE)
+        return false;
+
+    // Sized by the first blocks, then reused
+    slot.input.resize(count);
+    memcpy(slot.input.data(), samples, count * sizeof(int16_t));
+    slot.first_sample = next_sample - count;
+    slot.state.store(SLOT_QUEUED, std::memory_order_release);
+
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        submitted++;
+    }
+    cv.notify_one();
+    return true;
+}
+
+void adc_encoder::Stop()
+{
+    if (workers.empty())
+        return;
+
+    TracePrintln(TAG, "");
+
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+    workers.clear();
+
+    DebugPrintln(TAG, "%llu bytes encoded to %llu, %.1f ms busy",
+        (unsigned long long)bytes_in.load(), (unsigned long long)bytes_out.load(), busy_ns / 1e6);
+}
+
+void adc_encoder::WorkerThread(sddc_thread_config_t config)
+{
+    sddc_thread_apply(SDDC_THREAD_ENCODER, config);
+
+    for (;;)
+    {
+        uint64_t job;
+        {
+            std::unique_lock<std::mutex> lk(mutex);
+            cv.wait(lk, [this] { return taken < submitted || stopping; });
+            if (taken == submitted)
+                break;
+            job = taken++;
+        }
+
+        slot_t& slot = slots[job % slot_count];
+        const auto start = std::chrono::steady_clock::now();
+        slot.output.resize(adc_codec::MaxEncodedSize(slot.input.size()));
+        slot.size = adc_codec::Encode(slot.input.data(), slot.input.size(), slot.first_sample, slot.output.data());
+        busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        slot.state.store(SLOT_DONE, std::memory_order_release);
+
+        Flush();
+    }
+}
+
+// Hands over the frames done in a row from the oldest one. A thread finishing a
+// frame while another one flushes waits for the lock, then finds its frame done
+void adc_encoder::Flush()
+{
+    std::lock_guard<std::mutex> lk(flush_mutex);
+
+    for (;;)
+    {
+        slot_t& slot = slots[flushed % slot_count];
+        if (slot.state.load(std::memory_order_acquire) != SLOT_DONE)
+            break;
+
+        if (sink(slot.output.data(), slot.size, slot.input.size()))
+        {
+            bytes_in += slot.input.size() * sizeof(int16_t);
+            bytes_out += slot.size;
+        }
+        slot.state.store(SLOT_FREE, std::memory_order_release);
+        flushed++;
+    }
+}
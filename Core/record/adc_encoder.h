@@ -0,0 +1,100 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include "../types.h"
+
+/**
+ * @brief Encodes the raw ADC blocks with adc_codec on a pool of threads
+ *
+ * Submit() copies a block into a free slot and returns; the encoder threads
+ * take the slots in turn, and the frames go to the sink in the order of the
+ * blocks, whichever thread finished first. With every slot taken (the threads
+ * do not keep up), Submit() refuses the block: the next frame then starts
+ * further in the stream (see adc_codec::frame_header::first_sample).
+ */
+class adc_encoder
+{
+public:
+    // Takes the frames in order, one call at a time, false if the frame was dropped
+    typedef std::function<bool(const uint8_t* frame, size_t size, size_t samples)> sink_t;
+
+    adc_encoder();
+    ~adc_encoder();
+
+    // `threads` encoder threads, with 4 slots per thread
+    void Start(int threads, sink_t sink, const sddc_thread_config_t& config);
+
+    // From a single thread. False if the block was refused
+    bool Submit(const int16_t* samples, size_t count);
+
+    // Encodes what was submitted, hands it to the sink, and stops the threads
+    void Stop();
+
+    bool IsRunning() const { return !workers.empty(); }
+
+    uint64_t GetBytesIn() const { return bytes_in; }    // samples of the frames handed over
+    uint64_t GetBytesOut() const { return bytes_out; }  // frames handed over
+    uint64_t GetBusyTime() const { return busy_ns; }    // encoding, all threads together
+
+private:
+    enum slot_state { SLOT_FREE, SLOT_QUEUED, SLOT_DONE };
+
+    struct slot_t
+    {
+        std::vector<int16_t> input;
+        uint64_t first_sample;
+        std::vector<uint8_t> output;
+        size_t size;
+        std::atomic<int> state;
+    };
+
+    void WorkerThread(sddc_thread_config_t config);
+    void Flush();
+
+    sink_t sink;
+    std::unique_ptr<slot_t[]> slots;
+    size_t slot_count;
+    std::vector<std::thread> workers;
+
+    uint64_t next_sample;   // Submit() side
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint64_t submitted;     // slots given to the threads
+    uint64_t taken;         // slots taken by a thread
+    bool stopping;
+
+    std::mutex flush_mutex;
+    uint64_t flushed;       // slots handed to the sink
+
+    std::atomic<uint64_t> bytes_in;
+    std::atomic<uint64_t> bytes_out;
+    std::atomic<uint64_t> busy_ns;
+};
@@ -0,0 +1,443 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "recorder.h"
+
+#include "../config.h"
+#include "../dsp/allocator.h"
+#include "../thread_config.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+
+#define TAG "recorder"
+
+namespace {
+    // O_DIRECT wants the buffer, the size and the offset of a write aligned on the
+    // logical block size of the device, 4096 covers all of them
+    const size_t direct_io_alignment = 4096;
+
+    const uint32_t default_buffer_size = 256 * 1024 * 1024;
+    const uint32_t default_chunk_size = 4 * 1024 * 1024;
+    const uint32_t default_preallocate = 1024 * 1024 * 1024;
+    const uint32_t max_encoder_threads = 64;
+
+    int OpenFile(const char* path, bool direct, bool* direct_used)
+    {
+        *direct_used = false;
+#ifdef _WIN32
+        return _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+#ifdef O_DIRECT
+        if (direct)
+        {
+            int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+            if (fd >= 0)
+            {
+                *direct_used = true;
+                return fd;
+            }
+            // tmpfs and a few others refuse it
+            if (errno != EINVAL)
+                return -1;
+        }
+#endif
+        return open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+    }
+
+    // 0 or errno
+    int WriteAt(int fd, const uint8_t* data, size_t size, uint64_t offset)
+    {
+        while (size > 0)
+        {
+#ifdef _WIN32
+            if (_lseeki64(fd, offset, SEEK_SET) < 0)
+                return errno;
+            int n = _write(fd, data, (unsigned)(size < 0x40000000 ? size : 0x40000000));
+#else
+            ssize_t n = pwrite(fd, data, size, offset);
+#endif
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return errno;
+            }
+            if (n == 0)
+                return EIO;
+            data += n;
+            size -= n;
+            offset += n;
+        }
+        return 0;
+    }
+
+    void TruncateFile(int fd, uint64_t size)
+    {
+#ifdef _WIN32
+        _chsize_s(fd, size);
+#else
+        if (ftruncate(fd, size) != 0)
+            WarnPrintln(TAG, "ftruncate failed: %s", strerror(errno));
+#endif
+    }
+
+    void CloseFile(int fd)
+    {
+#ifdef _WIN32
+        _close(fd);
+#else
+        close(fd);
+#endif
+    }
+}
+
+recorder::recorder():
+    config(GetDefaultConfig()),
+    thread_config{},
+    encoder_thread_config{},
+    fd(-1),
+    direct_io(false),
+    pool_block(nullptr),
+    current(-1),
+    closing(false),
+    file_offset(0),
+    allocated(0),
+    can_preallocate(false),
+    bytes_written(0),
+    bytes_recorded(0),
+    bytes_dropped(0),
+    blocks_dropped(0),
+    queued_chunks(0),
+    peak_chunks(0),
+    error(0),
+    first_timestamp(0),
+    first_block(true)
+{
+}
+
+recorder::~recorder()
+{
+    Close();
+}
+
+sddc_record_config_t recorder::GetDefaultConfig()
+{
+    sddc_record_config_t config;
+    config.buffer_size = default_buffer_size;
+    config.chunk_size = default_chunk_size;
+    config.preallocate = default_preallocate;
+    config.direct_io = true;
+    config.encoder_threads = 0;
+    return config;
+}
+
+sddc_err_t recorder::Open(const char* path, const sddc_record_config_t* cfg)
+{
+    TracePrintln(TAG, "%s", path);
+
+    if (fd >= 0)
+        return ERR_STREAM_RUNNING;
+
+    config = cfg ? *cfg : GetDefaultConfig();
+    if (config.buffer_size == 0)
+        config.buffer_size = default_buffer_size;
+    if (config.chunk_size == 0)
+        config.chunk_size = default_chunk_size;
+
+    // Double buffering at least: one chunk filled while the other is written
+    if (config.chunk_size % direct_io_alignment != 0 || config.buffer_size / config.chunk_size < 2)
+        return ERR_BUFFER_SIZE_INVALID;
+    if (config.encoder_threads > max_encoder_threads)
+        return ERR_THREAD_CONFIG_INVALID;
+
+    // Large pools come page aligned from sddc_alloc, small ones only on a cache line
+    const int count = config.buffer_size / config.chunk_size;
+    pool_block = (uint8_t*)sddc_alloc((size_t)count * config.chunk_size + direct_io_alignment);
+    if (pool_block == nullptr)
+        return ERR_BUFFER_SIZE_INVALID;
+    uint8_t* pool = (uint8_t*)(((uintptr_t)pool_block + direct_io_alignment - 1) & ~(uintptr_t)(direct_io_alignment - 1));
+
+    fd = OpenFile(path, config.direct_io, &direct_io);
+    if (fd < 0)
+    {
+        WarnPrintln(TAG, "Cannot create %s: %s", path, strerror(errno));
+        sddc_free(pool_block);
+        pool_block = nullptr;
+        return ERR_RECORD_FAILED;
+    }
+
+    chunks.resize(count);
+    free_chunks.clear();
+    full_chunks.clear();
+    for (int i = count - 1; i >= 0; i--)
+    {
+        chunks[i].data = pool + (size_t)i * config.chunk_size;
+        chunks[i].used = 0;
+        free_chunks.push_back(i);
+    }
+
+    current = -1;
+    closing = false;
+    file_offset = 0;
+    allocated = 0;
+    can_preallocate = config.preallocate != 0;
+    bytes_written = 0;
+    bytes_recorded = 0;
+    bytes_dropped = 0;
+    blocks_dropped = 0;
+    queued_chunks = 0;
+    peak_chunks = 0;
+    error = 0;
+    first_timestamp = 0;
+    first_block = true;
+
+    DebugPrintln(TAG, "%s: %d chunks of %u bytes, %s, %u encoder threads", path, count, config.chunk_size,
+        direct_io ? "direct I/O" : "buffered I/O", config.encoder_threads);
+
+    if (config.encoder_threads > 0)
+    {
+        // The frames come in order from one encoder thread at a time
+        encoder.reset(new adc_encoder());
+        encoder->Start(config.encoder_threads, [this](const uint8_t* frame, size_t size, size_t samples) {
+            if (Append(frame, size))
+            {
+                bytes_recorded += samples * sizeof(int16_t);
+                return true;
+            }
+            bytes_dropped += samples * sizeof(int16_t);
+            blocks_dropped++;
+            return false;
+        }, encoder_thread_config);
+    }
+
+    writer = std::thread(&recorder::WriterThread, this);
+    return ERR_SUCCESS;
+}
+
+bool recorder::Write(const void* data, size_t size, int64_t timestamp_ns)
+{
+    bool accepted = fd >= 0 && error == 0 &&
+        (encoder ? encoder->Submit((const int16_t*)data, size / sizeof(int16_t)) : Append(data, size));
+    if (!accepted)
+    {
+        bytes_dropped += size;
+        blocks_dropped++;
+        return false;
+    }
+
+    if (!encoder)
+        bytes_recorded += size;
+    if (first_block)
+    {
+        first_timestamp = timestamp_ns;
+        first_block = false;
+    }
+    return true;
+}
+
+// Copies into the chunks, from one thread at a time. False if they have no room
+bool recorder::Append(const void* data, size_t size)
+{
+    // Room left in the current chunk and the free ones: the writer thread only
+    // ever adds free chunks, so the block fits if it fits now
+    size_t room = current >= 0 ? config.chunk_size - chunks[current].used : 0;
+    if (size > room)
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        if (room + free_chunks.size() * config.chunk_size < size)
+            return false;
+    }
+
+    const uint8_t* src = (const uint8_t*)data;
+    while (size > 0)
+    {
+        if (current < 0)
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            current = free_chunks.back();
+            free_chunks.pop_back();
+            chunks[current].used = 0;
+        }
+
+        chunk_t& chunk = chunks[current];
+        size_t n = std::min(size, config.chunk_size - chunk.used);
+        memcpy(chunk.data + chunk.used, src, n);
+        chunk.used += n;
+        src += n;
+        size -= n;
+
+        if (chunk.used == config.chunk_size)
+        {
+            Queue(current);
+            current = -1;
+        }
+    }
+
+    return true;
+}
+
+void recorder::Queue(int index)
+{
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        full_chunks.push_back(index);
+    }
+    cv.notify_one();
+
+    uint32_t queued = ++queued_chunks;
+    if (queued > peak_chunks)
+        peak_chunks = queued;
+}
+
+sddc_err_t recorder::Close()
+{
+    if (fd < 0)
+        return ERR_SUCCESS;
+
+    TracePrintln(TAG, "");
+
+    if (encoder)
+    {
+        encoder->Stop();
+        encoder.reset();
+    }
+
+    // The last chunk is usually partial
+    if (current >= 0 && chunks[current].used > 0)
+        Queue(current);
+    current = -1;
+
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        closing = true;
+    }
+    cv.notify_one();
+    writer.join();
+
+    // Drops the padding of the last direct write and the space reserved past the end
+    TruncateFile(fd, file_offset);
+    CloseFile(fd);
+    fd = -1;
+
+    sddc_free(pool_block);
+    pool_block = nullptr;
+    chunks.clear();
+
+    DebugPrintln(TAG, "%llu bytes written, %u blocks dropped",
+        (unsigned long long)bytes_written.load(), blocks_dropped.load());
+
+    return error != 0 ? ERR_RECORD_FAILED : ERR_SUCCESS;
+}
+
+void recorder::WriterThread()
+{
+    sddc_thread_apply(SDDC_THREAD_RECORDER, thread_config);
+
+    for (;;)
+    {
+        int index;
+        {
+            std::unique_lock<std::mutex> lk(mutex);
+            cv.wait(lk, [this] { return !full_chunks.empty() || closing; });
+            if (full_chunks.empty())
+                break;
+            index = full_chunks.front();
+            full_chunks.pop_front();
+        }
+
+        // After a failed write the chunks are only given back
+        if (error == 0 && WriteChunk(chunks[index]) && on_chunk)
+            on_chunk();
+
+        queued_chunks--;
+        std::lock_guard<std::mutex> lk(mutex);
+        free_chunks.push_back(index);
+    }
+}
+
+bool recorder::WriteChunk(chunk_t& chunk)
+{
+    // Only the last chunk can be partial: pad it to the alignment, Close() truncates the file
+    size_t size = chunk.used;
+    if (direct_io && size % direct_io_alignment != 0)
+    {
+        size_t aligned = (size + direct_io_alignment - 1) / direct_io_alignment * direct_io_alignment;
+        memset(chunk.data + size, 0, aligned - size);
+        size = aligned;
+    }
+
+    Preallocate(file_offset + size);
+
+    int err = WriteAt(fd, chunk.data, size, file_offset);
+    if (err != 0)
+    {
+        WarnPrintln(TAG, "Write failed at %llu: %s", (unsigned long long)file_offset, strerror(err));
+        error = err;
+        return false;
+    }
+
+    file_offset += chunk.used;
+    bytes_written += chunk.used;
+    return true;
+}
+
+void recorder::Preallocate(uint64_t end)
+{
+    if (!can_preallocate || end <= allocated)
+        return;
+
+#ifdef __linux__
+    // Reserved without changing the file size, so a crash leaves no zeros at the end
+    uint64_t new_end = end + config.preallocate;
+    if (fallocate(fd, FALLOC_FL_KEEP_SIZE, allocated, new_end - allocated) == 0)
+    {
+        allocated = new_end;
+        return;
+    }
+    DebugPrintln(TAG, "fallocate not available: %s", strerror(errno));
+#endif
+    can_preallocate = false;
+}
+
+sddc_record_stats_t recorder::GetStats() const
+{
+    sddc_record_stats_t stats;
+    stats.bytes_written = bytes_written;
+    stats.bytes_recorded = bytes_recorded;
+    stats.bytes_dropped = bytes_dropped;
+    stats.blocks_dropped = blocks_dropped;
+    stats.buffer_fill = queued_chunks * config.chunk_size;
+    stats.buffer_peak = peak_chunks * config.chunk_size;
+    stats.buffer_size = (config.buffer_size / config.chunk_size) * config.chunk_size;
+    stats.direct_io = direct_io;
+    stats.error = error;
+    stats.first_timestamp = first_timestamp;
+    return stats;
+}
@@ -0,0 +1,125 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include "../types.h"
+#include "adc_encoder.h"
+
+/**
+ * @brief Writes a sample stream to a file from its own thread
+ *
+ * The stream thread hands its blocks to Write(), which copies them into a
+ * pool of page aligned chunks and returns at once. A writer thread writes the
+ * full chunks to the file, with O_DIRECT when the file system allows it (the
+ * page cache would otherwise hold gigabytes of a capture nobody reads back)
+ * and reserving the space ahead of the writes with fallocate.
+ *
+ * When the disk does not keep up and the pool is full, Write() drops the whole
+ * block and counts it rather than stalling the stream: the USB side never
+ * waits for the disk. The file holds the samples as they came, without header,
+ * or with sddc_record_config_t::encoder_threads the adc_codec frames of the raw
+ * ADC samples, encoded by an adc_encoder before they reach the chunks.
+ */
+class recorder
+{
+public:
+    recorder();
+    ~recorder();
+
+    static sddc_record_config_t GetDefaultConfig();
+
+    // Creates (or truncates) the file and starts the writer thread, nullptr config for the defaults
+    sddc_err_t Open(const char* path, const sddc_record_config_t* config = nullptr);
+
+    // Queues `size` bytes, from a single thread. False when the block was dropped
+    bool Write(const void* data, size_t size, int64_t timestamp_ns = 0);
+
+    // Writes what is queued and closes the file. ERR_RECORD_FAILED if a write failed
+    sddc_err_t Close();
+
+    bool IsOpen() const { return fd >= 0; }
+
+    // Scheduling of the writer thread, applied by the next Open()
+    void SetThreadConfig(const sddc_thread_config_t& config) { thread_config = config; }
+    // Same, for the encoder threads
+    void SetEncoderThreadConfig(const sddc_thread_config_t& config) { encoder_thread_config = config; }
+
+    // Called by the writer thread after each chunk reached the file, set before Open()
+    void SetChunkCallback(std::function<void()> callback) { on_chunk = callback; }
+
+    sddc_record_stats_t GetStats() const;
+
+private:
+    struct chunk_t
+    {
+        uint8_t* data;
+        size_t used;
+    };
+
+    bool Append(const void* data, size_t size);
+    void WriterThread();
+    bool WriteChunk(chunk_t& chunk);
+    void Preallocate(uint64_t end);
+    void Queue(int index);
+
+    sddc_record_config_t config;
+    sddc_thread_config_t thread_config;
+    sddc_thread_config_t encoder_thread_config;
+    std::function<void()> on_chunk;
+    int fd;
+    bool direct_io;
+
+    uint8_t* pool_block;    // from sddc_alloc
+    std::vector<chunk_t> chunks;   // in pool_block, aligned for O_DIRECT
+    int current;            // chunk being filled by Append(), -1 if none
+    std::unique_ptr<adc_encoder> encoder;   // null without compression
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<int> free_chunks;
+    std::deque<int> full_chunks;
+    bool closing;
+    std::thread writer;
+
+    uint64_t file_offset;   // writer thread
+    uint64_t allocated;     // end of the space reserved by Preallocate
+    bool can_preallocate;
+
+    std::atomic<uint64_t> bytes_written;
+    std::atomic<uint64_t> bytes_recorded;
+    std::atomic<uint64_t> bytes_dropped;
+    std::atomic<uint32_t> blocks_dropped;
+    std::atomic<uint32_t> queued_chunks;
+    std::atomic<uint32_t> peak_chunks;
+    std::atomic<int> error;
+    std::atomic<int64_t> first_timestamp;
+    bool first_block;
+};
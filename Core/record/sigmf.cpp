@@ -0,0 +1,396 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sigmf.h"
+
+#include "../config.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TAG "sigmf"
+
+namespace {
+    const char* data_extension = ".sigmf-data";
+    const char* meta_extension = ".sigmf-meta";
+
+    bool EndsWith(const std::string& s, const char* suffix)
+    {
+        size_t n = strlen(suffix);
+        return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+    }
+
+    std::string Base(const std::string& path)
+    {
+        if (EndsWith(path, data_extension) || EndsWith(path, meta_extension))
+            return path.substr(0, path.size() - strlen(data_extension));
+        return path;
+    }
+
+    std::string Quote(const std::string& s)
+    {
+        std::string out = "\"";
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+                out += c;
+            }
+            else if ((unsigned char)c < 0x20)
+            {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            }
+            else
+            {
+                out += c;
+            }
+        }
+        return out + "\"";
+    }
+
+    // ISO 8601 in UTC, to the nanosecond
+    std::string Datetime(int64_t ns)
+    {
+        time_t seconds = (time_t)(ns / 1000000000);
+        struct tm t;
+#ifdef _WIN32
+        gmtime_s(&t, &seconds);
+#else
+        gmtime_r(&seconds, &t);
+#endif
+        char text[40];
+        snprintf(text, sizeof(text), "\"%04d-%02d-%02dT%02d:%02d:%02d.%09dZ\"",
+            t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec,
+            (int)(ns % 1000000000));
+        return text;
+    }
+
+    const char* ModeName(sddc_rf_mode_t mode)
+    {
+        switch (mode)
+        {
+            case HFMODE: return "HF";
+            case VHFMODE: return "VHF";
+            default: return "none";
+        }
+    }
+
+    bool SameGains(const sigmf_state_t& a, const sigmf_state_t& b)
+    {
+        return a.rf_gain == b.rf_gain && a.if_gain == b.if_gain && a.rf_mode == b.rf_mode;
+    }
+}
+
+sigmf_writer::sigmf_writer():
+    global{},
+    ns_per_sample(0),
+    samples(0),
+    dropped(0),
+    first_block(true),
+    gap(false),
+    current{},
+    has_pending(false),
+    dirty(false)
+{
+    // The metadata follows the data from the writer thread, never from the stream one
+    rec.SetChunkCallback([this] {
+        if (dirty)
+            WriteMeta();
+    });
+}
+
+sigmf_writer::~sigmf_writer()
+{
+    Close();
+}
+
+std::string sigmf_writer::DataPath(const std::string& base)
+{
+    return Base(base) + data_extension;
+}
+
+std::string sigmf_writer::MetaPath(const std::string& base)
+{
+    return Base(base) + meta_extension;
+}
+
+sddc_err_t sigmf_writer::Open(const char* base, const sigmf_global_t& g, const sigmf_state_t& state,
+    const sddc_record_config_t* config)
+{
+    TracePrintln(TAG, "%s", base);
+
+    if (rec.IsOpen())
+        return ERR_STREAM_RUNNING;
+    // The data file of a SigMF recording holds the samples as they are
+    if (g.datatype == nullptr || g.sample_size == 0 || g.sample_rate <= 0 || (config && config->encoder_threads))
+        return ERR_FORMAT_INVALID;
+
+    global = g;
+    meta_path = MetaPath(base);
+    ns_per_sample = 1e9 / global.sample_rate;
+
+    samples = 0;
+    dropped = 0;
+    first_block = true;
+    gap = false;
+    current = state;
+    pending.clear();
+    has_pending = false;
+    captures.assign(1, capture_t{ 0, 0, state.frequency, 0 });
+    annotations.assign(1, annotation_t{ 0, 0, state });
+
+    sddc_err_t ret = rec.Open(DataPath(base).c_str(), config);
+    if (ret != ERR_SUCCESS)
+        return ret;
+
+    // The pair exists from the start, a reader can follow the recording
+    if (!WriteMeta())
+    {
+        rec.Close();
+        remove(DataPath(base).c_str());
+        return ERR_RECORD_FAILED;
+    }
+    return ERR_SUCCESS;
+}
+
+bool sigmf_writer::Write(const void* data, size_t size, int64_t timestamp_ns)
+{
+    const uint64_t count = size / global.sample_size;
+
+    if (!rec.Write(data, size, timestamp_ns))
+    {
+        dropped += count;
+        gap = !first_block;
+        return false;
+    }
+
+    if (first_block || gap || has_pending)
+        Update(timestamp_ns, count);
+    samples += count;
+    return true;
+}
+
+void sigmf_writer::SetState(const sigmf_state_t& state, int64_t time_ns)
+{
+    if (time_ns == 0)
+        time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::lock_guard<std::mutex> lk(mutex);
+    auto it = std::upper_bound(pending.begin(), pending.end(), time_ns,
+        [](int64_t t, const change_t& c) { return t < c.time_ns; });
+    pending.insert(it, change_t{ time_ns, state });
+    has_pending = true;
+}
+
+// A block of `count` samples starting at `timestamp_ns` was accepted at `samples`
+void sigmf_writer::Update(int64_t timestamp_ns, uint64_t count)
+{
+    std::lock_guard<std::mutex> lk(mutex);
+
+    if (first_block)
+    {
+        captures[0].global_index = dropped;
+        captures[0].time_ns = timestamp_ns;
+        first_block = false;
+        dirty = true;
+    }
+    else if (gap)
+    {
+        captures.push_back(capture_t{ samples, samples + dropped, current.frequency, timestamp_ns });
+        gap = false;
+        dirty = true;
+    }
+
+    // Without timestamps, a change applies to the next block
+    size_t applied = 0;
+    for (const change_t& change : pending)
+    {
+        uint64_t offset = 0;
+        if (timestamp_ns != 0 && change.time_ns > timestamp_ns)
+        {
+            offset = (uint64_t)((change.time_ns - timestamp_ns) / ns_per_sample);
+            if (offset >= count)
+                break;
+        }
+        Apply(change.state, samples + offset,
+            timestamp_ns != 0 ? timestamp_ns + (int64_t)(offset * ns_per_sample) : 0);
+        applied++;
+    }
+    pending.erase(pending.begin(), pending.begin() + applied);
+    has_pending = !pending.empty();
+}
+
+void sigmf_writer::Apply(const sigmf_state_t& state, uint64_t position, int64_t time_ns)
+{
+    if (state.frequency != current.frequency)
+    {
+        capture_t& last = captures.back();
+        if (last.sample_start == position)
+            last.frequency = state.frequency;
+        else
+            captures.push_back(capture_t{ position, position + dropped, state.frequency, time_ns });
+    }
+
+    if (!SameGains(state, current))
+    {
+        annotation_t& last = annotations.back();
+        if (last.sample_start == position)
+        {
+            last.state = state;
+        }
+        else
+        {
+            last.sample_count = position - last.sample_start;
+            annotations.push_back(annotation_t{ position, 0, state });
+        }
+    }
+
+    current = state;
+    dirty = true;
+}
+
+sddc_err_t sigmf_writer::Close()
+{
+    if (!rec.IsOpen())
+        return ERR_SUCCESS;
+
+    TracePrintln(TAG, "");
+
+    sddc_err_t ret = rec.Close();
+
+    {
+        // The changes not reached by the stream have no sample
+        std::lock_guard<std::mutex> lk(mutex);
+        pending.clear();
+        has_pending = false;
+        if (captures.size() > 1 && captures.back().sample_start == samples)
+            captures.pop_back();
+        if (annotations.size() > 1 && annotations.back().sample_start == samples)
+            annotations.pop_back();
+        annotations.back().sample_count = samples - annotations.back().sample_start;
+    }
+
+    if (!WriteMeta())
+        ret = ERR_RECORD_FAILED;
+
+    DebugPrintln(TAG, "%llu samples, %u captures, %u annotations", (unsigned long long)samples,
+        (unsigned)captures.size(), (unsigned)annotations.size());
+    return ret;
+}
+
+std::string sigmf_writer::Meta()
+{
+    std::lock_guard<std::mutex> lk(mutex);
+
+    char line[512];
+    std::string meta = "{\n    \"global\": {\n";
+
+    snprintf(line, sizeof(line),
+        "        \"core:datatype\": \"%s\",\n"
+        "        \"core:sample_rate\": %.17g,\n"
+        "        \"core:version\": \"1.0.0\",\n"
+        "        \"core:recorder\": \"libsddc\",\n",
+        global.datatype, global.sample_rate);
+    meta += line;
+    snprintf(line, sizeof(line), "%s, firmware %x", global.hardware.c_str(), global.firmware);
+    meta += "        \"core:hw\": " + Quote(line) + ",\n";
+    snprintf(line, sizeof(line),
+        "        \"core:extensions\": [\n"
+        "            { \"name\": \"sddc\", \"version\": \"1.0.0\", \"optional\": true }\n"
+        "        ],\n"
+        "        \"sddc:adc_sample_rate\": %u,\n"
+        "        \"sddc:firmware\": %u,\n",
+        global.adc_sample_rate, global.firmware);
+    meta += line;
+    meta += "        \"sddc:model\": " + Quote(global.hardware) + "\n    },\n";
+
+    meta += "    \"captures\": [";
+    for (size_t i = 0; i < captures.size(); i++)
+    {
+        const capture_t& c = captures[i];
+        snprintf(line, sizeof(line),
+            "%s\n        { \"core:sample_start\": %llu, \"core:global_index\": %llu, \"core:frequency\": %.17g",
+            i ? "," : "", (unsigned long long)c.sample_start, (unsigned long long)c.global_index, c.frequency);
+        meta += line;
+        if (c.time_ns != 0)
+            meta += ", \"core:datetime\": " + Datetime(c.time_ns);
+        meta += " }";
+    }
+    meta += "\n    ],\n";
+
+    meta += "    \"annotations\": [";
+    for (size_t i = 0; i < annotations.size(); i++)
+    {
+        const annotation_t& a = annotations[i];
+        snprintf(line, sizeof(line), "%s\n        { \"core:sample_start\": %llu",
+            i ? "," : "", (unsigned long long)a.sample_start);
+        meta += line;
+        // The last one is open until Close()
+        if (a.sample_count != 0)
+        {
+            snprintf(line, sizeof(line), ", \"core:sample_count\": %llu", (unsigned long long)a.sample_count);
+            meta += line;
+        }
+        snprintf(line, sizeof(line), ", \"sddc:rf_mode\": \"%s\", \"sddc:rf_gain\": %g, \"sddc:if_gain\": %g }",
+            ModeName(a.state.rf_mode), a.state.rf_gain, a.state.if_gain);
+        meta += line;
+    }
+    meta += "\n    ]\n}\n";
+
+    return meta;
+}
+
+// A reader sees the previous metadata or the new one, never half of it
+bool sigmf_writer::WriteMeta()
+{
+    std::lock_guard<std::mutex> lk(meta_mutex);
+
+    dirty = false;
+    const std::string meta = Meta();
+    const std::string tmp_path = meta_path + ".tmp";
+
+    FILE* f = fopen(tmp_path.c_str(), "wb");
+    if (f == nullptr)
+    {
+        WarnPrintln(TAG, "Cannot create %s", tmp_path.c_str());
+        return false;
+    }
+    bool ok = fwrite(meta.data(), 1, meta.size(), f) == meta.size();
+    ok = fclose(f) == 0 && ok;
+
+#ifdef _WIN32
+    // rename does not replace an existing file there
+    if (ok)
+        remove(meta_path.c_str());
+#endif
+    if (!ok || rename(tmp_path.c_str(), meta_path.c_str()) != 0)
+    {
+        WarnPrintln(TAG, "Cannot write %s", meta_path.c_str());
+        remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
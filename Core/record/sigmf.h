@@ -0,0 +1,138 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "recorder.h"
+
+// What the radio is set to, as recorded in the captures and annotations
+struct sigmf_state_t
+{
+    double frequency;       // Hz
+    float rf_gain;
+    float if_gain;
+    sddc_rf_mode_t rf_mode;
+};
+
+// Fixed for the whole recording
+struct sigmf_global_t
+{
+    const char* datatype;   // "ri16_le", "cf32_le", "ci16_le" or "ci8"
+    size_t sample_size;     // bytes, both I and Q for the complex types
+    double sample_rate;
+    uint32_t adc_sample_rate;
+    std::string hardware;
+    uint16_t firmware;
+};
+
+/**
+ * @brief Writes a SigMF recording: `<base>.sigmf-data` and `<base>.sigmf-meta`
+ *
+ * The samples go through a recorder, as they come. The metadata file is JSON:
+ * the global object, one capture per segment of constant center frequency (and
+ * a new one after dropped blocks, whose core:global_index counts the samples
+ * missing), and one annotation per segment of constant gain state with the
+ * sddc:rf_gain, sddc:if_gain and sddc:rf_mode fields.
+ *
+ * SetState() records the time of the change: the segment starts at the first
+ * sample whose timestamp is at or after it, so the samples still in the pipeline
+ * keep the previous state. The data file is only ever appended to. The metadata
+ * file is small, and rewritten as a whole (to a temporary file renamed over the
+ * previous one) by the writer thread of the recorder after a chunk was written
+ * when a segment started, and by Close().
+ */
+class sigmf_writer
+{
+public:
+    sigmf_writer();
+    ~sigmf_writer();
+
+    // `base` may end with .sigmf-data or .sigmf-meta. Start time is the first block's
+    sddc_err_t Open(const char* base, const sigmf_global_t& global, const sigmf_state_t& state,
+        const sddc_record_config_t* config = nullptr);
+
+    // From the stream thread, as recorder::Write
+    bool Write(const void* data, size_t size, int64_t timestamp_ns);
+
+    // From any thread, when the radio was retuned or a gain changed. 0 for now
+    void SetState(const sigmf_state_t& state, int64_t time_ns = 0);
+
+    sddc_err_t Close();
+
+    bool IsOpen() const { return rec.IsOpen(); }
+    void SetThreadConfig(const sddc_thread_config_t& config) { rec.SetThreadConfig(config); }
+    sddc_record_stats_t GetStats() const { return rec.GetStats(); }
+
+    // Paths of the pair for `base`, with or without the SigMF extensions
+    static std::string DataPath(const std::string& base);
+    static std::string MetaPath(const std::string& base);
+
+private:
+    struct capture_t
+    {
+        uint64_t sample_start;
+        uint64_t global_index;
+        double frequency;
+        int64_t time_ns;    // 0 if unknown
+    };
+
+    struct annotation_t
+    {
+        uint64_t sample_start;
+        uint64_t sample_count;  // 0 while open
+        sigmf_state_t state;
+    };
+
+    struct change_t
+    {
+        int64_t time_ns;
+        sigmf_state_t state;
+    };
+
+    void Update(int64_t timestamp_ns, uint64_t count);
+    void Apply(const sigmf_state_t& state, uint64_t position, int64_t time_ns);
+    std::string Meta();
+    bool WriteMeta();
+
+    recorder rec;
+    sigmf_global_t global;
+    std::string meta_path;
+    double ns_per_sample;
+
+    // Stream thread
+    uint64_t samples;           // in the data file
+    uint64_t dropped;
+    bool first_block;
+    bool gap;
+
+    std::mutex mutex;
+    sigmf_state_t current;      // of the last segment
+    std::vector<change_t> pending;
+    std::atomic<bool> has_pending;
+    std::vector<capture_t> captures;
+    std::vector<annotation_t> annotations;
+    std::atomic<bool> dirty;
+    std::mutex meta_mutex;      // one rewrite at a time
+};
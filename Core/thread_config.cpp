@@ -0,0 +1,189 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "thread_config.h"
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#define TAG "thread_config"
+
+const char* sddc_thread_name(sddc_thread_role_t role)
+{
+    switch (role)
+    {
+    case SDDC_THREAD_USB:      return "sddc-usb";
+    case SDDC_THREAD_R2IQ:     return "sddc-r2iq";
+    case SDDC_THREAD_DELIVERY: return "sddc-delivery";
+    case SDDC_THREAD_STATS:    return "sddc-stats";
+    case SDDC_THREAD_RECORDER: return "sddc-recorder";
+    case SDDC_THREAD_ENCODER:  return "sddc-encoder";
+    case SDDC_THREAD_SERVER:   return "sddc-server";
+    case SDDC_THREAD_CLIENT:   return "sddc-client";
+    default:                   return "sddc";
+    }
+}
+
+// CPUs the system has online, as a mask of the first 64
+static uint64_t online_cpu_mask()
+{
+#if defined(__linux__)
+    // e.g. "0-3,6", CPUs may be taken offline
+    FILE* f = fopen("/sys/devices/system/cpu/online", "r");
+    if (f)
+    {
+        char list[256];
+        uint64_t mask = 0;
+        bool ok = fgets(list, sizeof(list), f) != nullptr;
+        fclose(f);
+        if (ok)
+        {
+            list[strcspn(list, "\n")] = 0;
+            if (sddc_parse_cpu_list(list, &mask) && mask)
+                return mask;
+        }
+    }
+#elif defined(_WIN32)
+    DWORD_PTR process_mask, system_mask;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask))
+        return (uint64_t)system_mask;
+#endif
+    unsigned count = std::thread::hardware_concurrency();
+    return count == 0 || count >= 64 ? ~0ULL : (1ULL << count) - 1;
+}
+
+bool sddc_thread_config_valid(const sddc_thread_config_t& config)
+{
+    return config.priority >= 0 && config.priority <= SDDC_THREAD_MAX_PRIORITY &&
+        (config.cpu_mask & ~online_cpu_mask()) == 0;
+}
+
+bool sddc_thread_apply(sddc_thread_role_t role, const sddc_thread_config_t& config)
+{
+    TracePrintln(TAG, "%d, %d, %llx", role, config.priority, (unsigned long long)config.cpu_mask);
+
+    bool ok = true;
+
+#if defined(__linux__)
+    pthread_t self = pthread_self();
+    pthread_setname_np(self, sddc_thread_name(role));
+
+    if (config.cpu_mask)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int cpu = 0; cpu < 64; cpu++)
+        {
+            if (config.cpu_mask & (1ULL << cpu))
+                CPU_SET(cpu, &cpus);
+        }
+        if (pthread_setaffinity_np(self, sizeof(cpus), &cpus) != 0)
+        {
+            WarnPrintln(TAG, "%s: cannot set the CPU affinity to %llx", sddc_thread_name(role),
+                (unsigned long long)config.cpu_mask);
+            ok = false;
+        }
+    }
+
+    if (config.priority > 0)
+    {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = config.priority;
+        if (pthread_setschedparam(self, SCHED_FIFO, &param) != 0)
+        {
+            WarnPrintln(TAG, "%s: cannot switch to SCHED_FIFO priority %d (needs CAP_SYS_NICE or an rtprio limit)",
+                sddc_thread_name(role), config.priority);
+            ok = false;
+        }
+    }
+#elif defined(__APPLE__)
+    // No affinity API and no SCHED_FIFO for user threads, only the name
+    pthread_setname_np(sddc_thread_name(role));
+    ok = config.priority == 0 && config.cpu_mask == 0;
+#elif defined(_WIN32)
+    HANDLE self = GetCurrentThread();
+    if (config.cpu_mask && SetThreadAffinityMask(self, (DWORD_PTR)config.cpu_mask) == 0)
+    {
+        WarnPrintln(TAG, "%s: cannot set the CPU affinity", sddc_thread_name(role));
+        ok = false;
+    }
+    if (config.priority > 0)
+    {
+        int level = config.priority >= 90 ? THREAD_PRIORITY_TIME_CRITICAL :
+                    config.priority >= 50 ? THREAD_PRIORITY_HIGHEST : THREAD_PRIORITY_ABOVE_NORMAL;
+        if (!SetThreadPriority(self, level))
+        {
+            WarnPrintln(TAG, "%s: cannot raise the priority", sddc_thread_name(role));
+            ok = false;
+        }
+    }
+#endif
+
+    return ok;
+}
+
+bool sddc_parse_cpu_list(const char* list, uint64_t* mask)
+{
+    uint64_t result = 0;
+    const char* p = list;
+
+    while (*p)
+    {
+        char* end;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0 || first > 63)
+            return false;
+
+        long last = first;
+        p = end;
+        if (*p == '-')
+        {
+            p++;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first || last > 63)
+                return false;
+            p = end;
+        }
+
+        for (long cpu = first; cpu <= last; cpu++)
+            result |= 1ULL << cpu;
+
+        if (*p == ',')
+            p++;
+        else if (*p)
+            return false;
+    }
+
+    *mask = result;
+    return true;
+}
@@ -0,0 +1,53 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "types.h"
+
+// Highest SCHED_FIFO priority accepted in sddc_thread_config_t
+#define SDDC_THREAD_MAX_PRIORITY 99
+
+/**
+ * @brief Name given to the threads of a role ("sddc-usb", "sddc-r2iq", ...)
+ */
+const char* sddc_thread_name(sddc_thread_role_t role);
+
+/**
+ * @brief Tells if a configuration can be applied (priority in range, CPUs online)
+ */
+bool sddc_thread_config_valid(const sddc_thread_config_t& config);
+
+/**
+ * @brief Names the calling thread after its role and applies its scheduling
+ *
+ * Meant to be the first thing a driver thread does. Real time priorities
+ * need CAP_SYS_NICE (or an rtprio limit) on Linux: when the system refuses,
+ * a warning is logged and the thread keeps running with the default scheduling.
+ *
+ * \retval true Everything requested was applied
+ */
+bool sddc_thread_apply(sddc_thread_role_t role, const sddc_thread_config_t& config);
+
+/**
+ * @brief Parses a CPU list such as "2,3" or "4-7,10" into a mask
+ *
+ * \retval true The list is valid and only names CPUs 0 to 63
+ */
+bool sddc_parse_cpu_list(const char* list, uint64_t* mask);
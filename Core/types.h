@@ -34,7 +34,17 @@ typedef enum sddc_err_t {
 	ERR_NOT_COMPATIBLE = -0x10, ///< The function is not compatible with the current hardware
 	ERR_DECIMATION_OUT_OF_RANGE, ///< The given decimation is out of the allowed range
 	ERR_NOT_LED, ///< The selected LED is not an LED
-	ERR_BUFFER_SIZE_INVALID
+	ERR_BUFFER_SIZE_INVALID,
+	ERR_STREAM_RUNNING, ///< The operation requires the stream to be stopped
+	ERR_THREAD_CONFIG_INVALID, ///< Unknown thread role, priority out of range or CPU mask naming offline CPUs
+	ERR_BACKEND_INVALID, ///< Unknown backend or option, or the device is already open
+	ERR_STREAM_STOPPED, ///< The operation requires the stream to be running
+	ERR_TIMEOUT, ///< No samples arrived in the given time
+	ERR_FORMAT_INVALID, ///< Unknown sample format or scale out of range
+	ERR_RECORD_FAILED, ///< The capture file could not be created or written
+	ERR_SERVER_FAILED, ///< The server could not listen on the address, or is already running
+	ERR_SHM_FAILED, ///< The shared memory could not be created or opened, or its name is taken by a running publisher
+	ERR_SHM_OVERRUN ///< The shared memory block was overwritten while held: the reader fell a whole ring behind
 } sddc_err_t;
 
 typedef enum sddc_rf_mode_t {
@@ -56,4 +66,161 @@ typedef struct sddc_device_t {
 
 typedef float sddc_complex_t[2];
 
+/**
+ * @brief Format of the IQ samples, see RadioHandler::SetIQFormat
+ * 
+ */
+typedef enum sddc_iq_format_t {
+	SDDC_IQ_CF32 = 0, ///< Interleaved float I and Q, the r2iq output
+	SDDC_IQ_CS16,     ///< Interleaved int16 I and Q
+	SDDC_IQ_CS8       ///< Interleaved int8 I and Q
+} sddc_iq_format_t;
+
+/**
+ * @brief Geometry of the sample stream, see RadioHandler::SetStreamConfig
+ * 
+ */
+typedef struct sddc_stream_config_t {
+	uint32_t transfer_size;        ///< Size of one USB transfer (and of one block of real samples) in bytes
+	uint32_t concurrent_transfers; ///< Number of USB transfers kept in flight (starting point when adaptive)
+	uint32_t max_concurrent_transfers; ///< Upper bound of the adaptive number of transfers, 0 to keep it fixed
+	uint32_t ring_blocks;          ///< Number of blocks in the real and IQ ring buffers
+} sddc_stream_config_t;
+
+/**
+ * @brief Health of the running stream, see RadioHandler::GetStreamStats
+ * 
+ * The rates and loads are measured over the last second, the counters start
+ * with the stream.
+ */
+typedef struct sddc_stream_stats_t {
+	float real_samples_per_second; ///< ADC samples received from the device
+	float iq_samples_per_second;   ///< IQ samples handed to the application
+	uint32_t transfer_depth;       ///< USB transfers in flight
+	uint32_t usb_errors;           ///< USB transfers which failed
+	uint32_t real_ring_full;       ///< Times the USB side waited for room in the real ring: r2iq (or the application when r2iq is off) was late, samples were dropped by the device
+	uint32_t iq_ring_full;         ///< Times r2iq waited for room in the IQ ring: the application was late
+	uint32_t real_ring_fill;       ///< Blocks waiting in the real ring
+	uint32_t iq_ring_fill;         ///< Blocks waiting in the IQ ring
+	uint32_t ring_blocks;          ///< Size of the rings
+	float r2iq_load;               ///< Fraction of the time r2iq spent converting, at most 1
+	float delivery_load;           ///< Fraction of the time spent on the fine tune, the integer conversion and the stream callback
+} sddc_stream_stats_t;
+
+/**
+ * @brief Settings of a recording, see recorder::Open
+ * 
+ */
+typedef struct sddc_record_config_t {
+	uint32_t buffer_size;   ///< Bytes kept between the stream and the disk, 0 for the default (256 MiB)
+	uint32_t chunk_size;    ///< Bytes per write, a multiple of 4096, 0 for the default (4 MiB)
+	uint32_t preallocate;   ///< Bytes reserved ahead of the writes (fallocate), 0 to disable
+	bool direct_io;         ///< Bypass the page cache (O_DIRECT) when the file system allows it
+	uint32_t encoder_threads; ///< Compress the raw ADC samples losslessly (see adc_codec) on that many threads, 0 to write them as they come
+} sddc_record_config_t;
+
+/**
+ * @brief Progress of a recording, see recorder::GetStats
+ * 
+ */
+typedef struct sddc_record_stats_t {
+	uint64_t bytes_written;  ///< Bytes in the file
+	uint64_t bytes_recorded; ///< Bytes of samples recorded: bytes_written before compression
+	uint64_t bytes_dropped;  ///< Bytes refused because the buffer was full: the disk did not keep up
+	uint32_t blocks_dropped; ///< Stream blocks refused, each one is a gap in the recording
+	uint32_t buffer_fill;    ///< Bytes waiting for the disk
+	uint32_t buffer_peak;    ///< Highest buffer_fill of the recording
+	uint32_t buffer_size;    ///< Size of the buffer
+	bool direct_io;          ///< The writes bypass the page cache
+	int error;               ///< errno of the first failed write, 0 if none. The recording stops there
+	int64_t first_timestamp; ///< Time of the first recorded sample (ns since the Unix epoch), 0 if unknown
+} sddc_record_stats_t;
+
+/**
+ * @brief What happens to a network client falling behind the stream, see stream_server
+ * 
+ */
+typedef enum sddc_drop_policy_t {
+	SDDC_DROP_SKIP = 0,   ///< Skip to the newest samples: the client sees a gap
+	SDDC_DROP_DISCONNECT  ///< Close the connection
+} sddc_drop_policy_t;
+
+/**
+ * @brief Settings of the network server, see stream_server::Start
+ * 
+ */
+typedef struct sddc_server_config_t {
+	const char* address;      ///< IPv4 address to listen on, NULL for all the interfaces
+	uint16_t port;            ///< TCP port, 0 for any free one (see sddc_server_stats_t::port)
+	uint32_t max_clients;     ///< Connections served at once, 0 for the default (8)
+	uint32_t buffer_ms;       ///< How far behind the stream a client may fall before its drop policy applies, 0 for the default (500 ms)
+	sddc_drop_policy_t drop_policy; ///< Policy of a new client, which may change its own
+	float scale;              ///< Factor applied to the IQ samples before the 8 bit conversion, 0 for the full scale (1.0 gives 127)
+	bool read_only;           ///< Ignore the frequency, gain and mode commands of the clients
+} sddc_server_config_t;
+
+/**
+ * @brief Activity of the network server, see stream_server::GetStats
+ * 
+ */
+typedef struct sddc_server_stats_t {
+	uint16_t port;            ///< Port the server listens on
+	uint32_t clients;         ///< Clients connected
+	uint32_t clients_total;   ///< Clients accepted since the start
+	uint32_t clients_refused; ///< Connections closed at once, max_clients being reached
+	uint32_t clients_dropped; ///< Clients disconnected by the SDDC_DROP_DISCONNECT policy
+	uint32_t blocks_dropped;  ///< Blocks skipped by slow clients, all the clients together
+	uint32_t commands;        ///< Commands received from the clients
+	uint64_t bytes_sent;      ///< To all the clients
+} sddc_server_stats_t;
+
+/**
+ * @brief Settings of the shared memory publisher, see shm_publisher::Open
+ * 
+ */
+typedef struct sddc_shm_config_t {
+	uint32_t buffer_size;     ///< Bytes of samples kept in the ring, 0 for the default (64 MiB)
+	uint32_t slot_size;       ///< Bytes per slot, a multiple of 4096 (larger blocks span several slots), 0 for the default (256 KiB)
+	uint32_t max_readers;     ///< Readers attached at once, 0 for the default (16)
+} sddc_shm_config_t;
+
+/**
+ * @brief Activity of the shared memory publisher, see shm_publisher::GetStats
+ * 
+ */
+typedef struct sddc_shm_stats_t {
+	uint64_t slots_published; ///< Since the start
+	uint64_t bytes_published; ///< Since the start
+	uint32_t slot_count;      ///< Slots in the ring
+	uint32_t readers;         ///< Readers attached, whose process is alive
+	uint64_t max_lag;         ///< Slots published and not yet read by the slowest reader
+	uint64_t slots_dropped;   ///< Slots skipped by the readers falling a ring behind, the attached readers together
+	uint64_t overruns;        ///< Blocks overwritten while a reader held them, the attached readers together
+} sddc_shm_stats_t;
+
+/**
+ * @brief Threads the driver runs while streaming, see RadioHandler::SetThreadConfig
+ * 
+ */
+typedef enum sddc_thread_role_t {
+	SDDC_THREAD_USB = 0,   ///< Polls the USB events and copies the transfers into the ring
+	SDDC_THREAD_R2IQ,      ///< Converts the real samples to IQ
+	SDDC_THREAD_DELIVERY,  ///< Calls the stream callback
+	SDDC_THREAD_STATS,     ///< Computes the sample rate statistics
+	SDDC_THREAD_RECORDER,  ///< Writes a recording to the disk
+	SDDC_THREAD_ENCODER,   ///< Compresses a recording (sddc_record_config_t::encoder_threads of them)
+	SDDC_THREAD_SERVER,    ///< Takes the blocks for the network clients, decimates and converts them
+	SDDC_THREAD_CLIENT,    ///< Sends the samples to one network client and reads its commands
+	SDDC_THREAD_ROLE_COUNT
+} sddc_thread_role_t;
+
+/**
+ * @brief Scheduling of one of the driver threads
+ * 
+ */
+typedef struct sddc_thread_config_t {
+	int priority;      ///< SCHED_FIFO priority (1 to 99), 0 keeps the default scheduler
+	uint64_t cpu_mask; ///< CPUs the thread may run on (bit n for CPU n), 0 for no restriction
+} sddc_thread_config_t;
+
 #endif // _H_TYPES
\ No newline at end of file
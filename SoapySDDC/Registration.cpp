@@ -13,13 +13,19 @@ SoapySDR::KwargsList findSDDC(const SoapySDR::Kwargs &args)
 
     vector<SoapySDR::Kwargs> results;
 
-    vector<SDDC::DeviceItem> device_list = RadioHandler::GetDeviceList();
+    // backend=replay,file=... streams a capture instead of the USB device.
+    // Its options are comma separated, so use quotes: --args='driver=SDDC,backend="replay,file=x.wav"'
+    string backend = args.count("backend") ? args.at("backend") : "";
+
+    vector<SDDC::DeviceItem> device_list = RadioHandler::GetDeviceList(backend.c_str());
     for(auto sddc_device: device_list)
     {
         SoapySDR::Kwargs soapy_device;
         soapy_device["index"] = to_string(sddc_device.index);
         soapy_device["label"] = string(sddc_device.product);
         soapy_device["serial"] = string(sddc_device.serial_number);
+        if(!backend.empty())
+            soapy_device["backend"] = backend;
         results.push_back(soapy_device);
     }
 
@@ -34,7 +40,7 @@ SoapySDR::Device *makeSDDC(const SoapySDR::Kwargs &args)
     if(args.find("index") == args.end())
         return nullptr;
 
-    return new SoapySDDC(stoul(args.at("index")));
+    return new SoapySDDC(stoul(args.at("index")), args.count("backend") ? args.at("backend") : "");
 }
 
 static SoapySDR::Registry registerSDDC("SDDC", &findSDDC, &makeSDDC, SOAPY_SDR_ABI_VERSION);
@@ -3,6 +3,8 @@
 #include <sys/types.h>
 #include <cstdint>
 #include <cstring>
+#include <chrono>
+#include <stdexcept>
 #include <SoapySDR/Types.hpp>
 #include <SoapySDR/Time.hpp>
 
@@ -11,43 +13,22 @@ using namespace std;
 
 const char TAG[] = "SoapySDDC_Settings";
 
-static void _Callback(void *context, const sddc_complex_t *data, uint32_t len)
+SoapySDDC::SoapySDDC(uint8_t dev_index, const std::string &backend): deviceId(dev_index),
+                                        bytesPerSample(sizeof(sddc_complex_t)),
+                                        rawStream(false),
+                                        sampleRate(0),
+                                        numBuffers(16),
+                                        bufferedElems(0),
+                                        overflowCount(0),
+                                        statusOverflowCount(0)
 {
-    SoapySDDC *sddc = (SoapySDDC *)context;
-    sddc->Callback(data, len);
-}
-
-void SoapySDDC::Callback(const sddc_complex_t *data, uint32_t len)
-{
-    TraceExtremePrintln(TAG, "%p, %d", data, len);
-    if (_buf_count == numBuffers)
-    {
-        _overflowEvent = true;
-        return;
-    }
-
-    auto &buff = samples_buffer[samples_block_write];
-    buff.resize(len * sizeof(sddc_complex_t));
-    memcpy(buff.data(), data, len * sizeof(sddc_complex_t));
-
-    samples_block_write = (samples_block_write + 1) % numBuffers;
-
-    {
-        std::lock_guard<std::mutex> lock(_buf_mutex);
-        _buf_count++;
-    }
-    _buf_cond.notify_one();
-
-    return;
-}
-
-SoapySDDC::SoapySDDC(uint8_t dev_index): deviceId(dev_index),
-                                        numBuffers(16)
-{
-    TracePrintln(TAG, "%d", dev_index);
+    TracePrintln(TAG, "%d, %s", dev_index, backend.c_str());
     radio_handler = new RadioHandler();
+    if (!backend.empty() && radio_handler->SetBackend(backend.c_str()) != ERR_SUCCESS)
+        throw std::runtime_error("SoapySDDC: invalid backend " + backend);
     radio_handler->Init(dev_index);
-    radio_handler->AttachIQ(_Callback, this);
+    // No delivery thread: readStream and acquireReadBuffer take the blocks themselves
+    radio_handler->SetPullMode(true);
 }
 
 SoapySDDC::~SoapySDDC(void)
@@ -356,13 +337,16 @@ void SoapySDDC::setSampleRate(const int, const size_t, const double rate)
 {
     TracePrintln(TAG, "*, *, %f", rate);
     
-    radio_handler->SetADCSampleRate(rate*2);
+    // The raw stream has one element per ADC sample, the IQ one every 2. Apps
+    // may set the rate before the stream format: setupStream applies it again
+    sampleRate = rate;
+    radio_handler->SetADCSampleRate(rawStream ? rate : rate*2);
 }
 
 double SoapySDDC::getSampleRate(const int, const size_t) const
 {
     TracePrintln(TAG, "*, *");
-    return radio_handler->GetADCSampleRate()/2;
+    return rawStream ? radio_handler->GetADCSampleRate() : radio_handler->GetADCSampleRate()/2;
 }
 
 SoapySDR::RangeList SoapySDDC::getSampleRateRange(const int, const size_t) const
@@ -371,19 +355,45 @@ SoapySDR::RangeList SoapySDDC::getSampleRateRange(const int, const size_t) const
 
     SoapySDR::RangeList ranges;
 
-    ranges.push_back(SoapySDR::Range(1000000/2, 160000000/2));
+    if (rawStream)
+        ranges.push_back(SoapySDR::Range(1000000, 160000000));
+    else
+        ranges.push_back(SoapySDR::Range(1000000/2, 160000000/2));
 
     return ranges;
 }
 
 
+// Telemetry of the stream, see RadioHandler::GetStreamStats
+static const struct {
+    const char *key;
+    const char *name;
+    const char *description;
+    const char *units;
+    SoapySDR::ArgInfo::Type type;
+} stream_sensors[] = {
+    { "RealRate",     "ADC rate",          "ADC samples received from the device per second", "Sps", SoapySDR::ArgInfo::FLOAT },
+    { "IQRate",       "IQ rate",           "IQ samples handed to the application per second", "Sps", SoapySDR::ArgInfo::FLOAT },
+    { "USBErrors",    "USB errors",        "USB transfers which failed since the stream started", "", SoapySDR::ArgInfo::INT },
+    { "USBDrops",     "USB side drops",    "Times the USB side found the real ring full since the stream started: r2iq (or the application with S16) was late and the device dropped samples", "", SoapySDR::ArgInfo::INT },
+    { "IQDrops",      "IQ side drops",     "Times r2iq found the IQ ring full since the stream started: the application was late", "", SoapySDR::ArgInfo::INT },
+    { "RealRingFill", "Real ring fill",    "Blocks waiting in the real ring, in percent of the ring", "%", SoapySDR::ArgInfo::FLOAT },
+    { "IQRingFill",   "IQ ring fill",      "Blocks waiting in the IQ ring, in percent of the ring", "%", SoapySDR::ArgInfo::FLOAT },
+    { "R2IQLoad",     "r2iq load",         "Time spent converting the real samples to IQ", "%", SoapySDR::ArgInfo::FLOAT },
+    { "DeliveryLoad", "Delivery load",     "Time spent on the fine tune and the integer conversion of the IQ samples", "%", SoapySDR::ArgInfo::FLOAT },
+};
+
 vector<string> SoapySDDC::listSensors() const 
 {
     TracePrintln(TAG, "");
 
-    return vector<string>{
-        "RFMode"
+    vector<string> sensors{
+        "RFMode",
+        "USBTransfers"
     };
+    for (const auto &sensor : stream_sensors)
+        sensors.push_back(sensor.key);
+    return sensors;
 }
 
 SoapySDR::ArgInfo SoapySDDC::getSensorInfo(const string &key) const
@@ -400,6 +410,31 @@ SoapySDR::ArgInfo SoapySDDC::getSensorInfo(const string &key) const
         arg.type = SoapySDR::ArgInfo::STRING;
         return arg;
     }
+    else if(key == "USBTransfers")
+    {
+        SoapySDR::ArgInfo arg;
+        arg.key = "USBTransfers";
+        arg.value = readSensor(key);
+        arg.name = "USB transfers";
+        arg.description = "Number of USB transfers currently kept in flight";
+        arg.type = SoapySDR::ArgInfo::INT;
+        return arg;
+    }
+
+    for (const auto &sensor : stream_sensors)
+    {
+        if (key != sensor.key)
+            continue;
+
+        SoapySDR::ArgInfo arg;
+        arg.key = sensor.key;
+        arg.value = readSensor(key);
+        arg.name = sensor.name;
+        arg.description = sensor.description;
+        arg.units = sensor.units;
+        arg.type = sensor.type;
+        return arg;
+    }
 
     return SoapySDR::ArgInfo();
 }
@@ -408,10 +443,34 @@ string SoapySDDC::readSensor(const string &key) const
 {
     TracePrintln(TAG, "%s", key.c_str());
 
-    if(key == "RF mode")
+    if(key == "RFMode")
     {
         return radio_handler->GetRFMode() == VHFMODE ? "VHF" : "HF";
     }
+    else if(key == "USBTransfers")
+    {
+        return std::to_string(radio_handler->getTransferDepth());
+    }
+
+    const sddc_stream_stats_t stats = radio_handler->GetStreamStats();
+    if(key == "RealRate")
+        return std::to_string(stats.real_samples_per_second);
+    else if(key == "IQRate")
+        return std::to_string(stats.iq_samples_per_second);
+    else if(key == "USBErrors")
+        return std::to_string(stats.usb_errors);
+    else if(key == "USBDrops")
+        return std::to_string(stats.real_ring_full);
+    else if(key == "IQDrops")
+        return std::to_string(stats.iq_ring_full);
+    else if(key == "RealRingFill")
+        return std::to_string(100.0f * stats.real_ring_fill / stats.ring_blocks);
+    else if(key == "IQRingFill")
+        return std::to_string(100.0f * stats.iq_ring_fill / stats.ring_blocks);
+    else if(key == "R2IQLoad")
+        return std::to_string(100.0f * stats.r2iq_load);
+    else if(key == "DeliveryLoad")
+        return std::to_string(100.0f * stats.delivery_load);
     return "";
 }
 
@@ -526,17 +585,20 @@ void SoapySDDC::writeSetting(const std::string &key, const std::string &value)
 //     return "sw_ticks";
 // }
 
-// bool SoapySDDC::hasHardwareTime(const std::string &what) const
-// {
-//     DbgPrintf("SoapySDDC::hasHardwareTime\n");
-//     return what == "" || what == "sw_ticks";
-// }
+// The stream timestamps are on the host clock (see RadioHandler::AttachReal),
+// which is the time reported here
+bool SoapySDDC::hasHardwareTime(const std::string &what) const
+{
+    TracePrintln(TAG, "%s", what.c_str());
+    return what.empty();
+}
 
-// long long SoapySDDC::getHardwareTime(const std::string &what) const
-// {
-//     DbgPrintf("SoapySDDC::getHardwareTime\n");
-//     return SoapySDR::ticksToTimeNs(ticks, sampleRate);
-// }
+long long SoapySDDC::getHardwareTime(const std::string &what) const
+{
+    TracePrintln(TAG, "%s", what.c_str());
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
 
 // void SoapySDDC::setHardwareTime(const long long timeNs, const std::string &what)
 // {
@@ -11,7 +11,7 @@
 class SoapySDDC : public SoapySDR::Device
 {
 public:
-    explicit SoapySDDC(uint8_t dev_index);
+    explicit SoapySDDC(uint8_t dev_index, const std::string &backend = "");
     ~SoapySDDC(void);
 
     // ----- Metadata ----- //
@@ -43,13 +43,15 @@ public:
 
     int readStream(SoapySDR::Stream *stream, void *const *buffs, const size_t numElems, int &flags, long long &timeNs, const long timeoutUs = 100000) override;
 
-    // size_t getNumDirectAccessBuffers(SoapySDR::Stream *stream);
+    size_t getNumDirectAccessBuffers(SoapySDR::Stream *stream) override;
 
-    // int getDirectAccessBufferAddrs(SoapySDR::Stream *stream, const size_t handle, void **buffs);
+    int getDirectAccessBufferAddrs(SoapySDR::Stream *stream, const size_t handle, void **buffs) override;
 
     int acquireReadBuffer(SoapySDR::Stream *stream, size_t &handle, const void **buffs, int &flags, long long &timeNs, const long timeoutUs = 100000) override;
 
     void releaseReadBuffer(SoapySDR::Stream *stream, const size_t handle) override;
+
+    int readStreamStatus(SoapySDR::Stream *stream, size_t &chanMask, int &flags, long long &timeNs, const long timeoutUs = 100000) override;
     // ----- //
 
     // ----- Antennas ----- //
@@ -117,15 +119,17 @@ public:
 
     // std::string getTimeSource(void) const;
 
-    // bool hasHardwareTime(const std::string &what = "") const;
+    bool hasHardwareTime(const std::string &what = "") const override;
 
-    // long long getHardwareTime(const std::string &what = "") const;
+    long long getHardwareTime(const std::string &what = "") const override;
 
     // void setHardwareTime(const long long timeNs, const std::string &what = "");
 
 private:
     int deviceId;
     int bytesPerSample;
+    bool rawStream;     // S16 stream of the ADC samples, the r2iq conversion is off
+    double sampleRate;  // last setSampleRate, in stream elements: applied again by setupStream, 0 if none
 
     uint64_t centerFrequency;
     size_t numBuffers, bufferLength, asyncBuffs;
@@ -134,22 +138,17 @@ private:
     fx3class *Fx3;
     RadioHandler *radio_handler;
 
-public:
-    void Callback(const sddc_complex_t *data, uint32_t len);
-
-    std::mutex _buf_mutex;
-    std::condition_variable _buf_cond;
-
-    std::vector<std::vector<uint8_t>> samples_buffer;
-    size_t samples_block_write;
-    size_t samples_block_read;
-    std::atomic<size_t> _buf_count;
-    char *_currentBuff;
-    std::atomic<bool> _overflowEvent;
+    // The samples are taken from the ring buffer of RadioHandler in pull mode:
+    // acquireReadBuffer gives a block of the ring, readStream copies it once
+    const char *_currentBuff;
     size_t bufferedElems;
+    long long _currentTime;     // of the next element of _currentBuff
+    double nsPerElem;
     size_t _currentHandle;
-    bool resetBuffer;
+    int overflowCount;          // RadioHandler::GetPullOverflowCount when the last overflow was reported
+    std::atomic<int> statusOverflowCount;   // the same for readStreamStatus, polled by another thread
 
+public:
     int samplerateidx;
 
     double masterClockRate;
@@ -5,17 +5,65 @@
 #include <SoapySDR/Formats.hpp>
 
 #include <SoapySDR/Time.hpp>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
+#include <thread>
 #include "SoapySDDC.hpp"
+#include "thread_config.h"
+#include "r2iq_pool.h"
 
 #define TAG "SoapySDDC_Streaming"
 
+// Stream args prefix of the threads that can be tuned: <prefix>_priority and <prefix>_cpus
+static const struct {
+    const char *prefix;
+    const char *name;
+    sddc_thread_role_t role;
+} thread_args[] = {
+    { "usb",      "USB thread",      SDDC_THREAD_USB },
+    { "r2iq",     "r2iq thread",     SDDC_THREAD_R2IQ },
+};
+
+// Integer stream arg in [min, max], `value` when it is not given
+static uint32_t parseIntArg(const SoapySDR::Kwargs &args, const std::string &key, uint32_t value, long long min, long long max)
+{
+    auto it = args.find(key);
+    if (it == args.end())
+        return value;
+
+    size_t end = 0;
+    long long parsed = 0;
+    try { parsed = std::stoll(it->second, &end); }
+    catch (const std::exception &) { end = 0; }
+
+    if (end == 0 || end != it->second.size() || parsed < min || parsed > max)
+        throw std::runtime_error("setupStream failed: invalid " + key + "=" + it->second +
+            " (" + std::to_string(min) + " to " + std::to_string(max) + ")");
+    return (uint32_t)parsed;
+}
+
+static bool parseBoolArg(const SoapySDR::Kwargs &args, const std::string &key, bool value)
+{
+    auto it = args.find(key);
+    if (it == args.end())
+        return value;
+
+    if (it->second == "true" || it->second == "1")
+        return true;
+    if (it->second == "false" || it->second == "0")
+        return false;
+    throw std::runtime_error("setupStream failed: invalid " + key + "=" + it->second + " (true or false)");
+}
+
 std::vector<std::string> SoapySDDC::getStreamFormats(const int, const size_t) const
 {
     TracePrintln(TAG, "*, *");
     std::vector<std::string> formats;
     formats.push_back(SOAPY_SDR_CF32);
+    formats.push_back(SOAPY_SDR_CS16);
+    formats.push_back(SOAPY_SDR_CS8);
+    formats.push_back(SOAPY_SDR_S16);
     return formats;
 }
 
@@ -31,13 +79,116 @@ SoapySDR::ArgInfoList SoapySDDC::getStreamArgsInfo(const int, const size_t) cons
     TracePrintln(TAG, "*, *");
 
     SoapySDR::ArgInfoList streamArgs;
+    const sddc_stream_config_t defaults = RadioHandler::GetDefaultStreamConfig();
+
+    SoapySDR::ArgInfo buffersArg;
+    buffersArg.key = "buffers";
+    buffersArg.value = std::to_string(defaults.ring_blocks);
+    buffersArg.name = "Ring buffers";
+    buffersArg.description = "Number of blocks in the sample ring buffers.";
+    buffersArg.units = "blocks";
+    buffersArg.type = SoapySDR::ArgInfo::INT;
+    buffersArg.range = SoapySDR::Range(MIN_RING_BLOCKS, MAX_RING_BLOCKS);
+    streamArgs.push_back(buffersArg);
+
+    SoapySDR::ArgInfo transferSizeArg;
+    transferSizeArg.key = "transfer_size";
+    transferSizeArg.value = std::to_string(defaults.transfer_size);
+    transferSizeArg.name = "USB transfer size";
+    transferSizeArg.description = "Size of one USB bulk transfer, a multiple of 16384 bytes at USB 3. The stream MTU is a quarter of it (half of it with S16).";
+    transferSizeArg.units = "bytes";
+    transferSizeArg.type = SoapySDR::ArgInfo::INT;
+    transferSizeArg.range = SoapySDR::Range(16384, MAX_TRANSFER_SIZE, 16384);
+    streamArgs.push_back(transferSizeArg);
+
+    SoapySDR::ArgInfo mtuArg;
+    mtuArg.key = "mtu";
+    mtuArg.value = std::to_string(defaults.transfer_size / sizeof(int16_t) / 2);
+    mtuArg.name = "Buffer length";
+    mtuArg.description = "Samples per buffer (stream MTU), sets transfer_size: 4096 multiples with CF32/CS16/CS8, 8192 with S16. Smaller is lower latency, larger is less overhead.";
+    mtuArg.units = "samples";
+    mtuArg.type = SoapySDR::ArgInfo::INT;
+    mtuArg.range = SoapySDR::Range(4096, MAX_TRANSFER_SIZE / sizeof(int16_t), 4096);
+    streamArgs.push_back(mtuArg);
+
+    SoapySDR::ArgInfo transfersArg;
+    transfersArg.key = "transfers";
+    transfersArg.value = std::to_string(defaults.concurrent_transfers);
+    transfersArg.name = "USB transfers";
+    transfersArg.description = "Number of USB transfers kept in flight (starting point when max_transfers is set).";
+    transfersArg.type = SoapySDR::ArgInfo::INT;
+    transfersArg.range = SoapySDR::Range(1, MAX_CONCURRENT_TRANSFERS);
+    streamArgs.push_back(transfersArg);
+
+    SoapySDR::ArgInfo maxTransfersArg;
+    maxTransfersArg.key = "max_transfers";
+    maxTransfersArg.value = std::to_string(defaults.max_concurrent_transfers);
+    maxTransfersArg.name = "Max USB transfers";
+    maxTransfersArg.description = "The number of transfers in flight adapts to the USB completion jitter up to this value. 0 keeps it fixed.";
+    maxTransfersArg.type = SoapySDR::ArgInfo::INT;
+    maxTransfersArg.range = SoapySDR::Range(0, MAX_CONCURRENT_TRANSFERS);
+    streamArgs.push_back(maxTransfersArg);
+
+    SoapySDR::ArgInfo sharedArg;
+    sharedArg.key = "shared_r2iq";
+    sharedArg.value = "false";
+    sharedArg.name = "Shared r2iq workers";
+    sharedArg.description = "Convert the samples on one pool of workers shared by all the devices of the process, instead of a thread per device. Useful with several devices.";
+    sharedArg.type = SoapySDR::ArgInfo::BOOL;
+    streamArgs.push_back(sharedArg);
+
+    SoapySDR::ArgInfo r2iqThreadsArg;
+    r2iqThreadsArg.key = "r2iq_threads";
+    r2iqThreadsArg.value = "0";
+    r2iqThreadsArg.name = "Shared r2iq worker count";
+    r2iqThreadsArg.description = "Number of workers of the shared pool, needs shared_r2iq=true, 0 for one per core. Applied when the pool starts with the first device streaming. A stream is always converted by one thread at a time.";
+    r2iqThreadsArg.type = SoapySDR::ArgInfo::INT;
+    r2iqThreadsArg.range = SoapySDR::Range(0, MAX_R2IQ_WORKERS);
+    streamArgs.push_back(r2iqThreadsArg);
+
+    SoapySDR::ArgInfo scaleArg;
+    scaleArg.key = "scale";
+    scaleArg.value = "0";
+    scaleArg.name = "Integer scale";
+    scaleArg.description = "CS16 and CS8 formats: factor applied to the float samples before rounding. 0 maps 1.0 to the largest integer.";
+    scaleArg.type = SoapySDR::ArgInfo::FLOAT;
+    streamArgs.push_back(scaleArg);
+
+    SoapySDR::ArgInfo ditherArg;
+    ditherArg.key = "dither";
+    ditherArg.value = "false";
+    ditherArg.name = "Dither";
+    ditherArg.description = "CS16 and CS8 formats: add a triangular dither of +-1 LSB before rounding.";
+    ditherArg.type = SoapySDR::ArgInfo::BOOL;
+    streamArgs.push_back(ditherArg);
+
+    for (const auto &thread : thread_args)
+    {
+        SoapySDR::ArgInfo priorityArg;
+        priorityArg.key = std::string(thread.prefix) + "_priority";
+        priorityArg.value = "0";
+        priorityArg.name = std::string(thread.name) + " priority";
+        priorityArg.description = "SCHED_FIFO priority of the thread, 0 for the default scheduler.";
+        priorityArg.type = SoapySDR::ArgInfo::INT;
+        priorityArg.range = SoapySDR::Range(0, SDDC_THREAD_MAX_PRIORITY);
+        streamArgs.push_back(priorityArg);
+
+        SoapySDR::ArgInfo cpusArg;
+        cpusArg.key = std::string(thread.prefix) + "_cpus";
+        cpusArg.value = "";
+        cpusArg.name = std::string(thread.name) + " CPUs";
+        cpusArg.description = "CPUs the thread is pinned to, e.g. 2 or 2-3,6. Empty for no restriction.";
+        cpusArg.type = SoapySDR::ArgInfo::STRING;
+        streamArgs.push_back(cpusArg);
+    }
+
     return streamArgs;
 }
 
 SoapySDR::Stream *SoapySDDC::setupStream(const int direction,
                                          const std::string &format,
                                          const std::vector<size_t> &channels,
-                                         const SoapySDR::Kwargs&)
+                                         const SoapySDR::Kwargs &args)
 {
     TracePrintln(TAG, "%d, %s, *, *", direction, format.c_str());
 
@@ -46,36 +197,124 @@ SoapySDR::Stream *SoapySDDC::setupStream(const int direction,
     if (channels.size() != 1)
         throw std::runtime_error("setupStream failed: SDDC only supports one channel");
     
+    // The integer formats are converted once by the driver, right after r2iq
+    sddc_iq_format_t iqFormat = SDDC_IQ_CF32;
+    rawStream = false;
     if (format == SOAPY_SDR_CF32)
     {
         SoapySDR_logf(SOAPY_SDR_INFO, "Using format CF32.");
     }
+    else if (format == SOAPY_SDR_CS16)
+    {
+        SoapySDR_logf(SOAPY_SDR_INFO, "Using format CS16.");
+        iqFormat = SDDC_IQ_CS16;
+    }
+    else if (format == SOAPY_SDR_CS8)
+    {
+        SoapySDR_logf(SOAPY_SDR_INFO, "Using format CS8.");
+        iqFormat = SDDC_IQ_CS8;
+    }
+    else if (format == SOAPY_SDR_S16)
+    {
+        // The sample rate is then the ADC one
+        SoapySDR_logf(SOAPY_SDR_INFO, "Using format S16: raw ADC samples, no IQ conversion.");
+        rawStream = true;
+    }
     else
     {
-        throw std::runtime_error("setupStream failed: SDDC only supports CF32.");
+        throw std::runtime_error("setupStream failed: SDDC only supports CF32, CS16, CS8 and S16.");
     }
 
-    // FIXME : The size of the buffers should be aligned directly on the size
-    // of the output IQ buffer
-    bytesPerSample = sizeof(sddc_complex_t);
-    bufferLength = transferSamples / 2;
+    // Everything is checked before anything is applied
+    const SoapySDR::ArgInfoList argsInfo = getStreamArgsInfo(direction, channels[0]);
+    for (const auto &arg : args)
+    {
+        bool known = false;
+        for (const auto &info : argsInfo)
+            known = known || info.key == arg.first;
+        if (!known)
+            SoapySDR_logf(SOAPY_SDR_WARNING, "setupStream: unknown stream arg %s", arg.first.c_str());
+    }
 
-    DebugPrintln(TAG, "CF32 element size : %ld", SoapySDR::formatToSize(SOAPY_SDR_CF32));
-    DebugPrintln(TAG, "Bytes per sample : %d", bytesPerSample);
-    DebugPrintln(TAG, "Input buffer size : %ld (%ld bytes)", bufferLength, bufferLength * bytesPerSample);
+    float scale = 0;
+    if (args.count("scale"))
+    {
+        size_t end = 0;
+        try { scale = std::stof(args.at("scale"), &end); }
+        catch (const std::exception &) { end = 0; }
+        if (end == 0 || end != args.at("scale").size())
+            throw std::runtime_error("setupStream failed: invalid scale=" + args.at("scale"));
+    }
+    const bool dither = parseBoolArg(args, "dither", false);
+
+    sddc_stream_config_t config = radio_handler->GetStreamConfig();
+    config.ring_blocks = parseIntArg(args, "buffers", config.ring_blocks, MIN_RING_BLOCKS, MAX_RING_BLOCKS);
+    config.transfer_size = parseIntArg(args, "transfer_size", config.transfer_size, 1, MAX_TRANSFER_SIZE);
+    config.concurrent_transfers = parseIntArg(args, "transfers", config.concurrent_transfers, 1, MAX_CONCURRENT_TRANSFERS);
+    config.max_concurrent_transfers = parseIntArg(args, "max_transfers", config.max_concurrent_transfers, 0, MAX_CONCURRENT_TRANSFERS);
+
+    // One buffer is one USB transfer: 2 ADC samples per IQ element, one per S16 element
+    const uint32_t bytesPerElem = sizeof(int16_t) * (rawStream ? 1 : 2);
+    if (args.count("mtu"))
+    {
+        const uint32_t mtu = parseIntArg(args, "mtu", 0, 1, MAX_TRANSFER_SIZE / bytesPerElem);
+        if (args.count("transfer_size") && mtu * bytesPerElem != config.transfer_size)
+            throw std::runtime_error("setupStream failed: mtu and transfer_size disagree");
+        config.transfer_size = mtu * bytesPerElem;
+    }
+
+    sddc_thread_config_t threadConfigs[sizeof(thread_args) / sizeof(thread_args[0])];
+    for (size_t i = 0; i < sizeof(thread_args) / sizeof(thread_args[0]); i++)
+    {
+        const auto &thread = thread_args[i];
+        const std::string priority_key = std::string(thread.prefix) + "_priority";
+        const std::string cpus_key = std::string(thread.prefix) + "_cpus";
+
+        threadConfigs[i] = radio_handler->GetThreadConfig(thread.role);
+        threadConfigs[i].priority = parseIntArg(args, priority_key, threadConfigs[i].priority, 0, SDDC_THREAD_MAX_PRIORITY);
+        if (args.count(cpus_key) && !sddc_parse_cpu_list(args.at(cpus_key).c_str(), &threadConfigs[i].cpu_mask))
+            throw std::runtime_error("setupStream failed: invalid CPU list for " + cpus_key);
+    }
+
+    const bool shared = parseBoolArg(args, "shared_r2iq", radio_handler->GetSharedProcessing());
+    const uint32_t r2iqThreads = parseIntArg(args, "r2iq_threads", 0, 0, MAX_R2IQ_WORKERS);
+    if (args.count("r2iq_threads") && !shared)
+        throw std::runtime_error("setupStream failed: r2iq_threads needs shared_r2iq=true");
+
+    if (radio_handler->SetIQFormat(iqFormat, scale, dither) != ERR_SUCCESS)
+        throw std::runtime_error("setupStream failed: invalid scale, or the stream is running");
+
+    if (radio_handler->SetStreamConfig(config) != ERR_SUCCESS)
+        throw std::runtime_error("setupStream failed: invalid buffers/transfer_size/mtu/transfers/max_transfers, see the log");
+
+    // The rate asked for was in elements of the stream, now of a known format
+    if (sampleRate > 0)
+        radio_handler->SetADCSampleRate(rawStream ? sampleRate : sampleRate * 2);
+
+    for (size_t i = 0; i < sizeof(thread_args) / sizeof(thread_args[0]); i++)
+    {
+        if (radio_handler->SetThreadConfig(thread_args[i].role, threadConfigs[i]) != ERR_SUCCESS)
+            throw std::runtime_error(std::string("setupStream failed: invalid ") + thread_args[i].prefix + "_priority");
+    }
+
+    radio_handler->SetSharedProcessing(shared);
+    if (args.count("r2iq_threads"))
+    {
+        r2iq_pool::Get().SetWorkerCount(r2iqThreads);
+        if (r2iq_pool::Get().StreamCount() > 0)
+            SoapySDR_logf(SOAPY_SDR_WARNING, "setupStream: the shared r2iq workers are running for another device, r2iq_threads applies once they all stopped");
+    }
 
-    samples_block_write = 0;
-    samples_block_read  = 0;
-    _buf_count = 0;
+    numBuffers = config.ring_blocks;
 
-    // allocate buffers
-    samples_buffer.resize(numBuffers);
-    for (auto &buff : samples_buffer)
-        buff.reserve(bufferLength * bytesPerSample);
-    for (auto &buff : samples_buffer)
-        buff.resize(bufferLength * bytesPerSample);
+    // One element per block of the core
+    bytesPerSample = rawStream ? sizeof(int16_t) : iq_quantizer::SampleSize(iqFormat);
+    bufferLength = config.transfer_size / sizeof(int16_t) / (rawStream ? 1 : 2);
+
+    DebugPrintln(TAG, "%s element size : %ld", format.c_str(), SoapySDR::formatToSize(format));
+    DebugPrintln(TAG, "Bytes per sample : %d", bytesPerSample);
+    DebugPrintln(TAG, "Input buffer size : %ld (%ld bytes)", bufferLength, bufferLength * bytesPerSample);
 
-    // std::this_thread::sleep_for(std::chrono::milliseconds(1000));
     return (SoapySDR::Stream *)this;
 }
 
@@ -97,9 +336,12 @@ int SoapySDDC::activateStream(SoapySDR::Stream*,
                               const size_t)
 {
     TracePrintln(TAG, "*, *, *, *");
-    resetBuffer = true;
     bufferedElems = 0;
-    radio_handler->Start(true);
+    overflowCount = radio_handler->GetPullOverflowCount();
+    statusOverflowCount = overflowCount;
+    // the stream is not decimated: one element every 2 ADC samples, or every one when raw
+    nsPerElem = (rawStream ? 1.0e9 : 2.0e9) / radio_handler->GetADCSampleRate();
+    radio_handler->Start(!rawStream);
 
     return 0;
 }
@@ -110,6 +352,7 @@ int SoapySDDC::deactivateStream(SoapySDR::Stream*,
 {
     TracePrintln(TAG, "*, *, *");
     radio_handler->Stop();
+    bufferedElems = 0;
     return 0;
 }
 
@@ -125,20 +368,27 @@ int SoapySDDC::readStream(SoapySDR::Stream *stream,
     void *buffer_channel0 = buffs[0];
     if (bufferedElems == 0)
     {
-        int ret = this->acquireReadBuffer(stream, _currentHandle, (const void **)&_currentBuff, flags, timeNs, timeoutUs);
+        int ret = this->acquireReadBuffer(stream, _currentHandle, (const void **)&_currentBuff, flags, _currentTime, timeoutUs);
         if (ret < 0)
             return ret;
         bufferedElems = ret;
     }
+    else
+    {
+        flags = _currentTime != 0 ? SOAPY_SDR_HAS_TIME : 0;
+    }
+    timeNs = _currentTime;
 
     size_t returnedElems = std::min(bufferedElems, numElems);
 
-    // convert into user's buffer for channel 0
+    // the only copy, from the ring buffer into user's buffer for channel 0
     std::memcpy(buffer_channel0, _currentBuff, returnedElems * bytesPerSample);
 
     // bump variables for next call into readStream
     bufferedElems -= returnedElems;
     _currentBuff += returnedElems * bytesPerSample;
+    if (_currentTime != 0)
+        _currentTime += (long long)(returnedElems * nsPerElem);
 
     // return number of elements written to buff0
     if (bufferedElems != 0)
@@ -148,53 +398,109 @@ int SoapySDDC::readStream(SoapySDR::Stream *stream,
     return returnedElems;
 }
 
+size_t SoapySDDC::getNumDirectAccessBuffers(SoapySDR::Stream*)
+{
+    TracePrintln(TAG, "*");
+    return radio_handler->GetPullBlockCount();
+}
+
+int SoapySDDC::getDirectAccessBufferAddrs(SoapySDR::Stream*, const size_t handle, void **buffs)
+{
+    TracePrintln(TAG, "*, %ld, %p", handle, buffs);
+
+    // The blocks of the ring buffer, in the format of the stream (see RadioHandler::SetIQFormat)
+    const void *block = radio_handler->GetPullBlock(handle, !rawStream);
+    if (block == nullptr)
+        return SOAPY_SDR_NOT_SUPPORTED;
+
+    buffs[0] = (void *)block;
+    return 0;
+}
+
 int SoapySDDC::acquireReadBuffer(SoapySDR::Stream*,
                                  size_t &handle,
                                  const void **buffs,
                                  int &flags,
-                                 long long&,
+                                 long long &timeNs,
                                  const long timeoutUs)
 {
     TraceExtremePrintln(TAG, "*, %ld, %p, *, *, %ld", handle, buffs, timeoutUs);
 
-    if (resetBuffer)
+    // One block at a time: the next one comes once this one is released
+    if (radio_handler->GetPullBlockIndex() >= 0)
     {
-        samples_block_read = (samples_block_read + _buf_count.exchange(0)) % numBuffers;
-        resetBuffer = false;
-        _overflowEvent = false;
+        SoapySDR_logf(SOAPY_SDR_ERROR, "acquireReadBuffer: release the previous buffer first");
+        return SOAPY_SDR_STREAM_ERROR;
     }
 
-    if (_overflowEvent)
+    // The ring was full since the last block: samples were dropped
+    const int overflows = radio_handler->GetPullOverflowCount();
+    if (overflows != overflowCount)
     {
-        samples_block_read = (samples_block_read + _buf_count.exchange(0)) % numBuffers;
-        _overflowEvent = false;
+        overflowCount = overflows;
         SoapySDR::log(SOAPY_SDR_SSI, "O");
         return SOAPY_SDR_OVERFLOW;
     }
-    // wait for a buffer to become available
-    if (_buf_count == 0)
-    {
-        std::unique_lock<std::mutex> lock(_buf_mutex);
-        _buf_cond.wait_for(lock, std::chrono::microseconds(timeoutUs), [this]
-                           { return _buf_count != 0; });
-        if (_buf_count == 0)
-            return SOAPY_SDR_TIMEOUT;
-    }
-    // extract handle and buffer
-    handle = samples_block_read;
-    samples_block_read = (samples_block_read + 1) % numBuffers;
 
-    buffs[0] = (void *)samples_buffer[handle].data();
-    flags = 0;
+    const void *block;
+    uint32_t length;
+    int64_t timestamp;
+    const uint32_t timeout_ms = (timeoutUs + 999) / 1000;
+    sddc_err_t ret = rawStream ?
+        radio_handler->AcquireReal((const int16_t **)&block, &length, &timestamp, timeout_ms) :
+        radio_handler->AcquireIQ((const sddc_complex_t **)&block, &length, &timestamp, timeout_ms);
+
+    if (ret == ERR_TIMEOUT)
+        return SOAPY_SDR_TIMEOUT;
+    if (ret != ERR_SUCCESS)
+        return SOAPY_SDR_STREAM_ERROR;
+
+    handle = radio_handler->GetPullBlockIndex();
+    buffs[0] = block;
+    timeNs = timestamp;
+    flags = timeNs != 0 ? SOAPY_SDR_HAS_TIME : 0;
 
     // return number available
-    return samples_buffer[handle].size() / bytesPerSample;
+    return length;
 }
 
 void SoapySDDC::releaseReadBuffer(SoapySDR::Stream*,
                                   const size_t)
 {
     TraceExtremePrintln(TAG, "*, *");
-    std::lock_guard<std::mutex> lock(_buf_mutex);
-    _buf_count--;
-}
\ No newline at end of file
+    if (rawStream)
+        radio_handler->ReleaseReal();
+    else
+        radio_handler->ReleaseIQ();
+}
+
+int SoapySDDC::readStreamStatus(SoapySDR::Stream*,
+                                size_t &chanMask,
+                                int &flags,
+                                long long &timeNs,
+                                const long timeoutUs)
+{
+    TraceExtremePrintln(TAG, "*, *, *, *, %ld", timeoutUs);
+
+    // The ring buffer counts the overflows without waking anybody up: polled,
+    // so that the stream does not pay for a status reader
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeoutUs);
+    while (true)
+    {
+        int64_t timestamp;
+        const int overflows = radio_handler->GetPullOverflowCount(&timestamp);
+        if (overflows != statusOverflowCount)
+        {
+            statusOverflowCount = overflows;
+            chanMask = 1;
+            timeNs = timestamp;
+            flags = timeNs != 0 ? SOAPY_SDR_HAS_TIME : 0;
+            return SOAPY_SDR_OVERFLOW;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+            return SOAPY_SDR_TIMEOUT;
+        std::this_thread::sleep_until(std::min(deadline, now + std::chrono::milliseconds(5)));
+    }
+}
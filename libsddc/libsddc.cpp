@@ -22,8 +22,17 @@
 #include "libsddc.h"
 #include "config.h"
 #include "RadioHandler.h"
+#include "thread_config.h"
+#include "backend/backend.h"
+#include "dsp/quantize.h"
+#include "ipc/shm_publisher.h"
+#include "net/stream_server.h"
+#include "record/recorder.h"
+#include "record/sigmf.h"
 
 #include <cstring>
+#include <mutex>
+#include <string>
 
 // libsddc handler
 struct libsddc_handler
@@ -32,16 +41,100 @@ struct libsddc_handler
 
 	sddc_read_async_cb_t callback;
 	void *callback_context;
+	sddc_read_real_async_cb_t real_callback;
+	void *real_callback_context;
+	bool raw_mode;
+	bool pull_mode;			// as set by sddc_start_streaming
+	int64_t timestamp;		// of the block being delivered
+
+	// geometry requested before sddc_init
+	bool has_stream_config;
+	sddc_stream_config_t stream_config;
+
+	// thread scheduling, kept here so it can be set before sddc_init
+	sddc_thread_config_t thread_config[SDDC_THREAD_ROLE_COUNT];
+	bool shared_processing;
+
+	// backend requested before sddc_init, empty for the default one
+	std::string backend;
+
+	// recording, fed by the stream callbacks: raw file or SigMF, one at a time
+	std::mutex record_mutex;
+	recorder* record;
+	sigmf_writer* sigmf;
+	sddc_record_stats_t record_stats;	// of the last recording
+
+	// network server, takes the samples in pull mode
+	stream_server* server;
+	sddc_server_stats_t server_stats;	// of the last server
+
+	// shared memory ring, fed by the stream callbacks
+	std::mutex shm_mutex;
+	shm_publisher* shm;
+	sddc_shm_stats_t shm_stats;		// of the last ring
 };
 
-static void Callback(void* context, const sddc_complex_t* data, uint32_t len)
+static void Record(libsddc_handler_t t, const void* data, size_t size, int64_t timestamp)
+{
+	std::lock_guard<std::mutex> lk(t->record_mutex);
+	if(t->record)
+		t->record->Write(data, size, timestamp);
+	else if(t->sigmf)
+		t->sigmf->Write(data, size, timestamp);
+}
+
+static void Publish(libsddc_handler_t t, const void* data, size_t size, int64_t timestamp)
+{
+	std::lock_guard<std::mutex> lk(t->shm_mutex);
+	if(t->shm)
+		t->shm->Write(data, size, timestamp);
+}
+
+static sigmf_state_t SigMFState(libsddc_handler_t t)
+{
+	sigmf_state_t state;
+	state.frequency = t->radio_handler->GetCenterFrequency();
+	state.rf_gain = t->radio_handler->GetRFGain();
+	state.if_gain = t->radio_handler->GetIFGain();
+	state.rf_mode = t->radio_handler->GetRFMode();
+	return state;
+}
+
+// After a retune or a gain change, starts a segment of the SigMF recording
+static void UpdateSigMF(libsddc_handler_t t)
+{
+	std::lock_guard<std::mutex> lk(t->record_mutex);
+	if(t->sigmf)
+		t->sigmf->SetState(SigMFState(t));
+}
+
+static void Callback(void* context, const sddc_complex_t* data, uint32_t len, int64_t timestamp)
 {
 	const libsddc_handler_t t = static_cast<libsddc_handler_t>(context);
 
+	t->timestamp = timestamp;
+
+	const size_t size = len * iq_quantizer::SampleSize(t->radio_handler->GetIQFormat());
+	Record(t, data, size, timestamp);
+	Publish(t, data, size, timestamp);
+
 	if(t->callback)
 		t->callback(len, data, t->callback_context);
 }
 
+static void RealCallback(void* context, const int16_t* data, uint32_t len, int64_t timestamp)
+{
+	const libsddc_handler_t t = static_cast<libsddc_handler_t>(context);
+
+	t->timestamp = timestamp;
+
+	Record(t, data, len * sizeof(int16_t), timestamp);
+	Publish(t, data, len * sizeof(int16_t), timestamp);
+
+	if(t->real_callback)
+		t->real_callback(len, data, t->real_callback_context);
+}
+
 // --- "Static" functions --- //
 uint16_t sddc_get_device_count()
 {
@@ -65,20 +158,52 @@ sddc_err_t sddc_init(libsddc_handler_t t, uint8_t dev_index)
 {
 	t->radio_handler = new RadioHandler();
 
-	sddc_err_t ret = t->radio_handler->Init(dev_index);
+	sddc_err_t ret;
+	if(!t->backend.empty())
+	{
+		ret = t->radio_handler->SetBackend(t->backend.c_str());
+		if(ret != ERR_SUCCESS) return ret;
+	}
+
+	ret = t->radio_handler->Init(dev_index, t->has_stream_config ? &t->stream_config : nullptr);
 	if(ret != ERR_SUCCESS) return ret;
 
 	ret = t->radio_handler->AttachIQ(Callback, t);
 	if(ret != ERR_SUCCESS) return ret;
 
+	ret = t->radio_handler->AttachReal(RealCallback, t);
+	if(ret != ERR_SUCCESS) return ret;
+
+	for(int role = 0; role < SDDC_THREAD_ROLE_COUNT; role++)
+		t->radio_handler->SetThreadConfig((sddc_thread_role_t)role, t->thread_config[role]);
+	t->radio_handler->SetSharedProcessing(t->shared_processing);
+
 	return ERR_SUCCESS;
 }
 
 
 
 
+sddc_err_t sddc_set_backend(libsddc_handler_t t, const char *spec)
+{
+	if(t->radio_handler)
+		return ERR_BACKEND_INVALID;
+
+	// Checked now rather than at sddc_init
+	fx3class *backend = CreateFx3Backend(spec);
+	if(backend == nullptr)
+		return ERR_BACKEND_INVALID;
+	delete backend;
+
+	t->backend = spec ? spec : "";
+	return ERR_SUCCESS;
+}
+
 void sddc_destroy(libsddc_handler_t t)
 {
+	sddc_stop_recording(t);
+	sddc_stop_server(t);
+	sddc_stop_shm(t);
 	if(t->radio_handler)
 		delete t->radio_handler;
 	delete t;
@@ -103,7 +228,13 @@ uint16_t sddc_get_firmware(libsddc_handler_t t)
 // --- RF --- //
 sddc_rf_mode_t sddc_get_rf_mode(libsddc_handler_t t) { return t->radio_handler->GetRFMode(); }
 
-sddc_err_t sddc_set_rf_mode(libsddc_handler_t t, sddc_rf_mode_t rf_mode) { return t->radio_handler->SetRFMode(rf_mode); }
+sddc_err_t sddc_set_rf_mode(libsddc_handler_t t, sddc_rf_mode_t rf_mode)
+{
+	sddc_err_t ret = t->radio_handler->SetRFMode(rf_mode);
+	if(ret == ERR_SUCCESS)
+		UpdateSigMF(t);
+	return ret;
+}
 // --- //
 
 // --- LEDs --- //
@@ -164,7 +295,10 @@ sddc_err_t sddc_set_biast_vhf(libsddc_handler_t t, bool new_state)
 
 uint32_t sddc_set_center_frequency (libsddc_handler_t t, uint32_t freq)
 {
-	return t->radio_handler->SetCenterFrequency(freq);
+	sddc_err_t ret = t->radio_handler->SetCenterFrequency(freq);
+	if(ret == ERR_SUCCESS)
+		UpdateSigMF(t);
+	return ret;
 }
 
 
@@ -174,6 +308,15 @@ uint32_t sddc_get_adc_sample_rate(libsddc_handler_t t)
 }
 sddc_err_t sddc_set_adc_sample_rate(libsddc_handler_t t, uint32_t sample_rate)
 {
+	// The rate of the shared memory ring is fixed, and so is core:sample_rate
+	if(t->shm)
+		return ERR_NOT_COMPATIBLE;
+	{
+		std::lock_guard<std::mutex> lk(t->record_mutex);
+		if(t->sigmf)
+			return ERR_NOT_COMPATIBLE;
+	}
+
 	return t->radio_handler->SetADCSampleRate(sample_rate);
 }
 
@@ -185,9 +328,148 @@ sddc_err_t sddc_set_stream_callback(libsddc_handler_t t, sddc_read_async_cb_t ca
 	return ERR_SUCCESS;
 }
 
+sddc_err_t sddc_set_real_stream_callback(libsddc_handler_t t, sddc_read_real_async_cb_t callback,
+						  void *callback_context)
+{
+	t->real_callback = callback;
+	t->real_callback_context = callback_context;
+	return ERR_SUCCESS;
+}
+
+bool sddc_get_raw_mode(libsddc_handler_t t)
+{
+	return t->raw_mode;
+}
+
+sddc_err_t sddc_set_raw_mode(libsddc_handler_t t, bool raw)
+{
+	if(t->radio_handler && t->radio_handler->IsStreaming())
+		return ERR_STREAM_RUNNING;
+	if(t->server || t->shm)
+		return ERR_NOT_COMPATIBLE;
+
+	t->raw_mode = raw;
+	return ERR_SUCCESS;
+}
+
+int64_t sddc_get_stream_timestamp(libsddc_handler_t t)
+{
+	return t->timestamp;
+}
+
+sddc_err_t sddc_read_sync(libsddc_handler_t t, void *buf, uint32_t n, uint32_t *n_read,
+						  uint32_t timeout_ms)
+{
+	return t->radio_handler->ReadIQ(buf, n, n_read, &t->timestamp, timeout_ms);
+}
+
+sddc_err_t sddc_acquire_buffer(libsddc_handler_t t, const sddc_complex_t **data, uint32_t *n,
+							   uint32_t timeout_ms)
+{
+	return t->radio_handler->AcquireIQ(data, n, &t->timestamp, timeout_ms);
+}
+
+sddc_err_t sddc_release_buffer(libsddc_handler_t t)
+{
+	if(t->raw_mode)
+		return t->radio_handler->ReleaseReal();
+
+	return t->radio_handler->ReleaseIQ();
+}
+
+sddc_err_t sddc_read_sync_real(libsddc_handler_t t, int16_t *buf, uint32_t n, uint32_t *n_read,
+							   uint32_t timeout_ms)
+{
+	return t->radio_handler->ReadReal(buf, n, n_read, &t->timestamp, timeout_ms);
+}
+
+sddc_err_t sddc_acquire_real_buffer(libsddc_handler_t t, const int16_t **data, uint32_t *n,
+									uint32_t timeout_ms)
+{
+	return t->radio_handler->AcquireReal(data, n, &t->timestamp, timeout_ms);
+}
+
+sddc_err_t sddc_get_stream_config(libsddc_handler_t t, sddc_stream_config_t *config)
+{
+	if(t->radio_handler)
+		*config = t->radio_handler->GetStreamConfig();
+	else if(t->has_stream_config)
+		*config = t->stream_config;
+	else
+		*config = RadioHandler::GetDefaultStreamConfig();
+
+	return ERR_SUCCESS;
+}
+
+sddc_err_t sddc_set_stream_config(libsddc_handler_t t, const sddc_stream_config_t *config)
+{
+	if(t->radio_handler)
+		return t->radio_handler->SetStreamConfig(*config);
+
+	t->stream_config = *config;
+	t->has_stream_config = true;
+	return ERR_SUCCESS;
+}
+
+sddc_err_t sddc_get_thread_config(libsddc_handler_t t, sddc_thread_role_t role, sddc_thread_config_t *config)
+{
+	if((unsigned)role >= SDDC_THREAD_ROLE_COUNT)
+		return ERR_THREAD_CONFIG_INVALID;
+
+	*config = t->thread_config[role];
+	return ERR_SUCCESS;
+}
+
+sddc_err_t sddc_set_thread_config(libsddc_handler_t t, sddc_thread_role_t role, const sddc_thread_config_t *config)
+{
+	if(t->radio_handler)
+	{
+		sddc_err_t ret = t->radio_handler->SetThreadConfig(role, *config);
+		if(ret != ERR_SUCCESS) return ret;
+	}
+	else if((unsigned)role >= SDDC_THREAD_ROLE_COUNT || !sddc_thread_config_valid(*config))
+	{
+		return ERR_THREAD_CONFIG_INVALID;
+	}
+
+	t->thread_config[role] = *config;
+	return ERR_SUCCESS;
+}
+
+bool sddc_get_shared_processing(libsddc_handler_t t)
+{
+	return t->shared_processing;
+}
+
+sddc_err_t sddc_set_shared_processing(libsddc_handler_t t, bool shared)
+{
+	if(t->radio_handler)
+	{
+		sddc_err_t ret = t->radio_handler->SetSharedProcessing(shared);
+		if(ret != ERR_SUCCESS) return ret;
+	}
+
+	t->shared_processing = shared;
+	return ERR_SUCCESS;
+}
+
 sddc_err_t sddc_start_streaming(libsddc_handler_t t)
 {
-	return t->radio_handler->Start(/*convert_r2iq=*/true);
+	bool pull = t->raw_mode ? t->real_callback == nullptr : t->callback == nullptr;
+	{
+		std::lock_guard<std::mutex> lk(t->record_mutex);
+		pull = pull && t->record == nullptr && t->sigmf == nullptr;
+	}
+	{
+		std::lock_guard<std::mutex> lk(t->shm_mutex);
+		pull = pull && t->shm == nullptr;
+	}
+	pull = pull || t->server != nullptr;
+	sddc_err_t ret = t->radio_handler->SetPullMode(pull);
+	if(ret != ERR_SUCCESS) return ret;
+	t->pull_mode = pull;
+
+	return t->radio_handler->Start(/*convert_r2iq=*/!t->raw_mode);
 }
 
 sddc_err_t sddc_stop_streaming(libsddc_handler_t t)
@@ -195,11 +477,257 @@ sddc_err_t sddc_stop_streaming(libsddc_handler_t t)
 	return t->radio_handler->Stop();
 }
 
+uint32_t sddc_get_transfer_depth(libsddc_handler_t t)
+{
+	return t->radio_handler->getTransferDepth();
+}
+
+sddc_err_t sddc_get_stream_stats(libsddc_handler_t t, sddc_stream_stats_t *stats)
+{
+	*stats = t->radio_handler->GetStreamStats();
+	return ERR_SUCCESS;
+}
+
+sddc_err_t sddc_start_recording(libsddc_handler_t t, const char *path, const sddc_record_config_t *config)
+{
+	if(t->radio_handler && t->radio_handler->IsStreaming() && t->pull_mode)
+		return ERR_STREAM_RUNNING;
+
+	if(t->server)
+		return ERR_NOT_COMPATIBLE;
+
+	// The codec is for the raw ADC samples
+	if(config && config->encoder_threads && !t->raw_mode)
+		return ERR_FORMAT_INVALID;
+
+	std::lock_guard<std::mutex> lk(t->record_mutex);
+	if(t->record || t->sigmf)
+		return ERR_RECORD_FAILED;
+
+	recorder* record = new recorder();
+	record->SetThreadConfig(t->thread_config[SDDC_THREAD_RECORDER]);
+	record->SetEncoderThreadConfig(t->thread_config[SDDC_THREAD_ENCODER]);
+	sddc_err_t ret = record->Open(path, config);
+	if(ret != ERR_SUCCESS)
+	{
+		delete record;
+		return ret;
+	}
+
+	t->record = record;
+	return ERR_SUCCESS;
+}
+
+sddc_err_t sddc_start_sigmf_recording(libsddc_handler_t t, const char *path, const sddc_record_config_t *config)
+{
+	// The metadata comes from the device, open by sddc_init
+	if(!t->radio_handler)
+		return ERR_RECORD_FAILED;
+	if(t->radio_handler->IsStreaming() && t->pull_mode)
+		return ERR_STREAM_RUNNING;
+	if(t->server)
+		return ERR_NOT_COMPATIBLE;
+
+	sigmf_global_t global;
+	global.adc_sample_rate = t->radio_handler->GetADCSampleRate();
+	global.hardware = t->radio_handler->getHardwareName();
+	global.firmware = t->radio_handler->GetHardwareFirmware();
+	if(t->raw_mode)
+	{
+		global.datatype = "ri16_le";
+		global.sample_size = sizeof(int16_t);
+		global.sample_rate = global.adc_sample_rate;
+	}
+	else
+	{
+		sddc_iq_format_t format = t->radio_handler->GetIQFormat();
+		global.datatype = format == SDDC_IQ_CS16 ? "ci16_le" : format == SDDC_IQ_CS8 ? "ci8" : "cf32_le";
+		global.sample_size = iq_quantizer::SampleSize(format);
+		global.sample_rate = t->radio_handler->GetIQSampleRate();
+	}
+
+	std::lock_guard<std::mutex> lk(t->record_mutex);
+	if(t->record || t->sigmf)
+		return ERR_RECORD_FAILED;
+
+	sigmf_writer* sigmf = new sigmf_writer();
+	sigmf->SetThreadConfig(t->thread_config[SDDC_THREAD_RECORDER]);
+	sddc_err_t ret = sigmf->Open(path, global, SigMFState(t), config);
+	if(ret != ERR_SUCCESS)
+	{
+		delete sigmf;
+		return ret;
+	}
+
+	t->sigmf = sigmf;
+	return ERR_SUCCESS;
+}
+
+sddc_err_t sddc_stop_recording(libsddc_handler_t t)
+{
+	recorder* record;
+	sigmf_writer* sigmf;
+	{
+		std::lock_guard<std::mutex> lk(t->record_mutex);
+		record = t->record;
+		sigmf = t->sigmf;
+		t->record = nullptr;
+		t->sigmf = nullptr;
+	}
+
+	// Outside the lock: the stream goes on while the last chunks are written
+	sddc_err_t ret = ERR_SUCCESS;
+	if(record)
+	{
+		ret = record->Close();
+		t->record_stats = record->GetStats();
+		delete record;
+	}
+	else if(sigmf)
+	{
+		ret = sigmf->Close();
+		t->record_stats = sigmf->GetStats();
+		delete sigmf;
+	}
+	return ret;
+}
+
+sddc_err_t sddc_get_record_stats(libsddc_handler_t t, sddc_record_stats_t *stats)
+{
+	std::lock_guard<std::mutex> lk(t->record_mutex);
+	*stats = t->record ? t->record->GetStats() : t->sigmf ? t->sigmf->GetStats() : t->record_stats;
+	return ERR_SUCCESS;
+}
+
+sddc_err_t sddc_start_server(libsddc_handler_t t, const sddc_server_config_t *config)
+{
+	// Nothing to serve before sddc_init
+	if(t->server || !t->radio_handler)
+		return ERR_SERVER_FAILED;
+	if(t->radio_handler->IsStreaming())
+		return ERR_STREAM_RUNNING;
+	{
+		std::lock_guard<std::mutex> lk(t->record_mutex);
+		if(t->record || t->sigmf)
+			return ERR_NOT_COMPATIBLE;
+	}
+
+	if(t->shm)
+		return ERR_NOT_COMPATIBLE;
+
+	stream_server* server = new stream_server(*t->radio_handler);
+	server->SetThreadConfig(t->thread_config[SDDC_THREAD_SERVER], t->thread_config[SDDC_THREAD_CLIENT]);
+	sddc_err_t ret = server->Start(config, t->raw_mode);
+	if(ret != ERR_SUCCESS)
+	{
+		delete server;
+		return ret;
+	}
+
+	t->server = server;
+	return ERR_SUCCESS;
+}
+
+sddc_err_t sddc_stop_server(libsddc_handler_t t)
+{
+	if(t->server)
+	{
+		t->server->Stop();
+		t->server_stats = t->server->GetStats();
+		delete t->server;
+		t->server = nullptr;
+	}
+	return ERR_SUCCESS;
+}
+
+sddc_err_t sddc_get_server_stats(libsddc_handler_t t, sddc_server_stats_t *stats)
+{
+	*stats = t->server ? t->server->GetStats() : t->server_stats;
+	return ERR_SUCCESS;
+}
+
+sddc_err_t sddc_start_shm(libsddc_handler_t t, const char *name, const sddc_shm_config_t *config)
+{
+	// The ring describes the stream of the device, open by sddc_init
+	if(!t->radio_handler)
+		return ERR_SHM_FAILED;
+	if(t->radio_handler->IsStreaming() && t->pull_mode)
+		return ERR_STREAM_RUNNING;
+	if(t->server)
+		return ERR_NOT_COMPATIBLE;
+
+	shm_stream_t stream;
+	stream.raw = t->raw_mode;
+	stream.iq_format = t->radio_handler->GetIQFormat();
+	stream.adc_sample_rate = t->radio_handler->GetADCSampleRate();
+	if(t->raw_mode)
+	{
+		stream.sample_size = sizeof(int16_t);
+		stream.sample_rate = stream.adc_sample_rate;
+	}
+	else
+	{
+		stream.sample_size = iq_quantizer::SampleSize(stream.iq_format);
+		stream.sample_rate = t->radio_handler->GetIQSampleRate();
+	}
+
+	std::lock_guard<std::mutex> lk(t->shm_mutex);
+	if(t->shm)
+		return ERR_SHM_FAILED;
+
+	shm_publisher* shm = new shm_publisher();
+	sddc_err_t ret = shm->Open(name, config, stream);
+	if(ret != ERR_SUCCESS)
+	{
+		delete shm;
+		return ret;
+	}
+
+	t->shm = shm;
+	return ERR_SUCCESS;
+}
+
+sddc_err_t sddc_stop_shm(libsddc_handler_t t)
+{
+	std::lock_guard<std::mutex> lk(t->shm_mutex);
+	if(t->shm)
+	{
+		t->shm_stats = t->shm->GetStats();
+		delete t->shm;
+		t->shm = nullptr;
+	}
+	return ERR_SUCCESS;
+}
+
+sddc_err_t sddc_get_shm_stats(libsddc_handler_t t, sddc_shm_stats_t *stats)
+{
+	std::lock_guard<std::mutex> lk(t->shm_mutex);
+	*stats = t->shm ? t->shm->GetStats() : t->shm_stats;
+	return ERR_SUCCESS;
+}
+
 sddc_err_t sddc_set_decimation(libsddc_handler_t t, uint8_t decimate)
 {
+	if(t->shm)
+		return ERR_NOT_COMPATIBLE;
+	{
+		std::lock_guard<std::mutex> lk(t->record_mutex);
+		if(t->sigmf)
+			return ERR_NOT_COMPATIBLE;
+	}
+
 	return t->radio_handler->SetDecimation(decimate);
 }
 
+sddc_err_t sddc_set_iq_format(libsddc_handler_t t, sddc_iq_format_t format, float scale, bool dither)
+{
+	// The server converts the samples itself, and the format of the ring is fixed
+	if(t->server || t->shm)
+		return ERR_NOT_COMPATIBLE;
+
+	return t->radio_handler->SetIQFormat(format, scale, dither);
+}
+
 
 int sddc_get_rf_gain_steps(libsddc_handler_t t, const float** s)
 {
@@ -212,7 +740,10 @@ int sddc_get_rf_gain_steps(libsddc_handler_t t, const float** s)
 }
 sddc_err_t sddc_set_rf_gain(libsddc_handler_t t, float gain)
 {
-	return t->radio_handler->SetRFGain(gain);
+	sddc_err_t ret = t->radio_handler->SetRFGain(gain);
+	if(ret == ERR_SUCCESS)
+		UpdateSigMF(t);
+	return ret;
 }
 
 int sddc_get_if_gain_steps(libsddc_handler_t t, const float** s)
@@ -226,5 +757,8 @@ int sddc_get_if_gain_steps(libsddc_handler_t t, const float** s)
 }
 sddc_err_t sddc_set_if_gain(libsddc_handler_t t, float gain)
 {
-	return t->radio_handler->SetIFGain(gain);
+	sddc_err_t ret = t->radio_handler->SetIFGain(gain);
+	if(ret == ERR_SUCCESS)
+		UpdateSigMF(t);
+	return ret;
 }
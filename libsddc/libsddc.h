@@ -40,6 +40,9 @@ sddc_err_t sddc_get_device(uint8_t dev_index, struct sddc_device_t *dev);
 
 typedef void (*sddc_read_async_cb_t)(uint32_t data_size, const sddc_complex_t *data,
 										void *context);
+// Raw ADC samples, see sddc_set_raw_mode
+typedef void (*sddc_read_real_async_cb_t)(uint32_t data_size, const int16_t *data,
+										void *context);
 
 typedef struct libsddc_handler* libsddc_handler_t;
 
@@ -48,6 +51,11 @@ libsddc_handler_t sddc_create();
 sddc_err_t	sddc_init(libsddc_handler_t, uint8_t dev_index);
 void		sddc_destroy(libsddc_handler_t);
 
+// Source of the ADC samples, to be set before sddc_init: "usb" (default),
+// or "replay,file=capture.wav[,speed=1][,loop=1][,model=RX888r2]" (see CreateFx3Backend).
+// NULL goes back to the SDDC_BACKEND environment variable
+sddc_err_t	sddc_set_backend(libsddc_handler_t t, const char *spec);
+
 
 
 
@@ -55,6 +63,57 @@ sddc_err_t	sddc_set_stream_callback(
 	libsddc_handler_t t,
 	sddc_read_async_cb_t callback,
 	void *callback_context);
+sddc_err_t	sddc_set_real_stream_callback(
+	libsddc_handler_t t,
+	sddc_read_real_async_cb_t callback,
+	void *callback_context);
+
+// Stream the raw ADC samples (int16, at the ADC rate) instead of converting them to IQ,
+// applied by sddc_start_streaming. The samples go to the real stream callback,
+// or to the _real pull functions below
+bool		sddc_get_raw_mode(libsddc_handler_t t);
+sddc_err_t	sddc_set_raw_mode(libsddc_handler_t t, bool raw);
+
+// Time of the first sample of the block being passed to the stream callback,
+// or of the samples returned by the last sddc_read_sync / sddc_acquire_buffer,
+// in ns since the Unix epoch (host clock, CLOCK_REALTIME), 0 if unknown.
+// Only meaningful when called from the thread receiving the samples
+int64_t		sddc_get_stream_timestamp(libsddc_handler_t t);
+
+// --- Pull mode --- //
+// Without a stream callback, sddc_start_streaming leaves the samples in the
+// driver ring buffer for the application to take, from a single thread.
+// These functions return ERR_TIMEOUT when no samples came in timeout_ms,
+// and ERR_STREAM_STOPPED once the stream is stopped
+
+// Copies n samples (in the IQ format, see sddc_set_iq_format), n_read is the number copied even on error
+sddc_err_t	sddc_read_sync(libsddc_handler_t t, void *buf, uint32_t n, uint32_t *n_read, uint32_t timeout_ms);
+
+// Zero copy: the block stays valid until sddc_release_buffer (not to be mixed with sddc_read_sync).
+// Stopping the stream drops the block held, releasing it afterwards does nothing
+sddc_err_t	sddc_acquire_buffer(libsddc_handler_t t, const sddc_complex_t **data, uint32_t *n, uint32_t timeout_ms);
+sddc_err_t	sddc_release_buffer(libsddc_handler_t t);
+
+// Same in raw mode
+sddc_err_t	sddc_read_sync_real(libsddc_handler_t t, int16_t *buf, uint32_t n, uint32_t *n_read, uint32_t timeout_ms);
+sddc_err_t	sddc_acquire_real_buffer(libsddc_handler_t t, const int16_t **data, uint32_t *n, uint32_t timeout_ms);
+
+// --- Stream geometry --- //
+// Can be set before sddc_init (checked against the device when it is opened)
+// or later while the stream is stopped
+sddc_err_t	sddc_get_stream_config(libsddc_handler_t t, sddc_stream_config_t *config);
+sddc_err_t	sddc_set_stream_config(libsddc_handler_t t, const sddc_stream_config_t *config);
+
+// --- Threads --- //
+// Real time priority and CPU affinity of the driver threads,
+// applied when the stream starts (see RadioHandler::SetThreadConfig)
+sddc_err_t	sddc_get_thread_config(libsddc_handler_t t, sddc_thread_role_t role, sddc_thread_config_t *config);
+sddc_err_t	sddc_set_thread_config(libsddc_handler_t t, sddc_thread_role_t role, const sddc_thread_config_t *config);
+
+// Convert the samples on workers shared by all the devices of the process (one per core)
+// instead of a thread per device, applied when the stream starts (see RadioHandler::SetSharedProcessing)
+bool		sddc_get_shared_processing(libsddc_handler_t t);
+sddc_err_t	sddc_set_shared_processing(libsddc_handler_t t, bool shared);
 
 
 
@@ -66,6 +125,75 @@ sddc_err_t	sddc_set_stream_callback(
 sddc_err_t	sddc_start_streaming(libsddc_handler_t t);
 sddc_err_t	sddc_stop_streaming(libsddc_handler_t t);
 
+// Number of USB transfers in flight, as last chosen by the adaptive depth (updated every second)
+uint32_t	sddc_get_transfer_depth(libsddc_handler_t t);
+
+// Rates, drops, ring fill levels and thread loads of the running stream (see sddc_stream_stats_t)
+sddc_err_t	sddc_get_stream_stats(libsddc_handler_t t, sddc_stream_stats_t *stats);
+
+// --- Recording --- //
+// Writes the stream to a file, without header: the raw ADC samples in raw mode,
+// the IQ samples in the IQ format otherwise. A writer thread of its own does the
+// disk I/O, and the blocks the disk cannot take are dropped and counted instead of
+// stalling the stream (see sddc_record_stats_t). Can start before or during the
+// stream, except in pull mode: the samples go to the recorder and to the stream
+// callback, if any. NULL config for the defaults.
+// With config->encoder_threads, the raw ADC samples are compressed losslessly
+// (see adc_codec), ERR_FORMAT_INVALID in IQ mode. The replay backend decodes them.
+// ERR_RECORD_FAILED if the file cannot be created or a recording is already running,
+// ERR_NOT_COMPATIBLE while the network server runs
+sddc_err_t	sddc_start_recording(libsddc_handler_t t, const char *path, const sddc_record_config_t *config);
+// Same, as a SigMF recording: <path>.sigmf-data holds the samples and
+// <path>.sigmf-meta the datatype, sample rate, model, firmware and start time,
+// with a capture per center frequency and an annotation per gain state (RF mode,
+// RF and IF gains) as changed through this handler during the recording.
+// `path` may end with either extension. The metadata is kept up to date while
+// the data file is appended to; the ADC sample rate and the decimation stay as
+// they were until sddc_stop_recording (ERR_NOT_COMPATIBLE).
+// ERR_RECORD_FAILED as above, and before sddc_init
+sddc_err_t	sddc_start_sigmf_recording(libsddc_handler_t t, const char *path, const sddc_record_config_t *config);
+// Stops either kind of recording. ERR_RECORD_FAILED if a write failed (the file ends there)
+sddc_err_t	sddc_stop_recording(libsddc_handler_t t);
+// Progress of the current recording, or of the last one once stopped
+sddc_err_t	sddc_get_record_stats(libsddc_handler_t t, sddc_record_stats_t *stats);
+
+// --- Network server --- //
+// Serves the stream to TCP clients, with the rtl_tcp protocol (see stream_server):
+// unsigned 8 bit IQ samples, or in raw mode the raw ADC samples, to up to
+// config->max_clients clients, each at the rate of the stream divided by the
+// power of two it asks for. The frequency, gain and mode commands of the clients
+// go to this device unless config->read_only. To be started while the stream is
+// stopped: sddc_start_streaming then leaves the samples to the server, which takes
+// them from the driver ring, and neither calls the stream callbacks nor records.
+// The IQ format must stay CF32 (the server converts the samples) and the raw mode
+// as it was. NULL config for the defaults (port 1234, all the interfaces).
+// ERR_SERVER_FAILED if it cannot listen, is already running or sddc_init was not called,
+// ERR_NOT_COMPATIBLE while recording or publishing in shared memory
+sddc_err_t	sddc_start_server(libsddc_handler_t t, const sddc_server_config_t *config);
+// Closes the connections and stops the server
+sddc_err_t	sddc_stop_server(libsddc_handler_t t);
+// Clients and traffic of the running server, or of the last one once stopped
+sddc_err_t	sddc_get_server_stats(libsddc_handler_t t, sddc_server_stats_t *stats);
+
+// --- Shared memory --- //
+// Publishes the stream in a POSIX shared memory ring called `name` (NULL for
+// "/sddc"), which any number of local processes map with the reader of sddc_shm.h
+// (see shm_publisher). The stream callbacks copy each block into the ring once,
+// and the readers use it in place; a reader falling a whole ring behind skips
+// blocks, and never slows the stream down. Holds the samples as they come: the
+// raw ADC samples in raw mode, the IQ samples in the IQ format otherwise. Can
+// start before or during the stream, except in pull mode, and alongside a
+// recording; the raw mode, IQ format, decimation and ADC sample rate stay as they
+// were until sddc_stop_shm. NULL config for the defaults (64 MiB ring).
+// ERR_SHM_FAILED if the ring cannot be created, the name is taken by a running
+// publisher, this handler already publishes or sddc_init was not called,
+// ERR_NOT_COMPATIBLE while the network server runs, and on Windows
+sddc_err_t	sddc_start_shm(libsddc_handler_t t, const char *name, const sddc_shm_config_t *config);
+// Marks the ring closed (its readers see ERR_STREAM_STOPPED) and unlinks it
+sddc_err_t	sddc_stop_shm(libsddc_handler_t t);
+// Blocks published and readers of the running ring, or of the last one once stopped
+sddc_err_t	sddc_get_shm_stats(libsddc_handler_t t, sddc_shm_stats_t *stats);
+
 // --- Hardware infos --- //
 RadioModel		sddc_get_model(libsddc_handler_t t);
 const char*		sddc_get_model_name(libsddc_handler_t t);
@@ -113,6 +241,12 @@ sddc_err_t	sddc_set_led(libsddc_handler_t t, sddc_leds_t led, bool on);
 
 // --- r2iq only --- //
 sddc_err_t sddc_set_decimation(libsddc_handler_t t, uint8_t decimate);
+
+// Format of the IQ samples, converted once in the driver. With CS16 or CS8, the
+// stream callback and sddc_acquire_buffer give interleaved int16 or int8 samples
+// despite the sddc_complex_t pointer. scale multiplies the float samples before
+// rounding (0 for the full scale of the format), dither adds a +-1 LSB triangular dither
+sddc_err_t sddc_set_iq_format(libsddc_handler_t t, sddc_iq_format_t format, float scale, bool dither);
 // --- //
 
 #ifdef __cplusplus
@@ -0,0 +1,171 @@
+/*
+ * sddc_geometry_sweep - sweeps the stream geometry (USB transfer size,
+ *                       transfers in flight, ring depth) and reports
+ *                       the sample drop rate and the CPU usage
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/resource.h>
+
+#include "libsddc.h"
+
+static const uint32_t default_transfer_sizes[] = { 32768, 65536, 131072, 262144, 524288 };
+static const uint32_t default_transfer_counts[] = { 4, 8, 16, 32, 64 };
+static const uint32_t default_ring_sizes[] = { 16, 64, 256 };
+
+static atomic_ullong received_samples;
+
+static void count_samples_callback(uint32_t data_size, const sddc_complex_t *data,
+                                   void *context)
+{
+  (void)data;
+  (void)context;
+  atomic_fetch_add(&received_samples, data_size);
+}
+
+static double timespec_diff(const struct timespec *start, const struct timespec *end)
+{
+  return (double)(end->tv_sec - start->tv_sec) + 1.0e-9 * (end->tv_nsec - start->tv_nsec);
+}
+
+static double cpu_seconds(void)
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (double)usage.ru_utime.tv_sec + 1.0e-6 * usage.ru_utime.tv_usec +
+         (double)usage.ru_stime.tv_sec + 1.0e-6 * usage.ru_stime.tv_usec;
+}
+
+/* parses a comma separated list of values, returns the number of values */
+static int parse_list(const char *arg, uint32_t *values, int max_values)
+{
+  int n = 0;
+  char *copy = strdup(arg);
+  for (char *tok = strtok(copy, ","); tok && n < max_values; tok = strtok(0, ",")) {
+    values[n++] = (uint32_t)strtoul(tok, 0, 0);
+  }
+  free(copy);
+  return n;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t sample_rate = 64000000;
+  int runtime = 5;
+  uint32_t transfer_sizes[16], transfer_counts[16], ring_sizes[16];
+  int n_sizes = sizeof(default_transfer_sizes) / sizeof(default_transfer_sizes[0]);
+  int n_counts = sizeof(default_transfer_counts) / sizeof(default_transfer_counts[0]);
+  int n_rings = sizeof(default_ring_sizes) / sizeof(default_ring_sizes[0]);
+  memcpy(transfer_sizes, default_transfer_sizes, sizeof(default_transfer_sizes));
+  memcpy(transfer_counts, default_transfer_counts, sizeof(default_transfer_counts));
+  memcpy(ring_sizes, default_ring_sizes, sizeof(default_ring_sizes));
+
+  int opt;
+  while ((opt = getopt(argc, argv, "r:t:s:n:b:h")) != -1) {
+    switch (opt) {
+      case 'r': sample_rate = (uint32_t)strtoul(optarg, 0, 0); break;
+      case 't': runtime = atoi(optarg); break;
+      case 's': n_sizes = parse_list(optarg, transfer_sizes, 16); break;
+      case 'n': n_counts = parse_list(optarg, transfer_counts, 16); break;
+      case 'b': n_rings = parse_list(optarg, ring_sizes, 16); break;
+      default:
+        fprintf(stderr, "usage: %s [-r adc_rate] [-t seconds_per_point] [-s transfer_sizes] [-n transfer_counts] [-b ring_sizes]\n", argv[0]);
+        fprintf(stderr, "  lists are comma separated, e.g. -s 65536,131072 -n 8,16 -b 64\n");
+        return opt == 'h' ? 0 : -1;
+    }
+  }
+
+  libsddc_handler_t sddc = sddc_create();
+  sddc_err_t ret = sddc_init(sddc, 0);
+  if (ret != ERR_SUCCESS) {
+    fprintf(stderr, "ERROR - sddc_init() failed : %d\n", ret);
+    sddc_destroy(sddc);
+    return -1;
+  }
+
+  if (sddc_set_adc_sample_rate(sddc, sample_rate) != ERR_SUCCESS ||
+      sddc_set_decimation(sddc, 0) != ERR_SUCCESS ||
+      sddc_set_stream_callback(sddc, count_samples_callback, 0) != ERR_SUCCESS) {
+    fprintf(stderr, "ERROR - failed to configure the stream\n");
+    sddc_destroy(sddc);
+    return -1;
+  }
+
+  /* r2iq outputs complex samples at half the ADC rate */
+  const double expected_rate = sample_rate / 2.0;
+
+  printf("# ADC rate %u, %d s per point\n", sample_rate, runtime);
+  printf("# %12s %10s %10s %12s %10s %8s\n", "xfer_bytes", "xfers", "ring", "iq_rate", "drop_%", "cpu_%");
+
+  for (int s = 0; s < n_sizes; s++) {
+    for (int c = 0; c < n_counts; c++) {
+      for (int b = 0; b < n_rings; b++) {
+        sddc_stream_config_t config;
+        config.transfer_size = transfer_sizes[s];
+        config.concurrent_transfers = transfer_counts[c];
+        config.max_concurrent_transfers = 0;  /* fixed depth, that is what is being measured */
+        config.ring_blocks = ring_sizes[b];
+
+        ret = sddc_set_stream_config(sddc, &config);
+        if (ret != ERR_SUCCESS) {
+          printf("  %12u %10u %10u %12s (rejected: %d)\n", config.transfer_size,
+                 config.concurrent_transfers, config.ring_blocks, "-", ret);
+          continue;
+        }
+
+        if (sddc_start_streaming(sddc) != ERR_SUCCESS) {
+          fprintf(stderr, "ERROR - sddc_start_streaming() failed\n");
+          continue;
+        }
+
+        /* let the stream settle before measuring */
+        sleep(1);
+
+        struct timespec clk_start, clk_end;
+        atomic_store(&received_samples, 0);
+        double cpu_start = cpu_seconds();
+        clock_gettime(CLOCK_MONOTONIC, &clk_start);
+
+        sleep(runtime);
+
+        unsigned long long samples = atomic_load(&received_samples);
+        clock_gettime(CLOCK_MONOTONIC, &clk_end);
+        double cpu = cpu_seconds() - cpu_start;
+
+        sddc_stop_streaming(sddc);
+
+        double elapsed = timespec_diff(&clk_start, &clk_end);
+        double rate = samples / elapsed;
+        double drop = rate < expected_rate ? 100.0 * (1.0 - rate / expected_rate) : 0.0;
+
+        printf("  %12u %10u %10u %12.0f %10.3f %8.1f\n", config.transfer_size,
+               config.concurrent_transfers, config.ring_blocks, rate, drop,
+               100.0 * cpu / elapsed);
+        fflush(stdout);
+      }
+    }
+  }
+
+  sddc_destroy(sddc);
+  return 0;
+}
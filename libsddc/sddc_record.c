@@ -0,0 +1,204 @@
+/*
+ * sddc_record - records the raw ADC samples (or the IQ samples) of a
+ *               libsddc stream to a file, for as long as the disk allows
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libsddc.h"
+
+static volatile sig_atomic_t stop_recording = 0;
+
+static void on_signal(int sig)
+{
+  (void)sig;
+  stop_recording = 1;
+}
+
+static double now_seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + 1.0e-9 * ts.tv_nsec;
+}
+
+static void usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [options] <output_file>\n", name);
+  fprintf(stderr, "  -r adc_rate      ADC sample rate (default 64000000)\n");
+  fprintf(stderr, "  -t seconds       duration, 0 until Ctrl-C (default 0)\n");
+  fprintf(stderr, "  -i format        record the IQ samples (cf32, cs16 or cs8) instead of the raw ADC samples\n");
+  fprintf(stderr, "  -d decimation    IQ decimation (default 0)\n");
+  fprintf(stderr, "  -f frequency     IQ center frequency\n");
+  fprintf(stderr, "  -b buffer_mb     memory between the stream and the disk (default 256)\n");
+  fprintf(stderr, "  -c chunk_kb      bytes per write, multiple of 4 (default 4096)\n");
+  fprintf(stderr, "  -p prealloc_mb   space reserved ahead of the writes, 0 to disable (default 1024)\n");
+  fprintf(stderr, "  -D               buffered writes instead of O_DIRECT\n");
+  fprintf(stderr, "  -s               SigMF recording: <output_file>.sigmf-data and .sigmf-meta\n");
+  fprintf(stderr, "  -z threads       compress the raw ADC samples losslessly on that many threads\n");
+  fprintf(stderr, "  -B backend       e.g. \"generator,speed=max\" to measure the disk without a radio\n");
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t sample_rate = 64000000;
+  int runtime = 0;
+  int iq = 0;
+  int sigmf = 0;
+  sddc_iq_format_t iq_format = SDDC_IQ_CS16;
+  int decimation = 0;
+  uint32_t frequency = 0;
+  const char *backend = 0;
+  sddc_record_config_t config = { 0, 0, 1024u * 1024 * 1024, true };
+
+  int opt;
+  while ((opt = getopt(argc, argv, "r:t:i:d:f:b:c:p:Dsz:B:h")) != -1) {
+    switch (opt) {
+      case 'r': sample_rate = (uint32_t)strtoul(optarg, 0, 0); break;
+      case 't': runtime = atoi(optarg); break;
+      case 'i':
+        iq = 1;
+        if (!strcmp(optarg, "cf32")) iq_format = SDDC_IQ_CF32;
+        else if (!strcmp(optarg, "cs16")) iq_format = SDDC_IQ_CS16;
+        else if (!strcmp(optarg, "cs8")) iq_format = SDDC_IQ_CS8;
+        else { usage(argv[0]); return -1; }
+        break;
+      case 'd': decimation = atoi(optarg); break;
+      case 'f': frequency = (uint32_t)strtoul(optarg, 0, 0); break;
+      case 'b': config.buffer_size = (uint32_t)strtoul(optarg, 0, 0) * 1024 * 1024; break;
+      case 'c': config.chunk_size = (uint32_t)strtoul(optarg, 0, 0) * 1024; break;
+      case 'p': config.preallocate = (uint32_t)strtoul(optarg, 0, 0) * 1024 * 1024; break;
+      case 'D': config.direct_io = false; break;
+      case 's': sigmf = 1; break;
+      case 'z': config.encoder_threads = (uint32_t)strtoul(optarg, 0, 0); break;
+      case 'B': backend = optarg; break;
+      default:
+        usage(argv[0]);
+        return opt == 'h' ? 0 : -1;
+    }
+  }
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return -1;
+  }
+  const char *outfilename = argv[optind];
+
+  int ret_val = -1;
+  libsddc_handler_t sddc = sddc_create();
+
+  if (backend && sddc_set_backend(sddc, backend) != ERR_SUCCESS) {
+    fprintf(stderr, "ERROR - invalid backend '%s'\n", backend);
+    sddc_destroy(sddc);
+    return -1;
+  }
+
+  sddc_err_t ret = sddc_init(sddc, 0);
+  if (ret != ERR_SUCCESS) {
+    fprintf(stderr, "ERROR - sddc_init() failed : %d\n", ret);
+    sddc_destroy(sddc);
+    return -1;
+  }
+
+  if (sddc_set_adc_sample_rate(sddc, sample_rate) != ERR_SUCCESS ||
+      sddc_set_raw_mode(sddc, !iq) != ERR_SUCCESS) {
+    fprintf(stderr, "ERROR - failed to configure the stream\n");
+    goto DONE;
+  }
+
+  if (iq) {
+    if (sddc_set_decimation(sddc, decimation) != ERR_SUCCESS ||
+        sddc_set_iq_format(sddc, iq_format, 0, false) != ERR_SUCCESS) {
+      fprintf(stderr, "ERROR - failed to configure the IQ output\n");
+      goto DONE;
+    }
+    if (frequency)
+      sddc_set_center_frequency(sddc, frequency);
+  }
+
+  /* no stream callback: the samples only go to the recorder */
+  if (sigmf)
+    ret = sddc_start_sigmf_recording(sddc, outfilename, &config);
+  else
+    ret = sddc_start_recording(sddc, outfilename, &config);
+  if (ret != ERR_SUCCESS) {
+    fprintf(stderr, "ERROR - starting the recording failed : %d\n", ret);
+    goto DONE;
+  }
+
+  if (sddc_start_streaming(sddc) != ERR_SUCCESS) {
+    fprintf(stderr, "ERROR - sddc_start_streaming() failed\n");
+    sddc_stop_recording(sddc);
+    goto DONE;
+  }
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+
+  sddc_record_stats_t stats;
+  sddc_get_record_stats(sddc, &stats);
+  fprintf(stderr, "recording %s samples to %s (%s) %s\n", iq ? "IQ" : "raw ADC", outfilename,
+          stats.direct_io ? "direct I/O" : "buffered I/O",
+          runtime ? "" : "until Ctrl-C");
+
+  const double start = now_seconds();
+  double last = start;
+  uint64_t last_bytes = 0;
+  while (!stop_recording && (runtime == 0 || now_seconds() - start < runtime)) {
+    usleep(1000000);
+
+    double t = now_seconds();
+    sddc_get_record_stats(sddc, &stats);
+    fprintf(stderr, "%7.0f s  %8.1f MB/s  %10.1f MB  buffer %3u%% (peak %3u%%)  dropped %u blocks\n",
+            t - start, (stats.bytes_written - last_bytes) / (t - last) / 1e6,
+            stats.bytes_written / 1e6,
+            (unsigned)(100.0 * stats.buffer_fill / stats.buffer_size),
+            (unsigned)(100.0 * stats.buffer_peak / stats.buffer_size),
+            stats.blocks_dropped);
+    last = t;
+    last_bytes = stats.bytes_written;
+    if (stats.error) {
+      fprintf(stderr, "ERROR - write failed: %s\n", strerror(stats.error));
+      break;
+    }
+  }
+
+  sddc_stop_streaming(sddc);
+  ret = sddc_stop_recording(sddc);
+  sddc_get_record_stats(sddc, &stats);
+
+  const double elapsed = now_seconds() - start;
+  fprintf(stderr, "%llu bytes in %.1f s (%.1f MB/s), %u blocks (%llu bytes) dropped\n",
+          (unsigned long long)stats.bytes_written, elapsed, stats.bytes_written / elapsed / 1e6,
+          stats.blocks_dropped, (unsigned long long)stats.bytes_dropped);
+  if (config.encoder_threads && stats.bytes_written)
+    fprintf(stderr, "%llu bytes of samples compressed %.2f:1\n",
+            (unsigned long long)stats.bytes_recorded, (double)stats.bytes_recorded / stats.bytes_written);
+
+  if (ret == ERR_SUCCESS)
+    ret_val = stats.blocks_dropped ? 1 : 0;
+
+DONE:
+  sddc_destroy(sddc);
+
+  return ret_val;
+}
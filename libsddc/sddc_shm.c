@@ -0,0 +1,227 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sddc_shm.h"
+#include "ipc/shm_layout.h"
+
+struct sddc_shm_reader
+{
+  sddc_shm_header_t *header;
+  size_t size;
+  sddc_shm_slot_t *slots;
+  const uint8_t *data;
+  sddc_shm_reader_slot_t *slot;   // our cursor
+  uint64_t cursor;                // next block
+  uint64_t held;                  // block held + 1, 0 if none
+};
+
+static int64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static bool is_alive(uint32_t pid)
+{
+  return pid != 0 && (kill((pid_t)pid, 0) == 0 || errno == EPERM);
+}
+
+// A free slot, or one left by a reader which died without closing
+static sddc_shm_reader_slot_t *take_slot(sddc_shm_header_t *header)
+{
+  sddc_shm_reader_slot_t *slots = (sddc_shm_reader_slot_t *)((uint8_t *)header + header->readers_offset);
+  const uint32_t pid = (uint32_t)getpid();
+
+  for (uint32_t i = 0; i < header->max_readers; i++) {
+    uint32_t owner = __atomic_load_n(&slots[i].pid, __ATOMIC_ACQUIRE);
+    if (owner != 0 && is_alive(owner))
+      continue;
+    if (__atomic_compare_exchange_n(&slots[i].pid, &owner, pid, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+      return &slots[i];
+  }
+  return 0;
+}
+
+sddc_err_t sddc_shm_open(const char *name, sddc_shm_reader_t *reader)
+{
+  char path[256];
+  if (!name || !*name)
+    name = SDDC_SHM_DEFAULT_NAME;
+  snprintf(path, sizeof(path), "%s%s", name[0] == '/' ? "" : "/", name);
+
+  int fd = shm_open(path, O_RDWR, 0);
+  if (fd < 0)
+    return ERR_SHM_FAILED;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(sddc_shm_header_t)) {
+    close(fd);
+    return ERR_SHM_FAILED;
+  }
+
+  void *p = mmap(0, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED)
+    return ERR_SHM_FAILED;
+
+  sddc_shm_header_t *header = (sddc_shm_header_t *)p;
+  sddc_err_t ret = ERR_SUCCESS;
+  if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != SDDC_SHM_MAGIC || header->size != (uint64_t)st.st_size)
+    ret = ERR_SHM_FAILED;     // not a ring, or still being created
+  else if (header->version != SDDC_SHM_VERSION)
+    ret = ERR_NOT_COMPATIBLE;
+
+  sddc_shm_reader_slot_t *slot = 0;
+  if (ret == ERR_SUCCESS && (slot = take_slot(header)) == 0)
+    ret = ERR_SHM_FAILED;
+
+  struct sddc_shm_reader *r = 0;
+  if (ret == ERR_SUCCESS && (r = (struct sddc_shm_reader *)calloc(1, sizeof(*r))) == 0) {
+    __atomic_store_n(&slot->pid, 0, __ATOMIC_RELEASE);
+    ret = ERR_SHM_FAILED;
+  }
+  if (ret != ERR_SUCCESS) {
+    munmap(p, (size_t)st.st_size);
+    return ret;
+  }
+
+  r->header = header;
+  r->size = (size_t)st.st_size;
+  r->slots = (sddc_shm_slot_t *)((uint8_t *)header + header->slots_offset);
+  r->data = (const uint8_t *)header + header->data_offset;
+  r->slot = slot;
+
+  // From the newest block on, or the next one if none yet
+  uint64_t published = __atomic_load_n(&header->published, __ATOMIC_ACQUIRE);
+  r->cursor = published ? published - 1 : 0;
+  __atomic_store_n(&slot->cursor, r->cursor, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->dropped, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->overruns, 0, __ATOMIC_RELAXED);
+
+  *reader = r;
+  return ERR_SUCCESS;
+}
+
+void sddc_shm_close(sddc_shm_reader_t reader)
+{
+  if (!reader)
+    return;
+
+  sddc_shm_release(reader);
+  __atomic_store_n(&reader->slot->pid, 0, __ATOMIC_RELEASE);
+  munmap(reader->header, reader->size);
+  free(reader);
+}
+
+sddc_err_t sddc_shm_get_info(sddc_shm_reader_t reader, sddc_shm_info_t *info)
+{
+  const sddc_shm_header_t *h = reader->header;
+  info->raw = h->raw != 0;
+  info->iq_format = (sddc_iq_format_t)h->iq_format;
+  info->sample_size = h->sample_size;
+  info->sample_rate = h->sample_rate;
+  info->adc_sample_rate = h->adc_sample_rate;
+  info->slot_count = h->slot_count;
+  info->slot_size = h->slot_size;
+  return ERR_SUCCESS;
+}
+
+sddc_err_t sddc_shm_acquire(sddc_shm_reader_t reader, sddc_shm_block_t *block, uint32_t timeout_ms)
+{
+  sddc_shm_header_t *h = reader->header;
+  const uint32_t count = h->slot_count;
+  const int64_t deadline = now_ns() + (int64_t)timeout_ms * 1000000;
+  uint64_t dropped = 0;
+
+  if (reader->held)
+    sddc_shm_release(reader);
+
+  for (;;) {
+    const uint32_t futex = __atomic_load_n(&h->futex, __ATOMIC_ACQUIRE);
+    const uint64_t published = __atomic_load_n(&h->published, __ATOMIC_ACQUIRE);
+
+    if (reader->cursor < published) {
+      // The publisher may be writing the slot of block published - count
+      if (published - reader->cursor >= count) {
+        dropped += published - 1 - reader->cursor;
+        __atomic_add_fetch(&reader->slot->dropped, published - 1 - reader->cursor, __ATOMIC_RELAXED);
+        reader->cursor = published - 1;
+      }
+
+      const sddc_shm_slot_t *slot = &reader->slots[reader->cursor % count];
+      if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != reader->cursor + 1)
+        continue;   // reused meanwhile: published moved on
+
+      const uint32_t size = slot->size;
+      block->data = reader->data + (size_t)(reader->cursor % count) * h->slot_size;
+      block->size = size < h->slot_size ? size : h->slot_size;
+      block->seq = reader->cursor;
+      block->first_sample = slot->first_sample;
+      block->timestamp_ns = slot->timestamp_ns;
+      block->dropped = dropped;
+      reader->held = reader->cursor + 1;
+      return ERR_SUCCESS;
+    }
+
+    if (__atomic_load_n(&h->closed, __ATOMIC_ACQUIRE))
+      return ERR_STREAM_STOPPED;
+
+    const int64_t left = deadline - now_ns();
+    if (left <= 0)
+      return ERR_TIMEOUT;
+
+    // The publisher bumps futex after publishing, then wakes us if we count as waiting
+    __atomic_add_fetch(&h->waiters, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&h->published, __ATOMIC_SEQ_CST) == published)
+      sddc_shm_wait(h, futex, left);
+    __atomic_sub_fetch(&h->waiters, 1, __ATOMIC_SEQ_CST);
+  }
+}
+
+sddc_err_t sddc_shm_release(sddc_shm_reader_t reader)
+{
+  if (!reader->held)
+    return ERR_SUCCESS;
+
+  const uint64_t seq = reader->held - 1;
+  const sddc_shm_slot_t *slot = &reader->slots[seq % reader->header->slot_count];
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  const bool intact = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq + 1;
+
+  reader->held = 0;
+  reader->cursor = seq + 1;
+  __atomic_store_n(&reader->slot->cursor, reader->cursor, __ATOMIC_RELAXED);
+  if (intact)
+    return ERR_SUCCESS;
+
+  __atomic_add_fetch(&reader->slot->overruns, 1, __ATOMIC_RELAXED);
+  return ERR_SHM_OVERRUN;
+}
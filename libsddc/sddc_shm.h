@@ -0,0 +1,85 @@
+/*
+ * This file is part of SDDC_Driver.
+ *
+ * Copyright (C) 2025 - RenardSpark
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __H_SDDC_SHM
+#define __H_SDDC_SHM
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ----- Shared memory reader ----- //
+// Maps the ring of a process publishing its stream (see sddc_start_shm in
+// libsddc.h) and hands out its blocks in place, without copying them. Any number
+// of readers, in any number of processes, each with its own cursor: a reader
+// starts at the newest block, and one falling a whole ring behind skips to the
+// newest block again (see sddc_shm_block_t::dropped). The publisher never waits
+// for the readers. Only needs this file and libsddc/../Core/ipc/shm_layout.h,
+// not libsddc itself.
+
+typedef struct sddc_shm_reader *sddc_shm_reader_t;
+
+// What the stream carries, fixed for the life of the ring
+typedef struct sddc_shm_info_t {
+  bool raw;                     // int16 ADC samples, else IQ samples in iq_format
+  sddc_iq_format_t iq_format;
+  uint32_t sample_size;         // bytes, both I and Q for IQ
+  double sample_rate;
+  uint32_t adc_sample_rate;
+  uint32_t slot_count;          // blocks in the ring
+  uint32_t slot_size;           // largest block, in bytes
+} sddc_shm_info_t;
+
+// One block of the stream, in the shared memory
+typedef struct sddc_shm_block_t {
+  const void *data;
+  uint32_t size;                // bytes
+  uint64_t seq;                 // blocks published before this one
+  uint64_t first_sample;        // index of its first sample in the stream
+  int64_t timestamp_ns;         // of its first sample (ns since the Unix epoch), 0 if unknown
+  uint64_t dropped;             // blocks skipped right before this one, the reader falling behind
+} sddc_shm_block_t;
+
+// Attaches to the ring called `name` (as given to sddc_start_shm, NULL for the default).
+// ERR_SHM_FAILED if no publisher created it or every reader slot is taken,
+// ERR_NOT_COMPATIBLE if it was created by another version of the layout
+sddc_err_t sddc_shm_open(const char *name, sddc_shm_reader_t *reader);
+// Detaches, releasing the block held if any
+void sddc_shm_close(sddc_shm_reader_t reader);
+
+sddc_err_t sddc_shm_get_info(sddc_shm_reader_t reader, sddc_shm_info_t *info);
+
+// Waits up to timeout_ms for the next block, and holds it until sddc_shm_release
+// (or the next sddc_shm_acquire). block->data points into the ring: the publisher
+// reuses the slot once it went a whole ring further, so hold it for less than that.
+// ERR_TIMEOUT, or ERR_STREAM_STOPPED once the publisher stopped and every block was read
+sddc_err_t sddc_shm_acquire(sddc_shm_reader_t reader, sddc_shm_block_t *block, uint32_t timeout_ms);
+// Gives the block back. ERR_SHM_OVERRUN if the publisher reused its slot meanwhile:
+// what was read of it may be torn
+sddc_err_t sddc_shm_release(sddc_shm_reader_t reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __H_SDDC_SHM
@@ -0,0 +1,277 @@
+/*
+ * sddc_shm_bench - publishes the stream in shared memory and measures the
+ *                  throughput of reader processes using it in place
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libsddc.h"
+#include "sddc_shm.h"
+
+#define MAX_READERS 64
+
+static volatile sig_atomic_t stop_publishing = 0;
+
+static void on_signal(int sig)
+{
+  (void)sig;
+  stop_publishing = 1;
+}
+
+static double now_seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + 1.0e-9 * ts.tv_nsec;
+}
+
+/* what a reader process sends back through its pipe */
+typedef struct {
+  int error;
+  uint64_t blocks;
+  uint64_t bytes;
+  uint64_t dropped;
+  uint64_t overruns;
+  double seconds;
+  uint64_t checksum;
+} reader_result_t;
+
+static void usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [options]\n", name);
+  fprintf(stderr, "  -n readers       reader processes, 0 to only publish (default 4)\n");
+  fprintf(stderr, "  -t seconds       duration, 0 until Ctrl-C (default 10)\n");
+  fprintf(stderr, "  -N name          name of the ring (default /sddc)\n");
+  fprintf(stderr, "  -a               attach the readers to a running publisher instead\n");
+  fprintf(stderr, "  -r adc_rate      ADC sample rate (default 64000000)\n");
+  fprintf(stderr, "  -i format        publish the IQ samples (cf32, cs16 or cs8) instead of the raw ADC samples\n");
+  fprintf(stderr, "  -d decimation    IQ decimation (default 0)\n");
+  fprintf(stderr, "  -b buffer_mb     ring size (default 64)\n");
+  fprintf(stderr, "  -s slot_kb       slot size, multiple of 4 (default 256)\n");
+  fprintf(stderr, "  -B backend       (default \"generator,speed=max\", \"\" for the device)\n");
+}
+
+/* Reads every block in place until the publisher stops, Ctrl-C or the duration */
+static void run_reader(const char *name, int runtime, int fd)
+{
+  reader_result_t result;
+  memset(&result, 0, sizeof(result));
+
+  /* the publisher may not be there yet */
+  sddc_shm_reader_t reader = 0;
+  sddc_err_t ret = ERR_SHM_FAILED;
+  for (int i = 0; i < 500 && ret == ERR_SHM_FAILED; i++) {
+    ret = sddc_shm_open(name, &reader);
+    if (ret == ERR_SHM_FAILED)
+      usleep(10000);
+  }
+
+  if (ret != ERR_SUCCESS) {
+    result.error = ret;
+  } else {
+    sddc_shm_block_t block;
+    const double end = now_seconds() + runtime;
+    double start = 0;
+    while ((ret = sddc_shm_acquire(reader, &block, 1000)) != ERR_STREAM_STOPPED &&
+           !stop_publishing && (runtime == 0 || now_seconds() < end)) {
+      if (ret == ERR_TIMEOUT)
+        continue;
+      if (!result.blocks)
+        start = now_seconds();
+
+      /* touch every byte, as a consumer would */
+      const uint64_t *words = (const uint64_t *)block.data;
+      for (uint32_t i = 0; i < block.size / sizeof(uint64_t); i++)
+        result.checksum += words[i];
+
+      if (sddc_shm_release(reader) == ERR_SHM_OVERRUN)
+        result.overruns++;
+      result.blocks++;
+      result.bytes += block.size;
+      result.dropped += block.dropped;
+    }
+    if (result.blocks)
+      result.seconds = now_seconds() - start;
+    sddc_shm_close(reader);
+  }
+
+  if (write(fd, &result, sizeof(result)) != sizeof(result))
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+  int readers = 4;
+  int runtime = 10;
+  const char *name = "/sddc";
+  int attach = 0;
+  uint32_t sample_rate = 64000000;
+  int iq = 0;
+  sddc_iq_format_t iq_format = SDDC_IQ_CS16;
+  int decimation = 0;
+  const char *backend = "generator,speed=max";
+  sddc_shm_config_t config = { 64u * 1024 * 1024, 256u * 1024, 0 };
+
+  int opt;
+  while ((opt = getopt(argc, argv, "n:t:N:ar:i:d:b:s:B:h")) != -1) {
+    switch (opt) {
+      case 'n': readers = atoi(optarg); break;
+      case 't': runtime = atoi(optarg); break;
+      case 'N': name = optarg; break;
+      case 'a': attach = 1; break;
+      case 'r': sample_rate = (uint32_t)strtoul(optarg, 0, 0); break;
+      case 'i':
+        iq = 1;
+        if (!strcmp(optarg, "cf32")) iq_format = SDDC_IQ_CF32;
+        else if (!strcmp(optarg, "cs16")) iq_format = SDDC_IQ_CS16;
+        else if (!strcmp(optarg, "cs8")) iq_format = SDDC_IQ_CS8;
+        else { usage(argv[0]); return -1; }
+        break;
+      case 'd': decimation = atoi(optarg); break;
+      case 'b': config.buffer_size = (uint32_t)strtoul(optarg, 0, 0) * 1024 * 1024; break;
+      case 's': config.slot_size = (uint32_t)strtoul(optarg, 0, 0) * 1024; break;
+      case 'B': backend = *optarg ? optarg : 0; break;
+      default:
+        usage(argv[0]);
+        return opt == 'h' ? 0 : -1;
+    }
+  }
+  if (optind != argc || readers < 0 || readers > MAX_READERS || (attach && readers == 0)) {
+    usage(argv[0]);
+    return -1;
+  }
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+
+  /* the readers first, before any thread of libsddc runs */
+  pid_t pids[MAX_READERS];
+  int fds[MAX_READERS];
+  for (int i = 0; i < readers; i++) {
+    int p[2];
+    if (pipe(p) != 0) {
+      perror("pipe");
+      return -1;
+    }
+    pids[i] = fork();
+    if (pids[i] == 0) {
+      close(p[0]);
+      /* past the publisher's own end, to read what it published */
+      run_reader(name, runtime ? runtime + (attach ? 0 : 5) : 0, p[1]);
+      _exit(0);
+    }
+    close(p[1]);
+    fds[i] = p[0];
+  }
+
+  int ret_val = -1;
+  libsddc_handler_t sddc = 0;
+  sddc_shm_stats_t stats;
+  memset(&stats, 0, sizeof(stats));
+
+  if (!attach) {
+    sddc = sddc_create();
+    if (backend && sddc_set_backend(sddc, backend) != ERR_SUCCESS) {
+      fprintf(stderr, "ERROR - invalid backend '%s'\n", backend);
+      goto DONE;
+    }
+    if (sddc_init(sddc, 0) != ERR_SUCCESS) {
+      fprintf(stderr, "ERROR - sddc_init() failed\n");
+      goto DONE;
+    }
+    if (sddc_set_adc_sample_rate(sddc, sample_rate) != ERR_SUCCESS ||
+        sddc_set_raw_mode(sddc, !iq) != ERR_SUCCESS ||
+        (iq && (sddc_set_decimation(sddc, decimation) != ERR_SUCCESS ||
+                sddc_set_iq_format(sddc, iq_format, 0, false) != ERR_SUCCESS))) {
+      fprintf(stderr, "ERROR - failed to configure the stream\n");
+      goto DONE;
+    }
+
+    sddc_err_t ret = sddc_start_shm(sddc, name, &config);
+    if (ret != ERR_SUCCESS) {
+      fprintf(stderr, "ERROR - sddc_start_shm() failed : %d\n", ret);
+      goto DONE;
+    }
+    if (sddc_start_streaming(sddc) != ERR_SUCCESS) {
+      fprintf(stderr, "ERROR - sddc_start_streaming() failed\n");
+      goto DONE;
+    }
+    fprintf(stderr, "publishing %s samples to %s for %d readers %s\n", iq ? "IQ" : "raw ADC", name, readers,
+            runtime ? "" : "until Ctrl-C");
+
+    const double start = now_seconds();
+    double last = start;
+    uint64_t last_bytes = 0;
+    while (!stop_publishing && (runtime == 0 || now_seconds() - start < runtime)) {
+      usleep(1000000);
+
+      double t = now_seconds();
+      sddc_get_shm_stats(sddc, &stats);
+      fprintf(stderr, "%7.0f s  %8.1f MB/s  %u readers  lag %4llu slots  dropped %llu slots\n",
+              t - start, (stats.bytes_published - last_bytes) / (t - last) / 1e6, stats.readers,
+              (unsigned long long)stats.max_lag, (unsigned long long)stats.slots_dropped);
+      last = t;
+      last_bytes = stats.bytes_published;
+    }
+
+    /* the readers see the end of the stream */
+    sddc_stop_streaming(sddc);
+    sddc_stop_shm(sddc);
+    sddc_get_shm_stats(sddc, &stats);
+    fprintf(stderr, "%llu bytes published in %llu slots, a ring of %u\n", (unsigned long long)stats.bytes_published,
+            (unsigned long long)stats.slots_published, stats.slot_count);
+  }
+  ret_val = 0;
+
+DONE:
+  if (sddc)
+    sddc_destroy(sddc);
+
+  /* a reader waiting for a publisher which never came gives up by itself */
+  double total = 0;
+  for (int i = 0; i < readers; i++) {
+    reader_result_t result;
+    if (read(fds[i], &result, sizeof(result)) != sizeof(result)) {
+      fprintf(stderr, "reader %d: no result\n", i);
+      ret_val = -1;
+    } else if (result.error) {
+      fprintf(stderr, "reader %d: sddc_shm_open() failed : %d\n", i, result.error);
+      ret_val = -1;
+    } else {
+      double rate = result.seconds > 0 ? result.bytes / result.seconds / 1e6 : 0;
+      total += rate;
+      fprintf(stderr, "reader %d: %8.1f MB/s  %llu blocks  %llu dropped  %llu overruns\n", i, rate,
+              (unsigned long long)result.blocks, (unsigned long long)result.dropped,
+              (unsigned long long)result.overruns);
+      if (ret_val == 0 && (result.dropped || result.overruns))
+        ret_val = 1;
+    }
+    close(fds[i]);
+    waitpid(pids[i], 0, 0);
+  }
+  if (readers)
+    fprintf(stderr, "%d readers: %.1f MB/s together\n", readers, total);
+
+  return ret_val;
+}
@@ -0,0 +1,154 @@
+/*
+ * sddc_tcp - serves the samples of a libsddc stream to rtl_tcp clients
+ *            on the network, several at once
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libsddc.h"
+
+static volatile sig_atomic_t stop_server = 0;
+
+static void on_signal(int sig)
+{
+  (void)sig;
+  stop_server = 1;
+}
+
+static void usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [options]\n", name);
+  fprintf(stderr, "  -a address       IPv4 address to listen on (default all the interfaces)\n");
+  fprintf(stderr, "  -p port          TCP port (default 1234)\n");
+  fprintf(stderr, "  -n clients       clients served at once (default 8)\n");
+  fprintf(stderr, "  -r adc_rate      ADC sample rate (default 64000000)\n");
+  fprintf(stderr, "  -d decimation    IQ decimation of the stream, the clients may decimate further (default 4)\n");
+  fprintf(stderr, "  -f frequency     initial center frequency\n");
+  fprintf(stderr, "  -b buffer_ms     how far behind a client may fall (default 500)\n");
+  fprintf(stderr, "  -D               disconnect the clients falling behind instead of skipping samples\n");
+  fprintf(stderr, "  -s scale         factor applied to the IQ samples before the 8 bit conversion (default 127)\n");
+  fprintf(stderr, "  -R               read only: ignore the frequency and gain commands of the clients\n");
+  fprintf(stderr, "  -x               serve the raw ADC samples (int16) instead of IQ\n");
+  fprintf(stderr, "  -B backend       e.g. \"generator,tones=7.1e6:-30\" to serve without a radio\n");
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t sample_rate = 64000000;
+  int decimation = 4;
+  uint32_t frequency = 0;
+  int raw = 0;
+  const char *backend = 0;
+  sddc_server_config_t config = { 0, 1234, 0, 0, SDDC_DROP_SKIP, 0, false };
+
+  int opt;
+  while ((opt = getopt(argc, argv, "a:p:n:r:d:f:b:Ds:RxB:h")) != -1) {
+    switch (opt) {
+      case 'a': config.address = optarg; break;
+      case 'p': config.port = (uint16_t)atoi(optarg); break;
+      case 'n': config.max_clients = (uint32_t)strtoul(optarg, 0, 0); break;
+      case 'r': sample_rate = (uint32_t)strtoul(optarg, 0, 0); break;
+      case 'd': decimation = atoi(optarg); break;
+      case 'f': frequency = (uint32_t)strtoul(optarg, 0, 0); break;
+      case 'b': config.buffer_ms = (uint32_t)strtoul(optarg, 0, 0); break;
+      case 'D': config.drop_policy = SDDC_DROP_DISCONNECT; break;
+      case 's': config.scale = (float)atof(optarg); break;
+      case 'R': config.read_only = true; break;
+      case 'x': raw = 1; break;
+      case 'B': backend = optarg; break;
+      default:
+        usage(argv[0]);
+        return opt == 'h' ? 0 : -1;
+    }
+  }
+  if (optind != argc) {
+    usage(argv[0]);
+    return -1;
+  }
+
+  int ret_val = -1;
+  libsddc_handler_t sddc = sddc_create();
+
+  if (backend && sddc_set_backend(sddc, backend) != ERR_SUCCESS) {
+    fprintf(stderr, "ERROR - invalid backend '%s'\n", backend);
+    sddc_destroy(sddc);
+    return -1;
+  }
+
+  sddc_err_t ret = sddc_init(sddc, 0);
+  if (ret != ERR_SUCCESS) {
+    fprintf(stderr, "ERROR - sddc_init() failed : %d\n", ret);
+    sddc_destroy(sddc);
+    return -1;
+  }
+
+  if (sddc_set_adc_sample_rate(sddc, sample_rate) != ERR_SUCCESS ||
+      sddc_set_raw_mode(sddc, raw) != ERR_SUCCESS ||
+      (!raw && sddc_set_decimation(sddc, decimation) != ERR_SUCCESS)) {
+    fprintf(stderr, "ERROR - failed to configure the stream\n");
+    goto DONE;
+  }
+  if (frequency)
+    sddc_set_center_frequency(sddc, frequency);
+
+  ret = sddc_start_server(sddc, &config);
+  if (ret != ERR_SUCCESS) {
+    fprintf(stderr, "ERROR - starting the server failed : %d\n", ret);
+    goto DONE;
+  }
+
+  if (sddc_start_streaming(sddc) != ERR_SUCCESS) {
+    fprintf(stderr, "ERROR - sddc_start_streaming() failed\n");
+    goto DONE;
+  }
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+
+  sddc_server_stats_t stats;
+  sddc_get_server_stats(sddc, &stats);
+  fprintf(stderr, "serving %s samples on %s:%u until Ctrl-C\n", raw ? "raw ADC" : "IQ",
+          config.address ? config.address : "*", stats.port);
+
+  uint64_t last_bytes = 0;
+  while (!stop_server) {
+    sleep(5);
+
+    sddc_get_server_stats(sddc, &stats);
+    fprintf(stderr, "%u clients  %8.1f MB/s  %u blocks skipped  %u clients dropped  %u refused\n",
+            stats.clients, (stats.bytes_sent - last_bytes) / 5.0 / 1e6,
+            stats.blocks_dropped, stats.clients_dropped, stats.clients_refused);
+    last_bytes = stats.bytes_sent;
+  }
+
+  sddc_stop_streaming(sddc);
+  sddc_stop_server(sddc);
+  sddc_get_server_stats(sddc, &stats);
+  fprintf(stderr, "%u clients served, %llu bytes sent\n", stats.clients_total,
+          (unsigned long long)stats.bytes_sent);
+  ret_val = 0;
+
+DONE:
+  sddc_destroy(sddc);
+
+  return ret_val;
+}
@@ -93,8 +93,8 @@ clock_gettime(int X, struct timeval* tv)
 #endif
 
 
-static void count_bytes_callback(uint32_t data_size, uint8_t *data,
-                                 void *context);
+static void count_samples_callback(uint32_t data_size, const int16_t *data,
+                                   void *context);
 
 static unsigned long long received_samples = 0;
 static unsigned long long total_samples = 0;
@@ -147,7 +147,9 @@ int main(int argc, char **argv)
     goto DONE;
   }
 
-  if (sddc_set_stream_callback(sddc, count_bytes_callback, sddc) < 0) {
+  /* real ADC samples */
+  if (sddc_set_raw_mode(sddc, true) < 0 ||
+      sddc_set_real_stream_callback(sddc, count_samples_callback, sddc) < 0) {
     fprintf(stderr, "ERROR - sddc_set_async_params() failed\n");
     goto DONE;
   }
@@ -199,11 +201,12 @@ int main(int argc, char **argv)
   if (outfilename && sampleData && received_samples) {
     FILE * f = fopen(outfilename, "wb");
     if (f) {
+      waveWriter wave = { 0 };
       fprintf(stderr, "saving received real samples to file ..\n");
-      waveWriteHeader( (unsigned)(0.5 + sample_rate), 0U /*frequency*/, 16 /*bitsPerSample*/, 1 /*numChannels*/, f);
+      waveWriteHeader(&wave, (unsigned)(0.5 + sample_rate), 0U /*frequency*/, 16 /*bitsPerSample*/, 1 /*numChannels*/, f);
       for ( unsigned long long off = 0; off + 65536 < received_samples; off += 65536 )
-        waveWriteSamples(f,  sampleData + off, 65536, 0 /*needCleanData*/);
-      waveFinalizeHeader(f);
+        waveWriteSamples(&wave, f,  sampleData + off, 65536, 0 /*needCleanData*/);
+      waveFinalizeHeader(&wave, f);
       fclose(f);
     }
   }
@@ -217,17 +220,17 @@ DONE:
   return ret_val;
 }
 
-static void count_bytes_callback(uint32_t data_size,
-                                 uint8_t *data,
-                                 void *context)
+static void count_samples_callback(uint32_t data_size,
+                                   const int16_t *data,
+                                   void *context)
 {
   if (stop_reception)
     return;
   ++num_callbacks;
-  unsigned N = data_size / sizeof(int16_t);
+  unsigned N = data_size;
   if ( received_samples + N < total_samples ) {
     if (sampleData)
-      memcpy( sampleData+received_samples, data, data_size);
+      memcpy( sampleData+received_samples, data, N * sizeof(int16_t));
     received_samples += N;
   }
   else {
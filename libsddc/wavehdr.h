@@ -51,6 +51,19 @@ typedef struct
 	char		waveID[4];	/* "WAVE" string */
 } riff_chunk;
 
+typedef struct
+{
+	/* ds64 header - RF64 / BW64 (EBU Tech 3306): the sizes which do not fit in 32 bits */
+	chunk_hdr	hdr;		/* ="ds64", or ="JUNK" (same size, ignored by the readers) while the file stays below 4 GiB */
+	uint32_t	riffSizeLow;
+	uint32_t	riffSizeHigh;
+	uint32_t	dataSizeLow;
+	uint32_t	dataSizeHigh;
+	uint32_t	sampleCountLow;
+	uint32_t	sampleCountHigh;
+	uint32_t	tableLength;	/* no other chunk needs a 64 bit size */
+} ds64_chunk;
+
 typedef struct
 {
 	/* FMT header */
@@ -88,7 +101,8 @@ typedef struct
 
 typedef struct
 {
-	riff_chunk r;
+	riff_chunk r;		/* "RIFF", or "RF64" with the sizes set to 0xFFFFFFFF and given by ds64 */
+	ds64_chunk j;
 	fmt_chunk  f;
 	auxi_chunk a;
 	data_chunk d;
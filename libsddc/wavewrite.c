@@ -61,11 +61,23 @@ int gettimeofday(struct timeval * tp, struct timezone * tzp)
 
 #include "wavehdr.h"
 
-static waveFileHeader waveHdr;
+#ifdef _WIN32
+#define waveSeek	_fseeki64
+#define waveTell	_ftelli64
+#else
+#define waveSeek	fseeko
+#define waveTell	ftello
+#endif
 
-static uint32_t	waveDataSize = 0;
-int	waveHdrStarted = 0;
 
+static void waveGmTime(time_t tim, struct tm *t)
+{
+#ifdef _WIN32
+	gmtime_s(t, &tim);
+#else
+	gmtime_r(&tim, t);
+#endif
+}
 
 static void waveSetCurrTime(Wind_SystemTime *p)
 {
@@ -75,11 +87,7 @@ static void waveSetCurrTime(Wind_SystemTime *p)
 	gettimeofday(&tv, NULL);
 	p->wMilliseconds = tv.tv_usec / 1000;
 
-#ifdef _WIN32
-	t = *gmtime(&tv.tv_sec);
-#else
-	gmtime_r(&tv.tv_sec, &t);
-#endif
+	waveGmTime(tv.tv_sec, &t);
 
 	p->wYear = t.tm_year + 1900;	/* 1601 through 30827 */
 	p->wMonth = t.tm_mon + 1;		/* 1..12 */
@@ -92,7 +100,8 @@ static void waveSetCurrTime(Wind_SystemTime *p)
 
 static void waveSetStartTimeInt(time_t tim, double fraction, Wind_SystemTime *p)
 {
-	struct tm t = *gmtime( &tim );
+	struct tm t;
+	waveGmTime(tim, &t);
 	p->wYear = t.tm_year + 1900;	/* 1601 through 30827 */
 	p->wMonth = t.tm_mon + 1;		/* 1..12 */
 	p->wDayOfWeek = t.tm_wday;		/* 0 .. 6: 0 == Sunday, .., 6 == Saturday */
@@ -105,64 +114,69 @@ static void waveSetStartTimeInt(time_t tim, double fraction, Wind_SystemTime *p)
 		p->wMilliseconds = 999;
 }
 
-void waveSetStartTime(time_t tim, double fraction)
+void waveSetStartTime(waveWriter * w, time_t tim, double fraction)
 {
-	waveSetStartTimeInt(tim, fraction, &waveHdr.a.StartTime );
-	waveHdr.a.StopTime = waveHdr.a.StartTime;		/* to fix */
+	waveSetStartTimeInt(tim, fraction, &w->hdr.a.StartTime );
+	w->hdr.a.StopTime = w->hdr.a.StartTime;		/* to fix */
 }
 
 
-void wavePrepareHeader(unsigned samplerate, unsigned freq, int bitsPerSample, int numChannels)
+static void wavePrepareHeader(waveFileHeader *h, unsigned samplerate, unsigned freq, int bitsPerSample, int numChannels)
 {
 	int	bytesPerSample = bitsPerSample / 8;
 	int bytesPerFrame = bytesPerSample * numChannels;
 
-	memcpy( waveHdr.r.hdr.ID, "RIFF", 4 );
-	waveHdr.r.hdr.size = sizeof(waveFileHeader) - 8;		/* to fix */
-	memcpy( waveHdr.r.waveID, "WAVE", 4 );
-
-	memcpy( waveHdr.f.hdr.ID, "fmt ", 4 );
-	waveHdr.f.hdr.size = 16;
-	waveHdr.f.wFormatTag = 1;					/* PCM */
-	waveHdr.f.nChannels = numChannels;		/* I and Q channels */
-	waveHdr.f.nSamplesPerSec = samplerate;
-	waveHdr.f.nAvgBytesPerSec = samplerate * bytesPerFrame;
-	waveHdr.f.nBlockAlign = waveHdr.f.nChannels;
-	waveHdr.f.nBitsPerSample = bitsPerSample;
-
-	memcpy( waveHdr.a.hdr.ID, "auxi", 4 );
-	waveHdr.a.hdr.size = 2 * sizeof(Wind_SystemTime) + 9 * sizeof(int32_t);  /* = 2 * 16 + 9 * 4 = 68 */
-	waveSetCurrTime( &waveHdr.a.StartTime );
-	waveHdr.a.StopTime = waveHdr.a.StartTime;		/* to fix */
-	waveHdr.a.centerFreq = freq;
-	waveHdr.a.ADsamplerate = samplerate;
-	waveHdr.a.IFFrequency = 0;
-	waveHdr.a.Bandwidth = 0;
-	waveHdr.a.IQOffset = 0;
-	waveHdr.a.Unused2 = 0;
-	waveHdr.a.Unused3 = 0;
-	waveHdr.a.Unused4 = 0;
-	waveHdr.a.Unused5 = 0;
-
-	memcpy( waveHdr.d.hdr.ID, "data", 4 );
-	waveHdr.d.hdr.size = 0;		/* to fix later */
-	waveDataSize = 0;
+	memset( h, 0, sizeof(waveFileHeader) );
+
+	memcpy( h->r.hdr.ID, "RIFF", 4 );
+	h->r.hdr.size = sizeof(waveFileHeader) - 8;		/* to fix */
+	memcpy( h->r.waveID, "WAVE", 4 );
+
+	/* room for the ds64 chunk, in case the file grows past 4 GiB */
+	memcpy( h->j.hdr.ID, "JUNK", 4 );
+	h->j.hdr.size = sizeof(ds64_chunk) - sizeof(chunk_hdr);	/* = 28 */
+
+	memcpy( h->f.hdr.ID, "fmt ", 4 );
+	h->f.hdr.size = 16;
+	h->f.wFormatTag = 1;					/* PCM */
+	h->f.nChannels = numChannels;		/* I and Q channels */
+	h->f.nSamplesPerSec = samplerate;
+	h->f.nAvgBytesPerSec = samplerate * bytesPerFrame;
+	h->f.nBlockAlign = bytesPerFrame;
+	h->f.nBitsPerSample = bitsPerSample;
+
+	memcpy( h->a.hdr.ID, "auxi", 4 );
+	h->a.hdr.size = 2 * sizeof(Wind_SystemTime) + 9 * sizeof(int32_t);  /* = 2 * 16 + 9 * 4 = 68 */
+	waveSetCurrTime( &h->a.StartTime );
+	h->a.StopTime = h->a.StartTime;		/* to fix */
+	h->a.centerFreq = freq;
+	h->a.ADsamplerate = samplerate;
+	h->a.IFFrequency = 0;
+	h->a.Bandwidth = 0;
+	h->a.IQOffset = 0;
+	h->a.Unused2 = 0;
+	h->a.Unused3 = 0;
+	h->a.Unused4 = 0;
+	h->a.Unused5 = 0;
+
+	memcpy( h->d.hdr.ID, "data", 4 );
+	h->d.hdr.size = 0;		/* to fix later */
 }
 
-void waveWriteHeader(unsigned samplerate, unsigned freq, int bitsPerSample, int numChannels, FILE * f)
+void waveWriteHeader(waveWriter * w, unsigned samplerate, unsigned freq, int bitsPerSample, int numChannels, FILE * f)
 {
 	if (f != stdout) {
-		assert( !waveHdrStarted );
-		wavePrepareHeader(samplerate, freq, bitsPerSample, numChannels);
-		fwrite(&waveHdr, sizeof(waveFileHeader), 1, f);
-		waveHdrStarted = 1;
+		assert( !w->started );
+		wavePrepareHeader(&w->hdr, samplerate, freq, bitsPerSample, numChannels);
+		fwrite(&w->hdr, sizeof(waveFileHeader), 1, f);
+		w->started = 1;
 	}
 }
 
-int  waveWriteSamples(FILE* f,  void * vpData, size_t numSamples, int needCleanData)
+int  waveWriteSamples(waveWriter * w, FILE* f,  void * vpData, size_t numSamples, int needCleanData)
 {
 	size_t nw;
-	switch (waveHdr.f.nBitsPerSample)
+	switch (w->hdr.f.nBitsPerSample)
 	{
 	case 0:
 	default:
@@ -170,12 +184,10 @@ int  waveWriteSamples(FILE* f,  void * vpData, size_t numSamples, int needCleanD
 	case 8:
 		/* no endian conversion needed for single bytes */
 		nw = fwrite(vpData, sizeof(uint8_t), numSamples, f);
-		waveDataSize += sizeof(uint8_t) * numSamples;
 		return (nw == numSamples) ? 0 : 1;
 	case 16:
 		/* TODO: endian conversion needed */
 		nw = fwrite(vpData, sizeof(int16_t), numSamples, f);
-		waveDataSize += sizeof(int16_t) * numSamples;
 		if ( needCleanData )
 		{
 			/* TODO: convert back endianness */
@@ -184,23 +196,21 @@ int  waveWriteSamples(FILE* f,  void * vpData, size_t numSamples, int needCleanD
 	}
 }
 
-int  waveWriteFrames(FILE* f,  void * vpData, size_t numFrames, int needCleanData)
+int  waveWriteFrames(waveWriter * w, FILE* f,  void * vpData, size_t numFrames, int needCleanData)
 {
 	size_t nw;
-	switch (waveHdr.f.nBitsPerSample)
+	switch (w->hdr.f.nBitsPerSample)
 	{
 	case 0:
 	default:
 		return 1;
 	case 8:
 		/* no endian conversion needed for single bytes */
-		nw = fwrite(vpData, waveHdr.f.nChannels * sizeof(uint8_t), numFrames, f);
-		waveDataSize += waveHdr.f.nChannels * sizeof(uint8_t) * numFrames;
+		nw = fwrite(vpData, w->hdr.f.nChannels * sizeof(uint8_t), numFrames, f);
 		return (nw == numFrames) ? 0 : 1;
 	case 16:
 		/* TODO: endian conversion needed */
-		nw = fwrite(vpData, waveHdr.f.nChannels * sizeof(int16_t), numFrames, f);
-		waveDataSize += waveHdr.f.nChannels * sizeof(int16_t) * numFrames;
+		nw = fwrite(vpData, w->hdr.f.nChannels * sizeof(int16_t), numFrames, f);
 		if ( needCleanData )
 		{
 			/* TODO: convert back endianness */
@@ -210,18 +220,46 @@ int  waveWriteFrames(FILE* f,  void * vpData, size_t numFrames, int needCleanDat
 }
 
 
-int  waveFinalizeHeader(FILE * f)
+int  waveFinalizeHeader(waveWriter * w, FILE * f)
 {
 	if (f != stdout) {
-		assert( waveHdrStarted );
-		waveSetCurrTime( &waveHdr.a.StopTime );
-		waveHdr.d.hdr.size = waveDataSize;
-		waveHdr.r.hdr.size += waveDataSize;
-		/* fprintf(stderr, "waveFinalizeHeader(): datasize = %d\n", waveHdr.dataSize); */
-		waveHdrStarted = 0;
-		if ( fseek(f, 0, SEEK_SET) )
+		waveFileHeader *h = &w->hdr;
+		uint64_t fileSize, dataSize;
+
+		assert( w->started );
+		w->started = 0;
+		waveSetCurrTime( &h->a.StopTime );
+
+		/* everything after the header is data */
+		if ( waveSeek(f, 0, SEEK_END) )
+			return 1;
+		fileSize = (uint64_t)waveTell(f);
+		dataSize = fileSize - sizeof(waveFileHeader);
+
+		if ( fileSize - 8 > 0xFFFFFFFFu ) {
+			/* RF64: the 32 bit sizes are set to -1, the real ones go to ds64 */
+			uint64_t sampleCount = dataSize / h->f.nBlockAlign;
+			memcpy( h->r.hdr.ID, "RF64", 4 );
+			h->r.hdr.size = 0xFFFFFFFFu;
+			memcpy( h->j.hdr.ID, "ds64", 4 );
+			h->j.riffSizeLow = (uint32_t)(fileSize - 8);
+			h->j.riffSizeHigh = (uint32_t)((fileSize - 8) >> 32);
+			h->j.dataSizeLow = (uint32_t)dataSize;
+			h->j.dataSizeHigh = (uint32_t)(dataSize >> 32);
+			h->j.sampleCountLow = (uint32_t)sampleCount;
+			h->j.sampleCountHigh = (uint32_t)(sampleCount >> 32);
+			h->j.tableLength = 0;
+			h->d.hdr.size = 0xFFFFFFFFu;
+		}
+		else {
+			h->r.hdr.size = (uint32_t)(fileSize - 8);
+			h->d.hdr.size = (uint32_t)dataSize;
+		}
+
+		/* fprintf(stderr, "waveFinalizeHeader(): datasize = %llu\n", dataSize); */
+		if ( waveSeek(f, 0, SEEK_SET) )
 			return 1;
-		if ( 1 != fwrite(&waveHdr, sizeof(waveFileHeader), 1, f) )
+		if ( 1 != fwrite(h, sizeof(waveFileHeader), 1, f) )
 			return 1;
 		/* fprintf(stderr, "waveFinalizeHeader(): success writing header\n"); */
 		return 0;
@@ -21,11 +21,18 @@
 #include <stdio.h>
 #include <time.h>
 
+#include "wavehdr.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-extern int	waveHdrStarted;
+/* state of one file being written, several files can be written at once */
+typedef struct
+{
+	waveFileHeader	hdr;
+	int		started;
+} waveWriter;
 
 /*!
  * helper functions to write and finalize wave headers
@@ -34,19 +41,22 @@ extern int	waveHdrStarted;
  * call waveWriteHeader() before writing anything to to file
  * and call waveFinalizeHeader() afterwards,
  * stdout/stderr can't be used, because seek to begin isn't possible.
- * 
+ *
+ * the data size is taken from the end of the file when finalizing:
+ * past 4 GiB the file becomes an RF64 file (EBU Tech 3306), the header
+ * keeps room for it from the start.
  */
 
-void waveWriteHeader(unsigned samplerate, unsigned freq, int bitsPerSample, int numChannels, FILE * f);
+void waveWriteHeader(waveWriter * w, unsigned samplerate, unsigned freq, int bitsPerSample, int numChannels, FILE * f);
 
 /* waveWriteFrames() writes (numFrames * numChannels) samples
  * waveWriteSamples()
  * both return 0, when no errors occured
  */
-int  waveWriteFrames(FILE* f,  void * vpData, size_t numFrames, int needCleanData);
-int  waveWriteSamples(FILE* f,  void * vpData, size_t numSamples, int needCleanData);  /* returns 0, when no errors occured */
-void waveSetStartTime(time_t t, double fraction);
-int  waveFinalizeHeader(FILE * f);      /* returns 0, when no errors occured */
+int  waveWriteFrames(waveWriter * w, FILE* f,  void * vpData, size_t numFrames, int needCleanData);
+int  waveWriteSamples(waveWriter * w, FILE* f,  void * vpData, size_t numSamples, int needCleanData);  /* returns 0, when no errors occured */
+void waveSetStartTime(waveWriter * w, time_t t, double fraction);	/* after waveWriteHeader() */
+int  waveFinalizeHeader(waveWriter * w, FILE * f);      /* returns 0, when no errors occured */
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,218 @@
+#include "record/adc_codec.h"
+#include "record/adc_encoder.h"
+#include "record/recorder.h"
+#include "RadioHandler.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <thread>
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+namespace {
+    struct AdcCodecFixture {};
+
+    const char* record_path = "adc_codec_test.sdz";
+
+    uint32_t Random(uint32_t& state)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // A tone over a noise floor of about `noise` LSB, with the ADC saturation
+    std::vector<int16_t> Signal(size_t count, double noise, uint32_t seed = 1)
+    {
+        std::vector<int16_t> samples(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            double n = 0;
+            for (int j = 0; j < 4; j++)
+                n += (int32_t)(Random(seed) & 0xFFFF) - 32768;
+            double v = 3000 * sin(i * 0.05) + noise * n / 37837.0;
+            samples[i] = (int16_t)std::max(-32768.0, std::min(32767.0, v));
+        }
+        return samples;
+    }
+
+    std::vector<int16_t> RoundTrip(const std::vector<int16_t>& samples, size_t* size = nullptr)
+    {
+        std::vector<uint8_t> frame(adc_codec::MaxEncodedSize(samples.size()));
+        size_t encoded = adc_codec::Encode(samples.data(), samples.size(), 0, frame.data());
+        if (size)
+            *size = encoded;
+
+        adc_codec::frame_header header;
+        std::vector<int16_t> decoded(samples.size());
+        if (!adc_codec::ReadHeader(frame.data(), encoded, &header) || header.samples != samples.size() ||
+            sizeof(header) + header.payload_size != encoded ||
+            !adc_codec::Decode(header, frame.data() + sizeof(header), decoded.data()))
+            decoded.clear();
+        return decoded;
+    }
+
+    struct Received {
+        uint64_t samples = 0;
+        uint64_t check_until = 0;
+        const std::vector<int16_t>* expected = nullptr;
+        bool content_ok = true;
+    };
+
+    void RealCallback(void* context, const int16_t* data, uint32_t len, int64_t)
+    {
+        auto received = (Received*)context;
+        const auto& expected = *received->expected;
+        for (uint32_t i = 0; i < len && received->samples + i < received->check_until; i++)
+        {
+            if (data[i] != expected[(received->samples + i) % expected.size()])
+                received->content_ok = false;
+        }
+        received->samples += len;
+    }
+}
+
+TEST_CASE(AdcCodecFixture, RoundTripTest)
+{
+    // Quiet, loud, and lengths which are not a whole number of partitions
+    for (double noise : { 0.0, 4.0, 300.0, 20000.0 })
+    {
+        for (size_t count : { (size_t)0, (size_t)1, (size_t)255, (size_t)257, (size_t)transferSamples })
+        {
+            auto samples = Signal(count, noise);
+            REQUIRE_TRUE(RoundTrip(samples) == samples);
+        }
+    }
+
+    // Full scale steps: the residuals of order 2 take the escape
+    std::vector<int16_t> steps(1000);
+    for (size_t i = 0; i < steps.size(); i++)
+        steps[i] = (i / 3) % 2 ? 32767 : -32768;
+    REQUIRE_TRUE(RoundTrip(steps) == steps);
+
+    // Random 16 bit words are stored verbatim, at most a few bytes larger
+    std::vector<int16_t> random(transferSamples);
+    uint32_t seed = 7;
+    for (auto& s : random)
+        s = (int16_t)Random(seed);
+    size_t size;
+    REQUIRE_TRUE(RoundTrip(random, &size) == random);
+    REQUIRE_TRUE(size <= adc_codec::MaxEncodedSize(random.size()));
+    REQUIRE_TRUE(size < random.size() * sizeof(int16_t) * 1.01);
+
+    // RAND encoded samples compress as well as the plain ones
+    auto plain = Signal(transferSamples, 300);
+    auto rand = plain;
+    for (auto& s : rand)
+        s = (int16_t)(s & 1 ? s ^ 0xFFFE : s);
+    size_t plain_size, rand_size;
+    REQUIRE_TRUE(RoundTrip(plain, &plain_size) == plain);
+    REQUIRE_TRUE(RoundTrip(rand, &rand_size) == rand);
+    REQUIRE_TRUE(rand_size < plain_size * 1.01);
+    REQUIRE_TRUE(plain_size < plain.size() * sizeof(int16_t) / 1.3);
+}
+
+TEST_CASE(AdcCodecFixture, DamagedTest)
+{
+    auto samples = Signal(transferSamples, 300);
+    std::vector<uint8_t> frame(adc_codec::MaxEncodedSize(samples.size()));
+    size_t size = adc_codec::Encode(samples.data(), samples.size(), 0, frame.data());
+
+    adc_codec::frame_header header;
+    REQUIRE_FALSE(adc_codec::ReadHeader(frame.data(), sizeof(header) - 1, &header));
+    REQUIRE_TRUE(adc_codec::ReadHeader(frame.data(), size, &header));
+
+    // Cut short: the decoder runs out of bits
+    std::vector<int16_t> decoded(samples.size());
+    header.payload_size /= 2;
+    REQUIRE_FALSE(adc_codec::Decode(header, frame.data() + sizeof(header), decoded.data()));
+
+    frame[0] ^= 1;
+    REQUIRE_FALSE(adc_codec::ReadHeader(frame.data(), size, &header));
+}
+
+TEST_CASE(AdcCodecFixture, EncoderTest)
+{
+    // Blocks of varying sizes through 3 threads: the frames come out in order
+    std::vector<std::vector<int16_t>> blocks;
+    for (int b = 0; b < 100; b++)
+        blocks.push_back(Signal(1000 + b * 97, b % 2 ? 10 : 1000, b + 1));
+
+    std::vector<std::vector<uint8_t>> frames;
+    adc_encoder encoder;
+    encoder.Start(3, [&](const uint8_t* frame, size_t size, size_t) {
+        frames.emplace_back(frame, frame + size);
+        return true;
+    }, sddc_thread_config_t{});
+
+    for (auto& block : blocks)
+    {
+        while (!encoder.Submit(block.data(), block.size()))
+            std::this_thread::sleep_for(1ms);
+    }
+    encoder.Stop();
+
+    REQUIRE_EQUAL(frames.size(), blocks.size());
+    uint64_t first_sample = 0;
+    for (size_t b = 0; b < blocks.size(); b++)
+    {
+        adc_codec::frame_header header;
+        REQUIRE_TRUE(adc_codec::ReadHeader(frames[b].data(), frames[b].size(), &header));
+        // A refused block still counts in the stream position, as a gap
+        REQUIRE_TRUE(header.first_sample >= first_sample);
+        std::vector<int16_t> decoded(header.samples);
+        REQUIRE_TRUE(adc_codec::Decode(header, frames[b].data() + sizeof(header), decoded.data()));
+        REQUIRE_TRUE(decoded == blocks[b]);
+        first_sample = header.first_sample + header.samples;
+    }
+}
+
+TEST_CASE(AdcCodecFixture, ReplayTest)
+{
+    // A compressed recording replayed bit exact, several times over
+    const size_t block = transferSamples;
+    auto samples = Signal(block * 6 + 500, 100);
+
+    sddc_record_config_t config = recorder::GetDefaultConfig();
+    config.buffer_size = 16 * 65536;
+    config.chunk_size = 65536;
+    config.encoder_threads = 2;
+
+    recorder rec;
+    REQUIRE_EQUAL(rec.Open(record_path, &config), ERR_SUCCESS);
+    for (size_t i = 0; i < samples.size(); i += block)
+    {
+        size_t n = std::min(block, samples.size() - i);
+        while (!rec.Write(samples.data() + i, n * sizeof(int16_t)))
+            std::this_thread::sleep_for(1ms);
+    }
+    REQUIRE_EQUAL(rec.Close(), ERR_SUCCESS);
+
+    auto stats = rec.GetStats();
+    REQUIRE_EQUAL(stats.bytes_recorded, (uint64_t)samples.size() * sizeof(int16_t));
+    REQUIRE_TRUE(stats.bytes_written < stats.bytes_recorded / 1.3);
+
+    RadioHandler radio;
+    REQUIRE_EQUAL(radio.SetBackend((std::string("replay,speed=max,file=") + record_path).c_str()), ERR_SUCCESS);
+    REQUIRE_EQUAL(radio.Init(0), ERR_SUCCESS);
+
+    Received received;
+    received.expected = &samples;
+    received.check_until = samples.size() * 3;
+    radio.AttachReal(RealCallback, &received);
+    auto start = steady_clock::now();
+    radio.Start(false);
+    while (received.samples < received.check_until && steady_clock::now() - start < 10s)
+        std::this_thread::sleep_for(1ms);
+    radio.Stop();
+
+    REQUIRE_TRUE(received.samples >= received.check_until);
+    REQUIRE_TRUE(received.content_ok);
+
+    remove(record_path);
+}
@@ -0,0 +1,49 @@
+#include "dsp/allocator.h"
+#include "dsp/ringbuffer.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <stdint.h>
+
+namespace {
+    struct AllocatorFixture {};
+}
+
+TEST_CASE(AllocatorFixture, AlignmentTest)
+{
+    const size_t sizes[] = { 1, 100, 4096, 64 * 1024, 3 * 1024 * 1024 };
+
+    for (auto size : sizes)
+    {
+        auto ptr = (uint8_t*)sddc_alloc(size);
+        REQUIRE_TRUE(ptr != nullptr);
+        REQUIRE_EQUAL((uintptr_t)ptr % SDDC_CACHELINE_SIZE, 0u);
+
+        // Blocks come back zeroed (pre-faulted)
+        REQUIRE_EQUAL(ptr[0], 0);
+        REQUIRE_EQUAL(ptr[size - 1], 0);
+        memset(ptr, 0x5A, size);
+
+        sddc_mem_bind_current_node(ptr);
+        sddc_free(ptr);
+    }
+}
+
+TEST_CASE(AllocatorFixture, RingBufferTest)
+{
+    ringbuffer<sddc_complex_t> buffer(16);
+    buffer.setBlockSize(1000);
+
+    for (int i = 0; i < 16; i++)
+    {
+        REQUIRE_EQUAL((uintptr_t)buffer.peekWritePtr(i) % SDDC_CACHELINE_SIZE, 0u);
+    }
+
+    // resize in place
+    buffer.setBlockSize(transferSamples / 2);
+    REQUIRE_EQUAL(buffer.getBlockSize(), (int)transferSamples / 2);
+
+    sddc_set_hugepages(false);
+    buffer.setBlockSize(transferSamples);
+    REQUIRE_FALSE(buffer.isHugepageBacked());
+    sddc_set_hugepages(true);
+}
@@ -0,0 +1,111 @@
+#include "record/adc_codec.h"
+#include "record/adc_encoder.h"
+#include "RadioHandler.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+namespace {
+    struct AdcCodecFixture {};
+
+    // Real samples of a backend, e.g. the generator or the replay of a capture
+    std::vector<int16_t> Capture(const std::string& backend, size_t count)
+    {
+        struct Received {
+            std::vector<int16_t> samples;
+            size_t wanted;
+        } received;
+        received.wanted = count;
+
+        RadioHandler radio;
+        if (radio.SetBackend(backend.c_str()) != ERR_SUCCESS || radio.Init(0) != ERR_SUCCESS)
+            return received.samples;
+
+        radio.AttachReal([](void* context, const int16_t* data, uint32_t len, int64_t) {
+            auto r = (Received*)context;
+            size_t n = std::min<size_t>(len, r->wanted - std::min(r->wanted, r->samples.size()));
+            r->samples.insert(r->samples.end(), data, data + n);
+        }, &received);
+        radio.Start(false);
+        auto start = steady_clock::now();
+        while (received.samples.size() < count && steady_clock::now() - start < 10s)
+            std::this_thread::sleep_for(1ms);
+        radio.Stop();
+        return received.samples;
+    }
+}
+
+TEST_CASE(AdcCodecFixture, Benchmark)
+{
+    // Compression ratio and throughput on the generator, and on a capture when
+    // SDDC_CODEC_CAPTURE names one (any file the replay backend reads)
+    std::vector<std::pair<std::string, std::string>> sources = {
+        { "tone -20 dBFS",                "generator,tones=10e6:-20,speed=max" },
+        { "tones, noise -50 dBFS",        "generator,tones=7.1e6:-30;14.2e6:-40;21e6:-35,noise=-50,speed=max" },
+        { "tone, noise -30 dBFS",         "generator,noise=-30,speed=max" },
+    };
+    const char* capture = getenv("SDDC_CODEC_CAPTURE");
+    if (capture)
+        sources.push_back({ capture, std::string("replay,loop=0,speed=max,file=") + capture });
+
+    const size_t block = transferSamples;
+    const double realtime = 128e6;   // samples per second at the highest ADC rate
+
+    for (auto& source : sources)
+    {
+        auto samples = Capture(source.second, block * 256);
+        samples.resize(samples.size() / block * block);
+        REQUIRE_TRUE(!samples.empty());
+
+        // One thread, frame by frame
+        std::vector<uint8_t> frame(adc_codec::MaxEncodedSize(block));
+        std::vector<int16_t> decoded(block);
+        uint64_t encoded = 0;
+        duration<double> encode_time(0), decode_time(0);
+        for (size_t i = 0; i < samples.size(); i += block)
+        {
+            auto t0 = steady_clock::now();
+            size_t size = adc_codec::Encode(samples.data() + i, block, i, frame.data());
+            auto t1 = steady_clock::now();
+            adc_codec::frame_header header;
+            adc_codec::ReadHeader(frame.data(), size, &header);
+            adc_codec::Decode(header, frame.data() + sizeof(header), decoded.data());
+            auto t2 = steady_clock::now();
+            encode_time += t1 - t0;
+            decode_time += t2 - t1;
+            encoded += size;
+            REQUIRE_TRUE(std::equal(decoded.begin(), decoded.end(), samples.begin() + i));
+        }
+        printf("%-24s ratio %.2f (%.2f bits/sample), encode %.0f Msps, decode %.0f Msps per thread\n",
+            source.first.c_str(), samples.size() * 2.0 / encoded, encoded * 8.0 / samples.size(),
+            samples.size() / encode_time.count() / 1e6, samples.size() / decode_time.count() / 1e6);
+
+        // The encoder threads, unpaced
+        for (int threads : { 1, 2, 4 })
+        {
+            adc_encoder encoder;
+            encoder.Start(threads, [](const uint8_t*, size_t, size_t) { return true; }, sddc_thread_config_t{});
+            auto start = steady_clock::now();
+            for (int pass = 0; pass < 4; pass++)
+            {
+                for (size_t i = 0; i < samples.size(); i += block)
+                {
+                    while (!encoder.Submit(samples.data() + i, block))
+                        std::this_thread::yield();
+                }
+            }
+            encoder.Stop();
+            double rate = encoder.GetBytesIn() / 2 / duration<double>(steady_clock::now() - start).count();
+            printf("    %d encoder threads: %.0f Msps, %.1fx real time at 128 Msps (%u cores here)\n",
+                threads, rate / 1e6, rate / realtime, std::thread::hardware_concurrency());
+        }
+    }
+}
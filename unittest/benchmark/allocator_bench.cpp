@@ -0,0 +1,74 @@
+#include "dsp/allocator.h"
+#include "dsp/ringbuffer.h"
+#include "fft_mt_r2iq.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <thread>
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+
+using namespace std::chrono;
+
+namespace {
+    struct AllocatorFixture {};
+
+    // Pushes `blocks` blocks of noise through one r2iq instance, returns the input rate in Msps
+    double RunR2iq(bool hugepages, int blocks)
+    {
+        sddc_set_hugepages(hugepages);
+
+        ringbuffer<int16_t> input;
+        ringbuffer<sddc_complex_t> output;
+        input.setBlockSize(transferSamples);
+        output.setBlockSize(transferSamples / 2);
+
+        uint32_t seed = 1;
+        for (int i = 0; i < input.getBlockSize() * 64; i++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            input.peekWritePtr(i / input.getBlockSize())[i % input.getBlockSize()] = (int16_t)(seed >> 20);
+        }
+
+        auto r2iq = new fft_mt_r2iq();
+        r2iq->Init(1.0f, &input, &output);
+        r2iq->TurnOn();
+
+        auto start = steady_clock::now();
+        auto producer = std::thread([&input, blocks]() {
+            for (int i = 0; i < blocks; i++)
+            {
+                input.getWritePtr();
+                input.WriteDone();
+            }
+        });
+
+        for (int i = 0; i < blocks; i++)
+        {
+            output.getReadPtr();
+            output.ReadDone();
+        }
+        auto elapsed = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+        producer.join();
+        r2iq->TurnOff();
+        delete r2iq;
+
+        sddc_set_hugepages(true);
+        return (double)blocks * transferSamples / elapsed / 1e6;
+    }
+}
+
+TEST_CASE(AllocatorFixture, HugepageBenchmark)
+{
+    const int blocks = 2000;
+
+    double plain = RunR2iq(false, blocks);
+    double huge = RunR2iq(true, blocks);
+
+    printf("r2iq throughput: %.1f Msps with regular pages, %.1f Msps with huge pages (%+.1f%%)\n",
+        plain, huge, (huge - plain) * 100.0 / plain);
+
+    REQUIRE_TRUE(plain > 0);
+    REQUIRE_TRUE(huge > 0);
+}
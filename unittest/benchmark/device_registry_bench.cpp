@@ -0,0 +1,67 @@
+#include "device_registry.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+namespace {
+    struct DeviceRegistryFixture {};
+
+    // Bus with the cost of a libusb scan: the context set up, then every
+    // device opened to read its strings
+    struct FakeBus
+    {
+        const microseconds init_time = microseconds(2000);
+        const microseconds open_time = microseconds(500);
+
+        int devices = 8;
+
+        void Scan(std::vector<SDDC::DeviceItem>& list)
+        {
+            std::this_thread::sleep_for(init_time + open_time * devices);
+            for (int i = 0; i < devices; i++)
+            {
+                SDDC::DeviceItem dev = { (uint8_t)i, "RX888r2", "000" + std::to_string(i) };
+                list.push_back(dev);
+            }
+        }
+
+        DeviceRegistry::Scanner Scanner()
+        {
+            return [this](std::vector<SDDC::DeviceItem>& list) { Scan(list); return true; };
+        }
+    };
+}
+
+TEST_CASE(DeviceRegistryFixture, EnumerationBenchmark)
+{
+    const int queries = 10000;
+    FakeBus bus;
+
+    // A scan for every query, as the length, each item and the list did before
+    std::vector<SDDC::DeviceItem> list;
+    auto start = steady_clock::now();
+    for (int i = 0; i < 20; i++)
+    {
+        list.clear();
+        bus.Scan(list);
+    }
+    double scan_us = duration<double, std::micro>(steady_clock::now() - start).count() / 20;
+
+    // The first query scans, the next ones share its result
+    DeviceRegistry registry(bus.Scanner());
+    registry.Snapshot();
+    start = steady_clock::now();
+    for (int i = 0; i < queries; i++)
+        registry.Snapshot();
+    double cached_us = duration<double, std::micro>(steady_clock::now() - start).count() / queries;
+
+    printf("enumeration of %d devices: %.1f us per scan, %.2f us per cached query\n",
+        bus.devices, scan_us, cached_us);
+    REQUIRE_EQUAL(registry.ScanCount(), 1u);
+}
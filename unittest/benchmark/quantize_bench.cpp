@@ -0,0 +1,58 @@
+#include "config.h"
+#include "dsp/quantize.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+using namespace std::chrono;
+
+namespace {
+    struct QuantizeFixture {};
+
+    // Samples exercising the rounding, the saturation and the SIMD tail
+    std::vector<float> TestSamples(size_t count)
+    {
+        std::vector<float> samples(count * 2);
+        for (size_t i = 0; i < samples.size(); i++)
+            samples[i] = 1.3f * sinf(i * 0.37f) + (i % 7 == 0 ? 0.5f / 32767 : 0);
+        samples[0] = 5.0f;      // saturates
+        samples[1] = -5.0f;
+        samples[2] = 2.5f / 32767; // halfway: to the even integer
+        return samples;
+    }
+}
+
+TEST_CASE(QuantizeFixture, Benchmark)
+{
+    const size_t count = transferSamples / 2;
+    std::vector<float> samples = TestSamples(count);
+    std::vector<float> block(samples.size());
+
+    const struct { sddc_iq_format_t format; bool dither; const char* name; } cases[] = {
+        { SDDC_IQ_CS16, false, "CS16" },
+        { SDDC_IQ_CS16, true,  "CS16 dithered" },
+        { SDDC_IQ_CS8,  false, "CS8" },
+        { SDDC_IQ_CS8,  true,  "CS8 dithered" },
+    };
+
+    for (auto& c : cases)
+    {
+        iq_quantizer quantizer;
+        quantizer.Configure(c.format, 0, c.dither);
+
+        const int blocks = 2000;
+        duration<double> elapsed(0);
+        for (int i = 0; i < blocks; i++)
+        {
+            block = samples;
+            auto start = steady_clock::now();
+            quantizer.Convert(block.data(), count);
+            elapsed += steady_clock::now() - start;
+        }
+
+        printf("%s: %.0f Msps\n", c.name, blocks * count / elapsed.count() / 1e6);
+    }
+}
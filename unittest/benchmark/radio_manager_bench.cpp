@@ -0,0 +1,90 @@
+#include "RadioManager.h"
+#include "r2iq_pool.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+
+using namespace std::chrono;
+
+namespace {
+    struct RadioManagerFixture {};
+
+    const char* backend = "generator,tones=10e6:-20,noise=-60,speed=max";
+    const int devices = 4;
+
+    struct Received {
+        std::atomic<uint64_t> samples{0};
+    };
+
+    void IQCallback(void* context, const sddc_complex_t*, uint32_t len, int64_t)
+    {
+        ((Received*)context)->samples += len;
+    }
+
+    // IQ samples per second over all the devices, for the given time
+    double Stream(std::vector<RadioHandler*>& radios, std::vector<Received>& received, seconds duration)
+    {
+        for (size_t i = 0; i < radios.size(); i++)
+        {
+            radios[i]->AttachIQ(IQCallback, &received[i]);
+            radios[i]->SetDecimation(2);
+        }
+
+        for (auto radio : radios)
+            radio->Start(true);
+
+        auto start = steady_clock::now();
+        std::this_thread::sleep_for(duration);
+        double elapsed = std::chrono::duration<double>(steady_clock::now() - start).count();
+
+        uint64_t samples = 0;
+        for (auto& r : received)
+            samples += r.samples;
+
+        for (auto radio : radios)
+            radio->Stop();
+
+        return samples / elapsed;
+    }
+}
+
+TEST_CASE(RadioManagerFixture, ThroughputBenchmark)
+{
+    // A thread per device
+    std::vector<std::unique_ptr<RadioHandler>> separate;
+    std::vector<RadioHandler*> radios;
+    for (int i = 0; i < devices; i++)
+    {
+        separate.emplace_back(new RadioHandler());
+        REQUIRE_EQUAL(separate.back()->SetBackend(backend), ERR_SUCCESS);
+        REQUIRE_EQUAL(separate.back()->Init(0), ERR_SUCCESS);
+        radios.push_back(separate.back().get());
+    }
+    std::vector<Received> received(devices);
+    double separate_rate = Stream(radios, received, seconds(2));
+    separate.clear();
+
+    // The shared workers
+    RadioManager manager;
+    radios.clear();
+    for (int i = 0; i < devices; i++)
+    {
+        REQUIRE_EQUAL(manager.Open(0, backend), ERR_SUCCESS);
+        radios.push_back(manager.Get(i));
+    }
+    std::vector<Received> shared_received(devices);
+    double shared_rate = Stream(radios, shared_received, seconds(2));
+
+    printf("%d devices, %u cores: %.1f Msps with a thread per device, %.1f Msps with %u shared workers\n",
+        devices, std::thread::hardware_concurrency(), separate_rate / 1e6, shared_rate / 1e6,
+        r2iq_pool::Get().WorkerCount());
+
+    // Every device gets its share
+    for (auto& r : shared_received)
+        REQUIRE_TRUE(r.samples > 0);
+}
@@ -0,0 +1,99 @@
+#include "RadioHandler.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+
+using namespace std::chrono;
+
+namespace {
+    struct PullFixture {};
+
+    const char* backend = "generator,tones=10e6:-20;3e6:-40,speed=max";
+
+    std::atomic<uint64_t> pushed_samples;
+
+    void CountIQ(void*, const sddc_complex_t*, uint32_t len, int64_t)
+    {
+        pushed_samples += len;
+    }
+
+    void Open(RadioHandler& radio)
+    {
+        REQUIRE_EQUAL(radio.SetBackend(backend), ERR_SUCCESS);
+        REQUIRE_EQUAL(radio.Init(0), ERR_SUCCESS);
+        REQUIRE_EQUAL(radio.SetDecimation(1), ERR_SUCCESS);
+    }
+}
+
+TEST_CASE(PullFixture, ThroughputBenchmark)
+{
+    const auto run_time = seconds(2);
+
+    // Callback on the delivery thread
+    double push_rate;
+    {
+        RadioHandler radio;
+        Open(radio);
+        radio.AttachIQ(CountIQ);
+        pushed_samples = 0;
+
+        radio.Start(true);
+        auto start = steady_clock::now();
+        std::this_thread::sleep_for(run_time);
+        push_rate = pushed_samples / duration<double>(steady_clock::now() - start).count();
+        radio.Stop();
+    }
+
+    // Blocks taken in place
+    double acquire_rate;
+    {
+        RadioHandler radio;
+        Open(radio);
+        radio.SetPullMode(true);
+        radio.Start(true);
+
+        uint64_t samples = 0;
+        auto start = steady_clock::now();
+        while (steady_clock::now() - start < run_time)
+        {
+            const sddc_complex_t* data;
+            uint32_t length;
+            REQUIRE_EQUAL(radio.AcquireIQ(&data, &length, nullptr, 1000), ERR_SUCCESS);
+            samples += length;
+            radio.ReleaseIQ();
+        }
+        acquire_rate = samples / duration<double>(steady_clock::now() - start).count();
+        radio.Stop();
+    }
+
+    // Copied by pieces
+    double read_rate;
+    {
+        RadioHandler radio;
+        Open(radio);
+        radio.SetPullMode(true);
+        radio.Start(true);
+
+        std::vector<sddc_complex_t> buffer(16384);
+        uint64_t samples = 0;
+        auto start = steady_clock::now();
+        while (steady_clock::now() - start < run_time)
+        {
+            uint32_t read;
+            REQUIRE_EQUAL(radio.ReadIQ(buffer.data(), (uint32_t)buffer.size(), &read, nullptr, 1000), ERR_SUCCESS);
+            samples += read;
+        }
+        read_rate = samples / duration<double>(steady_clock::now() - start).count();
+        radio.Stop();
+    }
+
+    printf("IQ delivery: %.1f Msps with a callback, %.1f Msps acquired, %.1f Msps read\n",
+        push_rate / 1e6, acquire_rate / 1e6, read_rate / 1e6);
+
+    REQUIRE_TRUE(acquire_rate > 0);
+    REQUIRE_TRUE(read_rate > 0);
+}
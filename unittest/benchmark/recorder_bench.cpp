@@ -0,0 +1,66 @@
+#include "record/recorder.h"
+#include "config.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+
+using namespace std::chrono;
+
+namespace {
+    struct RecorderFixture {};
+
+    const char* record_path = "recorder_bench.raw";
+}
+
+TEST_CASE(RecorderFixture, Benchmark)
+{
+    // Raw ADC blocks at 130 Msps (260 MB/s) for a few seconds, counting the drops,
+    // then 2 GB as fast as the disk goes (waiting for room instead of dropping).
+    // The file goes to the current directory, which should be on the disk to measure
+    const size_t block = transferSize;
+    std::vector<uint8_t> data(block, 0x5A);
+
+    const struct { double rate; const char* name; } cases[] = {
+        { 260e6, "260 MB/s" },
+        { 0,     "unpaced" },
+    };
+
+    for (auto& c : cases)
+    {
+        recorder rec;
+        REQUIRE_EQUAL(rec.Open(record_path), ERR_SUCCESS);
+
+        const int blocks = (int)((c.rate ? c.rate * 3 : 2e9) / block);
+        const auto period = c.rate ? duration<double>(block / c.rate) : duration<double>(0);
+
+        auto start = steady_clock::now();
+        for (int i = 0; i < blocks; i++)
+        {
+            if (c.rate)
+            {
+                std::this_thread::sleep_until(start + duration_cast<steady_clock::duration>(period * i));
+                rec.Write(data.data(), block);
+            }
+            else
+            {
+                while (!rec.Write(data.data(), block))
+                    std::this_thread::yield();
+            }
+        }
+        auto stats = rec.GetStats();
+        REQUIRE_EQUAL(rec.Close(), ERR_SUCCESS);
+        duration<double> elapsed = steady_clock::now() - start;
+
+        printf("%s: %.0f MB/s written (%s I/O), buffer peak %u MB",
+            c.name, rec.GetStats().bytes_written / elapsed.count() / 1e6,
+            stats.direct_io ? "direct" : "buffered", stats.buffer_peak >> 20);
+        if (c.rate)
+            printf(", %u of %d blocks dropped", stats.blocks_dropped, blocks);
+        printf("\n");
+
+        remove(record_path);
+    }
+}
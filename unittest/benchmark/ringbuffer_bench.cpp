@@ -0,0 +1,79 @@
+#include "dsp/ringbuffer.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <thread>
+#include <chrono>
+#include <stdio.h>
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+using namespace std::chrono;
+
+namespace {
+    struct RingBufferFixture {};
+}
+
+#ifdef __linux__
+namespace {
+    // Context switches of the calling thread
+    long ContextSwitches()
+    {
+        struct rusage usage;
+        getrusage(RUSAGE_THREAD, &usage);
+        return usage.ru_nvcsw + usage.ru_nivcsw;
+    }
+}
+
+TEST_CASE(RingBufferFixture, Benchmark)
+{
+    // One producer and one consumer, as r2iq and the pull mode reader:
+    // paced at 32 Msps of CF32 output (transferSamples / 2 IQ samples per block) then flat out
+    const int block_size = transferSamples / 2;
+    const struct { double rate; const char* name; } cases[] = {
+        { 32e6, "32 Msps" },
+        { 0,    "unpaced" },
+    };
+
+    for (auto& c : cases)
+    {
+        auto buffer = ringbuffer<float>(64);
+        buffer.setBlockSize(block_size * 2);
+
+        const auto period = c.rate ? duration<double>(block_size / c.rate) : duration<double>(0);
+        const int blocks = c.rate ? (int)(c.rate / block_size) : 200000;
+
+        long producer_switches = 0, consumer_switches = 0;
+        auto start = steady_clock::now();
+
+        auto producer = std::thread([&]() {
+            producer_switches = ContextSwitches();
+            for (int i = 0; i < blocks; i++) {
+                if (c.rate)
+                    std::this_thread::sleep_until(start + duration_cast<steady_clock::duration>(period * i));
+                auto ptr = buffer.getWritePtr();
+                ptr[0] = (float)i;
+                buffer.WriteDone();
+            }
+            producer_switches = ContextSwitches() - producer_switches;
+        });
+
+        auto consumer = std::thread([&]() {
+            consumer_switches = ContextSwitches();
+            for (int i = 0; i < blocks; i++) {
+                auto ptr = buffer.getReadPtr();
+                REQUIRE_EQUAL(ptr[0], (float)i);
+                buffer.ReadDone();
+            }
+            consumer_switches = ContextSwitches() - consumer_switches;
+        });
+
+        producer.join();
+        consumer.join();
+
+        duration<double> elapsed = steady_clock::now() - start;
+        printf("%s: %.0f blocks/s, context switches per second: producer %.0f, consumer %.0f\n",
+            c.name, blocks / elapsed.count(), producer_switches / elapsed.count(), consumer_switches / elapsed.count());
+    }
+}
+#endif
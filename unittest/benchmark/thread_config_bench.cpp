@@ -0,0 +1,59 @@
+#include "thread_config.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+
+using namespace std::chrono;
+
+namespace {
+    struct ThreadConfigFixture {};
+
+    // Wakes up every `period` for `count` periods, returns how late each wake up was (us)
+    std::vector<double> MeasureWakeups(sddc_thread_role_t role, const sddc_thread_config_t& config,
+        microseconds period, int count, bool* applied)
+    {
+        std::vector<double> lateness(count);
+        auto thread = std::thread([&]() {
+            *applied = sddc_thread_apply(role, config);
+
+            auto next = steady_clock::now() + period;
+            for (int i = 0; i < count; i++)
+            {
+                std::this_thread::sleep_until(next);
+                lateness[i] = duration_cast<duration<double, std::micro>>(steady_clock::now() - next).count();
+                next += period;
+            }
+        });
+        thread.join();
+
+        std::sort(lateness.begin(), lateness.end());
+        return lateness;
+    }
+}
+
+TEST_CASE(ThreadConfigFixture, JitterBenchmark)
+{
+    const microseconds period(500);
+    const int count = 4000;
+
+    // Pin to the last CPU, with and without a real time priority
+    unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+    sddc_thread_config_t normal = { 0, 1ull << std::min(cpus - 1, 63u) };
+    sddc_thread_config_t realtime = { 80, normal.cpu_mask };
+
+    bool applied;
+    auto base = MeasureWakeups(SDDC_THREAD_USB, normal, period, count, &applied);
+    auto rt = MeasureWakeups(SDDC_THREAD_USB, realtime, period, count, &applied);
+
+    printf("wake-up lateness (us)    p50      p99      max\n");
+    printf("  default          %8.1f %8.1f %8.1f\n", base[count / 2], base[count * 99 / 100], base[count - 1]);
+    printf("  SCHED_FIFO 80    %8.1f %8.1f %8.1f%s\n", rt[count / 2], rt[count * 99 / 100], rt[count - 1],
+        applied ? "" : "  (not permitted, default scheduling)");
+
+    REQUIRE_TRUE(base[0] >= 0);
+    REQUIRE_TRUE(rt[0] >= 0);
+}
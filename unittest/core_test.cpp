@@ -55,10 +55,15 @@ class fx3handler : public fx3class
         return true;
     }
 
+    uint32_t GetTransferGranularity()
+    {
+        return 0;
+    }
+
     std::thread emuthread;
     bool run;
 	long nxfers;
-    void StartStream(ringbuffer<int16_t>& input, int numofblock)
+    void StartStream(ringbuffer<int16_t>& input, int numofblock, int maxnumofblock)
     {
         input.setBlockSize(transferSamples);
         run = true;
@@ -79,6 +84,11 @@ class fx3handler : public fx3class
         emuthread.join();
     }
 
+    uint32_t GetTransferDepth()
+    {
+        return 1;
+    }
+
     size_t GetDeviceListLength()
     {
         return 0;
@@ -99,7 +109,7 @@ public:
 static uint32_t frame_count;
 static uint64_t totalsize;
 
-static void Callback(void* context, const sddc_complex_t* data, uint32_t len)
+static void Callback(void* context, const sddc_complex_t* data, uint32_t len, int64_t timestamp)
 {
     frame_count++;
     totalsize += len;
@@ -0,0 +1,124 @@
+#include "device_registry.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+namespace {
+    struct DeviceRegistryFixture {};
+
+    // Bus with the cost of a libusb scan: the context set up, then every
+    // device opened to read its strings
+    struct FakeBus
+    {
+        const microseconds init_time = microseconds(2000);
+        const microseconds open_time = microseconds(500);
+
+        int devices = 4;
+        bool readable = true;
+
+        bool Scan(std::vector<SDDC::DeviceItem>& list)
+        {
+            std::this_thread::sleep_for(init_time + open_time * devices);
+            if (!readable)
+                return false;
+
+            for (int i = 0; i < devices; i++)
+            {
+                SDDC::DeviceItem dev = { (uint8_t)i, "RX888r2", "000" + std::to_string(i) };
+                list.push_back(dev);
+            }
+            return true;
+        }
+
+        DeviceRegistry::Scanner Scanner()
+        {
+            return [this](std::vector<SDDC::DeviceItem>& list) { return Scan(list); };
+        }
+    };
+}
+
+TEST_CASE(DeviceRegistryFixture, SnapshotTest)
+{
+    FakeBus bus;
+    DeviceRegistry registry(bus.Scanner());
+
+    auto first = registry.Snapshot();
+    REQUIRE_EQUAL(first->size(), 4u);
+    REQUIRE_EQUAL((*first)[3].serial_number, std::string("0003"));
+    REQUIRE_TRUE(registry.Snapshot() == first);
+    REQUIRE_EQUAL(registry.ScanCount(), 1u);
+
+    // A device leaves: the list taken before doesn't change
+    bus.devices = 3;
+    registry.Invalidate();
+    auto second = registry.Snapshot();
+    REQUIRE_EQUAL(second->size(), 3u);
+    REQUIRE_EQUAL(first->size(), 4u);
+    REQUIRE_EQUAL(registry.ScanCount(), 2u);
+}
+
+TEST_CASE(DeviceRegistryFixture, FailedScanTest)
+{
+    FakeBus bus;
+    DeviceRegistry registry(bus.Scanner());
+    registry.Snapshot();
+
+    // Not readable yet, e.g. right after it arrived
+    bus.devices = 5;
+    bus.readable = false;
+    registry.Invalidate();
+    REQUIRE_FALSE(registry.Refresh());
+    REQUIRE_EQUAL(registry.Snapshot()->size(), 4u);
+    REQUIRE_EQUAL(registry.ScanCount(), 3u);
+
+    bus.readable = true;
+    REQUIRE_EQUAL(registry.Snapshot()->size(), 5u);
+    REQUIRE_EQUAL(registry.Snapshot()->size(), 5u);
+    REQUIRE_EQUAL(registry.ScanCount(), 4u);
+}
+
+TEST_CASE(DeviceRegistryFixture, MaxAgeTest)
+{
+    FakeBus bus;
+    DeviceRegistry registry(bus.Scanner(), milliseconds(50));
+
+    registry.Snapshot();
+    registry.Snapshot();
+    REQUIRE_EQUAL(registry.ScanCount(), 1u);
+
+    std::this_thread::sleep_for(milliseconds(60));
+    registry.Snapshot();
+    REQUIRE_EQUAL(registry.ScanCount(), 2u);
+}
+
+TEST_CASE(DeviceRegistryFixture, ConcurrentTest)
+{
+    FakeBus bus;
+    DeviceRegistry registry(bus.Scanner());
+
+    // Callers arriving together share one scan
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; i++)
+        threads.emplace_back([&registry]() { REQUIRE_EQUAL(registry.Snapshot()->size(), 4u); });
+    for (auto& thread : threads)
+        thread.join();
+
+    REQUIRE_EQUAL(registry.ScanCount(), 1u);
+}
+
+TEST_CASE(DeviceRegistryFixture, RepeatedQueryTest)
+{
+    FakeBus bus;
+    bus.devices = 8;
+    DeviceRegistry registry(bus.Scanner());
+
+    // The first query scans, the next ones share its result
+    for (int i = 0; i < 10000; i++)
+        REQUIRE_EQUAL(registry.Snapshot()->size(), 8u);
+    REQUIRE_EQUAL(registry.ScanCount(), 1u);
+}
@@ -0,0 +1,216 @@
+#include "backend/backend.h"
+#include "dsp/ringbuffer.h"
+#include "fft_mt_r2iq.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <chrono>
+#include <complex>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+using namespace std::chrono;
+
+namespace {
+    struct GeneratorFixture {};
+
+    typedef std::complex<double> cdouble;
+
+    const double pi = 3.14159265358979323846;
+
+    // 64 Msps, decimated by 2: the IQ output is 16 Msps centered on 8 MHz
+    const uint32_t adc_rate = 64000000;
+    const int fft_size = 8192;
+    const int tone_bin = 1024;       // 10 MHz, 2 MHz above the center
+    const int image_bin = 7168;      // 6 MHz, its mirror
+
+    std::vector<cdouble> CaptureIQ(const char* spec, bool generator_rand, bool r2iq_rand, size_t count)
+    {
+        ringbuffer<int16_t> input;
+        ringbuffer<sddc_complex_t> output;
+        input.setBlockSize(transferSamples);
+        output.setBlockSize(transferSamples / 2);
+
+        fx3class* generator = CreateFx3Backend(spec);
+        generator->Control(STARTADC, adc_rate);
+        generator->Control(GPIOFX3, generator_rand ? (uint32_t)RANDO : 0u);
+
+        auto r2iq = new fft_mt_r2iq();
+        r2iq->Init(1.0f, &input, &output);
+        r2iq->setSampleRate(adc_rate);
+        r2iq->setDecimate(1);
+        r2iq->SetRand(r2iq_rand);
+        r2iq->TurnOn();
+        generator->StartStream(input, 4);
+
+        // The first blocks hold the filter start up
+        std::vector<cdouble> iq;
+        for (int block = 0; iq.size() < count; block++)
+        {
+            auto ptr = output.getReadPtr();
+            for (int i = 0; block >= 2 && i < output.getBlockSize() && iq.size() < count; i++)
+                iq.push_back(cdouble(ptr[i][0], ptr[i][1]));
+            output.ReadDone();
+        }
+
+        r2iq->TurnOff();
+        generator->StopStream();
+        delete r2iq;
+        delete generator;
+        return iq;
+    }
+
+    cdouble Bin(const std::vector<cdouble>& iq, int bin)
+    {
+        cdouble sum = 0;
+        for (int i = 0; i < fft_size; i++)
+            sum += iq[i] * std::polar(1.0, -2 * pi * bin * i / fft_size);
+        return sum;
+    }
+
+    // The tone sits exactly on a bin: anything else in the band is noise
+    double SNR(const std::vector<cdouble>& iq)
+    {
+        double total = 0;
+        for (int i = 0; i < fft_size; i++)
+            total += std::norm(iq[i]);
+        double tone = std::norm(Bin(iq, tone_bin)) / fft_size;
+        return 10 * log10(tone / (total - tone));
+    }
+}
+
+TEST_CASE(GeneratorFixture, OptionsTest)
+{
+    fx3class* generator = CreateFx3Backend("generator");
+    REQUIRE_TRUE(generator != nullptr);
+    REQUIRE_TRUE(generator->Open(0));
+    REQUIRE_FALSE(generator->Open(1));
+    delete generator;
+
+    REQUIRE_TRUE(CreateFx3Backend("generator,tones=10e6") == nullptr);
+    REQUIRE_TRUE(CreateFx3Backend("generator,tones=10e6:x") == nullptr);
+    REQUIRE_TRUE(CreateFx3Backend("generator,noise=3") == nullptr);
+    REQUIRE_TRUE(CreateFx3Backend("generator,seed=0") == nullptr);
+
+    generator = CreateFx3Backend("generator,tones=1e6:-10;2e6:-30,noise=-80,seed=5,speed=max,model=HF103");
+    REQUIRE_TRUE(generator != nullptr);
+    auto devices = generator->GetDeviceList();
+    REQUIRE_EQUAL(devices.size(), 1u);
+    REQUIRE_EQUAL(devices[0].serial_number, std::string("1e+06Hz+2e+06Hz"));
+    delete generator;
+}
+
+TEST_CASE(GeneratorFixture, ToneTest)
+{
+    auto iq = CaptureIQ("generator,tones=10e6:-6,speed=max", false, false, fft_size);
+
+    int peak = 0;
+    double peak_power = 0;
+    for (int bin = 0; bin < fft_size; bin += 8)
+    {
+        double power = std::norm(Bin(iq, bin));
+        if (power > peak_power)
+        {
+            peak = bin;
+            peak_power = power;
+        }
+    }
+    REQUIRE_EQUAL(peak, tone_bin);
+
+    double snr = SNR(iq);
+    double image = 10 * log10(std::norm(Bin(iq, tone_bin)) / std::norm(Bin(iq, image_bin)));
+    printf("tone: SNR %.1f dB, image rejection %.1f dB\n", snr, image);
+    REQUIRE_TRUE(snr > 70);
+    REQUIRE_TRUE(image > 80);
+}
+
+TEST_CASE(GeneratorFixture, NoiseTest)
+{
+    // -50 dBFS over 32 MHz, the 16 MHz output keeps half of it
+    auto iq = CaptureIQ("generator,tones=10e6:-6,noise=-50,speed=max", false, false, fft_size);
+
+    double snr = SNR(iq);
+    printf("noise: SNR %.1f dB\n", snr);
+    REQUIRE_TRUE(snr > 44 && snr < 50);
+}
+
+TEST_CASE(GeneratorFixture, RandTest)
+{
+    auto iq = CaptureIQ("generator,tones=10e6:-6,speed=max", true, true, fft_size);
+    REQUIRE_TRUE(SNR(iq) > 70);
+
+    // Decoding what was not encoded scrambles the signal
+    iq = CaptureIQ("generator,tones=10e6:-6,speed=max", false, true, fft_size);
+    printf("RAND mismatch: SNR %.1f dB\n", SNR(iq));
+    REQUIRE_TRUE(SNR(iq) < 20);
+}
+
+TEST_CASE(GeneratorFixture, PhaseContinuityTest)
+{
+    // 2 MHz at 16 Msps turns by pi/4 every sample, across the block boundaries too
+    auto iq = CaptureIQ("generator,tones=10e6:-6,speed=max", false, false, transferSamples * 4);
+
+    double worst = 0;
+    for (size_t i = 1; i < iq.size(); i++)
+        worst = std::max(worst, fabs(std::arg(iq[i] * std::conj(iq[i - 1])) - pi / 4));
+    printf("phase: worst step error %.2e rad\n", worst);
+    REQUIRE_TRUE(worst < 1e-2);
+}
+
+TEST_CASE(GeneratorFixture, ClippingTest)
+{
+    ringbuffer<int16_t> input;
+    input.setBlockSize(transferSamples);
+
+    fx3class* generator = CreateFx3Backend("generator,tones=1e6:6,speed=max");
+    generator->Control(STARTADC, adc_rate);
+    generator->StartStream(input, 4);
+
+    int16_t low = 0, high = 0;
+    for (int block = 0; block < 4; block++)
+    {
+        auto ptr = input.getReadPtr();
+        for (int i = 0; i < input.getBlockSize(); i++)
+        {
+            low = std::min(low, ptr[i]);
+            high = std::max(high, ptr[i]);
+        }
+        input.ReadDone();
+    }
+    input.Stop();
+    generator->StopStream();
+    delete generator;
+
+    REQUIRE_EQUAL(low, -32768);
+    REQUIRE_EQUAL(high, 32767);
+}
+
+TEST_CASE(GeneratorFixture, ThroughputTest)
+{
+    ringbuffer<int16_t> input;
+    input.setBlockSize(transferSamples);
+
+    fx3class* generator = CreateFx3Backend("generator,tones=5e6:-10;10e6:-20;15e6:-30,noise=-60,speed=max");
+    generator->Control(STARTADC, adc_rate);
+    generator->StartStream(input, 4);
+
+    uint64_t samples = 0;
+    auto start = steady_clock::now();
+    while (steady_clock::now() - start < 1s)
+    {
+        input.getReadPtr();
+        input.ReadDone();
+        samples += input.getBlockSize();
+    }
+    double elapsed = duration<double>(steady_clock::now() - start).count();
+    input.Stop();
+    generator->StopStream();
+    delete generator;
+
+    double msps = samples / elapsed / 1e6;
+    printf("generator: %.1f Msps\n", msps);
+#ifdef NDEBUG
+    // Above the fastest ADC rate, so the generator is never the bottleneck
+    REQUIRE_TRUE(msps > 130);
+#endif
+}
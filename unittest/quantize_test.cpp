@@ -0,0 +1,119 @@
+#include "config.h"
+#include "dsp/quantize.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <math.h>
+#include <vector>
+
+namespace {
+    struct QuantizeFixture {};
+
+    // Samples exercising the rounding, the saturation and the SIMD tail
+    std::vector<float> TestSamples(size_t count)
+    {
+        std::vector<float> samples(count * 2);
+        for (size_t i = 0; i < samples.size(); i++)
+            samples[i] = 1.3f * sinf(i * 0.37f) + (i % 7 == 0 ? 0.5f / 32767 : 0);
+        samples[0] = 5.0f;      // saturates
+        samples[1] = -5.0f;
+        samples[2] = 2.5f / 32767; // halfway: to the even integer
+        return samples;
+    }
+
+    template<typename T> T Reference(float value, float scale, float low, float high)
+    {
+        float v = value * scale;
+        if (v < low) v = low;
+        if (v > high) v = high;
+        return (T)lrintf(v);
+    }
+}
+
+TEST_CASE(QuantizeFixture, ConfigureTest)
+{
+    iq_quantizer quantizer;
+    REQUIRE_EQUAL(quantizer.getFormat(), SDDC_IQ_CF32);
+    REQUIRE_EQUAL(quantizer.SampleSize(), sizeof(sddc_complex_t));
+
+    REQUIRE_TRUE(quantizer.Configure(SDDC_IQ_CS16));
+    REQUIRE_EQUAL(quantizer.getScale(), 32767.0f);
+    REQUIRE_EQUAL(quantizer.SampleSize(), (size_t)4);
+
+    REQUIRE_TRUE(quantizer.Configure(SDDC_IQ_CS8, 64.0f, true));
+    REQUIRE_EQUAL(quantizer.getScale(), 64.0f);
+    REQUIRE_TRUE(quantizer.getDither());
+    REQUIRE_EQUAL(quantizer.SampleSize(), (size_t)2);
+
+    REQUIRE_FALSE(quantizer.Configure(SDDC_IQ_CS16, -1.0f));
+    REQUIRE_FALSE(quantizer.Configure(SDDC_IQ_CS16, NAN));
+    REQUIRE_FALSE(quantizer.Configure((sddc_iq_format_t)7));
+    REQUIRE_EQUAL(quantizer.getFormat(), SDDC_IQ_CS8);
+}
+
+TEST_CASE(QuantizeFixture, CS16Test)
+{
+    // Odd count: the last samples go through the scalar code
+    const size_t count = 1001;
+    std::vector<float> samples = TestSamples(count);
+    std::vector<float> block = samples;
+
+    iq_quantizer quantizer;
+    quantizer.Configure(SDDC_IQ_CS16);
+    quantizer.Convert(block.data(), count);
+
+    const int16_t* output = (const int16_t*)block.data();
+    REQUIRE_EQUAL(output[0], 32767);
+    REQUIRE_EQUAL(output[1], -32768);
+    REQUIRE_EQUAL(output[2], 2);
+    for (size_t i = 0; i < count * 2; i++)
+        REQUIRE_EQUAL(output[i], Reference<int16_t>(samples[i], 32767.0f, -32768.0f, 32767.0f));
+}
+
+TEST_CASE(QuantizeFixture, CS8Test)
+{
+    const size_t count = 1003;
+    std::vector<float> samples = TestSamples(count);
+    std::vector<float> block = samples;
+
+    iq_quantizer quantizer;
+    quantizer.Configure(SDDC_IQ_CS8, 100.0f);
+    quantizer.Convert(block.data(), count);
+
+    const int8_t* output = (const int8_t*)block.data();
+    REQUIRE_EQUAL(output[0], 127);
+    REQUIRE_EQUAL(output[1], -128);
+    for (size_t i = 0; i < count * 2; i++)
+        REQUIRE_EQUAL(output[i], Reference<int8_t>(samples[i], 100.0f, -128.0f, 127.0f));
+}
+
+TEST_CASE(QuantizeFixture, DitherTest)
+{
+    // A level of 0.3 LSB is lost without dither, and found on average with it
+    const size_t count = 100000;
+    std::vector<float> block(count * 2);
+
+    iq_quantizer quantizer;
+    quantizer.Configure(SDDC_IQ_CS8, 1.0f, false);
+    block.assign(count * 2, 0.3f);
+    quantizer.Convert(block.data(), count);
+    const int8_t* output = (const int8_t*)block.data();
+    for (size_t i = 0; i < count * 2; i++)
+        REQUIRE_EQUAL(output[i], 0);
+
+    quantizer.Configure(SDDC_IQ_CS8, 1.0f, true);
+    block.assign(count * 2, 0.3f);
+    quantizer.Convert(block.data(), count);
+
+    double sum = 0, power = 0;
+    for (size_t i = 0; i < count * 2; i++)
+    {
+        REQUIRE_TRUE(output[i] >= -1 && output[i] <= 2);
+        sum += output[i];
+        power += (output[i] - 0.3) * (output[i] - 0.3);
+    }
+    const double mean = sum / (count * 2);
+    const double noise = power / (count * 2);
+    REQUIRE_TRUE(fabs(mean - 0.3) < 0.01);
+    // Triangular dither and rounding: 1/6 + 1/12 LSB^2
+    REQUIRE_TRUE(fabs(noise - 0.25) < 0.02);
+}
@@ -0,0 +1,60 @@
+#include "dsp/ringbuffer.h"
+#include "fft_mt_r2iq.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <thread>
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace {
+    struct R2iqFixture {};
+}
+
+TEST_CASE(R2iqFixture, TimestampTest)
+{
+    const uint32_t adc_rate = 64000000;
+    const double ns_per_sample = 1.0e9 / adc_rate;
+    const int64_t start_time = 1700000000LL * 1000000000LL;
+    const int blocks = 200;
+
+    ringbuffer<int16_t> input;
+    ringbuffer<sddc_complex_t> output;
+    input.setBlockSize(transferSamples);
+    output.setBlockSize(transferSamples / 2);
+
+    for (int i = 0; i < input.getBlockSize() * input.getBlockCount(); i++)
+    {
+        input.peekWritePtr(i / input.getBlockSize())[i % input.getBlockSize()] = (int16_t)(rand() >> 16);
+    }
+
+    auto r2iq = new fft_mt_r2iq();
+    r2iq->Init(1.0f, &input, &output);
+    r2iq->setSampleRate(adc_rate);
+    r2iq->setDecimate(1);
+    r2iq->TurnOn();
+
+    auto producer = std::thread([&]() {
+        for (int i = 0; i < blocks; i++)
+        {
+            input.getWritePtr();
+            input.setWriteTimestamp(start_time + (int64_t)((double)i * transferSamples * ns_per_sample));
+            input.WriteDone();
+        }
+    });
+
+    // Every output block is full and the blocks follow each other without gaps:
+    // a block of N samples decimated by 2 spans 4 * N ADC samples
+    const int output_blocks = blocks / 4;
+    const double block_ns = output.getBlockSize() * 4 * ns_per_sample;
+    for (int i = 0; i < output_blocks; i++)
+    {
+        output.getReadPtr();
+        int64_t expected = start_time + (int64_t)((BASE_FFT_OUTPUT_DELAY - BASE_FFT_SCRAP_SIZE) * ns_per_sample + i * block_ns);
+        REQUIRE_TRUE(llabs(output.getReadTimestamp() - expected) <= 2);
+        output.ReadDone();
+    }
+
+    r2iq->TurnOff();
+    producer.join();
+    delete r2iq;
+}
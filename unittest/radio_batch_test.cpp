@@ -0,0 +1,159 @@
+#include "radio/RadioHardware.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <chrono>
+#include <map>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+
+using namespace std::chrono;
+
+namespace {
+    struct RadioBatchFixture {};
+
+    // Device with the latency of a USB control transfer: every synchronous
+    // write waits for the round trip, pipelined writes wait for it once
+    class MockFx3 : public fx3class
+    {
+    public:
+        const microseconds round_trip = microseconds(250);
+        const microseconds wire_time = microseconds(10);
+
+        uint32_t gpios = 0;
+        std::map<uint16_t, uint16_t> arguments;
+        std::vector<std::pair<int, uint32_t>> commands;   // everything but GPIOs and arguments
+        int requests = 0;
+
+        bool Open(uint8_t) override { return true; }
+        bool Control(FX3Command command, uint8_t data) override { return Command(command, data); }
+        bool Control(FX3Command command, uint32_t data) override
+        {
+            if (command != GPIOFX3)
+                return Command(command, data);
+
+            gpios = data;
+            return Write();
+        }
+        bool Control(FX3Command command, uint64_t data) override { return Command(command, (uint32_t)data); }
+        bool SetArgument(uint16_t index, uint16_t value) override
+        {
+            arguments[index] = value;
+            return Write();
+        }
+        void BeginBatch() override { batching = true; }
+        bool CommitBatch() override
+        {
+            batching = false;
+            std::this_thread::sleep_for(round_trip);
+            return true;
+        }
+
+        bool GetHardwareInfo(uint32_t*) override { return true; }
+        bool ReadDebugTrace(uint8_t*, uint8_t) override { return false; }
+        uint32_t GetTransferGranularity() override { return 0; }
+        void StartStream(ringbuffer<int16_t>&, int, int) override {}
+        void StopStream() override {}
+        uint32_t GetTransferDepth() override { return 0; }
+        bool Enumerate(unsigned char&, char*) override { return false; }
+        size_t GetDeviceListLength() override { return 0; }
+        bool GetDevice(unsigned char&, char*, size_t, char*, size_t) override { return false; }
+        vector<SDDC::DeviceItem> GetDeviceList() override { return vector<SDDC::DeviceItem>(); }
+
+    private:
+        bool Command(FX3Command command, uint32_t data)
+        {
+            commands.push_back({ command, data });
+            return Write();
+        }
+
+        bool Write()
+        {
+            requests++;
+            std::this_thread::sleep_for(batching ? wire_time : round_trip);
+            return true;
+        }
+
+        bool batching = false;
+    };
+
+    // Retune to VHF and set it up, then back to HF with a gain sweep
+    void Configure(RadioHardware& radio, bool batch)
+    {
+        if (batch) radio.BeginBatch();
+        radio.SetRFMode(VHFMODE);
+        radio.SetRFAttenuation_VHF(12);
+        radio.SetIFGain_VHF(7);
+        radio.SetCenterFrequency_VHF(145000000);
+        radio.SetBiasT_VHF(true);
+        if (batch) REQUIRE_EQUAL(radio.Commit(), ERR_SUCCESS);
+
+        if (batch) radio.BeginBatch();
+        radio.SetRFMode(HFMODE);
+        for (int step = 0; step < 64; step++)
+            radio.SetRFAttenuation_HF(step);
+        for (int step = 0; step < 127; step += 8)
+            radio.SetIFGain_HF(step);
+        radio.SetDither(true);
+        radio.SetRand(true);
+        if (batch) REQUIRE_EQUAL(radio.Commit(), ERR_SUCCESS);
+    }
+}
+
+TEST_CASE(RadioBatchFixture, CoalesceTest)
+{
+    MockFx3 direct, batched;
+    {
+        RX888R2Radio radio(&direct);
+        Configure(radio, false);
+    }
+    {
+        RX888R2Radio radio(&batched);
+        Configure(radio, true);
+    }
+
+    // Same device state and same commands in the same order, with fewer writes
+    REQUIRE_EQUAL(batched.gpios, direct.gpios);
+    REQUIRE_TRUE(batched.arguments == direct.arguments);
+    REQUIRE_TRUE(batched.commands == direct.commands);
+    printf("writes: %d direct, %d batched\n", direct.requests, batched.requests);
+    REQUIRE_TRUE(batched.requests * 4 < direct.requests);
+}
+
+TEST_CASE(RadioBatchFixture, NestedTest)
+{
+    MockFx3 fx3;
+    RX888R2Radio radio(&fx3);
+
+    radio.BeginBatch();
+    radio.BeginBatch();
+    radio.SetDither(true);
+    REQUIRE_EQUAL(radio.Commit(), ERR_SUCCESS);
+    REQUIRE_EQUAL(fx3.requests, 0);
+
+    radio.SetPGA(true);
+    REQUIRE_EQUAL(radio.Commit(), ERR_SUCCESS);
+    REQUIRE_EQUAL(fx3.requests, 1);
+    REQUIRE_EQUAL(fx3.gpios, (uint32_t)(DITH | PGA_EN));
+
+    // No batch: sent right away
+    radio.SetRand(true);
+    REQUIRE_EQUAL(fx3.requests, 2);
+}
+
+TEST_CASE(RadioBatchFixture, TimingTest)
+{
+    MockFx3 direct, batched;
+    RX888R2Radio direct_radio(&direct), batched_radio(&batched);
+
+    auto start = steady_clock::now();
+    Configure(direct_radio, false);
+    double direct_ms = duration<double, std::milli>(steady_clock::now() - start).count();
+
+    start = steady_clock::now();
+    Configure(batched_radio, true);
+    double batched_ms = duration<double, std::milli>(steady_clock::now() - start).count();
+
+    printf("configuration: %.1f ms direct, %.1f ms batched\n", direct_ms, batched_ms);
+    REQUIRE_TRUE(batched_ms * 4 < direct_ms);
+}
@@ -0,0 +1,163 @@
+#include "RadioManager.h"
+#include "r2iq_pool.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+
+using namespace std::chrono;
+
+namespace {
+    struct RadioManagerFixture {};
+
+    const char* capture_path = "radio_manager_test.wav";
+    const uint32_t capture_samples = transferSamples * 4;
+    const char* backend = "replay,file=radio_manager_test.wav,speed=max";
+    const int devices = 4;
+
+    void WriteLE(FILE* f, uint32_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++)
+            fputc((value >> (8 * i)) & 0xFF, f);
+    }
+
+    // A tone and a bit of everything else
+    void WriteCapture()
+    {
+        FILE* f = fopen(capture_path, "wb");
+        uint32_t data_size = capture_samples * sizeof(int16_t);
+
+        fwrite("RIFF", 1, 4, f); WriteLE(f, 36 + data_size, 4); fwrite("WAVE", 1, 4, f);
+        fwrite("fmt ", 1, 4, f); WriteLE(f, 16, 4);
+        WriteLE(f, 1, 2); WriteLE(f, 1, 2);                                 // PCM, mono
+        WriteLE(f, DEFAULT_ADC_FREQ, 4); WriteLE(f, DEFAULT_ADC_FREQ * 2, 4);
+        WriteLE(f, 2, 2); WriteLE(f, 16, 2);
+        fwrite("data", 1, 4, f); WriteLE(f, data_size, 4);
+        for (uint32_t i = 0; i < capture_samples; i++)
+            WriteLE(f, (uint16_t)(int16_t)(8000 * sin(i * 0.3) + (int)(i * 7 % 201) - 100), 2);
+        fclose(f);
+    }
+
+    struct Received {
+        std::atomic<uint64_t> samples{0};
+        std::vector<float> first;     // the first IQ samples, to compare the devices
+        size_t keep = 0;             // IQ samples
+    };
+
+    void IQCallback(void* context, const sddc_complex_t* data, uint32_t len, int64_t)
+    {
+        auto received = (Received*)context;
+        for (uint32_t i = 0; i < len && received->first.size() < received->keep * 2; i++)
+        {
+            received->first.push_back(data[i][0]);
+            received->first.push_back(data[i][1]);
+        }
+        received->samples += len;
+    }
+
+    // IQ samples per second over all the devices, for the given time
+    double Stream(std::vector<RadioHandler*>& radios, std::vector<Received>& received, seconds duration)
+    {
+        for (size_t i = 0; i < radios.size(); i++)
+        {
+            radios[i]->AttachIQ(IQCallback, &received[i]);
+            radios[i]->SetDecimation(2);
+        }
+
+        for (auto radio : radios)
+            radio->Start(true);
+
+        auto start = steady_clock::now();
+        std::this_thread::sleep_for(duration);
+        double elapsed = std::chrono::duration<double>(steady_clock::now() - start).count();
+
+        uint64_t samples = 0;
+        for (auto& r : received)
+            samples += r.samples;
+
+        for (auto radio : radios)
+            radio->Stop();
+
+        return samples / elapsed;
+    }
+}
+
+TEST_CASE(RadioManagerFixture, OpenTest)
+{
+    WriteCapture();
+
+    RadioManager manager;
+    REQUIRE_EQUAL(manager.Open(0, "unknown"), ERR_BACKEND_INVALID);
+    REQUIRE_EQUAL(manager.Open(1, backend), ERR_FX3_OPEN_FAILED);
+    REQUIRE_EQUAL(manager.Count(), 0u);
+
+    REQUIRE_EQUAL(manager.Open(0, backend), ERR_SUCCESS);
+    REQUIRE_EQUAL(manager.Open(0, backend), ERR_SUCCESS);
+    REQUIRE_EQUAL(manager.Count(), 2u);
+    REQUIRE_TRUE(manager.Get(1)->GetSharedProcessing());
+    REQUIRE_TRUE(manager.Get(2) == nullptr);
+
+    // Attached while streaming only
+    REQUIRE_EQUAL(manager.StartAll(true), ERR_SUCCESS);
+    REQUIRE_EQUAL(r2iq_pool::Get().StreamCount(), 2u);
+    REQUIRE_EQUAL(manager.Get(0)->SetSharedProcessing(false), ERR_STREAM_RUNNING);
+    REQUIRE_EQUAL(manager.StopAll(), ERR_SUCCESS);
+    REQUIRE_EQUAL(r2iq_pool::Get().StreamCount(), 0u);
+
+    remove(capture_path);
+}
+
+TEST_CASE(RadioManagerFixture, WorkerCountTest)
+{
+    WriteCapture();
+
+    RadioManager manager;
+    REQUIRE_EQUAL(manager.Open(0, backend), ERR_SUCCESS);
+
+    r2iq_pool::Get().SetWorkerCount(2);
+    REQUIRE_EQUAL(r2iq_pool::Get().WorkerCount(), 2u);
+    REQUIRE_EQUAL(manager.StartAll(true), ERR_SUCCESS);
+    REQUIRE_EQUAL(manager.StopAll(), ERR_SUCCESS);
+
+    // Back to one per core
+    r2iq_pool::Get().SetWorkerCount(0);
+    REQUIRE_EQUAL(r2iq_pool::Get().WorkerCount(), std::max(1u, std::thread::hardware_concurrency()));
+
+    remove(capture_path);
+}
+
+TEST_CASE(RadioManagerFixture, SameOutputTest)
+{
+    WriteCapture();
+
+    // The shared workers and tables give the same samples as a thread per device
+    RadioHandler alone;
+    REQUIRE_EQUAL(alone.SetBackend(backend), ERR_SUCCESS);
+    REQUIRE_EQUAL(alone.Init(0), ERR_SUCCESS);
+
+    RadioManager manager;
+    for (int i = 0; i < devices; i++)
+        REQUIRE_EQUAL(manager.Open(0, backend), ERR_SUCCESS);
+
+    std::vector<RadioHandler*> radios = { &alone };
+    for (int i = 0; i < devices; i++)
+        radios.push_back(manager.Get(i));
+
+    std::vector<Received> received(radios.size());
+    for (auto& r : received)
+        r.keep = transferSamples / 4;
+    Stream(radios, received, seconds(1));
+
+    for (auto& r : received)
+    {
+        REQUIRE_EQUAL(r.first.size(), (size_t)transferSamples / 2);
+        REQUIRE_TRUE(r.first == received[0].first);
+    }
+
+    remove(capture_path);
+}
@@ -0,0 +1,301 @@
+#include "RadioHandler.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string.h>
+
+using namespace std::chrono;
+
+namespace {
+    struct PullFixture {};
+
+    const char* backend = "generator,tones=10e6:-20;3e6:-40,speed=max";
+
+    std::atomic<uint64_t> pushed_samples;
+
+    void CountIQ(void*, const sddc_complex_t*, uint32_t len, int64_t)
+    {
+        pushed_samples += len;
+    }
+
+    void Open(RadioHandler& radio)
+    {
+        REQUIRE_EQUAL(radio.SetBackend(backend), ERR_SUCCESS);
+        REQUIRE_EQUAL(radio.Init(0), ERR_SUCCESS);
+        REQUIRE_EQUAL(radio.SetDecimation(1), ERR_SUCCESS);
+    }
+
+    // The first IQ samples of a stream, block by block
+    std::vector<float> AcquireFirst(size_t count)
+    {
+        RadioHandler radio;
+        Open(radio);
+        radio.SetPullMode(true);
+        radio.Start(true);
+
+        std::vector<float> iq;
+        while (iq.size() < count * 2)
+        {
+            const sddc_complex_t* data;
+            uint32_t length;
+            REQUIRE_EQUAL(radio.AcquireIQ(&data, &length, nullptr, 1000), ERR_SUCCESS);
+            for (uint32_t i = 0; i < length && iq.size() < count * 2; i++)
+            {
+                iq.push_back(data[i][0]);
+                iq.push_back(data[i][1]);
+            }
+            radio.ReleaseIQ();
+        }
+
+        radio.Stop();
+        return iq;
+    }
+}
+
+TEST_CASE(PullFixture, ModeTest)
+{
+    RadioHandler radio;
+    Open(radio);
+
+    const sddc_complex_t* data;
+    uint32_t length;
+    REQUIRE_EQUAL(radio.AcquireIQ(&data, &length, nullptr, 10), ERR_STREAM_STOPPED);
+
+    // The callbacks get the samples
+    radio.AttachIQ(CountIQ);
+    REQUIRE_EQUAL(radio.Start(true), ERR_SUCCESS);
+    REQUIRE_EQUAL(radio.AcquireIQ(&data, &length, nullptr, 10), ERR_NOT_COMPATIBLE);
+    REQUIRE_EQUAL(radio.SetPullMode(true), ERR_STREAM_RUNNING);
+    radio.Stop();
+
+    REQUIRE_EQUAL(radio.SetPullMode(true), ERR_SUCCESS);
+    REQUIRE_TRUE(radio.GetPullMode());
+    REQUIRE_EQUAL(radio.Start(true), ERR_SUCCESS);
+
+    // Same block until it is released
+    const sddc_complex_t* again;
+    REQUIRE_EQUAL(radio.AcquireIQ(&data, &length, nullptr, 1000), ERR_SUCCESS);
+    REQUIRE_EQUAL(length, (uint32_t)transferSamples / 2);
+    REQUIRE_EQUAL(radio.AcquireIQ(&again, &length, nullptr, 1000), ERR_SUCCESS);
+    REQUIRE_TRUE(again == data);
+    REQUIRE_EQUAL(radio.ReleaseIQ(), ERR_SUCCESS);
+
+    const int16_t* real;
+    REQUIRE_EQUAL(radio.AcquireReal(&real, &length, nullptr, 10), ERR_NOT_COMPATIBLE);
+    radio.Stop();
+
+    // r2iq off
+    REQUIRE_EQUAL(radio.Start(false), ERR_SUCCESS);
+    REQUIRE_EQUAL(radio.AcquireReal(&real, &length, nullptr, 1000), ERR_SUCCESS);
+    REQUIRE_EQUAL(length, (uint32_t)transferSamples);
+    REQUIRE_EQUAL(radio.ReleaseReal(), ERR_SUCCESS);
+    REQUIRE_EQUAL(radio.AcquireIQ(&data, &length, nullptr, 10), ERR_NOT_COMPATIBLE);
+    radio.Stop();
+}
+
+TEST_CASE(PullFixture, StopTest)
+{
+    RadioHandler radio;
+    Open(radio);
+    radio.SetPullMode(true);
+    radio.Start(true);
+
+    // Not read: the ring fills up, and stopping wakes up the reader
+    std::this_thread::sleep_for(milliseconds(200));
+    std::thread stopper([&radio] {
+        std::this_thread::sleep_for(milliseconds(100));
+        radio.Stop();
+    });
+
+    sddc_err_t ret;
+    do {
+        const sddc_complex_t* data;
+        uint32_t length;
+        ret = radio.AcquireIQ(&data, &length, nullptr, 5000);
+        radio.ReleaseIQ();
+    } while (ret == ERR_SUCCESS);
+    stopper.join();
+
+    REQUIRE_EQUAL(ret, ERR_STREAM_STOPPED);
+}
+
+TEST_CASE(PullFixture, BlockIndexTest)
+{
+    RadioHandler radio;
+    Open(radio);
+    radio.SetPullMode(true);
+
+    const uint32_t blocks = radio.GetPullBlockCount();
+    REQUIRE_EQUAL(blocks, radio.GetStreamConfig().ring_blocks);
+    REQUIRE_TRUE(radio.GetPullBlock(blocks, true) == nullptr);
+    REQUIRE_EQUAL(radio.GetPullBlockIndex(), -1);
+
+    const int overflows = radio.GetPullOverflowCount();
+    radio.Start(true);
+
+    // The blocks come from the slots, in turn
+    for (uint32_t i = 0; i < blocks + 2; i++)
+    {
+        const sddc_complex_t* data;
+        uint32_t length;
+        REQUIRE_EQUAL(radio.AcquireIQ(&data, &length, nullptr, 1000), ERR_SUCCESS);
+        REQUIRE_EQUAL(radio.GetPullBlockIndex(), (int)(i % blocks));
+        REQUIRE_TRUE(radio.GetPullBlock(i % blocks, true) == data);
+        radio.ReleaseIQ();
+        REQUIRE_EQUAL(radio.GetPullBlockIndex(), -1);
+    }
+
+    // Not read: the producer ends up waiting on the full ring
+    auto deadline = steady_clock::now() + seconds(10);
+    while (radio.GetPullOverflowCount() == overflows && steady_clock::now() < deadline)
+        std::this_thread::sleep_for(milliseconds(10));
+    REQUIRE_TRUE(radio.GetPullOverflowCount() > overflows);
+    radio.Stop();
+}
+
+TEST_CASE(PullFixture, StatsTest)
+{
+    RadioHandler radio;
+    Open(radio);
+    radio.SetPullMode(true);
+    radio.Start(true);
+
+    // Read for a bit more than a statistics period, then not anymore
+    std::vector<sddc_complex_t> buffer(16384);
+    auto start = steady_clock::now();
+    while (steady_clock::now() - start < milliseconds(1500))
+    {
+        uint32_t read;
+        REQUIRE_EQUAL(radio.ReadIQ(buffer.data(), (uint32_t)buffer.size(), &read, nullptr, 1000), ERR_SUCCESS);
+    }
+
+    sddc_stream_stats_t stats = radio.GetStreamStats();
+    REQUIRE_TRUE(stats.real_samples_per_second > 0);
+    REQUIRE_TRUE(stats.iq_samples_per_second > 0);
+    REQUIRE_TRUE(stats.r2iq_load > 0);
+    REQUIRE_EQUAL(stats.usb_errors, 0u);
+    REQUIRE_EQUAL(stats.ring_blocks, radio.GetStreamConfig().ring_blocks);
+
+    auto deadline = steady_clock::now() + seconds(10);
+    while (radio.GetStreamStats().iq_ring_full == stats.iq_ring_full && steady_clock::now() < deadline)
+        std::this_thread::sleep_for(milliseconds(10));
+
+    stats = radio.GetStreamStats();
+    REQUIRE_TRUE(stats.iq_ring_full > 0);
+    REQUIRE_EQUAL(stats.iq_ring_fill, stats.ring_blocks - 1);
+
+    int64_t timestamp;
+    REQUIRE_TRUE(radio.GetPullOverflowCount(&timestamp) > 0);
+    REQUIRE_TRUE(timestamp != 0);
+    radio.Stop();
+}
+
+TEST_CASE(PullFixture, ReadTest)
+{
+    // Across the blocks, the copies give the samples of the blocks
+    const uint32_t chunk = 1000;
+    const size_t count = transferSamples * 2 + 123;
+    std::vector<float> expected = AcquireFirst(count);
+
+    RadioHandler radio;
+    Open(radio);
+    radio.SetPullMode(true);
+    radio.Start(true);
+
+    std::vector<float> iq;
+    std::vector<sddc_complex_t> buffer(chunk);
+    while (iq.size() < count * 2)
+    {
+        uint32_t read;
+        int64_t timestamp;
+        REQUIRE_EQUAL(radio.ReadIQ(buffer.data(), chunk, &read, &timestamp, 1000), ERR_SUCCESS);
+        REQUIRE_EQUAL(read, chunk);
+        for (uint32_t i = 0; i < read && iq.size() < count * 2; i++)
+        {
+            iq.push_back(buffer[i][0]);
+            iq.push_back(buffer[i][1]);
+        }
+    }
+    radio.Stop();
+
+    REQUIRE_TRUE(iq == expected);
+
+    // Nothing comes once stopped
+    uint32_t read;
+    REQUIRE_EQUAL(radio.ReadIQ(buffer.data(), chunk, &read, nullptr, 10), ERR_STREAM_STOPPED);
+    REQUIRE_EQUAL(read, 0u);
+}
+
+TEST_CASE(PullFixture, ReadRealTest)
+{
+    // The ADC samples, r2iq off
+    const uint32_t chunk = 5000;
+    const size_t count = transferSamples * 3;
+
+    std::vector<int16_t> expected;
+    {
+        RadioHandler radio;
+        Open(radio);
+        radio.SetPullMode(true);
+        radio.Start(false);
+        while (expected.size() < count)
+        {
+            const int16_t* data;
+            uint32_t length;
+            REQUIRE_EQUAL(radio.AcquireReal(&data, &length, nullptr, 1000), ERR_SUCCESS);
+            expected.insert(expected.end(), data, data + length);
+            radio.ReleaseReal();
+        }
+        radio.Stop();
+    }
+
+    RadioHandler radio;
+    Open(radio);
+    radio.SetPullMode(true);
+    radio.Start(false);
+
+    std::vector<int16_t> real(chunk);
+    for (size_t pos = 0; pos + chunk <= count; pos += chunk)
+    {
+        uint32_t read;
+        REQUIRE_EQUAL(radio.ReadReal(real.data(), chunk, &read, nullptr, 1000), ERR_SUCCESS);
+        REQUIRE_EQUAL(read, chunk);
+        REQUIRE_TRUE(std::equal(real.begin(), real.end(), expected.begin() + pos));
+    }
+
+    uint32_t read;
+    sddc_complex_t iq[16];
+    REQUIRE_EQUAL(radio.ReadIQ(iq, 16, &read, nullptr, 10), ERR_NOT_COMPATIBLE);
+    radio.Stop();
+}
+
+TEST_CASE(PullFixture, FormatTest)
+{
+    // CS16 gives the quantized CF32 samples
+    const size_t count = transferSamples + 17;
+    std::vector<float> expected = AcquireFirst(count);
+    iq_quantizer quantizer;
+    quantizer.Configure(SDDC_IQ_CS16, 1.0e4f);
+    quantizer.Convert(expected.data(), count);
+
+    RadioHandler radio;
+    Open(radio);
+    REQUIRE_EQUAL(radio.SetIQFormat(SDDC_IQ_CS16, -1.0f), ERR_FORMAT_INVALID);
+    REQUIRE_EQUAL(radio.SetIQFormat(SDDC_IQ_CS16, 1.0e4f), ERR_SUCCESS);
+    radio.SetPullMode(true);
+    radio.Start(true);
+    REQUIRE_EQUAL(radio.SetIQFormat(SDDC_IQ_CF32), ERR_STREAM_RUNNING);
+
+    std::vector<int16_t> iq(count * 2);
+    uint32_t read;
+    REQUIRE_EQUAL(radio.ReadIQ(iq.data(), (uint32_t)count, &read, nullptr, 1000), ERR_SUCCESS);
+    radio.Stop();
+
+    REQUIRE_EQUAL(read, (uint32_t)count);
+    REQUIRE_TRUE(*std::max_element(iq.begin(), iq.end()) > 100);
+    REQUIRE_TRUE(memcmp(iq.data(), expected.data(), count * 2 * sizeof(int16_t)) == 0);
+}
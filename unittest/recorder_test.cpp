@@ -0,0 +1,114 @@
+#include "record/recorder.h"
+#include "config.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+
+using namespace std::chrono;
+
+namespace {
+    struct RecorderFixture {};
+
+    const char* record_path = "recorder_test.raw";
+
+    int16_t Sample(uint64_t i)
+    {
+        return (int16_t)(i * 7 % 65521);
+    }
+
+    std::vector<int16_t> ReadFile(const char* path)
+    {
+        std::vector<int16_t> samples;
+        FILE* f = fopen(path, "rb");
+        if (!f)
+            return samples;
+        fseek(f, 0, SEEK_END);
+        samples.resize(ftell(f) / sizeof(int16_t));
+        fseek(f, 0, SEEK_SET);
+        size_t n = fread(samples.data(), sizeof(int16_t), samples.size(), f);
+        samples.resize(n);
+        fclose(f);
+        return samples;
+    }
+}
+
+TEST_CASE(RecorderFixture, ConfigTest)
+{
+    recorder rec;
+    sddc_record_config_t config = recorder::GetDefaultConfig();
+
+    config.chunk_size = 1000;       // not a multiple of 4096
+    REQUIRE_EQUAL(rec.Open(record_path, &config), ERR_BUFFER_SIZE_INVALID);
+
+    config.chunk_size = 65536;
+    config.buffer_size = 65536;     // a single chunk
+    REQUIRE_EQUAL(rec.Open(record_path, &config), ERR_BUFFER_SIZE_INVALID);
+
+    REQUIRE_EQUAL(rec.Open("no_such_dir/recorder_test.raw"), ERR_RECORD_FAILED);
+    REQUIRE_FALSE(rec.IsOpen());
+}
+
+TEST_CASE(RecorderFixture, WriteTest)
+{
+    // Blocks straddling the chunks, and a last chunk which is not a whole number of pages
+    sddc_record_config_t config = recorder::GetDefaultConfig();
+    config.buffer_size = 16 * 65536;
+    config.chunk_size = 65536;
+
+    const size_t block = 10007;
+    const int blocks = 300;
+    std::vector<int16_t> samples(block);
+
+    recorder rec;
+    REQUIRE_EQUAL(rec.Open(record_path, &config), ERR_SUCCESS);
+    for (int b = 0; b < blocks; b++)
+    {
+        for (size_t i = 0; i < block; i++)
+            samples[i] = Sample(b * block + i);
+        while (!rec.Write(samples.data(), block * sizeof(int16_t), 1000 + b))
+            std::this_thread::sleep_for(1ms);   // the disk was late, try again
+    }
+    REQUIRE_EQUAL(rec.Close(), ERR_SUCCESS);
+
+    auto stats = rec.GetStats();
+    REQUIRE_EQUAL(stats.bytes_written, (uint64_t)blocks * block * sizeof(int16_t));
+    REQUIRE_EQUAL(stats.error, 0);
+    REQUIRE_EQUAL(stats.first_timestamp, (int64_t)1000);
+
+    auto content = ReadFile(record_path);
+    REQUIRE_EQUAL(content.size(), (size_t)blocks * block);
+    for (size_t i = 0; i < content.size(); i++)
+        REQUIRE_EQUAL(content[i], Sample(i));
+
+    remove(record_path);
+}
+
+TEST_CASE(RecorderFixture, DropTest)
+{
+    sddc_record_config_t config = recorder::GetDefaultConfig();
+    config.buffer_size = 2 * 4096;
+    config.chunk_size = 4096;
+
+    recorder rec;
+    REQUIRE_EQUAL(rec.Open(record_path, &config), ERR_SUCCESS);
+
+    // Larger than the whole buffer: always dropped, and nothing is written
+    std::vector<uint8_t> large(3 * 4096, 0x5A);
+    REQUIRE_FALSE(rec.Write(large.data(), large.size()));
+    std::vector<uint8_t> small(1000, 0xA5);
+    REQUIRE_TRUE(rec.Write(small.data(), small.size()));
+
+    auto stats = rec.GetStats();
+    REQUIRE_EQUAL(stats.blocks_dropped, 1u);
+    REQUIRE_EQUAL(stats.bytes_dropped, (uint64_t)large.size());
+    REQUIRE_EQUAL(rec.Close(), ERR_SUCCESS);
+
+    auto content = ReadFile(record_path);
+    REQUIRE_EQUAL(content.size(), small.size() / sizeof(int16_t));
+    REQUIRE_EQUAL((uint16_t)content[0], 0xA5A5);
+
+    remove(record_path);
+}
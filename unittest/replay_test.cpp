@@ -0,0 +1,134 @@
+#include "RadioHandler.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+
+using namespace std::chrono;
+
+namespace {
+    struct ReplayFixture {};
+
+    const char* capture_path = "replay_test.wav";
+    const uint32_t capture_samples = transferSamples * 5 + 1000;   // not a whole number of blocks
+
+    int16_t CaptureSample(uint64_t i)
+    {
+        return (int16_t)(i * 7 % 65521);
+    }
+
+    void WriteLE(FILE* f, uint32_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++)
+            fputc((value >> (8 * i)) & 0xFF, f);
+    }
+
+    void WriteCapture()
+    {
+        FILE* f = fopen(capture_path, "wb");
+        uint32_t data_size = capture_samples * sizeof(int16_t);
+
+        fwrite("RIFF", 1, 4, f); WriteLE(f, 36 + data_size, 4); fwrite("WAVE", 1, 4, f);
+        fwrite("fmt ", 1, 4, f); WriteLE(f, 16, 4);
+        WriteLE(f, 1, 2); WriteLE(f, 1, 2);                                 // PCM, mono
+        WriteLE(f, DEFAULT_ADC_FREQ, 4); WriteLE(f, DEFAULT_ADC_FREQ * 2, 4);
+        WriteLE(f, 2, 2); WriteLE(f, 16, 2);
+        fwrite("data", 1, 4, f); WriteLE(f, data_size, 4);
+        for (uint32_t i = 0; i < capture_samples; i++)
+            WriteLE(f, (uint16_t)CaptureSample(i), 2);
+        fclose(f);
+    }
+
+    struct Received {
+        uint64_t samples = 0;
+        uint64_t check_until = 0;   // the last blocks may race with Stop()
+        bool content_ok = true;
+    };
+
+    void RealCallback(void* context, const int16_t* data, uint32_t len, int64_t)
+    {
+        auto received = (Received*)context;
+        for (uint32_t i = 0; i < len && received->samples < received->check_until; i++)
+        {
+            if (data[i] != CaptureSample((received->samples + i) % capture_samples))
+                received->content_ok = false;
+        }
+        received->samples += len;
+    }
+}
+
+TEST_CASE(ReplayFixture, OptionsTest)
+{
+    RadioHandler radio;
+
+    REQUIRE_EQUAL(radio.SetBackend("replay"), ERR_BACKEND_INVALID);
+    REQUIRE_EQUAL(radio.SetBackend("replay,file=x.wav,speed=-1"), ERR_BACKEND_INVALID);
+    REQUIRE_EQUAL(radio.SetBackend("replay,file=x.wav,model=RX1"), ERR_BACKEND_INVALID);
+    REQUIRE_EQUAL(radio.SetBackend("replay,file=x.wav,colour=blue"), ERR_BACKEND_INVALID);
+    REQUIRE_EQUAL(radio.SetBackend("unknown"), ERR_BACKEND_INVALID);
+
+    // Valid options, but no such file
+    REQUIRE_EQUAL(radio.SetBackend("replay,file=does_not_exist.wav,speed=max,loop=0"), ERR_SUCCESS);
+    REQUIRE_EQUAL(radio.Init(0), ERR_FX3_OPEN_FAILED);
+}
+
+TEST_CASE(ReplayFixture, MaxSpeedTest)
+{
+    WriteCapture();
+
+    RadioHandler radio;
+    REQUIRE_EQUAL(radio.SetBackend("replay,file=replay_test.wav,speed=max,model=RX888r3"), ERR_SUCCESS);
+    REQUIRE_EQUAL(radio.Init(0), ERR_SUCCESS);
+    REQUIRE_EQUAL(radio.getHardwareModel(), RX888r3);
+
+    // The device list follows the backend
+    auto devices = RadioHandler::GetDeviceList("replay,file=replay_test.wav");
+    REQUIRE_EQUAL(devices.size(), 1u);
+    REQUIRE_EQUAL(devices[0].serial_number, std::string(capture_path));
+
+    // Several loops over the capture, bit exact
+    const uint64_t wanted = (uint64_t)capture_samples * 20;
+    Received received;
+    received.check_until = wanted;
+    radio.AttachReal(RealCallback, &received);
+    auto start = steady_clock::now();
+    radio.Start(false);
+    while (received.samples < wanted && steady_clock::now() - start < 10s)
+        std::this_thread::sleep_for(1ms);
+    double elapsed = duration<double>(steady_clock::now() - start).count();
+    radio.Stop();
+
+    printf("replay at max speed: %.1f Msps\n", received.samples / elapsed / 1e6);
+    REQUIRE_TRUE(received.samples >= wanted);
+    REQUIRE_TRUE(received.content_ok);
+
+    remove(capture_path);
+}
+
+TEST_CASE(ReplayFixture, RealTimeTest)
+{
+    WriteCapture();
+
+    RadioHandler radio;
+    REQUIRE_EQUAL(radio.SetBackend("replay,file=replay_test.wav,speed=1"), ERR_SUCCESS);
+    REQUIRE_EQUAL(radio.Init(0), ERR_SUCCESS);
+    radio.SetADCSampleRate(32000000);
+
+    Received received;
+    received.check_until = 16000000;
+    radio.AttachReal(RealCallback, &received);
+
+    radio.Start(false);
+    std::this_thread::sleep_for(1s);
+    radio.Stop();
+
+    // Paced at the ADC rate, whatever the host can do
+    printf("replay at real time: %.1f Msps\n", received.samples / 1e6);
+    REQUIRE_TRUE(received.samples > 32000000 * 0.7);
+    REQUIRE_TRUE(received.samples < 32000000 * 1.1);
+    REQUIRE_TRUE(received.content_ok);
+
+    remove(capture_path);
+}
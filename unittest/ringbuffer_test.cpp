@@ -22,7 +22,7 @@ TEST_CASE(RingBufferFixture, BasicTest)
     auto ptr2 = ringbuf->getReadPtr();
     REQUIRE_EQUAL(*ptr2, 0x5a5a);
     REQUIRE_EQUAL(*(ptr2 + 0x100), 0x5a5a);
-    delete ptr;
+    delete ringbuf;
 }
 
 TEST_CASE(RingBufferFixture, TwoThreadsTest)
@@ -174,4 +174,25 @@ TEST_CASE(RingBufferFixture, PeekTest)
 
     auto rptr2 = buffer.peekReadPtr(-1);
     CHECK_EQUAL(rptr0, rptr2);
-}
\ No newline at end of file
+}
+
+TEST_CASE(RingBufferFixture, DoneAfterStopTest)
+{
+    auto buffer = ringbuffer<int16_t>(16);
+
+    buffer.getWritePtr();
+    buffer.WriteDone();
+    buffer.getReadPtr();
+
+    // Blocks finished once stopped leave the indices alone
+    buffer.Stop();
+    buffer.ReadDone();
+    buffer.WriteDone();
+    REQUIRE_EQUAL(buffer.getReadIndex(), 0);
+    REQUIRE_FALSE(buffer.isEmpty());
+
+    // Nor do they move them past the ones reset by Start
+    buffer.Start();
+    REQUIRE_TRUE(buffer.isEmpty());
+    REQUIRE_EQUAL(buffer.getReadIndex(), 0);
+}
@@ -0,0 +1,229 @@
+#include "ipc/shm_publisher.h"
+#include "sddc_shm.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <string>
+#include <thread>
+#include <vector>
+#include <string.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+
+namespace {
+    struct ShmFixture {};
+
+    // Unique per process, the tests may run in parallel
+    std::string Name(const char* test)
+    {
+        return "/sddc_test_" + std::string(test) + "_" + std::to_string(getpid());
+    }
+
+    shm_stream_t RawStream()
+    {
+        shm_stream_t stream;
+        stream.raw = true;
+        stream.iq_format = SDDC_IQ_CF32;
+        stream.sample_size = sizeof(int16_t);
+        stream.sample_rate = 1e9;   // 1 ns per sample
+        stream.adc_sample_rate = 1000000000;
+        return stream;
+    }
+
+    // 8 slots of 4096 bytes: 2048 samples each
+    sddc_shm_config_t SmallConfig()
+    {
+        sddc_shm_config_t config = shm_publisher::GetDefaultConfig();
+        config.buffer_size = 8 * 4096;
+        config.slot_size = 4096;
+        config.max_readers = 4;
+        return config;
+    }
+
+    // Samples numbered from `first`
+    std::vector<int16_t> Block(size_t count, uint64_t first)
+    {
+        std::vector<int16_t> block(count);
+        for (size_t i = 0; i < count; i++)
+            block[i] = (int16_t)(first + i);
+        return block;
+    }
+
+    void CheckBlock(const sddc_shm_block_t& block)
+    {
+        const int16_t* samples = (const int16_t*)block.data;
+        for (size_t i = 0; i < block.size / sizeof(int16_t); i++)
+            REQUIRE_EQUAL(samples[i], (int16_t)(block.first_sample + i));
+    }
+}
+
+TEST_CASE(ShmFixture, PublishTest)
+{
+    const std::string name = Name("publish");
+    shm_publisher publisher;
+    sddc_shm_config_t config = SmallConfig();
+    REQUIRE_EQUAL(publisher.Open(name.c_str(), &config, RawStream()), ERR_SUCCESS);
+
+    // Taken while its publisher runs
+    shm_publisher second;
+    REQUIRE_EQUAL(second.Open(name.c_str(), &config, RawStream()), ERR_SHM_FAILED);
+
+    sddc_shm_reader_t reader;
+    REQUIRE_EQUAL(sddc_shm_open(name.c_str(), &reader), ERR_SUCCESS);
+
+    sddc_shm_info_t info;
+    sddc_shm_get_info(reader, &info);
+    REQUIRE_TRUE(info.raw);
+    REQUIRE_EQUAL(info.sample_size, 2u);
+    REQUIRE_EQUAL(info.slot_count, 8u);
+    REQUIRE_EQUAL(info.slot_size, 4096u);
+
+    // Nothing yet
+    sddc_shm_block_t block;
+    REQUIRE_EQUAL(sddc_shm_acquire(reader, &block, 10), ERR_TIMEOUT);
+
+    // 3000 samples span two slots, the second one 2048 samples (ns) later
+    std::vector<int16_t> samples = Block(3000, 0);
+    publisher.Write(samples.data(), samples.size() * sizeof(int16_t), 1000000);
+    samples = Block(100, 3000);
+    publisher.Write(samples.data(), samples.size() * sizeof(int16_t), 2000000);
+
+    REQUIRE_EQUAL(sddc_shm_acquire(reader, &block, 10), ERR_SUCCESS);
+    REQUIRE_EQUAL(block.seq, 0u);
+    REQUIRE_EQUAL(block.size, 4096u);
+    REQUIRE_EQUAL(block.first_sample, 0u);
+    REQUIRE_EQUAL(block.timestamp_ns, 1000000);
+    REQUIRE_EQUAL(block.dropped, 0u);
+    CheckBlock(block);
+    REQUIRE_EQUAL(sddc_shm_release(reader), ERR_SUCCESS);
+
+    REQUIRE_EQUAL(sddc_shm_acquire(reader, &block, 10), ERR_SUCCESS);
+    REQUIRE_EQUAL(block.size, (3000u - 2048u) * 2);
+    REQUIRE_EQUAL(block.first_sample, 2048u);
+    REQUIRE_EQUAL(block.timestamp_ns, 1000000 + 2048);
+    CheckBlock(block);
+
+    // Acquiring releases the block held
+    REQUIRE_EQUAL(sddc_shm_acquire(reader, &block, 10), ERR_SUCCESS);
+    REQUIRE_EQUAL(block.seq, 2u);
+    REQUIRE_EQUAL(block.first_sample, 3000u);
+    CheckBlock(block);
+    REQUIRE_EQUAL(sddc_shm_release(reader), ERR_SUCCESS);
+
+    sddc_shm_stats_t stats = publisher.GetStats();
+    REQUIRE_EQUAL(stats.slots_published, 3u);
+    REQUIRE_EQUAL(stats.bytes_published, 3100u * 2);
+    REQUIRE_EQUAL(stats.readers, 1u);
+    REQUIRE_EQUAL(stats.max_lag, 0u);
+
+    // Once closed, the blocks left are read, then the stream ends
+    publisher.Write(samples.data(), samples.size() * sizeof(int16_t), 0);
+    publisher.Close();
+    REQUIRE_EQUAL(sddc_shm_acquire(reader, &block, 10), ERR_SUCCESS);
+    REQUIRE_EQUAL(block.timestamp_ns, 0);
+    REQUIRE_EQUAL(sddc_shm_acquire(reader, &block, 10), ERR_STREAM_STOPPED);
+    sddc_shm_close(reader);
+
+    REQUIRE_EQUAL(sddc_shm_open(name.c_str(), &reader), ERR_SHM_FAILED);
+}
+
+TEST_CASE(ShmFixture, OverrunTest)
+{
+    const std::string name = Name("overrun");
+    shm_publisher publisher;
+    sddc_shm_config_t config = SmallConfig();
+    REQUIRE_EQUAL(publisher.Open(name.c_str(), &config, RawStream()), ERR_SUCCESS);
+
+    sddc_shm_reader_t reader;
+    REQUIRE_EQUAL(sddc_shm_open(name.c_str(), &reader), ERR_SUCCESS);
+
+    // 20 slots while the reader is away: it skips to the newest one
+    uint64_t first = 0;
+    for (int i = 0; i < 20; i++, first += 2048)
+    {
+        std::vector<int16_t> samples = Block(2048, first);
+        publisher.Write(samples.data(), samples.size() * sizeof(int16_t), 0);
+    }
+
+    sddc_shm_block_t block;
+    REQUIRE_EQUAL(sddc_shm_acquire(reader, &block, 10), ERR_SUCCESS);
+    REQUIRE_EQUAL(block.seq, 19u);
+    REQUIRE_EQUAL(block.dropped, 19u);
+    CheckBlock(block);
+
+    // Held for a whole ring: the slot was reused meanwhile
+    for (int i = 0; i < 8; i++, first += 2048)
+    {
+        std::vector<int16_t> samples = Block(2048, first);
+        publisher.Write(samples.data(), samples.size() * sizeof(int16_t), 0);
+    }
+    REQUIRE_EQUAL(sddc_shm_release(reader), ERR_SHM_OVERRUN);
+
+    sddc_shm_stats_t stats = publisher.GetStats();
+    REQUIRE_EQUAL(stats.slots_dropped, 19u);
+    REQUIRE_EQUAL(stats.overruns, 1u);
+    REQUIRE_EQUAL(stats.max_lag, 8u);
+
+    sddc_shm_close(reader);
+    REQUIRE_EQUAL(publisher.GetStats().readers, 0u);
+}
+
+TEST_CASE(ShmFixture, ReadersTest)
+{
+    const std::string name = Name("readers");
+    shm_publisher publisher;
+    sddc_shm_config_t config = SmallConfig();
+    config.buffer_size = 64 * 4096;
+    REQUIRE_EQUAL(publisher.Open(name.c_str(), &config, RawStream()), ERR_SUCCESS);
+
+    // Every slot taken
+    const int count = 4;
+    sddc_shm_reader_t readers[count];
+    for (int i = 0; i < count; i++)
+        REQUIRE_EQUAL(sddc_shm_open(name.c_str(), &readers[i]), ERR_SUCCESS);
+    sddc_shm_reader_t extra;
+    REQUIRE_EQUAL(sddc_shm_open(name.c_str(), &extra), ERR_SHM_FAILED);
+
+    // The readers wait for the blocks, and see each one of them until the end
+    const int blocks = 1000;
+    uint64_t received[count] = {};
+    bool intact[count] = {};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < count; i++)
+    {
+        threads.emplace_back([&, i] {
+            intact[i] = true;
+            sddc_shm_block_t block;
+            sddc_err_t ret;
+            while ((ret = sddc_shm_acquire(readers[i], &block, 5000)) == ERR_SUCCESS)
+            {
+                const int16_t* samples = (const int16_t*)block.data;
+                intact[i] = intact[i] && block.dropped == 0 && block.first_sample == received[i] * 2048 &&
+                    samples[2047] == (int16_t)(block.first_sample + 2047);
+                intact[i] = sddc_shm_release(readers[i]) == ERR_SUCCESS && intact[i];
+                received[i]++;
+            }
+            intact[i] = intact[i] && ret == ERR_STREAM_STOPPED;
+        });
+    }
+
+    // Slowly enough for the readers to keep up
+    for (int i = 0; i < blocks; i++)
+    {
+        std::vector<int16_t> samples = Block(2048, (uint64_t)i * 2048);
+        publisher.Write(samples.data(), samples.size() * sizeof(int16_t), 0);
+        if (i % 16 == 15)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    publisher.Close();
+
+    for (auto& thread : threads)
+        thread.join();
+    for (int i = 0; i < count; i++)
+    {
+        REQUIRE_EQUAL(received[i], (uint64_t)blocks);
+        REQUIRE_TRUE(intact[i]);
+        sddc_shm_close(readers[i]);
+    }
+}
+#endif
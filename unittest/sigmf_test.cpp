@@ -0,0 +1,195 @@
+#include "record/sigmf.h"
+#include "RadioHandler.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+
+using namespace std::chrono;
+
+namespace {
+    struct SigMFFixture {};
+
+    const char* base_path = "sigmf_test";
+    const int64_t t0 = 1700000000000000000;     // 2023-11-14T22:13:20Z
+
+    int16_t Sample(uint64_t i)
+    {
+        return (int16_t)(i * 7 % 65521);
+    }
+
+    std::string ReadText(const std::string& path)
+    {
+        std::ifstream f(path);
+        std::stringstream text;
+        text << f.rdbuf();
+        return text.str();
+    }
+
+    bool Contains(const std::string& text, const std::string& part)
+    {
+        if (text.find(part) != std::string::npos)
+            return true;
+        printf("'%s' not found in:\n%s", part.c_str(), text.c_str());
+        return false;
+    }
+
+    sigmf_global_t RawGlobal(double sample_rate)
+    {
+        sigmf_global_t global;
+        global.datatype = "ri16_le";
+        global.sample_size = sizeof(int16_t);
+        global.sample_rate = sample_rate;
+        global.adc_sample_rate = (uint32_t)sample_rate;
+        global.hardware = "RX888 mkII";
+        global.firmware = 0x0203;
+        return global;
+    }
+
+    void RemoveRecording()
+    {
+        remove(sigmf_writer::DataPath(base_path).c_str());
+        remove(sigmf_writer::MetaPath(base_path).c_str());
+    }
+
+    struct Received {
+        uint64_t samples = 0;
+        uint64_t check_until = 0;
+        uint64_t length = 0;
+        bool content_ok = true;
+    };
+
+    void RealCallback(void* context, const int16_t* data, uint32_t len, int64_t)
+    {
+        auto received = (Received*)context;
+        for (uint32_t i = 0; i < len && received->samples + i < received->check_until; i++)
+        {
+            if (data[i] != Sample((received->samples + i) % received->length))
+                received->content_ok = false;
+        }
+        received->samples += len;
+    }
+}
+
+TEST_CASE(SigMFFixture, PathTest)
+{
+    REQUIRE_EQUAL(sigmf_writer::DataPath("a/b"), std::string("a/b.sigmf-data"));
+    REQUIRE_EQUAL(sigmf_writer::MetaPath("a/b.sigmf-data"), std::string("a/b.sigmf-meta"));
+    REQUIRE_EQUAL(sigmf_writer::DataPath("a/b.sigmf-meta"), std::string("a/b.sigmf-data"));
+}
+
+TEST_CASE(SigMFFixture, SegmentTest)
+{
+    // 1 Msps, blocks of 1000 samples: block b starts at t0 + b ms
+    const double rate = 1e6;
+    const size_t block = 1000;
+    std::vector<int16_t> samples(block);
+
+    sddc_record_config_t config = recorder::GetDefaultConfig();
+    config.buffer_size = 16 * 65536;
+    config.chunk_size = 65536;
+
+    sigmf_state_t state = { 7100000, 0, 10, HFMODE };
+    sigmf_writer sigmf;
+    REQUIRE_EQUAL(sigmf.Open(base_path, RawGlobal(rate), state, &config), ERR_SUCCESS);
+
+    // Readable before the first sample
+    std::string meta = ReadText(sigmf_writer::MetaPath(base_path));
+    REQUIRE_TRUE(Contains(meta, "\"core:datatype\": \"ri16_le\""));
+    REQUIRE_TRUE(Contains(meta, "\"core:sample_rate\": 1000000,"));
+
+    // A retune at 2.5 ms, then a gain change at 4 ms, both made ahead of the stream
+    state.frequency = 14200000;
+    sigmf.SetState(state, t0 + 2500000);
+    state.if_gain = 20;
+    sigmf.SetState(state, t0 + 4000000);
+
+    uint64_t written = 0;
+    for (int b = 0; b < 6; b++)
+    {
+        for (size_t i = 0; i < block; i++)
+            samples[i] = Sample(written + i);
+        REQUIRE_TRUE(sigmf.Write(samples.data(), block * sizeof(int16_t), t0 + b * 1000000));
+        written += block;
+    }
+
+    // Larger than the buffer: dropped, the next block starts a capture
+    const size_t lost = 600000;
+    std::vector<int16_t> large(lost);
+    REQUIRE_FALSE(sigmf.Write(large.data(), lost * sizeof(int16_t), t0 + 6000000));
+    for (int b = 0; b < 2; b++)
+    {
+        for (size_t i = 0; i < block; i++)
+            samples[i] = Sample(written + i);
+        REQUIRE_TRUE(sigmf.Write(samples.data(), block * sizeof(int16_t), t0 + 606000000 + b * 1000000));
+        written += block;
+    }
+
+    // After the last sample: not recorded
+    state.rf_gain = -10;
+    sigmf.SetState(state, t0 + 700000000);
+    REQUIRE_EQUAL(sigmf.Close(), ERR_SUCCESS);
+
+    meta = ReadText(sigmf_writer::MetaPath(base_path));
+    REQUIRE_TRUE(Contains(meta, "\"core:hw\": \"RX888 mkII, firmware 203\""));
+    REQUIRE_TRUE(Contains(meta, "{ \"core:sample_start\": 0, \"core:global_index\": 0, \"core:frequency\": 7100000, "
+        "\"core:datetime\": \"2023-11-14T22:13:20.000000000Z\" }"));
+    REQUIRE_TRUE(Contains(meta, "{ \"core:sample_start\": 2500, \"core:global_index\": 2500, \"core:frequency\": 14200000, "
+        "\"core:datetime\": \"2023-11-14T22:13:20.002500000Z\" }"));
+    REQUIRE_TRUE(Contains(meta, "{ \"core:sample_start\": 6000, \"core:global_index\": 606000, \"core:frequency\": 14200000, "
+        "\"core:datetime\": \"2023-11-14T22:13:20.606000000Z\" }"));
+    REQUIRE_TRUE(Contains(meta, "{ \"core:sample_start\": 0, \"core:sample_count\": 4000, "
+        "\"sddc:rf_mode\": \"HF\", \"sddc:rf_gain\": 0, \"sddc:if_gain\": 10 }"));
+    REQUIRE_TRUE(Contains(meta, "{ \"core:sample_start\": 4000, \"core:sample_count\": 4000, "
+        "\"sddc:rf_mode\": \"HF\", \"sddc:rf_gain\": 0, \"sddc:if_gain\": 20 }"));
+    REQUIRE_TRUE(meta.find("-10") == std::string::npos);
+
+    // The data file only holds what was accepted
+    std::ifstream data(sigmf_writer::DataPath(base_path), std::ios::binary);
+    std::vector<int16_t> content(written + 1);
+    data.read((char*)content.data(), content.size() * sizeof(int16_t));
+    REQUIRE_EQUAL((uint64_t)data.gcount(), written * sizeof(int16_t));
+    for (uint64_t i = 0; i < written; i++)
+        REQUIRE_EQUAL(content[i], Sample(i));
+
+    RemoveRecording();
+}
+
+TEST_CASE(SigMFFixture, ReplayTest)
+{
+    // A raw ADC recording replayed bit exact by the replay backend
+    const uint64_t length = transferSamples * 3 + 500;
+    std::vector<int16_t> samples(length);
+    for (uint64_t i = 0; i < length; i++)
+        samples[i] = Sample(i);
+
+    sigmf_state_t state = { 0, 0, 0, HFMODE };
+    sigmf_writer sigmf;
+    REQUIRE_EQUAL(sigmf.Open(base_path, RawGlobal(DEFAULT_ADC_FREQ), state), ERR_SUCCESS);
+    REQUIRE_TRUE(sigmf.Write(samples.data(), length * sizeof(int16_t), t0));
+    REQUIRE_EQUAL(sigmf.Close(), ERR_SUCCESS);
+
+    RadioHandler radio;
+    REQUIRE_EQUAL(radio.SetBackend("replay,file=sigmf_test.sigmf-meta,speed=max"), ERR_SUCCESS);
+    REQUIRE_EQUAL(radio.Init(0), ERR_SUCCESS);
+
+    Received received;
+    received.length = length;
+    received.check_until = length * 4;
+    radio.AttachReal(RealCallback, &received);
+    auto start = steady_clock::now();
+    radio.Start(false);
+    while (received.samples < received.check_until && steady_clock::now() - start < 10s)
+        std::this_thread::sleep_for(1ms);
+    radio.Stop();
+
+    REQUIRE_TRUE(received.samples >= received.check_until);
+    REQUIRE_TRUE(received.content_ok);
+
+    RemoveRecording();
+}
@@ -0,0 +1,231 @@
+#include "net/stream_server.h"
+#include "RadioHandler.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <algorithm>
+#include <chrono>
+#include <complex>
+#include <thread>
+#include <vector>
+#include <string.h>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std::chrono;
+
+namespace {
+    struct StreamServerFixture {};
+
+    // 64 Msps decimated by 4: 8 Msps of IQ, the tone 200 kHz below the center
+    const char* backend = "generator,tones=10e6:-20,speed=max";
+    const uint32_t center = 10200000;
+
+    void Open(RadioHandler& radio)
+    {
+        REQUIRE_EQUAL(radio.SetBackend(backend), ERR_SUCCESS);
+        REQUIRE_EQUAL(radio.Init(0), ERR_SUCCESS);
+        REQUIRE_EQUAL(radio.SetADCSampleRate(64000000), ERR_SUCCESS);
+        REQUIRE_EQUAL(radio.SetDecimation(2), ERR_SUCCESS);
+    }
+
+    sddc_server_config_t LocalConfig()
+    {
+        sddc_server_config_t config = stream_server::GetDefaultConfig();
+        config.address = "127.0.0.1";
+        config.port = 0;
+        return config;
+    }
+
+    int Connect(uint16_t port)
+    {
+        int s = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        REQUIRE_EQUAL(connect(s, (struct sockaddr*)&address, sizeof(address)), 0);
+
+        struct timeval timeout = { 5, 0 };
+        setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        return s;
+    }
+
+    // False when the connection closed first
+    bool Receive(int s, uint8_t* data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t received = recv(s, data, size, 0);
+            if (received <= 0)
+                return false;
+            data += received;
+            size -= received;
+        }
+        return true;
+    }
+
+    void SendCommand(int s, uint8_t code, uint32_t param)
+    {
+        uint8_t command[5] = { code, (uint8_t)(param >> 24), (uint8_t)(param >> 16), (uint8_t)(param >> 8), (uint8_t)param };
+        REQUIRE_EQUAL(send(s, command, sizeof(command), 0), (ssize_t)sizeof(command));
+    }
+
+    template<typename Condition> bool WaitFor(Condition condition)
+    {
+        for (int i = 0; i < 500 && !condition(); i++)
+            std::this_thread::sleep_for(milliseconds(10));
+        return condition();
+    }
+
+    // Phase step of the tone, radians per sample, from unsigned 8 bit IQ
+    double ToneStep(int s, size_t count)
+    {
+        std::vector<uint8_t> bytes(2 * count);
+        REQUIRE_TRUE(Receive(s, bytes.data(), bytes.size()));
+
+        std::complex<double> sum = 0, previous = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            std::complex<double> z(bytes[2 * i] - 128.0, bytes[2 * i + 1] - 128.0);
+            sum += z * std::conj(previous);
+            previous = z;
+        }
+        return std::arg(sum);
+    }
+}
+
+TEST_CASE(StreamServerFixture, ProtocolTest)
+{
+    RadioHandler radio;
+    Open(radio);
+
+    stream_server server(radio);
+    sddc_server_config_t config = LocalConfig();
+    config.max_clients = 1;
+    REQUIRE_EQUAL(server.Start(&config, false), ERR_SUCCESS);
+    REQUIRE_EQUAL(server.Start(&config, false), ERR_SERVER_FAILED);
+    REQUIRE_TRUE(radio.GetPullMode());
+    const uint16_t port = server.GetStats().port;
+    REQUIRE_TRUE(port != 0);
+
+    REQUIRE_EQUAL(radio.Start(true), ERR_SUCCESS);
+
+    int s = Connect(port);
+    uint8_t header[12];
+    REQUIRE_TRUE(Receive(s, header, sizeof(header)));
+    REQUIRE_EQUAL(memcmp(header, "RTL0", 4), 0);
+    REQUIRE_EQUAL((size_t)header[11], radio.GetRFGainSteps().size());
+
+    // The radio is shared: the commands tune it
+    SendCommand(s, stream_server::CMD_SET_FREQUENCY, center);
+    REQUIRE_TRUE(WaitFor([&] { return radio.GetCenterFrequency() == center; }));
+
+    std::vector<uint8_t> samples(1 << 16);
+    REQUIRE_TRUE(Receive(s, samples.data(), samples.size()));
+    REQUIRE_TRUE(std::count(samples.begin(), samples.end(), 128) < (long)samples.size() / 2);
+
+    // One client at most
+    int refused = Connect(port);
+    REQUIRE_FALSE(Receive(refused, header, sizeof(header)));
+    close(refused);
+
+    REQUIRE_TRUE(WaitFor([&] { return server.GetStats().commands == 1; }));
+    sddc_server_stats_t stats = server.GetStats();
+    REQUIRE_EQUAL(stats.clients, 1u);
+    REQUIRE_EQUAL(stats.clients_total, 1u);
+    REQUIRE_EQUAL(stats.clients_refused, 1u);
+    REQUIRE_TRUE(stats.bytes_sent >= samples.size());
+
+    close(s);
+    REQUIRE_TRUE(WaitFor([&] { return server.GetStats().clients == 0; }));
+
+    radio.Stop();
+    server.Stop();
+}
+
+TEST_CASE(StreamServerFixture, DecimationTest)
+{
+    RadioHandler radio;
+    Open(radio);
+    radio.SetCenterFrequency(center);
+
+    stream_server server(radio);
+    sddc_server_config_t config = LocalConfig();
+    config.buffer_ms = 2000;
+    REQUIRE_EQUAL(server.Start(&config, false), ERR_SUCCESS);
+    const uint16_t port = server.GetStats().port;
+    radio.Start(true);
+
+    // 8 Msps, and 2 Msps for the other client
+    int full = Connect(port);
+    int quarter = Connect(port);
+    uint8_t header[12];
+    REQUIRE_TRUE(Receive(full, header, sizeof(header)));
+    REQUIRE_TRUE(Receive(quarter, header, sizeof(header)));
+    SendCommand(quarter, stream_server::CMD_SET_SAMPLE_RATE, 2000000);
+
+    // What the socket buffers held was sent at the full rate
+    std::vector<uint8_t> stale(16 << 20);
+    REQUIRE_TRUE(Receive(quarter, stale.data(), stale.size()));
+
+    const double step = ToneStep(full, 1 << 18);
+    const double quarter_step = ToneStep(quarter, 1 << 16);
+    printf("tone at %.4f rad/sample, %.4f decimated by 4\n", step, quarter_step);
+
+    const double pi = 3.14159265358979323846;
+    REQUIRE_TRUE(fabs(fabs(step) - 2 * pi * 0.2 / 8) < 0.01);
+    REQUIRE_TRUE(fabs(quarter_step - 4 * step) < 0.02);
+
+    close(full);
+    close(quarter);
+    radio.Stop();
+    server.Stop();
+}
+
+TEST_CASE(StreamServerFixture, SlowClientTest)
+{
+    RadioHandler radio;
+    Open(radio);
+
+    stream_server server(radio);
+    sddc_server_config_t config = LocalConfig();
+    config.buffer_ms = 50;
+    REQUIRE_EQUAL(server.Start(&config, false), ERR_SUCCESS);
+    const uint16_t port = server.GetStats().port;
+    radio.Start(true);
+
+    // Both stop reading; the first one skips ahead, the second one is disconnected
+    int skipping = Connect(port);
+    int dropped = Connect(port);
+    SendCommand(dropped, stream_server::CMD_SET_DROP_POLICY, SDDC_DROP_DISCONNECT);
+
+    REQUIRE_TRUE(WaitFor([&] { return server.GetStats().clients_dropped == 1; }));
+    std::vector<uint8_t> data(1 << 20);
+    while (Receive(dropped, data.data(), data.size()))
+        ;
+
+    // The skipped blocks are counted once the client reads again: small reads
+    // which never wait, the deadline is for the whole drain
+    auto deadline = steady_clock::now() + seconds(5);
+    while (server.GetStats().blocks_dropped == 0 && steady_clock::now() < deadline)
+    {
+        if (recv(skipping, data.data(), 64 * 1024, MSG_DONTWAIT) <= 0)
+            std::this_thread::sleep_for(milliseconds(1));
+    }
+    REQUIRE_TRUE(server.GetStats().blocks_dropped > 0);
+
+    sddc_server_stats_t stats = server.GetStats();
+    REQUIRE_EQUAL(stats.clients, 1u);
+    REQUIRE_EQUAL(stats.clients_dropped, 1u);
+
+    close(skipping);
+    close(dropped);
+    radio.Stop();
+    server.Stop();
+}
+#endif
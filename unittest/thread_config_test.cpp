@@ -0,0 +1,59 @@
+#include "thread_config.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <thread>
+#include <string.h>
+#if defined(__linux__)
+#include <pthread.h>
+#endif
+
+namespace {
+    struct ThreadConfigFixture {};
+}
+
+TEST_CASE(ThreadConfigFixture, CpuListTest)
+{
+    uint64_t mask = 0;
+
+    REQUIRE_TRUE(sddc_parse_cpu_list("2", &mask));
+    REQUIRE_EQUAL(mask, 0x4ull);
+
+    REQUIRE_TRUE(sddc_parse_cpu_list("0,4-6,63", &mask));
+    REQUIRE_EQUAL(mask, 0x8000000000000071ull);
+
+    REQUIRE_TRUE(sddc_parse_cpu_list("", &mask));
+    REQUIRE_EQUAL(mask, 0ull);
+
+    REQUIRE_FALSE(sddc_parse_cpu_list("64", &mask));
+    REQUIRE_FALSE(sddc_parse_cpu_list("3-1", &mask));
+    REQUIRE_FALSE(sddc_parse_cpu_list("1;2", &mask));
+}
+
+TEST_CASE(ThreadConfigFixture, ApplyTest)
+{
+    sddc_thread_config_t config = { 0, 0x1 };
+    REQUIRE_TRUE(sddc_thread_config_valid(config));
+
+    config.priority = SDDC_THREAD_MAX_PRIORITY + 1;
+    REQUIRE_FALSE(sddc_thread_config_valid(config));
+
+    // Only the CPUs online
+    config.priority = 0;
+    if (std::thread::hardware_concurrency() < 64)
+    {
+        config.cpu_mask = 1ull << 63;
+        REQUIRE_FALSE(sddc_thread_config_valid(config));
+    }
+    config.cpu_mask = 0x1;
+
+    // Affinity to CPU 0 and a name work without privileges
+    auto thread = std::thread([&]() {
+        REQUIRE_TRUE(sddc_thread_apply(SDDC_THREAD_R2IQ, config));
+#if defined(__linux__)
+        char name[16];
+        pthread_getname_np(pthread_self(), name, sizeof(name));
+        REQUIRE_EQUAL(strcmp(name, "sddc-r2iq"), 0);
+#endif
+    });
+    thread.join();
+}
@@ -0,0 +1,131 @@
+#include "wavewrite.h"
+#include "backend/backend.h"
+#include "FX3Class.h"
+
+#include "CppUnitTestFramework.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define fseeko _fseeki64
+#endif
+
+namespace {
+    struct WaveWriteFixture {};
+
+    const char* wave_path = "wavewrite_test.wav";
+
+    waveFileHeader ReadHeader(const char* path)
+    {
+        waveFileHeader header;
+        memset(&header, 0, sizeof(header));
+        FILE* f = fopen(path, "rb");
+        if (f)
+        {
+            if (fread(&header, sizeof(header), 1, f) != 1)
+                memset(&header, 0, sizeof(header));
+            fclose(f);
+        }
+        return header;
+    }
+
+    bool Replayable(const char* path)
+    {
+        fx3class* backend = CreateFx3Backend((std::string("replay,file=") + path).c_str());
+        bool ok = backend && backend->Open(0);
+        delete backend;
+        return ok;
+    }
+}
+
+TEST_CASE(WaveWriteFixture, RiffTest)
+{
+    std::vector<int16_t> samples(10000);
+    for (size_t i = 0; i < samples.size(); i++)
+        samples[i] = (int16_t)(i * 7);
+
+    FILE* f = fopen(wave_path, "wb");
+    REQUIRE_TRUE(f != nullptr);
+    waveWriter wave = {};
+    waveWriteHeader(&wave, 64000000, 1000000, 16, 1, f);
+    REQUIRE_EQUAL(waveWriteSamples(&wave, f, samples.data(), samples.size(), 0), 0);
+    REQUIRE_EQUAL(waveFinalizeHeader(&wave, f), 0);
+    fclose(f);
+
+    waveFileHeader header = ReadHeader(wave_path);
+    REQUIRE_EQUAL(memcmp(header.r.hdr.ID, "RIFF", 4), 0);
+    REQUIRE_EQUAL(header.r.hdr.size, (uint32_t)(sizeof(waveFileHeader) - 8 + samples.size() * 2));
+    REQUIRE_EQUAL(memcmp(header.j.hdr.ID, "JUNK", 4), 0);
+    REQUIRE_EQUAL(header.f.nBlockAlign, (int16_t)2);
+    REQUIRE_EQUAL(memcmp(header.a.hdr.ID, "auxi", 4), 0);
+    REQUIRE_EQUAL(header.a.centerFreq, 1000000u);
+    REQUIRE_EQUAL(header.d.hdr.size, (uint32_t)(samples.size() * 2));
+
+    REQUIRE_TRUE(Replayable(wave_path));
+    remove(wave_path);
+}
+
+TEST_CASE(WaveWriteFixture, RF64Test)
+{
+    // Past 4 GiB, the file is sparse: only the header and the last samples take room on the disk
+    const uint64_t data_size = 0x100000000ull + 4096;
+    std::vector<int16_t> samples(2048, 0x1234);
+
+    FILE* f = fopen(wave_path, "wb");
+    REQUIRE_TRUE(f != nullptr);
+    waveWriter wave = {};
+    waveWriteHeader(&wave, 128000000, 0, 16, 1, f);
+    REQUIRE_EQUAL(fseeko(f, sizeof(waveFileHeader) + data_size - samples.size() * 2, SEEK_SET), 0);
+    REQUIRE_EQUAL(waveWriteSamples(&wave, f, samples.data(), samples.size(), 0), 0);
+    REQUIRE_EQUAL(waveFinalizeHeader(&wave, f), 0);
+    fclose(f);
+
+    waveFileHeader header = ReadHeader(wave_path);
+    REQUIRE_EQUAL(memcmp(header.r.hdr.ID, "RF64", 4), 0);
+    REQUIRE_EQUAL(header.r.hdr.size, 0xFFFFFFFFu);
+    REQUIRE_EQUAL(memcmp(header.j.hdr.ID, "ds64", 4), 0);
+    REQUIRE_EQUAL(header.j.dataSizeLow, (uint32_t)data_size);
+    REQUIRE_EQUAL(header.j.dataSizeHigh, 1u);
+    REQUIRE_EQUAL(((uint64_t)header.j.sampleCountHigh << 32) | header.j.sampleCountLow, data_size / 2);
+    REQUIRE_EQUAL(((uint64_t)header.j.riffSizeHigh << 32) | header.j.riffSizeLow, sizeof(waveFileHeader) - 8 + data_size);
+    REQUIRE_EQUAL(header.d.hdr.size, 0xFFFFFFFFu);
+    REQUIRE_EQUAL(memcmp(header.a.hdr.ID, "auxi", 4), 0);
+
+    REQUIRE_TRUE(Replayable(wave_path));
+    remove(wave_path);
+}
+
+TEST_CASE(WaveWriteFixture, TwoFilesTest)
+{
+    // Each writer keeps its own header
+    const char* other_path = "wavewrite_test2.wav";
+    std::vector<int16_t> samples(1000, 1);
+
+    FILE* f1 = fopen(wave_path, "wb");
+    FILE* f2 = fopen(other_path, "wb");
+    waveWriter w1 = {}, w2 = {};
+    waveWriteHeader(&w1, 32000000, 100, 16, 1, f1);
+    waveWriteHeader(&w2, 2000000, 200, 16, 2, f2);
+    waveWriteSamples(&w1, f1, samples.data(), 1000, 0);
+    waveWriteFrames(&w2, f2, samples.data(), 250, 0);
+    waveWriteSamples(&w1, f1, samples.data(), 500, 0);
+    REQUIRE_EQUAL(waveFinalizeHeader(&w2, f2), 0);
+    REQUIRE_EQUAL(waveFinalizeHeader(&w1, f1), 0);
+    fclose(f1);
+    fclose(f2);
+
+    waveFileHeader h1 = ReadHeader(wave_path);
+    waveFileHeader h2 = ReadHeader(other_path);
+    REQUIRE_EQUAL(h1.f.nSamplesPerSec, 32000000);
+    REQUIRE_EQUAL(h1.d.hdr.size, 3000u);
+    REQUIRE_EQUAL(h1.a.centerFreq, 100u);
+    REQUIRE_EQUAL(h2.f.nSamplesPerSec, 2000000);
+    REQUIRE_EQUAL(h2.f.nChannels, (int16_t)2);
+    REQUIRE_EQUAL(h2.d.hdr.size, 1000u);
+    REQUIRE_EQUAL(h2.a.centerFreq, 200u);
+
+    remove(wave_path);
+    remove(other_path);
+}